@@ -9,3 +9,6 @@
 #else
 #error "Unsupported implementation."
 #endif
+
+#include "eventrouter/internal/event_pool.c"
+#include "eventrouter/internal/serializer.c"
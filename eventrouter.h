@@ -108,9 +108,19 @@
 /// owning module, it knows that all the subscribers have finished preparations.
 
 #include "eventrouter/internal/event.h"
+#include "eventrouter/internal/event_pool.h"
 #include "eventrouter/internal/module.h"
+#include "eventrouter/internal/serializer.h"
 #include "eventrouter/internal/task_.h"
 
+#ifdef ER_CONFIG_OS
+#include "eventrouter/internal/stats.h"
+#endif
+
+#if ER_IMPLEMENTATION == ER_IMPL_POSIX
+#include "eventrouter/internal/stats_shm.h"
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -120,6 +130,17 @@ extern "C"
     // Functions available in all implementations.
     //============================================================================
 
+#ifdef ER_CONFIG_OS
+    /// Returns the partitioning key of `a_event`, such as a device or session
+    /// ID; see `ErOptions_t::m_key_extractors`.
+    typedef uint32_t (*ErEventKey_t)(const ErEvent_t *a_event);
+
+    /// One instance of the event router, with its own tasks, subscriptions,
+    /// and statistics. The functions below act on a default router unless the
+    /// POSIX implementation was told to use another; see `ErRouterNew()`.
+    typedef struct ErRouter ErRouter_t;
+#endif
+
     /// These parameters define how an instance of the event router behaves. Any
     /// instance of this struct which is passed to a `ErInit_t` function MUST
     /// NOT be modified or freed once passed.
@@ -134,6 +155,36 @@ extern "C"
         /// Returns true if the current execution context is an interrupt
         /// service routine.
         bool (*m_IsInIsr)(void);
+
+        /// Event types that only carry the latest state. When an event of one
+        /// of these types is sent to a task that still has an undelivered
+        /// event of the same type from the same sending module queued, the new
+        /// event takes the queued one's place and the queued one returns to
+        /// its sender without being delivered to that task. Each send scans
+        /// the subscribing tasks' queues, so keep those short. On FreeRTOS,
+        /// where a scan masks interrupts, only sends that find the lane full
+        /// scan it, so undelivered events are replaced only under pressure.
+        const ErEventType_t *m_conflated_types;
+        size_t m_num_conflated_types;
+
+        /// The priority lane of each event type, indexed by `type -
+        /// ER_EVENT_TYPE__FIRST`, in every task's queue; see
+        /// `ER_PRIORITY_LANES`. Higher lanes are received first, and return
+        /// trips travel in the lane of their event. NULL puts every type in
+        /// lane 0; otherwise the array MUST have `ER_EVENT_TYPE__COUNT`
+        /// entries, each below `ER_PRIORITY_LANES`.
+        const uint8_t *m_type_lanes;
+
+        /// The key extractor of each event type, indexed by `type -
+        /// ER_EVENT_TYPE__FIRST`. When a worker group gets an event of a type
+        /// with an extractor, the event goes to the task that owns the
+        /// partition of its key, so events with the same key are handled in
+        /// the order they were sent; see `ErGetKeyPartition()`. If that task
+        /// has no module subscribed to the type, the partition maps onto one
+        /// of the group's subscribed tasks instead, so its keys still stay
+        /// together. NULL, or a NULL entry, leaves types unkeyed;
+        /// notifications are never keyed.
+        const ErEventKey_t *m_key_extractors;
 #endif
     } ErOptions_t;
 
@@ -172,6 +223,21 @@ extern "C"
         /// the task that owns `a_event->m_sending_module` or in an interrupt;
         /// the implementation checks this and will assert if violated.
         bool m_allow_resending;
+
+        /// Skips returning the event to the sending module. Instead, the last
+        /// call to `ErReturnToSender()` releases the event where it runs:
+        /// `m_release` is called (if not NULL) and then pooled events go back
+        /// to their pool (see `ErEventPoolAlloc()`). This saves a queue
+        /// operation and a wakeup of the sending task per event; senders which
+        /// need to know when the event is idle can use `m_release`.
+        ///
+        /// An event sent with no subscribers is released before `ErSendEx()`
+        /// returns, so `m_release` must be safe to call from wherever the
+        /// event is sent, including interrupts. Fire-and-forget events MUST
+        /// NOT be re-sent while in flight, so this cannot be combined with
+        /// `m_allow_resending`.
+        bool m_fire_and_forget;
+        ErEventRelease_t m_release;
     } ErSendExOptions_t;
 
     /// Delivers a copy of `a_event` to all modules which subscribe to this
@@ -216,6 +282,76 @@ extern "C"
     /// NOT be called from an interrupt or a callback.
     void ErUnsubscribe(ErModule_t *a_module, ErEventType_t a_event_type);
 
+    /// Prepares every event in `a_pool` to be sent by `a_module` as an event
+    /// of `a_type` and marks them all free. This MUST be called before any
+    /// other pool function and MUST NOT be called while any of the pool's
+    /// events are allocated.
+    void ErEventPoolInit(ErEventPool_t *a_pool, ErEventType_t a_type,
+                         ErModule_t *a_module);
+
+    /// Returns an idle event from `a_pool`, or NULL if every event in the pool
+    /// is allocated. The caller fills in the surrounding struct (use
+    /// `er_container_of()` to reach it) and sends the event as usual.
+    ///
+    /// Once a pooled event returns to the sending module, the event router
+    /// puts it back in the pool right after the sending module's handler
+    /// returns; the handler MUST NOT hold on to it. If the handler re-sends
+    /// the event instead, it stays allocated until it comes back again.
+    ///
+    /// This function is lock-free and safe to call from any task or interrupt.
+    ErEvent_t *ErEventPoolAlloc(ErEventPool_t *a_pool);
+
+    /// Puts an allocated event back in `a_pool`. Only call this for events
+    /// which were allocated but never sent; sent events are recycled
+    /// automatically. This function is lock-free and safe to call from any
+    /// task or interrupt.
+    void ErEventPoolFree(ErEventPool_t *a_pool, ErEvent_t *a_event);
+
+    /// Registers how events of `a_type` become bytes and back, replacing any
+    /// serializer registered before; NULL unregisters the type. The registry
+    /// is shared by every router and is not synchronized, so register types
+    /// before any thread serializes them.
+    void ErSerializerRegister(ErEventType_t a_type,
+                              const ErSerializer_t *a_serializer);
+
+    /// Returns the serializer registered for `a_type`, or NULL if none is.
+    const ErSerializer_t *ErSerializerGet(ErEventType_t a_type);
+
+    /// Returns the payload of `a_event` where it lies, and sets `*a_size` to
+    /// its size, if its type is registered as plain old data; NULL otherwise.
+    /// This lets callers send payloads without copying them.
+    const void *ErPodPayload(const ErEvent_t *a_event, size_t *a_size);
+
+    /// Writes the payload of `a_event`, whose type MUST be registered, to
+    /// `a_buffer` if it fits in `a_size` bytes. Returns its size either way.
+    size_t ErEncodePayload(const ErEvent_t *a_event, uint8_t *a_buffer,
+                           size_t a_size);
+
+    /// Writes the header of a record for a payload of `a_payload_size` bytes
+    /// to `a_header`, which has room for `ER_RECORD_MAX_HEADER_SIZE`, and
+    /// returns its size. Callers that send the payload separately, as from
+    /// `ErPodPayload()`, send this first.
+    size_t ErWriteRecordHeader(ErEventType_t a_type, size_t a_payload_size,
+                               uint8_t *a_header);
+
+    /// Writes a record of `a_event`, whose type MUST be registered, to
+    /// `a_buffer` if it fits in `a_size` bytes: its type and payload size,
+    /// each a varint, then the payload. Returns the size of the record either
+    /// way. Only the payload is recorded; the event's routing state is not.
+    size_t ErSerialize(const ErEvent_t *a_event, uint8_t *a_buffer,
+                       size_t a_size);
+
+    /// Finds the record at the start of the `a_size` bytes at `a_bytes` and
+    /// describes it in `*a_record`, without copying it.
+    ErParseResult_t ErParseRecord(const uint8_t *a_bytes, size_t a_size,
+                                  ErRecord_t *a_record);
+
+    /// Fills the struct around `a_event`, which MUST be the registered size
+    /// for the record's type, from `a_record`'s payload. Returns false if the
+    /// payload is malformed. The `ErEvent_t` itself is left alone; initialize
+    /// it with `ErEventInit()` before sending it.
+    bool ErDeserialize(const ErRecord_t *a_record, ErEvent_t *a_event);
+
     //============================================================================
     // Implementation-Specific Functions
     //============================================================================
@@ -230,6 +366,491 @@ extern "C"
     /// timeout and asserts if called from an interrupt.
     ErEvent_t *ErTimedReceive(int64_t a_ms);
 
+    /// Sends `a_event` like `ErSend()`, but never waits more than `a_ms` in
+    /// total for room in subscribers' queues. Interrupts never wait. The
+    /// result has bit `i` set for each task `i` in `ErOptions_t::m_tasks` that
+    /// had no room; those tasks never see this send. It is 0 if every
+    /// subscribed task received the event.
+    ///
+    /// If at least one task received the event, it is in flight and returns
+    /// to the sending module once, as usual. If no task received it, the event
+    /// is left idle and the caller still owns it; without subscribers, that
+    /// happens when the sending task's own queue has no room.
+    ///
+    /// This never re-sends; it asserts if `a_event` is in flight. Return trips
+    /// still wait for room in the sending task's queue, so size that queue for
+    /// every event its modules can have in flight.
+    uint32_t ErTimedSend(ErEvent_t *a_event, int64_t a_ms);
+
+    /// Same as `ErTimedSend()` with a timeout of 0; never waits for room.
+    uint32_t ErTrySend(ErEvent_t *a_event);
+
+    /// Tells every module subscribed to `a_type` that something changed,
+    /// without an event. Each task keeps one pending bit per type, so repeated
+    /// notifications of a type coalesce until the task receives it, and a task
+    /// with any pending notifications holds at most one slot in its queue.
+    ///
+    /// `ErReceive()` and `ErTimedReceive()` return pending notifications, in
+    /// type order, before waiting for queued events. They arrive as an event
+    /// of `a_type` whose `m_sending_module` is NULL, which goes to
+    /// `ErCallHandlers()` as usual but never returns anywhere; handlers MUST
+    /// NOT keep it. This function never waits for room in a queue, and is
+    /// safe to call from any task or interrupt.
+    void ErNotify(ErEventType_t a_type);
+
+    /// Posts any events the current task is holding for their senders; see
+    /// `ErTask_t::m_batch_returns`. Tasks only need this if they stop calling
+    /// `ErReceive()` for a while; it does nothing for tasks that don't batch.
+    void ErFlushReturns(void);
+
+#if ER_TASK_STATS
+    /// Copies a consistent snapshot of the statistics for the task at index
+    /// `a_task_idx` in `ErOptions_t::m_tasks` into `a_stats`. It is safe to
+    /// call this from any task; it never blocks the task being measured.
+    void ErGetTaskStats(size_t a_task_idx, ErTaskStats_t *a_stats);
+#endif
+
+#if ER_EVENT_STATS
+    /// Copies the counters for events of `a_type` into `a_stats`. It is safe
+    /// to call this from any task. Counters are updated independently, so a
+    /// snapshot taken while events are moving may be off by a few events.
+    void ErGetEventTypeStats(ErEventType_t a_type, ErEventTypeStats_t *a_stats);
+#endif
+
+    /// Returns the number of events waiting in the queue of the task at index
+    /// `a_task_idx` in `ErOptions_t::m_tasks`.
+    size_t ErGetTaskQueueDepth(size_t a_task_idx);
+
+    /// Returns the number of events the overflow policy of the task at index
+    /// `a_task_idx` has dropped since initialization; see
+    /// `ErTask_t::m_overflow_policy`. It is safe to call this from any task.
+    uint64_t ErGetTaskDropCount(size_t a_task_idx);
+
+    /// Returns the partition that events with the key `a_key` belong to in
+    /// every worker group. The hash only depends on `ER_KEY_PARTITIONS`, so
+    /// it is the same from one run to the next.
+    size_t ErGetKeyPartition(uint32_t a_key);
+
+    /// Returns the index in `ErOptions_t::m_tasks` of the task that owns
+    /// `a_partition` in worker `a_group`. It is safe to call this from any
+    /// task.
+    size_t ErGetPartitionTask(size_t a_group, size_t a_partition);
+
+    /// Spreads the partitions of worker `a_group` evenly over the tasks with
+    /// their bit set in `a_task_mask`, which MUST all be in the group. Tasks
+    /// keep what they can of the partitions they own, so a worker joining or
+    /// leaving moves as few keys as possible. Events of a moved key that are
+    /// still queued for the old task may be handled after newer ones, so move
+    /// keys while they are quiet. `ErInit()` spreads each group's partitions
+    /// over all of its tasks. Only call this from one task at a time.
+    void ErRebalancePartitions(size_t a_group, uint32_t a_task_mask);
+
+#if ER_IMPLEMENTATION == ER_IMPL_POSIX
+    /// Allocates a router that shares nothing with the default one, or any
+    /// other, so that subsystems can route independently of each other. It
+    /// starts out uninitialized; threads call `ErRouterUse()` and then
+    /// `ErInit()` and friends as usual. Returns NULL if out of memory.
+    ErRouter_t *ErRouterNew(void);
+
+    /// Frees a router from `ErRouterNew()`, which MUST be de-initialized and
+    /// in use by no thread.
+    void ErRouterFree(ErRouter_t *a_router);
+
+    /// Makes every later call on this thread act on `a_router`, or on the
+    /// default router if it is NULL, and returns the router it replaced. Each
+    /// task's thread MUST use its router before it receives events, and
+    /// senders before they send. Threads started by the router itself, such as
+    /// those of `ErPoolStart()`, use the router of the thread that started
+    /// them, or of the event they are working on.
+    ErRouter_t *ErRouterUse(ErRouter_t *a_router);
+
+#if ER_SHARDS
+    /// One shard of a thread-per-core topology: a router of its own, usually
+    /// with a single task pinned to a core, and the module in that task that
+    /// carries events to and from the other shards. The module's handler MUST
+    /// be `ErShardHandler()`.
+    typedef struct
+    {
+        ErRouter_t *m_router;  /// NULL for the default router.
+        ErModule_t *m_module;
+    } ErShard_t;
+
+    /// Routers joined by `ErShardsStart()`.
+    typedef struct ErShards ErShards_t;
+
+    /// Joins `a_num_shards` initialized routers into shards. Every ordered pair
+    /// of shards gets a single-producer, single-consumer mailbox with room for
+    /// `a_capacity` sends each way, and each shard's module subscribes to
+    /// `a_mail_type`, which is notified when mail arrives and MUST NOT be sent
+    /// between shards. A router can be in one set of shards at a time, but
+    /// separate sets run side by side. Returns NULL if the mailboxes can't be
+    /// allocated.
+    ErShards_t *ErShardsStart(const ErShard_t *a_shards, size_t a_num_shards,
+                              size_t a_capacity, ErEventType_t a_mail_type);
+
+    /// Sends `a_event`, from a module of the calling shard, to the modules of
+    /// shard `a_shard` that subscribe to its type. That shard's module sends
+    /// it on as its own and returns it when its subscribers are done, and the
+    /// sending module gets it back in its own task as usual. Only the task of
+    /// the calling shard's module may call this, and nothing may look at the
+    /// event until it returns. Returns false, leaving the event idle, if
+    /// `a_capacity` of this shard's events are already in `a_shard`.
+    ///
+    /// Events within a shard never touch another shard's memory; a send to
+    /// another shard writes its mailbox and notifies it, and nothing else.
+    /// Neither waits, however busy the other shard is.
+    bool ErShardSend(size_t a_shard, ErEvent_t *a_event);
+
+    /// The handler of each shard's module; delivers mail from other shards
+    /// and sends their events back when they return.
+    ErEventHandlerRet_t ErShardHandler(ErEvent_t *a_event, void *a_context);
+
+    /// Frees the mailboxes; call this once no events are between shards, and
+    /// before any of the routers are de-initialized.
+    void ErShardsStop(ErShards_t *a_shards);
+#endif
+
+    /// The most processes that can share one bridge object.
+#define ER_SHM_BRIDGE_MAX_PROCESSES (8)
+
+    /// Configures `ErShmBridgeStart()`. Every process attached to an object
+    /// MUST use the same `m_num_slots`, `m_slot_size`, and event types, and be
+    /// built with the same settings that shape `ErEvent_t`.
+    typedef struct
+    {
+        /// The POSIX shared-memory object; the first process creates it and
+        /// the last one to stop unlinks it.
+        const char *m_name;
+        /// This process's index, below `ER_SHM_BRIDGE_MAX_PROCESSES` and
+        /// unique among the processes attached.
+        size_t m_process;
+        /// Two modules of one task, with the handlers `ErShmExportHandler()`
+        /// and `ErShmImportHandler()`; the bridge sets their contexts.
+        ErModule_t *m_exporter;
+        ErModule_t *m_importer;
+        /// The type the importer is notified with when letters arrive; it is
+        /// never bridged.
+        ErEventType_t m_mail_type;
+        /// The size of each type's event struct, indexed by `type -
+        /// ER_EVENT_TYPE__FIRST`, or 0 to keep a type in this process. These
+        /// structs MUST start with `MIXIN_ER_EVENT`, and everything in them is
+        /// copied, so they MUST NOT hold pointers.
+        const size_t *m_event_sizes;
+        /// How many copies this process can have in others at once. Events
+        /// that find no free slot aren't copied; see
+        /// `ErShmBridgeGetDropCount()`. The importer sends every copy that
+        /// has arrived at once, so its task's queue MUST have room for this
+        /// many events from each other process.
+        size_t m_num_slots;
+        /// The largest of `m_event_sizes`.
+        size_t m_slot_size;
+        /// How often subscriptions are exchanged with the other processes.
+        int64_t m_poll_ms;
+    } ErShmBridgeOptions_t;
+
+    typedef struct ErShmBridge ErShmBridge_t;
+
+    /// Attaches the calling thread's router to the shared-memory object in
+    /// `a_options`, so that its modules receive the events of other processes
+    /// attached to it, and theirs receive this one's. Each process publishes
+    /// the types its modules subscribe to, and the others' exporters subscribe
+    /// to them; subscriptions made later are exchanged every `m_poll_ms`, or
+    /// on `ErShmBridgeSync()`. Events are copied into the object once, and the
+    /// importer of each destination delivers them from there; the sender gets
+    /// its event back once every process is done with it. Returns NULL if the
+    /// object or its thread can't be set up, a process with other options or
+    /// settings laid it out, or the index is taken.
+    ErShmBridge_t *ErShmBridgeStart(const ErShmBridgeOptions_t *a_options);
+
+    /// Exchanges subscriptions with the other processes right away; call this
+    /// from the task of the bridge modules.
+    void ErShmBridgeSync(ErShmBridge_t *a_bridge);
+
+    /// The handlers of the bridge modules; see `ErShmBridgeOptions_t`.
+    ErEventHandlerRet_t ErShmExportHandler(ErEvent_t *a_event, void *a_context);
+    ErEventHandlerRet_t ErShmImportHandler(ErEvent_t *a_event, void *a_context);
+
+    /// Returns the number of copies that found no free slot; call this from
+    /// the task of the bridge modules.
+    uint64_t ErShmBridgeGetDropCount(const ErShmBridge_t *a_bridge);
+
+    /// Detaches from the object and frees the bridge. Call this from the task
+    /// of the bridge modules once none of this process's copies are out and
+    /// its modules are done with every copy from the other processes, and
+    /// after the other processes stop sending to it.
+    void ErShmBridgeStop(ErShmBridge_t *a_bridge);
+
+    /// Configures `ErSocketBridgeStart()`. Both peers MUST use the same
+    /// `m_num_slots`, `m_slot_size`, and event types.
+    typedef struct
+    {
+        /// A connected stream socket to the peer, on this host: Unix-domain
+        /// or TCP over loopback. The caller closes it after stopping.
+        int m_socket;
+        /// As in `ErShmBridgeOptions_t`, with the handlers
+        /// `ErSocketExportHandler()` and `ErSocketImportHandler()`.
+        ErModule_t *m_exporter;
+        ErModule_t *m_importer;
+        ErEventType_t m_mail_type;
+        const size_t *m_event_sizes;
+        size_t m_num_slots;
+        size_t m_slot_size;
+        int64_t m_poll_ms;
+    } ErSocketBridgeOptions_t;
+
+    typedef struct ErSocketBridge ErSocketBridge_t;
+
+    /// Connects the calling thread's router to a peer router, in this process
+    /// or another, through `a_options->m_socket`; it works like
+    /// `ErShmBridgeStart()` with one peer. Events travel in batches: a writer
+    /// thread sends every event queued since its last call in one vectored
+    /// send, straight from the events, and a reader thread takes as many as
+    /// the socket holds with each read. Types with an encoder in the
+    /// serializer registry travel encoded, and their encodings MUST fit in
+    /// `m_slot_size`; the rest travel as they are. Once the connection
+    /// breaks, the bridge shuts the socket for sending, events with the peer
+    /// come back to their senders, and later ones count as drops; see
+    /// `ErSocketBridgeIsBroken()`. Returns NULL if the bridge's threads or
+    /// memory can't be set up.
+    ErSocketBridge_t *ErSocketBridgeStart(
+        const ErSocketBridgeOptions_t *a_options);
+
+    /// Exchanges subscriptions with the peer right away; call this from the
+    /// task of the bridge modules.
+    void ErSocketBridgeSync(ErSocketBridge_t *a_bridge);
+
+    /// The handlers of the bridge modules; see `ErSocketBridgeOptions_t`.
+    ErEventHandlerRet_t ErSocketExportHandler(ErEvent_t *a_event,
+                                              void *a_context);
+    ErEventHandlerRet_t ErSocketImportHandler(ErEvent_t *a_event,
+                                              void *a_context);
+
+    /// Returns the number of events that found no free slot; call this from
+    /// the task of the bridge modules.
+    uint64_t ErSocketBridgeGetDropCount(const ErSocketBridge_t *a_bridge);
+
+    /// Returns whether the connection to the peer broke: the peer closed it,
+    /// the socket failed, or the peer sent something malformed. A broken
+    /// bridge stays broken; stop it, and start another on a new connection.
+    /// Safe to call from any task.
+    bool ErSocketBridgeIsBroken(const ErSocketBridge_t *a_bridge);
+
+    /// Stops the bridge's threads and frees it, leaving the socket open. Call
+    /// this from the task of the bridge modules once none of its events are
+    /// with the peer, or once the bridge is broken, and after the peer stops
+    /// sending and this side's modules are done with every event from the
+    /// peer; it can take up to `m_poll_ms`.
+    void ErSocketBridgeStop(ErSocketBridge_t *a_bridge);
+
+    /// Configures `ErDurableLogStart()`.
+    typedef struct
+    {
+        /// An existing directory that holds nothing but the log's segments.
+        const char *m_directory;
+        /// The module that delivers logged events; its handler MUST be
+        /// `ErDurableLogHandler()`, and the log sets its context.
+        ErModule_t *m_module;
+        /// The type the module is notified with when entries are on disk; it
+        /// MUST NOT be one of the logged types.
+        ErEventType_t m_mail_type;
+        /// How many entries can be out at once, and the size of the struct of
+        /// each.
+        size_t m_num_slots;
+        size_t m_slot_size;
+        /// Segments roll over once they hold this many bytes.
+        size_t m_segment_size;
+        /// How many bytes of appends can wait for the disk at once.
+        size_t m_max_pending;
+    } ErDurableLogOptions_t;
+
+    typedef struct ErDurableLog ErDurableLog_t;
+
+    /// Opens the log in `a_options->m_directory` for the calling thread's
+    /// router. Entries are delivered at least once: the log's module sends
+    /// each one, in the order appended, once it is on disk, and acknowledges
+    /// it on disk when it returns from its subscribers. Entries that weren't
+    /// acknowledged when the log last stopped, or its process died, are sent
+    /// again first. Returns NULL if the directory can't be read or written,
+    /// or the log's thread or memory can't be set up.
+    ErDurableLog_t *ErDurableLogStart(const ErDurableLogOptions_t *a_options);
+
+    /// Appends a copy of `a_event`, whose type MUST be in the serializer
+    /// registry, and returns its sequence number; the event itself is free as
+    /// soon as this returns. Appends are written and synced in batches, so
+    /// everything appended while one batch syncs shares the next sync. Returns
+    /// 0 if `m_max_pending` bytes are already waiting, or the log can no
+    /// longer write; see `ErDurableLogGetError()`. Safe to call from any
+    /// task, but not from an interrupt.
+    uint64_t ErDurableAppend(ErDurableLog_t *a_log, const ErEvent_t *a_event);
+
+    /// Returns the sequence number of the last entry that is on disk. Safe to
+    /// call from any task.
+    uint64_t ErDurableLogGetCommitted(const ErDurableLog_t *a_log);
+
+    /// The handler of the log's module; see `ErDurableLogOptions_t`.
+    ErEventHandlerRet_t ErDurableLogHandler(ErEvent_t *a_event,
+                                            void *a_context);
+
+    /// Returns whether every entry on disk has been delivered and come back.
+    /// Safe to call from any task.
+    bool ErDurableLogIsIdle(ErDurableLog_t *a_log);
+
+    /// Returns the `errno` of the write, sync, or allocation that failed the
+    /// log, or 0. A failed log appends nothing more, since entries after a
+    /// lost batch could not be trusted to follow it; stop it and start it
+    /// again, which delivers what reached the disk. Safe to call from any
+    /// task.
+    int ErDurableLogGetError(const ErDurableLog_t *a_log);
+
+    /// Returns the number of entries that couldn't be decoded into a slot,
+    /// which are acknowledged without being sent; call this from the task of
+    /// the log's module.
+    uint64_t ErDurableLogGetSkipCount(const ErDurableLog_t *a_log);
+
+    /// Commits whatever is waiting, stops the log's thread, and frees it. Call
+    /// this from the task of the log's module once none of its entries are
+    /// out.
+    void ErDurableLogStop(ErDurableLog_t *a_log);
+
+#if ER_CAPTURE
+    /// Starts writing every event the calling thread's router sends to the
+    /// file at `a_path`, which is replaced, until `ErCaptureStop()`. Each
+    /// record holds the time of the send, the sender's task and module
+    /// indices, and the event as `ErSerialize()` writes it, so only types in
+    /// the serializer registry are captured. Senders reserve room for their
+    /// records with one atomic add and write them straight into the mapped
+    /// file, whose records take up at most `a_capacity` bytes; events that
+    /// don't fit are dropped. Returns false if the file can't be set up.
+    bool ErCaptureStart(const char *a_path, size_t a_capacity);
+
+    /// Stops the capture of the calling thread's router, once sends already
+    /// writing to it are done, and trims the file to the records it holds.
+    /// Returns the number of events that didn't fit.
+    uint64_t ErCaptureStop(void);
+
+    /// Configures `ErReplayStart()`.
+    typedef struct
+    {
+        /// A file written by `ErCaptureStart()`.
+        const char *m_path;
+        /// The module that sends the events; its handler MUST be
+        /// `ErReplayHandler()`, the replay sets its context, and it MUST NOT
+        /// subscribe to the captured types.
+        ErModule_t *m_module;
+        /// The type the module is notified with when events are due; it MUST
+        /// NOT be one of the captured types.
+        ErEventType_t m_mail_type;
+        /// How many events can be out at once, and the size of the struct of
+        /// each; the replay waits for returns rather than skip events.
+        size_t m_num_slots;
+        size_t m_slot_size;
+        /// How many times faster than they were captured events are sent: 1
+        /// for the original pace, or 0 to send them as fast as they return.
+        uint32_t m_speedup;
+    } ErReplayOptions_t;
+
+    typedef struct ErReplay ErReplay_t;
+
+    /// Plays the capture in `a_options->m_path` back into the calling
+    /// thread's router: a thread keeps time and notifies the module as
+    /// events come due, and the module decodes each one into a free slot with
+    /// `ErDeserialize()` and sends it as its own, in the order captured.
+    /// Records whose types are no longer registered, or don't fit in a slot,
+    /// are skipped. Returns NULL if the file isn't a capture or the replay's
+    /// thread or memory can't be set up.
+    ErReplay_t *ErReplayStart(const ErReplayOptions_t *a_options);
+
+    /// The handler of the replay's module; see `ErReplayOptions_t`.
+    ErEventHandlerRet_t ErReplayHandler(ErEvent_t *a_event, void *a_context);
+
+    /// Returns whether every event has been sent and has come back; call this
+    /// from the task of the replay's module.
+    bool ErReplayIsDone(const ErReplay_t *a_replay);
+
+    /// Returns the number of records that were skipped; call this from the
+    /// task of the replay's module.
+    uint64_t ErReplayGetSkipCount(const ErReplay_t *a_replay);
+
+    /// Stops the replay's thread and frees it. Call this from the task of the
+    /// replay's module once none of its events are out.
+    void ErReplayStop(ErReplay_t *a_replay);
+#endif
+
+    /// Creates (or replaces) the POSIX shared-memory object `a_name` and starts
+    /// a thread that copies router statistics into it every `a_period_ms`. The
+    /// contents are laid out as an `ErStatsShm_t`; other processes can map the
+    /// object read-only and copy it with `ErStatsShmRead()`. Nothing on the
+    /// send or receive path waits for, or calls into, the publisher. Returns
+    /// false if the object could not be created or the thread not started.
+    bool ErStatsShmStart(const char *a_name, int64_t a_period_ms);
+
+    /// Publishes a snapshot immediately, without waiting for the period.
+    void ErStatsShmPublish(void);
+
+    /// Stops the publishing thread and unlinks the shared-memory object. This
+    /// MUST be called before `ErDeinit()` if the publisher was started.
+    void ErStatsShmStop(void);
+
+    /// Runs the modules of the current task as actors on `a_num_workers` new
+    /// threads, so that one task can use several cores. Each module gets a
+    /// mailbox, and idle workers steal modules with mail from busy ones, but
+    /// no module ever handles two events at once or sees them out of order.
+    /// Each router pools at most one task at a time, which MUST NOT batch
+    /// returns; routers of their own (see `ErRouterNew()`) pool one each.
+    /// Returns false if the pool could not be allocated or started.
+    ///
+    /// The task keeps receiving its events, and passes each one to
+    /// `ErPoolDispatch()` instead of `ErCallHandlers()`. Handlers run on the
+    /// workers, which count as the pooled task when they send events.
+    bool ErPoolStart(size_t a_num_workers);
+
+    /// Posts `a_event`, received by the pooled task, to the mailbox of every
+    /// module it is for and drops the task's reference to it.
+    void ErPoolDispatch(ErEvent_t *a_event);
+
+    /// Waits for every mailbox to empty and stops the workers; call this from
+    /// the pooled task, and before `ErDeinit()`. Events that arrive for the
+    /// task afterwards go to `ErCallHandlers()` as usual.
+    void ErPoolStop(void);
+
+    /// Work for `ErOffload()`; runs on a worker thread that belongs to no
+    /// task, so it MUST NOT send events.
+    typedef void (*ErOffloadWork_t)(ErEvent_t *a_event, void *a_context);
+
+    /// Starts the shared pool behind `ErOffload()`, with `a_num_workers`
+    /// threads and room for `a_capacity` waiting work items. Returns false if
+    /// the pool could not be allocated or started.
+    bool ErOffloadStart(size_t a_num_workers, size_t a_capacity);
+
+    /// Keeps `a_event` and runs `a_work(a_event, a_context)` on the pool, then
+    /// returns the event to its sender. This is the KEEP pattern without a
+    /// thread of the module's own, so slow work like compression doesn't hold
+    /// up the other modules of the task. Handlers return the result: the pool
+    /// holds its own reference, so it is `ER_EVENT_HANDLER_RET__HANDLED`. If
+    /// the pool has no room, the calling handler waits for it; see
+    /// `ErOffloadStats_t::m_waits`.
+    ErEventHandlerRet_t ErOffload(ErEvent_t *a_event, ErOffloadWork_t a_work,
+                                  void *a_context);
+
+    /// Copies the pool's counters into `a_stats`; safe to call from anywhere.
+    void ErGetOffloadStats(ErOffloadStats_t *a_stats);
+
+    /// Waits for all work to finish and stops the pool; MUST be called before
+    /// `ErDeinit()` if the pool was started.
+    void ErOffloadStop(void);
+
+    /// Starts `a_num_helpers` threads that deliver events to modules with
+    /// `ErModule_t::m_parallel_safe` set alongside the rest of their task.
+    /// Each task still runs one such module itself, and waits for the helpers
+    /// before the event goes back to its sender, so reference counts and KEPT
+    /// events work as usual. Returns false if the threads can't be started.
+    bool ErFanOutStart(size_t a_num_helpers);
+
+    /// Waits for deliveries in progress and stops the helpers; MUST be called
+    /// before `ErDeinit()` if they were started.
+    void ErFanOutStop(void);
+#endif
+
 #elif ER_IMPLEMENTATION == ER_IMPL_BAREMETAL
     /// Must be called at the beginning of a new event loop.
     void ErNewLoop(void);
@@ -6,7 +6,12 @@
 #ifdef __cplusplus
 #include <atomic>
 using std::atomic_int;
+using std::atomic_uint;
 using std::atomic_flag;
+using std::atomic_load_explicit;
+using std::atomic_thread_fence;
+using std::memory_order_acquire;
+using std::memory_order_relaxed;
 // Add more aliases here if necessary.
 #else
 #include <stdatomic.h>
@@ -0,0 +1,96 @@
+#ifndef EVENTROUTER_BRIDGE_POSIX_H
+#define EVENTROUTER_BRIDGE_POSIX_H
+
+/// @file Definitions shared by the bridges in shm_bridge_posix.c and
+/// socket_bridge_posix.c, which both route events between a router and its
+/// peers through an exporter module and an importer module.
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// NOTE: This header is only included by the bridges, at the end of
+// eventrouter_os.c, and reads the calling thread's `s_router` directly.
+
+//==============================================================================
+// Macros and Defines
+//==============================================================================
+
+/// Slot headers and events start on lines of their own; see
+/// `ER_EVENT_CACHE_LINE_SIZE`.
+#define BRIDGE_LINE ROUTER_ALIGNMENT
+
+/// The bytes in a set of event types with one bit per type.
+#define BRIDGE_TYPE_BYTES ((ER_EVENT_TYPE__COUNT + (CHAR_BIT - 1)) / CHAR_BIT)
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+static bool TestBit(const uint8_t *a_bits, size_t a_bit)
+{
+    return (a_bits[a_bit / CHAR_BIT] & (1u << (a_bit % CHAR_BIT))) != 0;
+}
+
+static size_t RoundUp(size_t a_value, size_t a_multiple)
+{
+    return ((a_value + a_multiple - 1) / a_multiple) * a_multiple;
+}
+
+/// Sets a bit in `a_wants` for each type that a module of the calling
+/// thread's router, other than the bridge modules, is subscribed to.
+static void BridgeLocalWants(const ErModule_t *a_exporter,
+                             const ErModule_t *a_importer, uint8_t *a_wants)
+{
+    memset(a_wants, 0, BRIDGE_TYPE_BYTES);
+    for (size_t task_idx = 0; task_idx < s_router->m_options->m_num_tasks;
+         ++task_idx)
+    {
+        const ErTask_t *task = &s_router->m_options->m_tasks[task_idx];
+        for (size_t idx = 0; idx < task->m_num_modules; ++idx)
+        {
+            ErModule_t *module = task->m_modules[idx];
+            if ((module == a_exporter) || (module == a_importer))
+            {
+                continue;
+            }
+            for (size_t byte = 0; byte < BRIDGE_TYPE_BYTES; ++byte)
+            {
+                a_wants[byte] |= (uint8_t)atomic_load_explicit(
+                    (atomic_char *)&module->m_subscriptions[byte],
+                    memory_order_relaxed);
+            }
+        }
+    }
+}
+
+/// Subscribes `a_exporter` to each type that has a bit set in any of the
+/// `a_count` sets in `a_wanted` and can be bridged, and unsubscribes it from
+/// the rest.
+static void BridgeExport(ErModule_t *a_exporter,
+                         const uint8_t (*a_wanted)[BRIDGE_TYPE_BYTES],
+                         size_t a_count, const size_t *a_event_sizes,
+                         ErEventType_t a_mail_type)
+{
+    for (size_t bit = 0; bit < ER_EVENT_TYPE__COUNT; ++bit)
+    {
+        const ErEventType_t type = (ErEventType_t)(ER_EVENT_TYPE__FIRST + bit);
+        bool wanted              = false;
+        for (size_t idx = 0; idx < a_count; ++idx)
+        {
+            wanted = wanted || TestBit(a_wanted[idx], bit);
+        }
+        wanted = wanted && (a_event_sizes[bit] != 0) && (type != a_mail_type);
+        if (wanted)
+        {
+            ErSubscribe(a_exporter, type);
+        }
+        else
+        {
+            ErUnsubscribe(a_exporter, type);
+        }
+    }
+}
+
+#endif /* EVENTROUTER_BRIDGE_POSIX_H */
@@ -0,0 +1,474 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// NOTE: This file is included at the end of eventrouter_os.c, after
+// shm_bridge_posix.c, and reads the calling thread's `s_router` directly; it
+// is not compiled on its own.
+
+/// @file Captures and replays the events a router sends. A capture file is a
+/// header followed by entries, each a `CaptureEntry_t` and the record that
+/// `ErSerialize()` writes for the event, padded to `CAPTURE_ALIGNMENT`.
+/// Senders reserve an entry with one atomic add and fill it in place; the
+/// size is written last, so a replay of a file whose capture never stopped
+/// ends at the first entry that wasn't finished.
+
+//==============================================================================
+// Macros and Defines
+//==============================================================================
+
+#define CAPTURE_MAGIC   (0x50435245u) /* "ERCP" as little-endian bytes. */
+#define CAPTURE_VERSION (1u)
+
+/// Where the entries start, and what each is padded to.
+#define CAPTURE_ENTRIES_OFFSET (64)
+#define CAPTURE_ALIGNMENT      (8)
+
+/// The longest the replay thread sleeps before checking whether it should
+/// stop.
+#define CAPTURE_REPLAY_NAP_US (10000)
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+typedef struct
+{
+    uint32_t m_magic;
+    uint32_t m_version;
+    /// The bytes of entries, set when the capture stops; 0 if it never did.
+    uint64_t m_length;
+} CaptureHeader_t;
+
+typedef struct
+{
+    /// The size of the record that follows; written last, so 0 ends the
+    /// capture.
+    _Atomic uint32_t m_size;
+    uint16_t m_task_idx;
+    uint16_t m_module_idx;
+    /// When the event was sent, since the capture started.
+    int64_t m_time_us;
+} CaptureEntry_t;
+
+typedef struct ErCapture
+{
+    int m_fd;
+    uint8_t *m_mapping;
+    size_t m_capacity;  //< Bytes of entries the file has room for.
+    int64_t m_start_us;
+    atomic_size_t m_tail;  //< Where the next entry goes; can pass the end.
+    atomic_ullong m_drops;
+} ErCapture_t;
+
+struct ErReplay
+{
+    ErReplayOptions_t m_options;
+    ErRouter_t *m_router;
+    void *m_mapping;
+    size_t m_mapping_size;
+    const uint8_t *m_entries;
+    size_t m_length;  //< Bytes of entries.
+    size_t m_slot_stride;
+    pthread_t m_thread;
+    bool m_thread_started;
+    atomic_bool m_running;
+    /// How many entries are due, counted by the thread, and whether it has
+    /// counted them all.
+    atomic_size_t m_due;
+    atomic_bool m_all_due;
+
+    // Private to the task of the replay's module.
+    size_t m_cursor;  //< The offset of the next entry.
+    size_t m_replayed;  //< Entries sent or skipped.
+    uint64_t m_skips;
+    uint8_t *m_slots;
+    uint32_t *m_free_slots;  //< A stack of free slots.
+    size_t m_num_free_slots;
+};
+
+//==============================================================================
+// Static Variables
+//==============================================================================
+
+// `ErCaptureStop()` sleeps on these until the last send writing to its capture
+// is done. They only carry the wakeup; each router counts its own writers.
+static pthread_mutex_t s_capture_mutex  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_capture_drained = PTHREAD_COND_INITIALIZER;
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+/// Returns the entry at `*a_offset` of the `a_length` bytes of entries at
+/// `a_entries` and moves the offset past it, or NULL if there are no more.
+static const CaptureEntry_t *CaptureNextEntry(const uint8_t *a_entries,
+                                              size_t a_length,
+                                              size_t *a_offset)
+{
+    if ((*a_offset > a_length) ||
+        ((a_length - *a_offset) < sizeof(CaptureEntry_t)))
+    {
+        return NULL;
+    }
+    const CaptureEntry_t *entry =
+        (const CaptureEntry_t *)(a_entries + *a_offset);
+    const size_t size =
+        atomic_load_explicit(&entry->m_size, memory_order_acquire);
+    if ((size == 0) ||
+        (size > ((a_length - *a_offset) - sizeof(CaptureEntry_t))))
+    {
+        return NULL;
+    }
+    *a_offset += RoundUp(sizeof(CaptureEntry_t) + size, CAPTURE_ALIGNMENT);
+    return entry;
+}
+
+static void CaptureWrite(ErCapture_t *a_capture, const ErEvent_t *a_event)
+{
+    if (ErSerializerGet(a_event->m_type) == NULL)
+    {
+        return;
+    }
+
+    const size_t size = ErSerialize(a_event, NULL, 0);
+    const size_t stride =
+        RoundUp(sizeof(CaptureEntry_t) + size, CAPTURE_ALIGNMENT);
+    const size_t offset = atomic_fetch_add_explicit(&a_capture->m_tail, stride,
+                                                    memory_order_relaxed);
+    if ((offset > a_capture->m_capacity) ||
+        (stride > (a_capture->m_capacity - offset)) || (size > UINT32_MAX))
+    {
+        atomic_fetch_add_explicit(&a_capture->m_drops, 1,
+                                  memory_order_relaxed);
+        return;
+    }
+
+    CaptureEntry_t *entry = (CaptureEntry_t *)(a_capture->m_mapping +
+                                               CAPTURE_ENTRIES_OFFSET + offset);
+    entry->m_task_idx   = (uint16_t)a_event->m_sending_module->m_task_idx;
+    entry->m_module_idx = (uint16_t)a_event->m_sending_module->m_module_idx;
+    entry->m_time_us =
+        s_router->m_os_functions.GetTimeUs() - a_capture->m_start_us;
+    ErSerialize(a_event, (uint8_t *)(entry + 1), size);
+    atomic_store_explicit(&entry->m_size, (uint32_t)size,
+                          memory_order_release);
+}
+
+static void CaptureOnSend(const ErEvent_t *a_event)
+{
+    if (atomic_load_explicit(&s_router->m_capture, memory_order_relaxed) ==
+        NULL)
+    {
+        return;
+    }
+
+    // `ErCaptureStop()` clears the capture before it waits for writers, so
+    // whoever counts themselves in and still finds the capture can use it.
+    atomic_fetch_add(&s_router->m_capture_writers, 1);
+    ErCapture_t *capture = atomic_load(&s_router->m_capture);
+    if (capture != NULL)
+    {
+        CaptureWrite(capture, a_event);
+    }
+
+    // Either the last writer sees the flag, or the stop sees no writers.
+    if ((atomic_fetch_sub(&s_router->m_capture_writers, 1) == 1) &&
+        atomic_load(&s_router->m_capture_stopping))
+    {
+        pthread_mutex_lock(&s_capture_mutex);
+        pthread_cond_broadcast(&s_capture_drained);
+        pthread_mutex_unlock(&s_capture_mutex);
+    }
+}
+
+/// Counts entries as they come due, at the pace they were captured divided by
+/// `m_speedup`, and notifies the replay's module.
+static void *ReplayThread(void *a_replay)
+{
+    ErReplay_t *replay = a_replay;
+    s_router           = replay->m_router;
+
+    const int64_t start_us = s_router->m_os_functions.GetTimeUs();
+    const uint32_t speedup = replay->m_options.m_speedup;
+    size_t offset          = 0;
+    size_t count           = 0;
+    const CaptureEntry_t *entry;
+    while (atomic_load(&replay->m_running) &&
+           ((entry = CaptureNextEntry(replay->m_entries, replay->m_length,
+                                      &offset)) != NULL))
+    {
+        const int64_t due_us =
+            (speedup == 0) ? start_us
+                           : start_us + (entry->m_time_us / speedup);
+        int64_t now_us = s_router->m_os_functions.GetTimeUs();
+        if (now_us < due_us)
+        {
+            // Hand over everything due so far before sleeping.
+            atomic_store_explicit(&replay->m_due, count,
+                                  memory_order_release);
+            ErNotify(replay->m_options.m_mail_type);
+        }
+        while ((now_us < due_us) && atomic_load(&replay->m_running))
+        {
+            const int64_t nap_us = due_us - now_us;
+            usleep((nap_us < CAPTURE_REPLAY_NAP_US) ? nap_us
+                                                    : CAPTURE_REPLAY_NAP_US);
+            now_us = s_router->m_os_functions.GetTimeUs();
+        }
+        count += 1;
+    }
+
+    atomic_store_explicit(&replay->m_due, count, memory_order_release);
+    atomic_store_explicit(&replay->m_all_due, true, memory_order_release);
+    ErNotify(replay->m_options.m_mail_type);
+    return NULL;
+}
+
+/// Sends entries that are due while slots are free.
+static void ReplaySendDue(ErReplay_t *a_replay)
+{
+    const size_t due =
+        atomic_load_explicit(&a_replay->m_due, memory_order_acquire);
+    while ((a_replay->m_replayed < due) && (a_replay->m_num_free_slots > 0))
+    {
+        const CaptureEntry_t *entry = CaptureNextEntry(
+            a_replay->m_entries, a_replay->m_length, &a_replay->m_cursor);
+        ER_ASSERT(entry != NULL);
+        a_replay->m_replayed += 1;
+
+        ErRecord_t record;
+        const ErParseResult_t result = ErParseRecord(
+            (const uint8_t *)(entry + 1), entry->m_size, &record);
+        if ((result != ER_PARSE_RESULT__OK) ||
+            (ErSerializerGet(record.m_type)->m_size >
+             a_replay->m_options.m_slot_size))
+        {
+            a_replay->m_skips += 1;
+            continue;
+        }
+
+        const uint32_t slot =
+            a_replay->m_free_slots[a_replay->m_num_free_slots - 1];
+        ErEvent_t *event = (ErEvent_t *)(a_replay->m_slots +
+                                         (slot * a_replay->m_slot_stride));
+        memset(event, 0, a_replay->m_options.m_slot_size);
+        ErEventInit(event, record.m_type, a_replay->m_options.m_module);
+        if (!ErDeserialize(&record, event))
+        {
+            a_replay->m_skips += 1;
+            continue;
+        }
+        a_replay->m_num_free_slots -= 1;
+        ErSend(event);
+    }
+}
+
+/// Frees everything `ErReplayStart()` set up.
+static void ReplayFree(ErReplay_t *a_replay)
+{
+    if (a_replay->m_mapping != NULL)
+    {
+        munmap(a_replay->m_mapping, a_replay->m_mapping_size);
+    }
+    free(a_replay->m_slots);
+    free(a_replay->m_free_slots);
+    free(a_replay);
+}
+
+//==============================================================================
+// API Functions
+//==============================================================================
+
+bool ErCaptureStart(const char *a_path, size_t a_capacity)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_path != NULL);
+    ER_ASSERT(atomic_load(&s_router->m_capture) == NULL);
+
+    ErCapture_t *capture = calloc(1, sizeof(ErCapture_t));
+    if (capture == NULL)
+    {
+        return false;
+    }
+    capture->m_capacity = RoundUp(a_capacity, CAPTURE_ALIGNMENT);
+    capture->m_fd =
+        open(a_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    const size_t size = CAPTURE_ENTRIES_OFFSET + capture->m_capacity;
+    void *mapping =
+        ((capture->m_fd >= 0) && (ftruncate(capture->m_fd, size) == 0))
+            ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   capture->m_fd, 0)
+            : MAP_FAILED;
+    if (mapping == MAP_FAILED)
+    {
+        if (capture->m_fd >= 0)
+        {
+            close(capture->m_fd);
+        }
+        free(capture);
+        return false;
+    }
+
+    CaptureHeader_t *header = mapping;
+    header->m_magic         = CAPTURE_MAGIC;
+    header->m_version       = CAPTURE_VERSION;
+    capture->m_mapping      = mapping;
+    capture->m_start_us     = s_router->m_os_functions.GetTimeUs();
+    atomic_store(&s_router->m_capture, capture);
+    return true;
+}
+
+uint64_t ErCaptureStop(void)
+{
+    pthread_mutex_lock(&s_capture_mutex);
+    atomic_store(&s_router->m_capture_stopping, true);
+    ErCapture_t *capture = atomic_exchange(&s_router->m_capture, NULL);
+    ER_ASSERT(capture != NULL);
+    while (atomic_load(&s_router->m_capture_writers) != 0)
+    {
+        pthread_cond_wait(&s_capture_drained, &s_capture_mutex);
+    }
+    atomic_store(&s_router->m_capture_stopping, false);
+    pthread_mutex_unlock(&s_capture_mutex);
+
+    const size_t tail   = atomic_load(&capture->m_tail);
+    const size_t length = (tail < capture->m_capacity) ? tail
+                                                       : capture->m_capacity;
+    ((CaptureHeader_t *)capture->m_mapping)->m_length = length;
+    munmap(capture->m_mapping, CAPTURE_ENTRIES_OFFSET + capture->m_capacity);
+    // Trim the room that was never used; replays stop at `m_length` anyway.
+    const bool trimmed =
+        (ftruncate(capture->m_fd, CAPTURE_ENTRIES_OFFSET + length) == 0);
+    ER_UNUSED(trimmed);
+    close(capture->m_fd);
+
+    const uint64_t drops = atomic_load(&capture->m_drops);
+    free(capture);
+    return drops;
+}
+
+ErReplay_t *ErReplayStart(const ErReplayOptions_t *a_options)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_options != NULL);
+    ER_ASSERT(a_options->m_path != NULL);
+    ER_ASSERT(a_options->m_module->m_handler == ErReplayHandler);
+    ER_ASSERT(IsModuleOwned(a_options->m_module));
+    ER_ASSERT(a_options->m_num_slots > 0);
+    ER_ASSERT(a_options->m_num_slots <= UINT32_MAX);
+    ER_ASSERT(a_options->m_slot_size >= sizeof(ErEvent_t));
+
+    ErReplay_t *replay = calloc(1, sizeof(ErReplay_t));
+    if (replay == NULL)
+    {
+        return NULL;
+    }
+    const size_t num_slots = a_options->m_num_slots;
+    replay->m_options      = *a_options;
+    replay->m_router       = s_router;
+    replay->m_slot_stride =
+        RoundUp(a_options->m_slot_size, _Alignof(max_align_t));
+    replay->m_slots =
+        aligned_alloc(_Alignof(max_align_t), num_slots * replay->m_slot_stride);
+    replay->m_free_slots = calloc(num_slots, sizeof(uint32_t));
+
+    const int fd = open(a_options->m_path, O_RDONLY | O_CLOEXEC);
+    struct stat stat;
+    if ((fd >= 0) && (fstat(fd, &stat) == 0) &&
+        ((size_t)stat.st_size >= CAPTURE_ENTRIES_OFFSET))
+    {
+        replay->m_mapping_size = stat.st_size;
+        replay->m_mapping = mmap(NULL, replay->m_mapping_size, PROT_READ,
+                                 MAP_SHARED, fd, 0);
+        if (replay->m_mapping == MAP_FAILED)
+        {
+            replay->m_mapping = NULL;
+        }
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    const CaptureHeader_t *header = replay->m_mapping;
+    if ((header == NULL) || (header->m_magic != CAPTURE_MAGIC) ||
+        (header->m_version != CAPTURE_VERSION) || (replay->m_slots == NULL) ||
+        (replay->m_free_slots == NULL))
+    {
+        ReplayFree(replay);
+        return NULL;
+    }
+    replay->m_entries = (const uint8_t *)header + CAPTURE_ENTRIES_OFFSET;
+    replay->m_length  = replay->m_mapping_size - CAPTURE_ENTRIES_OFFSET;
+    if ((header->m_length != 0) && (header->m_length < replay->m_length))
+    {
+        replay->m_length = header->m_length;
+    }
+    for (size_t idx = 0; idx < num_slots; ++idx)
+    {
+        replay->m_free_slots[idx] = num_slots - 1 - idx;
+    }
+    replay->m_num_free_slots = num_slots;
+
+    a_options->m_module->m_context = replay;
+    ErSubscribe(a_options->m_module, a_options->m_mail_type);
+    atomic_store(&replay->m_running, true);
+    replay->m_thread_started = (pthread_create(&replay->m_thread, NULL,
+                                               ReplayThread, replay) == 0);
+    if (!replay->m_thread_started)
+    {
+        ErUnsubscribe(a_options->m_module, a_options->m_mail_type);
+        ReplayFree(replay);
+        return NULL;
+    }
+    return replay;
+}
+
+ErEventHandlerRet_t ErReplayHandler(ErEvent_t *a_event, void *a_context)
+{
+    ErReplay_t *replay = a_context;
+
+    if (a_event->m_sending_module == replay->m_options.m_module)
+    {
+        // One of the replay's events is back.
+        const size_t slot =
+            ((uint8_t *)a_event - replay->m_slots) / replay->m_slot_stride;
+        replay->m_free_slots[replay->m_num_free_slots] = (uint32_t)slot;
+        replay->m_num_free_slots += 1;
+    }
+    ReplaySendDue(replay);
+    return ER_EVENT_HANDLER_RET__HANDLED;
+}
+
+bool ErReplayIsDone(const ErReplay_t *a_replay)
+{
+    ER_ASSERT(a_replay != NULL);
+    // The count is final once the thread says so.
+    return atomic_load_explicit(&a_replay->m_all_due, memory_order_acquire) &&
+           (a_replay->m_replayed == atomic_load(&a_replay->m_due)) &&
+           (a_replay->m_num_free_slots == a_replay->m_options.m_num_slots);
+}
+
+uint64_t ErReplayGetSkipCount(const ErReplay_t *a_replay)
+{
+    ER_ASSERT(a_replay != NULL);
+    return a_replay->m_skips;
+}
+
+void ErReplayStop(ErReplay_t *a_replay)
+{
+    ER_ASSERT(a_replay != NULL);
+    ER_ASSERT(a_replay->m_num_free_slots == a_replay->m_options.m_num_slots);
+
+    atomic_store(&a_replay->m_running, false);
+    if (a_replay->m_thread_started)
+    {
+        pthread_join(a_replay->m_thread, NULL);
+    }
+    ErUnsubscribe(a_replay->m_options.m_module,
+                  a_replay->m_options.m_mail_type);
+    ReplayFree(a_replay);
+}
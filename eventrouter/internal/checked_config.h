@@ -35,6 +35,21 @@
 #endif
 #endif
 
+/// Marks the places in OS-backed implementations where another task could run
+/// between two steps of the reference-count protocol. The interleaving tests
+/// build the router with `ER_INTERLEAVING_HARNESS` set, which makes every point
+/// a place to switch tasks; otherwise the points expand to nothing.
+#if defined(ER_INTERLEAVING_HARNESS) && ER_INTERLEAVING_HARNESS
+#ifdef __cplusplus
+extern "C" void ErInterleavingPoint(void);
+#else
+void ErInterleavingPoint(void);
+#endif
+#define ER_INTERLEAVING_POINT() ErInterleavingPoint()
+#else
+#define ER_INTERLEAVING_POINT()
+#endif
+
 //==============================================================================
 // Implementation Selection
 //==============================================================================
@@ -128,4 +143,120 @@
 #define ER_EVENT_MEMBER m_event
 #endif
 
+//==============================================================================
+// Optional Features
+//==============================================================================
+
+/// When non-zero, OS-backed implementations measure how long each task spends
+/// handling events versus waiting for them in `ErReceive()` and
+/// `ErTimedReceive()`, and how often a task finds more work waiting when it
+/// comes back for the next event. Read the results with `ErGetTaskStats()`.
+/// This costs two timestamps and one queue-depth query per receive.
+#ifndef ER_TASK_STATS
+#define ER_TASK_STATS 0
+#endif
+
+/// The length of the window, in milliseconds, over which `ErGetTaskStats()`
+/// reports rolling utilization and saturation.
+#ifndef ER_TASK_STATS_WINDOW_MS
+#define ER_TASK_STATS_WINDOW_MS 1000
+#endif
+
+/// When non-zero, OS-backed implementations count sends per event type and
+/// record how long events of each type take to come back to their sender in a
+/// histogram; read the results with `ErGetEventTypeStats()`. This adds a
+/// timestamp to every `ErEvent_t` and a few relaxed atomic increments to every
+/// send and return.
+#ifndef ER_EVENT_STATS
+#define ER_EVENT_STATS 0
+#endif
+
+/// The number of buckets in each latency histogram. Bucket 0 counts latencies
+/// under 1us, bucket `i` counts latencies in [2^(i-1), 2^i) microseconds, and
+/// the last bucket also counts everything longer.
+#ifndef ER_LATENCY_BUCKET_COUNT
+#define ER_LATENCY_BUCKET_COUNT 24
+#endif
+
+/// When non-zero, OS-backed tasks which set `ErTask_t::m_batch_returns` hold
+/// up to this many events bound back to their senders and post them in
+/// batches, one push (and one wakeup) per sending task, instead of one push per
+/// event. Held events go out when the buffer fills, when the task is about to
+/// block in `ErReceive()` or `ErTimedReceive()` with nothing left to handle,
+/// after the task has received this many more events, or when the task calls
+/// `ErFlushReturns()`.
+#ifndef ER_RETURN_BATCH_SIZE
+#define ER_RETURN_BATCH_SIZE 0
+#endif
+
+/// When non-zero, `ErEvent_t` starts its reference count on a cache line of
+/// this many bytes, apart from the payload. Every task an event visits writes
+/// the count, and without padding those writes also evict the payload that
+/// subscribers in other cores are reading. Set this to the target's cache line
+/// size (a power of two) on multi-core hosts with wide fan-out; it grows every
+/// event by up to two cache lines. Events allocated on the heap must then come
+/// from an aligned allocator such as `aligned_alloc()`.
+#ifndef ER_EVENT_CACHE_LINE_SIZE
+#define ER_EVENT_CACHE_LINE_SIZE 0
+#endif
+#if (ER_EVENT_CACHE_LINE_SIZE & (ER_EVENT_CACHE_LINE_SIZE - 1)) != 0
+#error "ER_EVENT_CACHE_LINE_SIZE must be zero or a power of two."
+#endif
+
+/// The number of priority lanes in each OS-backed task queue. Event types are
+/// assigned to lanes with `ErOptions_t::m_type_lanes`, each lane holds up to
+/// the queue's capacity on its own, and tasks always receive from the highest
+/// non-empty lane, so a backlog in a low lane neither delays nor blocks sends
+/// to a higher one. With FreeRTOS each extra lane costs a queue and the task
+/// waits on a queue set.
+#ifndef ER_PRIORITY_LANES
+#define ER_PRIORITY_LANES 1
+#endif
+#if (ER_PRIORITY_LANES < 1) || (ER_PRIORITY_LANES > 32)
+#error "ER_PRIORITY_LANES must be between 1 and 32."
+#endif
+
+/// The number of partitions keyed events are hashed into within each worker
+/// group; see `ErOptions_t::m_key_extractors`. Partitions are the unit of
+/// rebalancing, so use several per worker. Each group's partition map costs
+/// this many bytes.
+#ifndef ER_KEY_PARTITIONS
+#define ER_KEY_PARTITIONS 16
+#endif
+#if (ER_KEY_PARTITIONS < 1) || (ER_KEY_PARTITIONS > 256)
+#error "ER_KEY_PARTITIONS must be between 1 and 256."
+#endif
+
+/// NOTE: Only supported in the POSIX implementation.
+///
+/// When non-zero, every lane of every queue gets a ring of its own for each of
+/// up to this-many writing threads at a time, and one ring shared by all other
+/// writers. A thread's ring goes to the next new writer once the thread exits.
+/// Writers to their own ring don't lock anything, and tasks read the rings of
+/// a lane in turn, so one busy producer no longer starves the rest or contends
+/// with them for the queue's lock. Each ring holds up to the queue's capacity,
+/// every queue MUST have a single reader, and displaced events are always
+/// replaced in place; see `ErQueueDisplace()`.
+#ifndef ER_PRODUCER_RINGS
+#define ER_PRODUCER_RINGS 0
+#endif
+
+/// NOTE: Only supported in the POSIX implementation.
+///
+/// When non-zero, routers can be joined into shards that send events to each
+/// other with `ErShardSend()`. Every event grows by a pointer, which holds its
+/// sending module while it visits another shard.
+#ifndef ER_SHARDS
+#define ER_SHARDS 0
+#endif
+
+/// NOTE: Only supported in the POSIX implementation.
+///
+/// When non-zero, `ErCaptureStart()` can record every event a router sends to
+/// a file that `ErReplayStart()` plays back later. Sends pay for one relaxed
+/// load while nothing is being captured.
+#ifndef ER_CAPTURE
+#define ER_CAPTURE 0
+#endif
+
 #endif /* EVENTROUTER_CHECKED_CONFIG_H */
@@ -0,0 +1,813 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// NOTE: This file is included at the end of eventrouter_os.c, after
+// shm_bridge_posix.c, and reads the calling thread's `s_router` directly; it
+// is not compiled on its own.
+
+/// @file A log of events that outlives the process. `ErDurableAppend()` adds
+/// an entry, the event as `ErSerialize()` writes it, to a batch in memory, and
+/// a writer thread puts each batch in the current segment with one `write()`
+/// and one `fdatasync()`: whatever is appended during a sync shares the next
+/// one. Once a batch is on disk the log's module sends its entries, and each
+/// one that comes back gets an acknowledgement record in a later batch.
+///
+/// Starting a log reads its segments and delivers every entry without an
+/// acknowledgement again. Acknowledgements are always in their entry's segment
+/// or a later one, so segments are deleted oldest first, once nothing in them
+/// waits for one, and the rest keep everything they need.
+
+//==============================================================================
+// Macros and Defines
+//==============================================================================
+
+/// Segments are named after the first sequence number they can hold, padded
+/// so that names sort like numbers.
+#define DURABLE_SEGMENT_NAME        "%020" PRIu64 ".log"
+#define DURABLE_SEGMENT_NAME_LENGTH (24)
+
+#define DURABLE_FNV_OFFSET (2166136261u)
+#define DURABLE_FNV_PRIME  (16777619u)
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+typedef enum
+{
+    /// An event, appended under `m_sequence`.
+    DURABLE_RECORD__ENTRY = 1,
+    /// The entry `m_sequence` came back from its subscribers.
+    DURABLE_RECORD__ACK,
+} DurableRecordKind_t;
+
+/// Precedes every record, in the host's byte order. Records aren't padded, so
+/// headers are copied in and out.
+typedef struct
+{
+    uint32_t m_checksum;  //< FNV-1a of the rest of the header and the body.
+    uint32_t m_kind;
+    uint64_t m_sequence;
+    uint64_t m_size;  //< Bytes of body that follow.
+} DurableHeader_t;
+
+typedef struct
+{
+    uint64_t m_first_sequence;  //< Also its name.
+    size_t m_unacknowledged;
+} DurableSegment_t;
+
+typedef struct
+{
+    uint8_t *m_bytes;
+    size_t m_size;
+    size_t m_capacity;
+} DurableBuffer_t;
+
+struct ErDurableLog
+{
+    ErDurableLogOptions_t m_options;
+    ErRouter_t *m_router;
+    int m_directory_fd;
+    pthread_t m_writer;
+    atomic_ullong m_committed_sequence;  //< The last entry on disk.
+    atomic_int m_error;  //< Why the writer stopped writing, or 0.
+
+    // Private to the writer once it starts.
+    int m_segment_fd;
+    size_t m_segment_bytes;
+    DurableSegment_t *m_segments;  //< Oldest first.
+    size_t m_num_segments;
+    size_t m_segments_capacity;
+    uint64_t m_last_sequence;  //< The last entry written.
+    DurableBuffer_t m_writing;
+
+    // Private to the task of the log's module.
+    DurableBuffer_t m_backlog;  //< Committed records left to deliver.
+    size_t m_backlog_cursor;
+    uint8_t *m_slots;
+    size_t m_slot_stride;
+    uint64_t *m_slot_sequences;  //< The entry in each slot.
+    uint32_t *m_free_slots;      //< A stack of free slots.
+    size_t m_num_free_slots;
+    uint64_t m_skips;
+
+    pthread_mutex_t m_mutex;  //< Guards everything below.
+    pthread_cond_t m_work;    //< Wakes the writer.
+    bool m_running;
+    /// Whether the module's task had nothing left to deliver and no entries
+    /// out when it last looked; see `DurableDeliver()`.
+    bool m_delivered;
+    uint64_t m_next_sequence;
+    DurableBuffer_t m_pending;    //< Records waiting for the writer.
+    DurableBuffer_t m_committed;  //< Records on disk, for the module.
+};
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+static uint32_t DurableChecksum(const DurableHeader_t *a_header,
+                                const uint8_t *a_body)
+{
+    const uint8_t *bytes = (const uint8_t *)a_header;
+    uint32_t hash        = DURABLE_FNV_OFFSET;
+    for (size_t idx = sizeof(a_header->m_checksum); idx < sizeof(*a_header);
+         ++idx)
+    {
+        hash = (hash ^ bytes[idx]) * DURABLE_FNV_PRIME;
+    }
+    for (size_t idx = 0; idx < a_header->m_size; ++idx)
+    {
+        hash = (hash ^ a_body[idx]) * DURABLE_FNV_PRIME;
+    }
+    return hash;
+}
+
+/// Makes room for `a_size` more bytes in `a_buffer`.
+static bool DurableReserve(DurableBuffer_t *a_buffer, size_t a_size)
+{
+    if (a_size <= (a_buffer->m_capacity - a_buffer->m_size))
+    {
+        return true;
+    }
+    size_t capacity = (a_buffer->m_capacity > 0) ? a_buffer->m_capacity : 256;
+    while (capacity < (a_buffer->m_size + a_size))
+    {
+        capacity *= 2;
+    }
+    uint8_t *bytes = realloc(a_buffer->m_bytes, capacity);
+    if (bytes == NULL)
+    {
+        return false;
+    }
+    a_buffer->m_bytes    = bytes;
+    a_buffer->m_capacity = capacity;
+    return true;
+}
+
+/// Appends a record to `a_buffer`. Entries hold `a_event`, whose encoding is
+/// `a_size` bytes long; acknowledgements have no body.
+static bool DurablePush(DurableBuffer_t *a_buffer, DurableRecordKind_t a_kind,
+                        uint64_t a_sequence, const ErEvent_t *a_event,
+                        size_t a_size)
+{
+    if (!DurableReserve(a_buffer, sizeof(DurableHeader_t) + a_size))
+    {
+        return false;
+    }
+    uint8_t *record = a_buffer->m_bytes + a_buffer->m_size;
+    uint8_t *body   = record + sizeof(DurableHeader_t);
+    if (a_event != NULL)
+    {
+        ErSerialize(a_event, body, a_size);
+    }
+    DurableHeader_t header = {
+        .m_kind     = a_kind,
+        .m_sequence = a_sequence,
+        .m_size     = a_size,
+    };
+    header.m_checksum = DurableChecksum(&header, body);
+    memcpy(record, &header, sizeof(header));
+    a_buffer->m_size += sizeof(header) + a_size;
+    return true;
+}
+
+/// Reads the record at `*a_offset` of the `a_size` bytes at `a_bytes` into
+/// `a_header`, moves the offset past it, and returns its body; NULL if no
+/// whole, intact record is left.
+static const uint8_t *DurableNextRecord(const uint8_t *a_bytes, size_t a_size,
+                                        size_t *a_offset,
+                                        DurableHeader_t *a_header)
+{
+    if ((a_size - *a_offset) < sizeof(DurableHeader_t))
+    {
+        return NULL;
+    }
+    memcpy(a_header, a_bytes + *a_offset, sizeof(*a_header));
+    const uint8_t *body = a_bytes + *a_offset + sizeof(*a_header);
+    if ((a_header->m_size > (a_size - *a_offset - sizeof(*a_header))) ||
+        (a_header->m_checksum != DurableChecksum(a_header, body)))
+    {
+        return NULL;
+    }
+    *a_offset += sizeof(*a_header) + a_header->m_size;
+    return body;
+}
+
+static bool DurableWriteAll(int a_fd, const uint8_t *a_bytes, size_t a_size)
+{
+    while (a_size > 0)
+    {
+        const ssize_t written = write(a_fd, a_bytes, a_size);
+        if ((written < 0) && (errno != EINTR))
+        {
+            return false;
+        }
+        if (written > 0)
+        {
+            a_bytes += written;
+            a_size  -= written;
+        }
+    }
+    return true;
+}
+
+static void DurableSegmentName(uint64_t a_first_sequence,
+                               char (*a_name)[DURABLE_SEGMENT_NAME_LENGTH + 1])
+{
+    snprintf(*a_name, sizeof(*a_name), DURABLE_SEGMENT_NAME, a_first_sequence);
+}
+
+/// Adds a segment to the end of the list.
+static bool DurableAddSegment(ErDurableLog_t *a_log, uint64_t a_first_sequence)
+{
+    if (a_log->m_num_segments == a_log->m_segments_capacity)
+    {
+        const size_t capacity = (a_log->m_segments_capacity > 0)
+                                    ? 2 * a_log->m_segments_capacity
+                                    : 8;
+        DurableSegment_t *segments =
+            realloc(a_log->m_segments, capacity * sizeof(DurableSegment_t));
+        if (segments == NULL)
+        {
+            return false;
+        }
+        a_log->m_segments          = segments;
+        a_log->m_segments_capacity = capacity;
+    }
+    a_log->m_segments[a_log->m_num_segments] = (DurableSegment_t){
+        .m_first_sequence = a_first_sequence,
+        .m_unacknowledged = 0,
+    };
+    a_log->m_num_segments += 1;
+    return true;
+}
+
+/// Starts a new segment for the writer. The directory is synced too, or the
+/// segment itself could vanish in a crash.
+static bool DurableOpenSegment(ErDurableLog_t *a_log,
+                               uint64_t a_first_sequence)
+{
+    char name[DURABLE_SEGMENT_NAME_LENGTH + 1];
+    DurableSegmentName(a_first_sequence, &name);
+    const int fd = openat(a_log->m_directory_fd, name,
+                          O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if ((fd < 0) || (fsync(a_log->m_directory_fd) != 0) ||
+        !DurableAddSegment(a_log, a_first_sequence))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+    if (a_log->m_segment_fd >= 0)
+    {
+        close(a_log->m_segment_fd);
+    }
+    a_log->m_segment_fd    = fd;
+    a_log->m_segment_bytes = 0;
+    return true;
+}
+
+/// Deletes the oldest segments while nothing in them waits for an
+/// acknowledgement, always keeping the one being written.
+static void DurableTrimSegments(ErDurableLog_t *a_log)
+{
+    size_t count = 0;
+    while (((count + 1) < a_log->m_num_segments) &&
+           (a_log->m_segments[count].m_unacknowledged == 0))
+    {
+        char name[DURABLE_SEGMENT_NAME_LENGTH + 1];
+        DurableSegmentName(a_log->m_segments[count].m_first_sequence, &name);
+        unlinkat(a_log->m_directory_fd, name, 0);
+        count += 1;
+    }
+    a_log->m_num_segments -= count;
+    memmove(a_log->m_segments, a_log->m_segments + count,
+            a_log->m_num_segments * sizeof(DurableSegment_t));
+}
+
+/// Returns the segment that holds the entry `a_sequence`, or NULL if it is
+/// gone.
+static DurableSegment_t *DurableFindSegment(ErDurableLog_t *a_log,
+                                            uint64_t a_sequence)
+{
+    for (size_t idx = a_log->m_num_segments; idx > 0; --idx)
+    {
+        if (a_log->m_segments[idx - 1].m_first_sequence <= a_sequence)
+        {
+            return &a_log->m_segments[idx - 1];
+        }
+    }
+    return NULL;
+}
+
+/// Counts the records of `a_buffer` against their segments.
+static void DurableCount(ErDurableLog_t *a_log, const DurableBuffer_t *a_buffer)
+{
+    size_t offset = 0;
+    DurableHeader_t header;
+    while (DurableNextRecord(a_buffer->m_bytes, a_buffer->m_size, &offset,
+                             &header) != NULL)
+    {
+        DurableSegment_t *segment =
+            DurableFindSegment(a_log, header.m_sequence);
+        if (header.m_kind == DURABLE_RECORD__ENTRY)
+        {
+            a_log->m_segments[a_log->m_num_segments - 1].m_unacknowledged += 1;
+            a_log->m_last_sequence = header.m_sequence;
+        }
+        else if ((segment != NULL) && (segment->m_unacknowledged > 0))
+        {
+            segment->m_unacknowledged -= 1;
+        }
+    }
+}
+
+/// Reads the whole segment `a_first_sequence` into `a_buffer`.
+static bool DurableReadSegment(const ErDurableLog_t *a_log,
+                               uint64_t a_first_sequence,
+                               DurableBuffer_t *a_buffer)
+{
+    char name[DURABLE_SEGMENT_NAME_LENGTH + 1];
+    DurableSegmentName(a_first_sequence, &name);
+    const int fd = openat(a_log->m_directory_fd, name, O_RDONLY | O_CLOEXEC);
+    struct stat stat;
+    bool read_all = (fd >= 0) && (fstat(fd, &stat) == 0) &&
+                    DurableReserve(a_buffer, stat.st_size);
+    a_buffer->m_size = 0;
+    while (read_all && (a_buffer->m_size < (size_t)stat.st_size))
+    {
+        const ssize_t got = read(fd, a_buffer->m_bytes + a_buffer->m_size,
+                                 stat.st_size - a_buffer->m_size);
+        read_all          = (got > 0) || ((got < 0) && (errno == EINTR));
+        a_buffer->m_size += (got > 0) ? got : 0;
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return read_all;
+}
+
+static int DurableCompareSequences(const void *a_lhs, const void *a_rhs)
+{
+    const uint64_t lhs = *(const uint64_t *)a_lhs;
+    const uint64_t rhs = *(const uint64_t *)a_rhs;
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static int DurableCompareSegments(const void *a_lhs, const void *a_rhs)
+{
+    return DurableCompareSequences(
+        &((const DurableSegment_t *)a_lhs)->m_first_sequence,
+        &((const DurableSegment_t *)a_rhs)->m_first_sequence);
+}
+
+/// Finds the log's segments, queues their unacknowledged entries for the
+/// module, and picks up the sequence where they left off. Each segment is
+/// read twice, once for its acknowledgements and once for its entries, so
+/// that only one is in memory at a time.
+static bool DurableRecover(ErDurableLog_t *a_log)
+{
+    const int fd = dup(a_log->m_directory_fd);
+    DIR *directory = (fd >= 0) ? fdopendir(fd) : NULL;
+    if (directory == NULL)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+    bool ok = true;
+    for (struct dirent *file = readdir(directory); ok && (file != NULL);
+         file                = readdir(directory))
+    {
+        char *end;
+        const uint64_t first = strtoull(file->d_name, &end, 10);
+        if ((strlen(file->d_name) == DURABLE_SEGMENT_NAME_LENGTH) &&
+            (strcmp(end, ".log") == 0))
+        {
+            ok = DurableAddSegment(a_log, first);
+        }
+    }
+    closedir(directory);
+    qsort(a_log->m_segments, a_log->m_num_segments, sizeof(DurableSegment_t),
+          DurableCompareSegments);
+
+    DurableBuffer_t segment = {0};
+    uint64_t *acks          = NULL;
+    size_t num_acks         = 0;
+    size_t acks_capacity    = 0;
+    uint64_t last           = 0;
+    for (size_t idx = 0; ok && (idx < a_log->m_num_segments); ++idx)
+    {
+        ok = DurableReadSegment(a_log, a_log->m_segments[idx].m_first_sequence,
+                                &segment);
+        size_t offset = 0;
+        DurableHeader_t header;
+        while (ok && (DurableNextRecord(segment.m_bytes, segment.m_size,
+                                        &offset, &header) != NULL))
+        {
+            if (header.m_kind == DURABLE_RECORD__ENTRY)
+            {
+                last = (header.m_sequence > last) ? header.m_sequence : last;
+                continue;
+            }
+            if (num_acks == acks_capacity)
+            {
+                acks_capacity = (acks_capacity > 0) ? 2 * acks_capacity : 256;
+                uint64_t *grown =
+                    realloc(acks, acks_capacity * sizeof(uint64_t));
+                ok   = (grown != NULL);
+                acks = ok ? grown : acks;
+            }
+            if (ok)
+            {
+                acks[num_acks++] = header.m_sequence;
+            }
+        }
+    }
+    qsort(acks, num_acks, sizeof(uint64_t), DurableCompareSequences);
+
+    for (size_t idx = 0; ok && (idx < a_log->m_num_segments); ++idx)
+    {
+        ok = DurableReadSegment(a_log, a_log->m_segments[idx].m_first_sequence,
+                                &segment);
+        size_t offset = 0;
+        DurableHeader_t header;
+        const uint8_t *body;
+        while (ok && ((body = DurableNextRecord(segment.m_bytes,
+                                                segment.m_size, &offset,
+                                                &header)) != NULL))
+        {
+            if ((header.m_kind != DURABLE_RECORD__ENTRY) ||
+                (bsearch(&header.m_sequence, acks, num_acks, sizeof(uint64_t),
+                         DurableCompareSequences) != NULL))
+            {
+                continue;
+            }
+            const size_t size = sizeof(header) + header.m_size;
+            ok = DurableReserve(&a_log->m_committed, size);
+            if (ok)
+            {
+                memcpy(a_log->m_committed.m_bytes + a_log->m_committed.m_size,
+                       body - sizeof(header), size);
+                a_log->m_committed.m_size               += size;
+                a_log->m_segments[idx].m_unacknowledged += 1;
+            }
+        }
+    }
+    free(segment.m_bytes);
+    free(acks);
+
+    // Sequence numbers are never reused, even those of segments that only
+    // hold acknowledgements.
+    if (a_log->m_num_segments > 0)
+    {
+        const uint64_t first =
+            a_log->m_segments[a_log->m_num_segments - 1].m_first_sequence;
+        last = (first > last) ? first : last;
+    }
+    a_log->m_last_sequence = last;
+    a_log->m_next_sequence = last + 1;
+    atomic_store(&a_log->m_committed_sequence, last);
+    return ok;
+}
+
+/// Writes and syncs each batch of records, and hands it to the module.
+static void *DurableLogWriter(void *a_log)
+{
+    ErDurableLog_t *log = a_log;
+    s_router            = log->m_router;
+
+    pthread_mutex_lock(&log->m_mutex);
+    for (;;)
+    {
+        while (log->m_running && (log->m_pending.m_size == 0))
+        {
+            pthread_cond_wait(&log->m_work, &log->m_mutex);
+        }
+        if (log->m_pending.m_size == 0)
+        {
+            break;
+        }
+        const DurableBuffer_t batch = log->m_pending;
+        log->m_pending              = log->m_writing;
+        log->m_writing              = batch;
+        pthread_mutex_unlock(&log->m_mutex);
+
+        errno        = 0;
+        bool written = (atomic_load(&log->m_error) == 0) &&
+                       DurableWriteAll(log->m_segment_fd, batch.m_bytes,
+                                       batch.m_size) &&
+                       (fdatasync(log->m_segment_fd) == 0);
+        if (written)
+        {
+            DurableCount(log, &batch);
+            DurableTrimSegments(log);
+            log->m_segment_bytes += batch.m_size;
+            if ((log->m_segment_bytes >= log->m_options.m_segment_size) &&
+                (log->m_last_sequence >=
+                 log->m_segments[log->m_num_segments - 1].m_first_sequence))
+            {
+                written = DurableOpenSegment(log, log->m_last_sequence + 1);
+            }
+        }
+
+        const int error = (errno != 0) ? errno : EIO;
+        pthread_mutex_lock(&log->m_mutex);
+        const bool committed =
+            written && DurableReserve(&log->m_committed, batch.m_size);
+        if (committed)
+        {
+            memcpy(log->m_committed.m_bytes + log->m_committed.m_size,
+                   batch.m_bytes, batch.m_size);
+            log->m_committed.m_size += batch.m_size;
+            atomic_store(&log->m_committed_sequence, log->m_last_sequence);
+        }
+        else if (atomic_load(&log->m_error) == 0)
+        {
+            // Nothing after a lost batch can be trusted to follow it.
+            atomic_store(&log->m_error, written ? ENOMEM : error);
+        }
+        log->m_writing.m_size = 0;
+
+        // The module's task takes the mutex to deliver, so it is notified
+        // only once the mutex is free.
+        pthread_mutex_unlock(&log->m_mutex);
+        if (committed)
+        {
+            ErNotify(log->m_options.m_mail_type);
+        }
+        pthread_mutex_lock(&log->m_mutex);
+    }
+    pthread_mutex_unlock(&log->m_mutex);
+    return NULL;
+}
+
+/// Queues an acknowledgement of the entry `a_sequence`. Without room for it,
+/// the entry is delivered again after a restart.
+static void DurableAcknowledge(ErDurableLog_t *a_log, uint64_t a_sequence)
+{
+    pthread_mutex_lock(&a_log->m_mutex);
+    if (DurablePush(&a_log->m_pending, DURABLE_RECORD__ACK, a_sequence, NULL,
+                    0))
+    {
+        pthread_cond_signal(&a_log->m_work);
+    }
+    pthread_mutex_unlock(&a_log->m_mutex);
+}
+
+/// Sends committed entries while slots are free, and publishes whether
+/// anything is left for `ErDurableLogIsIdle()`.
+static void DurableDeliver(ErDurableLog_t *a_log)
+{
+    while (a_log->m_num_free_slots > 0)
+    {
+        if (a_log->m_backlog_cursor == a_log->m_backlog.m_size)
+        {
+            a_log->m_backlog.m_size = 0;
+            a_log->m_backlog_cursor = 0;
+            pthread_mutex_lock(&a_log->m_mutex);
+            const DurableBuffer_t committed = a_log->m_committed;
+            a_log->m_committed              = a_log->m_backlog;
+            a_log->m_backlog                = committed;
+            a_log->m_delivered              = false;
+            pthread_mutex_unlock(&a_log->m_mutex);
+            if (a_log->m_backlog.m_size == 0)
+            {
+                break;
+            }
+        }
+
+        DurableHeader_t header;
+        const uint8_t *body =
+            DurableNextRecord(a_log->m_backlog.m_bytes, a_log->m_backlog.m_size,
+                              &a_log->m_backlog_cursor, &header);
+        ER_ASSERT(body != NULL);
+        if (header.m_kind != DURABLE_RECORD__ENTRY)
+        {
+            continue;
+        }
+
+        const uint32_t slot = a_log->m_free_slots[a_log->m_num_free_slots - 1];
+        ErEvent_t *event =
+            (ErEvent_t *)(a_log->m_slots + (slot * a_log->m_slot_stride));
+        ErRecord_t record;
+        bool decoded =
+            (ErParseRecord(body, header.m_size, &record) ==
+             ER_PARSE_RESULT__OK) &&
+            (ErSerializerGet(record.m_type)->m_size <=
+             a_log->m_options.m_slot_size);
+        if (decoded)
+        {
+            memset(event, 0, a_log->m_options.m_slot_size);
+            ErEventInit(event, record.m_type, a_log->m_options.m_module);
+            decoded = ErDeserialize(&record, event);
+        }
+        if (!decoded)
+        {
+            // It would fail the same way after every restart.
+            a_log->m_skips += 1;
+            DurableAcknowledge(a_log, header.m_sequence);
+            continue;
+        }
+        a_log->m_num_free_slots       -= 1;
+        a_log->m_slot_sequences[slot]  = header.m_sequence;
+        ErSend(event);
+    }
+
+    const bool delivered =
+        (a_log->m_backlog_cursor == a_log->m_backlog.m_size) &&
+        (a_log->m_num_free_slots == a_log->m_options.m_num_slots);
+    pthread_mutex_lock(&a_log->m_mutex);
+    a_log->m_delivered = delivered;
+    pthread_mutex_unlock(&a_log->m_mutex);
+}
+
+/// Frees everything `ErDurableLogStart()` set up.
+static void DurableLogFree(ErDurableLog_t *a_log)
+{
+    if (a_log->m_segment_fd >= 0)
+    {
+        close(a_log->m_segment_fd);
+    }
+    if (a_log->m_directory_fd >= 0)
+    {
+        close(a_log->m_directory_fd);
+    }
+    pthread_mutex_destroy(&a_log->m_mutex);
+    pthread_cond_destroy(&a_log->m_work);
+    free(a_log->m_segments);
+    free(a_log->m_writing.m_bytes);
+    free(a_log->m_backlog.m_bytes);
+    free(a_log->m_pending.m_bytes);
+    free(a_log->m_committed.m_bytes);
+    free(a_log->m_slots);
+    free(a_log->m_slot_sequences);
+    free(a_log->m_free_slots);
+    free(a_log);
+}
+
+//==============================================================================
+// API Functions
+//==============================================================================
+
+ErDurableLog_t *ErDurableLogStart(const ErDurableLogOptions_t *a_options)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_options != NULL);
+    ER_ASSERT(a_options->m_directory != NULL);
+    ER_ASSERT(a_options->m_module->m_handler == ErDurableLogHandler);
+    ER_ASSERT(IsModuleOwned(a_options->m_module));
+    ER_ASSERT(a_options->m_num_slots > 0);
+    ER_ASSERT(a_options->m_num_slots <= UINT32_MAX);
+    ER_ASSERT(a_options->m_slot_size >= sizeof(ErEvent_t));
+    ER_ASSERT(a_options->m_segment_size > 0);
+    ER_ASSERT(a_options->m_max_pending > 0);
+
+    ErDurableLog_t *log = calloc(1, sizeof(ErDurableLog_t));
+    if (log == NULL)
+    {
+        return NULL;
+    }
+    const size_t num_slots = a_options->m_num_slots;
+    log->m_options         = *a_options;
+    log->m_router          = s_router;
+    log->m_segment_fd      = -1;
+    log->m_directory_fd =
+        open(a_options->m_directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    pthread_mutex_init(&log->m_mutex, NULL);
+    pthread_cond_init(&log->m_work, NULL);
+    log->m_slot_stride =
+        RoundUp(a_options->m_slot_size, _Alignof(max_align_t));
+    log->m_slots =
+        aligned_alloc(_Alignof(max_align_t), num_slots * log->m_slot_stride);
+    log->m_slot_sequences = calloc(num_slots, sizeof(uint64_t));
+    log->m_free_slots     = calloc(num_slots, sizeof(uint32_t));
+    if ((log->m_directory_fd < 0) || (log->m_slots == NULL) ||
+        (log->m_slot_sequences == NULL) || (log->m_free_slots == NULL) ||
+        !DurableRecover(log) ||
+        !DurableOpenSegment(log, log->m_next_sequence))
+    {
+        DurableLogFree(log);
+        return NULL;
+    }
+    DurableTrimSegments(log);
+    for (size_t idx = 0; idx < num_slots; ++idx)
+    {
+        log->m_free_slots[idx] = num_slots - 1 - idx;
+    }
+    log->m_num_free_slots = num_slots;
+    log->m_delivered      = true;
+
+    a_options->m_module->m_context = log;
+    ErSubscribe(a_options->m_module, a_options->m_mail_type);
+    log->m_running = true;
+    if (pthread_create(&log->m_writer, NULL, DurableLogWriter, log) != 0)
+    {
+        ErUnsubscribe(a_options->m_module, a_options->m_mail_type);
+        DurableLogFree(log);
+        return NULL;
+    }
+    if (log->m_committed.m_size > 0)
+    {
+        ErNotify(a_options->m_mail_type);
+    }
+    return log;
+}
+
+uint64_t ErDurableAppend(ErDurableLog_t *a_log, const ErEvent_t *a_event)
+{
+    ER_ASSERT(a_log != NULL);
+    ER_ASSERT(a_event != NULL);
+    ER_ASSERT(ErSerializerGet(a_event->m_type) != NULL);
+
+    const size_t size = ErSerialize(a_event, NULL, 0);
+    uint64_t sequence = 0;
+    pthread_mutex_lock(&a_log->m_mutex);
+    // Acknowledgements are never refused, so they can take the pending bytes
+    // past the limit.
+    if ((atomic_load(&a_log->m_error) == 0) &&
+        ((a_log->m_pending.m_size + sizeof(DurableHeader_t) + size) <=
+         a_log->m_options.m_max_pending) &&
+        DurablePush(&a_log->m_pending, DURABLE_RECORD__ENTRY,
+                    a_log->m_next_sequence, a_event, size))
+    {
+        sequence                = a_log->m_next_sequence;
+        a_log->m_next_sequence += 1;
+        pthread_cond_signal(&a_log->m_work);
+    }
+    pthread_mutex_unlock(&a_log->m_mutex);
+    return sequence;
+}
+
+uint64_t ErDurableLogGetCommitted(const ErDurableLog_t *a_log)
+{
+    ER_ASSERT(a_log != NULL);
+    return atomic_load(&a_log->m_committed_sequence);
+}
+
+ErEventHandlerRet_t ErDurableLogHandler(ErEvent_t *a_event, void *a_context)
+{
+    ErDurableLog_t *log = a_context;
+
+    if (a_event->m_sending_module == log->m_options.m_module)
+    {
+        // One of the log's entries is back from its subscribers.
+        const size_t slot =
+            ((uint8_t *)a_event - log->m_slots) / log->m_slot_stride;
+        DurableAcknowledge(log, log->m_slot_sequences[slot]);
+        log->m_free_slots[log->m_num_free_slots] = (uint32_t)slot;
+        log->m_num_free_slots += 1;
+    }
+    DurableDeliver(log);
+    return ER_EVENT_HANDLER_RET__HANDLED;
+}
+
+bool ErDurableLogIsIdle(ErDurableLog_t *a_log)
+{
+    ER_ASSERT(a_log != NULL);
+    pthread_mutex_lock(&a_log->m_mutex);
+    const bool idle = (a_log->m_committed.m_size == 0) && a_log->m_delivered;
+    pthread_mutex_unlock(&a_log->m_mutex);
+    return idle;
+}
+
+int ErDurableLogGetError(const ErDurableLog_t *a_log)
+{
+    ER_ASSERT(a_log != NULL);
+    return atomic_load(&a_log->m_error);
+}
+
+uint64_t ErDurableLogGetSkipCount(const ErDurableLog_t *a_log)
+{
+    ER_ASSERT(a_log != NULL);
+    return a_log->m_skips;
+}
+
+void ErDurableLogStop(ErDurableLog_t *a_log)
+{
+    ER_ASSERT(a_log != NULL);
+    ER_ASSERT(a_log->m_num_free_slots == a_log->m_options.m_num_slots);
+
+    // The writer commits whatever is pending before it exits.
+    pthread_mutex_lock(&a_log->m_mutex);
+    a_log->m_running = false;
+    pthread_cond_signal(&a_log->m_work);
+    pthread_mutex_unlock(&a_log->m_mutex);
+    pthread_join(a_log->m_writer, NULL);
+
+    ErUnsubscribe(a_log->m_options.m_module, a_log->m_options.m_mail_type);
+    DurableLogFree(a_log);
+}
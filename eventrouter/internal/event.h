@@ -2,6 +2,7 @@
 #define EVENTROUTER_EVENT_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "atomic.h"
 #include "defs.h"
@@ -17,6 +18,22 @@ extern "C"
 {
 #endif
 
+    /// Starts a new cache line at the field it precedes when
+    /// `ER_EVENT_CACHE_LINE_SIZE` is set.
+#if ER_EVENT_CACHE_LINE_SIZE == 0
+#define ER_EVENT_CACHE_ALIGNED
+#elif defined(__cplusplus)
+#define ER_EVENT_CACHE_ALIGNED alignas(ER_EVENT_CACHE_LINE_SIZE)
+#else
+#define ER_EVENT_CACHE_ALIGNED _Alignas(ER_EVENT_CACHE_LINE_SIZE)
+#endif
+
+    struct ErEvent_t;
+
+    /// Called when the last subscriber is done with an event that was sent
+    /// without a return trip; see `ErSendExOptions_t::m_fire_and_forget`.
+    typedef void (*ErEventRelease_t)(struct ErEvent_t *a_event);
+
     /// Contains the fields the Event Router needs to route events and manage
     /// subscriptions. New event structures must contain an `ErEvent_t` member
     /// whose name matches the expansion of `ER_EVENT_MEMBER`. This is most
@@ -24,10 +41,41 @@ extern "C"
     typedef struct ErEvent_t
     {
         ErEventType_t m_type;
-        atomic_int m_reference_count;
+        /// Every task that finishes with the event writes this field. With
+        /// `ER_EVENT_CACHE_LINE_SIZE` set it starts a new line, which it
+        /// shares only with the routing fields below, and the struct rounds up
+        /// to whole lines so that the payload after `MIXIN_ER_EVENT` starts on
+        /// a line the count never touches. Every event then spans at least two
+        /// lines, which only pays for itself when subscribers on several cores
+        /// read the same event at once.
+        ER_EVENT_CACHE_ALIGNED atomic_int m_reference_count;
         ErModule_t *m_sending_module;
+        /// The pool this event came from, or NULL; see `ErEventPool_t`.
+        struct ErEventPool_t *m_pool;
+        /// Set from `ErSendExOptions_t` each time the event goes from idle to
+        /// in flight.
+        bool m_fire_and_forget;
+#ifdef ER_CONFIG_OS
+        /// The queue lane the event travels in; set from
+        /// `ErOptions_t::m_type_lanes` along with `m_fire_and_forget`.
+        uint8_t m_lane;
+#endif
+        ErEventRelease_t m_release;
+#ifdef ER_CONFIG_OS
+        /// Links events whose return trip found their sending task's queue
+        /// full; see `ReturnWithoutWaiting()`.
+        struct ErEvent_t *m_next_parked;
+#endif
 #if ER_IMPLEMENTATION == ER_IMPL_BAREMETAL
         ErList_t m_next;
+#endif
+#if defined(ER_CONFIG_OS) && ER_EVENT_STATS
+        int64_t m_send_time_us;  /// When the event last went from idle to sent.
+#endif
+#if (ER_IMPLEMENTATION == ER_IMPL_POSIX) && ER_SHARDS
+        /// The sending module in the shard the event came from, while another
+        /// shard delivers it; see `ErShardSend()`.
+        ErModule_t *m_remote_sender;
 #endif
     } ErEvent_t;
 
@@ -35,7 +83,8 @@ extern "C"
     /// subscribers or returned to the sending module.
     static inline bool ErEventIsInFlight(const ErEvent_t *a_event)
     {
-        return atomic_load(&a_event->m_reference_count) != 0;
+        return atomic_load_explicit(&a_event->m_reference_count,
+                                    memory_order_acquire) != 0;
     }
 
     /// Initializes an `ErEvent_t` struct.
@@ -45,6 +94,12 @@ extern "C"
         a_event->m_type            = a_type;
         a_event->m_reference_count = 0;
         a_event->m_sending_module  = a_module;
+        a_event->m_pool            = NULL;
+        a_event->m_fire_and_forget = false;
+        a_event->m_release         = NULL;
+#ifdef ER_CONFIG_OS
+        a_event->m_lane = 0;
+#endif
 #if ER_IMPLEMENTATION == ER_IMPL_BAREMETAL
         a_event->m_next.m_next = NULL;
 #endif
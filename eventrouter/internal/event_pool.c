@@ -0,0 +1,109 @@
+#include "event_pool.h"
+
+#include "checked_config.h"
+
+// NOTE: This file is included by eventrouter.c and shared by every
+// implementation; it only depends on C11 atomics.
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+static inline unsigned HeadIndex(unsigned a_head)
+{
+    return a_head & 0xFFFFu;
+}
+
+static inline unsigned NextHead(unsigned a_head, unsigned a_index)
+{
+    return ((a_head + 0x10000u) & 0xFFFF0000u) | a_index;
+}
+
+static ErEvent_t *SlotEvent(ErEventPool_t *a_pool, size_t a_idx)
+{
+    char *slot = (char *)a_pool->m_slots + (a_idx * a_pool->m_slot_size);
+    return (ErEvent_t *)(slot + a_pool->m_event_offset);
+}
+
+static size_t EventSlot(ErEventPool_t *a_pool, ErEvent_t *a_event)
+{
+    const char *slot    = (const char *)a_event - a_pool->m_event_offset;
+    const size_t offset = (size_t)(slot - (const char *)a_pool->m_slots);
+    ER_ASSERT((offset % a_pool->m_slot_size) == 0);
+    ER_ASSERT((offset / a_pool->m_slot_size) < a_pool->m_num_slots);
+    return offset / a_pool->m_slot_size;
+}
+
+//==============================================================================
+// API Functions
+//==============================================================================
+
+void ErEventPoolInit(ErEventPool_t *a_pool, ErEventType_t a_type,
+                     ErModule_t *a_module)
+{
+    ER_ASSERT(a_pool != NULL);
+    ER_ASSERT(a_module != NULL);
+    ER_ASSERT(a_pool->m_num_slots > 0);
+    ER_ASSERT(a_pool->m_num_slots <= ER_EVENT_POOL_MAX_SLOTS);
+
+    // Thread every slot onto the free list in order so the first allocation
+    // returns the first slot.
+    for (size_t idx = 0; idx < a_pool->m_num_slots; ++idx)
+    {
+        ErEvent_t *event = SlotEvent(a_pool, idx);
+        ErEventInit(event, a_type, a_module);
+        event->m_pool = a_pool;
+
+        const size_t next = idx + 1;
+        atomic_store_explicit(
+            &a_pool->m_next[idx],
+            (next < a_pool->m_num_slots) ? next : ER_EVENT_POOL_NO_SLOT,
+            memory_order_relaxed);
+    }
+    atomic_store_explicit(&a_pool->m_head, 0, memory_order_release);
+}
+
+ErEvent_t *ErEventPoolAlloc(ErEventPool_t *a_pool)
+{
+    ER_ASSERT(a_pool != NULL);
+
+    unsigned head = atomic_load_explicit(&a_pool->m_head, memory_order_acquire);
+    unsigned next = 0;
+    do
+    {
+        if (HeadIndex(head) == ER_EVENT_POOL_NO_SLOT)
+        {
+            return NULL;
+        }
+
+        // If another thread takes this slot first, `next` may be stale; the
+        // tag in `head` guarantees the exchange below fails in that case.
+        next = atomic_load_explicit(&a_pool->m_next[HeadIndex(head)],
+                                    memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(
+        &a_pool->m_head, &head, NextHead(head, next), memory_order_acquire,
+        memory_order_acquire));
+
+    ErEvent_t *event = SlotEvent(a_pool, HeadIndex(head));
+    ER_ASSERT(!ErEventIsInFlight(event));
+    return event;
+}
+
+void ErEventPoolFree(ErEventPool_t *a_pool, ErEvent_t *a_event)
+{
+    ER_ASSERT(a_pool != NULL);
+    ER_ASSERT(a_event != NULL);
+    ER_ASSERT(a_event->m_pool == a_pool);
+    ER_ASSERT(!ErEventIsInFlight(a_event));
+
+    const unsigned idx = EventSlot(a_pool, a_event);
+
+    unsigned head = atomic_load_explicit(&a_pool->m_head, memory_order_relaxed);
+    do
+    {
+        atomic_store_explicit(&a_pool->m_next[idx], HeadIndex(head),
+                              memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(
+        &a_pool->m_head, &head, NextHead(head, idx), memory_order_release,
+        memory_order_relaxed));
+}
@@ -0,0 +1,63 @@
+#ifndef EVENTROUTER_EVENT_POOL_H
+#define EVENTROUTER_EVENT_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atomic.h"
+#include "event.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// Pools index their slots with 16 bits; this value marks the end of the free
+/// list, so a pool holds at most `ER_EVENT_POOL_MAX_SLOTS` events.
+#define ER_EVENT_POOL_NO_SLOT   (0xFFFFu)
+#define ER_EVENT_POOL_MAX_SLOTS (ER_EVENT_POOL_NO_SLOT)
+
+    /// A fixed number of preallocated events of one type, all owned by one
+    /// module. A module that needs several events of the same type in flight at
+    /// once allocates them from a pool instead of defining them one by one.
+    /// Pooled events return to the pool automatically once the sending
+    /// module's handler has seen them come back; see `ErEventPoolAlloc()`.
+    ///
+    /// Define pools with `ER_DEFINE_EVENT_POOL()` and initialize them with
+    /// `ErEventPoolInit()`; the fields below are private.
+    typedef struct ErEventPool_t
+    {
+        void *m_slots;          //< Storage for `m_num_slots` structs.
+        size_t m_slot_size;     //< The size of the struct in each slot.
+        size_t m_event_offset;  //< The offset of the `ErEvent_t` in a slot.
+        size_t m_num_slots;
+
+        /// The free list. `m_head` packs the index of the first free slot in
+        /// its low 16 bits and a tag in its high 16 bits; the tag changes every
+        /// time the head does, so a thread that read a stale head cannot swap
+        /// it in after other threads popped and pushed the same slot (ABA).
+        /// `m_next[i]` is the index of the free slot after slot `i`.
+        atomic_uint m_head;
+        atomic_uint *m_next;
+    } ErEventPool_t;
+
+    /// Defines a static `ErEventPool_t` named `a_name` that holds `a_count`
+    /// instances of `a_struct`, which must include `MIXIN_ER_EVENT`.
+#define ER_DEFINE_EVENT_POOL(a_name, a_struct, a_count)           \
+    static a_struct a_name##_slots[(a_count)];                    \
+    static atomic_uint a_name##_next[(a_count)];                  \
+    static ErEventPool_t a_name = {                               \
+        .m_slots        = a_name##_slots,                         \
+        .m_slot_size    = sizeof(a_struct),                       \
+        .m_event_offset = offsetof(a_struct, ER_EVENT_MEMBER),    \
+        .m_num_slots    = (a_count),                              \
+        .m_head         = INIT_ATOMIC_INT(ER_EVENT_POOL_NO_SLOT), \
+        .m_next         = a_name##_next,                          \
+    };                                                            \
+    ER_STATIC_ASSERT((a_count) <= ER_EVENT_POOL_MAX_SLOTS, "Pool is too large")
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENTROUTER_EVENT_POOL_H */
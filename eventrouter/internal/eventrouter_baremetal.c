@@ -99,6 +99,11 @@ void ErSendEx(ErEvent_t *a_event, ErSendExOptions_t a_options)
     ER_ASSERT(!ErEventIsInFlight(a_event));
     ER_ASSERT(a_event->m_next.m_next == NULL);
 
+    /// Every delivery happens in this task, so fire-and-forget events only
+    /// differ in what happens once all subscribers are done with them.
+    a_event->m_fire_and_forget = a_options.m_fire_and_forget;
+    a_event->m_release         = a_options.m_release;
+
     /// Prepare to deliver the event on the next iteration of the main loop,
     /// even if only to the sending module.
     a_event->m_reference_count++;
@@ -175,9 +180,29 @@ void ErReturnToSender(ErEvent_t *a_event)
         // Remove the event from the KEPT list (no-op if the event wasn't kept).
         ErListRemove(&s_context.m_events.m_kept, &a_event->m_next);
 
+        if (a_event->m_fire_and_forget)
+        {
+            // Release the event instead of returning it to its sender.
+            if (a_event->m_release != NULL)
+            {
+                a_event->m_release(a_event);
+            }
+            if (a_event->m_pool != NULL)
+            {
+                ErEventPoolFree(a_event->m_pool, a_event);
+            }
+            return;
+        }
+
         // All subscribed modules have received the event; return to its sender.
         ErModule_t *sender = a_event->m_sending_module;
         sender->m_handler(a_event, sender->m_context);
+
+        // Recycle pooled events unless the handler sent the event again.
+        if ((a_event->m_pool != NULL) && !ErEventIsInFlight(a_event))
+        {
+            ErEventPoolFree(a_event->m_pool, a_event);
+        }
     }
 }
 
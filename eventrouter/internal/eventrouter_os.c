@@ -20,6 +20,10 @@
 /// the dispatch strategy in `ErSend()`.
 #define TASK_SEND_LIMIT (32)
 
+/// Routers start on a cache line of their own, so that tasks of different
+/// routers never write to the same line.
+#define ROUTER_ALIGNMENT (64)
+
 /// Print information about `a_event` before asserting.
 #define ER_ASSERT_E(a_cond, a_event)                                           \
     do                                                                         \
@@ -41,15 +45,159 @@
 // Static Variables
 //==============================================================================
 
-static struct
+#if ER_TASK_STATS
+/// Per-task utilization bookkeeping. Only the task a record belongs to writes
+/// to it. `m_sequence` is odd while that task updates `m_published`, which lets
+/// readers in other tasks detect torn snapshots and retry without blocking the
+/// writer.
+typedef struct
+{
+    atomic_uint m_sequence;
+    ErTaskStats_t m_published;
+
+    // Private to the owning task.
+    bool m_started;
+    bool m_saturated;       //< Whether the current receive found work waiting.
+    size_t m_depth;         //< The queue depth at the current receive.
+    int64_t m_busy_us;      //< Busy time preceding the current receive.
+    int64_t m_wait_start_us;
+    int64_t m_last_return_us;
+    int64_t m_window_start_us;
+    int64_t m_window_busy_us;
+    int64_t m_window_blocked_us;
+    uint32_t m_window_receives;
+    uint32_t m_window_saturated;
+} TaskStats_t;
+#endif
+
+#if ER_EVENT_STATS
+/// Per-type counters. Any task (or interrupt) can send or return an event of
+/// any type, so every field is updated with relaxed atomic increments. Sends
+/// and returns of a type usually happen in different tasks, and busy types sit
+/// next to each other in the table, so each group of counters starts a cache
+/// line of its own.
+typedef struct
+{
+    _Alignas(ROUTER_ALIGNMENT) atomic_ullong m_sends;
+    _Alignas(ROUTER_ALIGNMENT) atomic_ullong m_returns;
+    atomic_ullong m_latency_buckets[ER_LATENCY_BUCKET_COUNT];
+} EventTypeStats_t;
+#endif
+
+#if ER_RETURN_BATCH_SIZE > 0
+/// Events a task has finished with that are bound for senders in other tasks.
+/// Only the task a batch belongs to touches it.
+typedef struct
+{
+    ErEvent_t *m_events[ER_RETURN_BATCH_SIZE];
+    size_t m_count;
+    /// Events the task has received since the batch last went out with
+    /// events in it; see `FlushReturnsAfterReceive()`.
+    size_t m_receives;
+} ReturnBatch_t;
+#endif
+
+/// Notifications posted to a task with `ErNotify()` that it has not received
+/// yet.
+typedef struct
+{
+    /// Bit `i` is set while a notification of type `ER_EVENT_TYPE__FIRST + i`
+    /// is pending. Any task or interrupt sets bits; only the owning task
+    /// clears them.
+    atomic_char m_pending[(ER_EVENT_TYPE__COUNT + (CHAR_BIT - 1)) / CHAR_BIT];
+    /// True from the time `m_wakeup` is posted until the task receives it, so
+    /// that pending notifications never hold more than one queue slot. A post
+    /// that found the queue full leaves it set as well.
+    atomic_bool m_wakeup_queued;
+    /// Events on their way back to this task that found its queue full,
+    /// newest first. Any task or interrupt pushes; only the task pops.
+    _Atomic(ErEvent_t *) m_parked;
+    /// Posted to the task's queue to wake it; never handed to handlers.
+    ErEvent_t m_wakeup;
+    /// Carries each pending notification to `ErCallHandlers()`.
+    ErEvent_t m_event;
+} Notifications_t;
+
+/// The modules of one `ErCallHandlers()` call that run beside the task; see
+/// `ErFanOutStart()`.
+typedef struct
+{
+    /// The first parallel-safe module, which the task runs itself once the
+    /// others are under way.
+    ErModule_t *m_held_module;
+    /// Modules handed to helpers that haven't finished; guarded by the
+    /// fan-out mutex.
+    size_t m_pending;
+    size_t m_task_idx;
+    /// The router the task's modules belong to.
+    ErRouter_t *m_router;
+} FanOut_t;
+
+/// Everything one router knows; see `ErRouterNew()`.
+struct ErRouter
 {
     bool m_initialized;
     const ErOptions_t *m_options;
     ErOsFunctions_t m_os_functions;
-} s_context;
+#if ER_TASK_STATS
+    TaskStats_t m_task_stats[TASK_SEND_LIMIT];
+#endif
+#if ER_EVENT_STATS
+    EventTypeStats_t m_type_stats[ER_EVENT_TYPE__COUNT];
+#endif
+#if ER_RETURN_BATCH_SIZE > 0
+    ReturnBatch_t m_return_batches[TASK_SEND_LIMIT];
+#endif
+    /// Events dropped by each task's overflow policy; any task can add to
+    /// these.
+    atomic_ullong m_task_drops[TASK_SEND_LIMIT];
+    /// Set from `ErOptions_t::m_conflated_types` at initialization.
+    bool m_conflated_types[ER_EVENT_TYPE__COUNT];
+    /// Copied from `ErOptions_t::m_type_lanes` at initialization.
+    uint8_t m_type_lanes[ER_EVENT_TYPE__COUNT];
+    Notifications_t m_notifications[TASK_SEND_LIMIT];
+    /// Bit `i` of entry `g` is set if task `i` is in worker group `g`; set at
+    /// initialization. Entry 0 is unused.
+    uint32_t m_worker_groups[TASK_SEND_LIMIT + 1];
+    ErWorkerBalance_t m_worker_balances[TASK_SEND_LIMIT + 1];
+    /// The highest worker group in use, or 0 if there are none.
+    size_t m_last_worker_group;
+    /// Whose turn it is in each worker group; any task can advance these.
+    atomic_uint m_worker_turns[TASK_SEND_LIMIT + 1];
+    /// Copied from `ErOptions_t::m_key_extractors` at initialization.
+    ErEventKey_t m_key_extractors[ER_EVENT_TYPE__COUNT];
+    /// The index of the task that owns each partition of each worker group.
+    atomic_uchar m_partition_owners[TASK_SEND_LIMIT + 1][ER_KEY_PARTITIONS];
+#if ER_IMPLEMENTATION == ER_IMPL_POSIX
+    /// One more than the index of the task whose modules run on the pool, or 0
+    /// if there is none; see `ErPoolStart()`.
+    size_t m_pooled_task;
+    /// The pool running that task's modules.
+    struct ErPool *m_pool;
+#if ER_SHARDS
+    /// One more than the router's index among the shards, or 0 if it isn't
+    /// one; see `ErShardsStart()`.
+    size_t m_shard;
+    /// The shards the router is one of.
+    struct ErShards *m_shards;
+#endif
+#if ER_CAPTURE
+    /// The capture in progress, if any; see `ErCaptureStart()`.
+    _Atomic(struct ErCapture *) m_capture;
+    /// Sends writing to `m_capture`, which `ErCaptureStop()` waits out.
+    atomic_uint m_capture_writers;
+    /// Set while `ErCaptureStop()` waits, so the last writer wakes it.
+    atomic_bool m_capture_stopping;
+#endif
+#endif
+};
+
+/// The router behind `ErInit()` and friends until a thread picks another.
+static _Alignas(ROUTER_ALIGNMENT) ErRouter_t s_default_router;
 
 #if ER_IMPLEMENTATION == ER_IMPL_POSIX
 #include <pthread.h>
+#include <time.h>
 // These variables are used to implement WaitUntilInitComplete() in the POSIX
 // implementation. WaitUntilInitComplete() is necessary because POSIX threads
 // execute as soon as they are created, which makes it impossible to create
@@ -58,6 +206,16 @@ static struct
 // initialization completes to avoid issues.
 static pthread_mutex_t s_init_gate_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t s_init_gate_cond   = PTHREAD_COND_INITIALIZER;
+// Pool workers and fan-out helpers run modules on behalf of a task, so they
+// count as that task. This is one more than its index while they do, and 0 on
+// every other thread.
+static _Thread_local size_t s_pool_worker_task;
+// Set on the threads of `ErOffload()`, which belong to no task.
+static _Thread_local bool s_offload_worker;
+// The router every call on this thread acts on; see `ErRouterUse()`.
+static _Thread_local ErRouter_t *s_router = &s_default_router;
+#else
+static ErRouter_t *const s_router = &s_default_router;
 #endif
 
 //==============================================================================
@@ -73,13 +231,15 @@ static bool IsInIsr(void);  // Forward declaration.
 
 static void DefaultSendEvent(ErQueueHandle_t a_queue, void *a_event)
 {
+    QueueHandle_t lane = ErQueueLane(a_queue, ((ErEvent_t *)a_event)->m_lane);
+
     if (IsInIsr())
     {
         // The logic for detecting a higher-priority task and yielding to it is
         // taken directly the documentation for `xQueueSendToBackFromISR()`.
         BaseType_t higher_priority_task_was_woken = pdFALSE;
         ER_ASSERT_E(
-            pdTRUE == xQueueSendToBackFromISR(a_queue, &a_event,
+            pdTRUE == xQueueSendToBackFromISR(lane, &a_event,
                                               &higher_priority_task_was_woken),
             a_event);
 
@@ -90,20 +250,66 @@ static void DefaultSendEvent(ErQueueHandle_t a_queue, void *a_event)
     }
     else
     {
-        ER_ASSERT_E(pdTRUE == xQueueSendToBack(a_queue, &a_event, 0), a_event);
+        ER_ASSERT_E(pdTRUE == xQueueSendToBack(lane, &a_event, 0), a_event);
     }
 }
 
+static void DefaultSendEvents(ErQueueHandle_t a_queue,
+                              ErEvent_t *const *a_events, size_t a_count)
+{
+    for (size_t idx = 0; idx < a_count; ++idx)
+    {
+        DefaultSendEvent(a_queue, a_events[idx]);
+    }
+}
+
+static bool DefaultTimedSendEvent(ErQueueHandle_t a_queue, ErEvent_t *a_event,
+                                  int64_t a_ms)
+{
+    QueueHandle_t lane = ErQueueLane(a_queue, a_event->m_lane);
+
+    if (IsInIsr())
+    {
+        // Interrupts cannot wait for room; `a_ms` only applies to tasks.
+        BaseType_t higher_priority_task_was_woken = pdFALSE;
+        const BaseType_t ret = xQueueSendToBackFromISR(
+            lane, &a_event, &higher_priority_task_was_woken);
+
+        if (higher_priority_task_was_woken)
+        {
+            taskYIELD();
+        }
+        return (ret == pdTRUE);
+    }
+    return (pdTRUE == xQueueSendToBack(lane, &a_event, pdMS_TO_TICKS(a_ms)));
+}
+
+static ErEvent_t *DefaultDisplaceEvent(ErQueueHandle_t a_queue,
+                                       ErEvent_t *a_event,
+                                       ErQueueMatch_t a_match, bool a_in_place)
+{
+    // Rotating a lane masks interrupts for time in proportion to its length:
+    // far too long for an interrupt, and too long for every send of a
+    // conflated type. Only a full lane, where the event would not fit anyway,
+    // is worth it.
+    if (IsInIsr() ||
+        (uxQueueSpacesAvailable(ErQueueLane(a_queue, a_event->m_lane)) != 0))
+    {
+        return NULL;
+    }
+    return ErQueueDisplace(a_queue, a_event, a_match, a_in_place);
+}
+
+// Receives go through the queue module, which reads the highest lane first.
 static void DefaultReceiveEvent(ErQueueHandle_t a_queue, ErEvent_t **a_event)
 {
-    ER_ASSERT_E(pdTRUE == xQueueReceive(a_queue, a_event, portMAX_DELAY),
-                *a_event);
+    *a_event = ErQueuePopFront(a_queue);
 }
 
 static void DefaultTimedReceiveEvent(ErQueueHandle_t a_queue,
                                      ErEvent_t **a_event, int64_t a_ms)
 {
-    xQueueReceive(a_queue, a_event, pdMS_TO_TICKS(a_ms));
+    ErQueueTimedPopFront(a_queue, a_event, a_ms);
 }
 
 static ErTaskHandle_t DefaultGetCurrentTaskHandle(void)
@@ -111,6 +317,28 @@ static ErTaskHandle_t DefaultGetCurrentTaskHandle(void)
     return xTaskGetCurrentTaskHandle();
 }
 
+static int64_t DefaultGetTimeUs(void)
+{
+    const TickType_t ticks =
+        IsInIsr() ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+    return ((int64_t)ticks * 1000000) / configTICK_RATE_HZ;
+}
+
+static size_t DefaultGetQueueDepth(ErQueueHandle_t a_queue)
+{
+    if (!IsInIsr())
+    {
+        return ErQueueSize(a_queue);
+    }
+
+    size_t depth = 0;
+    for (size_t lane = 0; lane < ER_PRIORITY_LANES; ++lane)
+    {
+        depth += uxQueueMessagesWaitingFromISR(ErQueueLane(a_queue, lane));
+    }
+    return depth;
+}
+
 static void WaitUntilInitComplete(void)
 {
     // FreeRTOS doesn't start tasks at creation; no delay is necessary.
@@ -121,6 +349,25 @@ static void DefaultSendEvent(ErQueueHandle_t a_queue, void *a_event)
     ErQueuePushBack(a_queue, a_event);
 }
 
+static void DefaultSendEvents(ErQueueHandle_t a_queue,
+                              ErEvent_t *const *a_events, size_t a_count)
+{
+    ErQueuePushBackMany(a_queue, a_events, a_count);
+}
+
+static bool DefaultTimedSendEvent(ErQueueHandle_t a_queue, ErEvent_t *a_event,
+                                  int64_t a_ms)
+{
+    return ErQueueTimedPushBack(a_queue, a_event, a_ms);
+}
+
+static ErEvent_t *DefaultDisplaceEvent(ErQueueHandle_t a_queue,
+                                       ErEvent_t *a_event,
+                                       ErQueueMatch_t a_match, bool a_in_place)
+{
+    return ErQueueDisplace(a_queue, a_event, a_match, a_in_place);
+}
+
 static void DefaultReceiveEvent(ErQueueHandle_t a_queue, ErEvent_t **a_event)
 {
     *a_event = ErQueuePopFront(a_queue);
@@ -137,12 +384,24 @@ static ErTaskHandle_t DefaultGetCurrentTaskHandle(void)
     return pthread_self();
 }
 
+static int64_t DefaultGetTimeUs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((int64_t)now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
+static size_t DefaultGetQueueDepth(ErQueueHandle_t a_queue)
+{
+    return ErQueueSize(a_queue);
+}
+
 static void WaitUntilInitComplete(void)
 {
-    while (!s_context.m_initialized)
+    while (!s_router->m_initialized)
     {
         pthread_mutex_lock(&s_init_gate_mutex);
-        if (!s_context.m_initialized)
+        if (!s_router->m_initialized)
         {
             pthread_cond_wait(&s_init_gate_cond, &s_init_gate_mutex);
         }
@@ -160,8 +419,8 @@ static void WaitUntilInitComplete(void)
 /// Returns true if the system is inside an interrupt handler.
 static bool IsInIsr(void)
 {
-    ER_ASSERT(s_context.m_initialized);
-    return s_context.m_options->m_IsInIsr();
+    ER_ASSERT(s_router->m_initialized);
+    return s_router->m_options->m_IsInIsr();
 }
 
 /// Asserts if the contents of the `ErOptions_t` struct are invalid and
@@ -179,6 +438,22 @@ static void ValidateAndInitializeOptions(const ErOptions_t *a_options)
     // See the comment in `ErSend()` for more info.
     ER_ASSERT(a_options->m_num_tasks <= TASK_SEND_LIMIT);
 
+    ER_ASSERT((a_options->m_conflated_types != NULL) ||
+              (a_options->m_num_conflated_types == 0));
+    for (size_t idx = 0; idx < a_options->m_num_conflated_types; ++idx)
+    {
+        const ErEventType_t type = a_options->m_conflated_types[idx];
+        ER_ASSERT((type >= ER_EVENT_TYPE__FIRST) &&
+                  (type <= ER_EVENT_TYPE__LAST));
+    }
+
+    for (size_t idx = 0;
+         (a_options->m_type_lanes != NULL) && (idx < ER_EVENT_TYPE__COUNT);
+         ++idx)
+    {
+        ER_ASSERT(a_options->m_type_lanes[idx] < ER_PRIORITY_LANES);
+    }
+
     for (size_t task_idx = 0; task_idx < a_options->m_num_tasks; ++task_idx)
     {
         const ErTask_t *task = &a_options->m_tasks[task_idx];
@@ -187,6 +462,16 @@ static void ValidateAndInitializeOptions(const ErOptions_t *a_options)
         ER_ASSERT(task->m_event_queue != 0);
         ER_ASSERT(task->m_modules != NULL);
         ER_ASSERT(task->m_num_modules > 0);
+        ER_ASSERT(!task->m_batch_returns || (ER_RETURN_BATCH_SIZE > 0));
+        ER_ASSERT(task->m_worker_group <= TASK_SEND_LIMIT);
+
+        for (size_t other_idx = 0; other_idx < task_idx; ++other_idx)
+        {
+            const ErTask_t *other = &a_options->m_tasks[other_idx];
+            ER_ASSERT((task->m_worker_group == 0) ||
+                      (task->m_worker_group != other->m_worker_group) ||
+                      (task->m_worker_balance == other->m_worker_balance));
+        }
 
         for (size_t module_idx = 0; module_idx < task->m_num_modules;
              ++module_idx)
@@ -211,12 +496,18 @@ static bool IsEventTypeRoutable(ErEventType_t a_type)
             (a_type <= ER_EVENT_TYPE__LAST));
 }
 
+/// Returns the queue lane for events of `a_type`; see `ER_PRIORITY_LANES`.
+static uint8_t LaneOfType(ErEventType_t a_type)
+{
+    return s_router->m_type_lanes[a_type - ER_EVENT_TYPE__FIRST];
+}
+
 /// Returns true if this module is owned by a task known to the Event Router.
 /// This function must be called after initialization completes.
 static bool IsModuleOwned(const ErModule_t *a_module)
 {
     const ErModule_t *claimed_module =
-        s_context.m_options->m_tasks[a_module->m_task_idx]
+        s_router->m_options->m_tasks[a_module->m_task_idx]
             .m_modules[a_module->m_module_idx];
     return claimed_module == a_module;
 }
@@ -229,13 +520,20 @@ static bool IsEventSendable(ErEvent_t *a_event)
            IsModuleOwned(a_event->m_sending_module);
 }
 
-/// Returns the index of the task in `s_context.m_options->m_tasks` that
+/// Returns the index of the task in `s_router->m_options->m_tasks` that
 /// corresponds with the currently running task.
 static size_t GetIndexOfCurrentTask(void)
 {
-    const ErOptions_t *options = s_context.m_options;
+#if ER_IMPLEMENTATION == ER_IMPL_POSIX
+    if (s_pool_worker_task != 0)
+    {
+        return s_pool_worker_task - 1;
+    }
+#endif
+
+    const ErOptions_t *options = s_router->m_options;
     const ErTaskHandle_t current_task =
-        s_context.m_os_functions.GetCurrentTaskHandle();
+        s_router->m_os_functions.GetCurrentTaskHandle();
 
     int task_idx = -1;
     for (size_t idx = 0; idx < options->m_num_tasks; ++idx)
@@ -255,6 +553,38 @@ static size_t GetIndexOfCurrentTask(void)
     return task_idx;
 }
 
+/// Returns true if the modules of the task at `a_task_idx` run on the pool.
+static bool IsTaskPooled(size_t a_task_idx)
+{
+#if ER_IMPLEMENTATION == ER_IMPL_POSIX
+    return s_router->m_pooled_task == (a_task_idx + 1);
+#else
+    ER_UNUSED(a_task_idx);
+    return false;
+#endif
+}
+
+/// Returns true on threads that run modules on behalf of a task, rather than
+/// being the task; see `s_pool_worker_task`.
+static bool IsHelperThread(void)
+{
+#if ER_IMPLEMENTATION == ER_IMPL_POSIX
+    return s_pool_worker_task != 0;
+#else
+    return false;
+#endif
+}
+
+/// Returns true on the threads of `ErOffload()`.
+static bool IsOffloadWorker(void)
+{
+#if ER_IMPLEMENTATION == ER_IMPL_POSIX
+    return s_offload_worker;
+#else
+    return false;
+#endif
+}
+
 /// Events may only be re-sent if re-sending is explicitly allowed and the
 /// sender is either in an interrupt or the sending module's task.
 static bool EventResendingAllowed(const ErSendExOptions_t *a_options,
@@ -264,39 +594,721 @@ static bool EventResendingAllowed(const ErSendExOptions_t *a_options,
            (IsInIsr() || (a_sending_task_idx == GetIndexOfCurrentTask()));
 }
 
+/// Returns the number of bits set in `a_task_mask`.
+static size_t CountTasks(uint32_t a_task_mask)
+{
+    size_t count = 0;
+    for (uint32_t mask = a_task_mask; mask != 0; mask &= mask - 1)
+    {
+        count += 1;
+    }
+    return count;
+}
+
+/// Returns the one task in `a_candidates`, a mask of at least two tasks in
+/// worker `a_group`, that gets `a_event` (NULL for a notification), as a mask.
+static uint32_t PickWorker(size_t a_group, uint32_t a_candidates,
+                           const ErEvent_t *a_event)
+{
+    size_t members[TASK_SEND_LIMIT];
+    size_t num_members = 0;
+    for (uint32_t mask = a_candidates; mask != 0; mask &= mask - 1)
+    {
+        size_t idx = 0;
+        while ((mask & (UINT32_C(1) << idx)) == 0)
+        {
+            idx += 1;
+        }
+        members[num_members++] = idx;
+    }
+
+    const ErEventKey_t key_of =
+        (a_event == NULL) ? NULL
+                          : s_router->m_key_extractors[a_event->m_type -
+                                                       ER_EVENT_TYPE__FIRST];
+    if (key_of != NULL)
+    {
+        const size_t partition = ErGetKeyPartition(key_of(a_event));
+        const uint32_t owner =
+            UINT32_C(1) << atomic_load_explicit(
+                &s_router->m_partition_owners[a_group][partition],
+                memory_order_relaxed);
+        if ((a_candidates & owner) != 0)
+        {
+            return owner;
+        }
+
+        // The owner has no module subscribed to the type. Spreading its
+        // partitions over the candidates still sends each key to one task.
+        return UINT32_C(1) << members[partition % num_members];
+    }
+
+    const unsigned turn = atomic_fetch_add_explicit(
+        &s_router->m_worker_turns[a_group], 1, memory_order_relaxed);
+    size_t picked = members[turn % num_members];
+
+    if (s_router->m_worker_balances[a_group] ==
+        ER_WORKER_BALANCE__LEAST_LOADED)
+    {
+        size_t least_depth = SIZE_MAX;
+        for (size_t offset = 0; offset < num_members; ++offset)
+        {
+            const size_t idx = members[(turn + offset) % num_members];
+            const size_t depth = s_router->m_os_functions.GetQueueDepth(
+                s_router->m_options->m_tasks[idx].m_event_queue);
+            if (depth < least_depth)
+            {
+                least_depth = depth;
+                picked      = idx;
+            }
+        }
+    }
+
+    return UINT32_C(1) << picked;
+}
+
+/// Returns a mask with bit `i` set if task `i` has a module subscribed to
+/// `a_type`, and stores the number of bits set in `a_count`. Only one task
+/// from each worker group is marked; see `ErTask_t::m_worker_group`.
+/// `a_event` is the event being sent, or NULL for a notification.
+static uint32_t MarkSubscribedTasks(ErEventType_t a_type,
+                                    const ErEvent_t *a_event, size_t *a_count)
+{
+    uint32_t subscribed_task_mask = 0;
+    ER_STATIC_ASSERT(
+        (sizeof(subscribed_task_mask) * CHAR_BIT) >= TASK_SEND_LIMIT,
+        "There must be enough bits in the mask to mark all the tasks");
+    for (size_t idx = 0; idx < s_router->m_options->m_num_tasks; ++idx)
+    {
+        const ErTask_t *task = &s_router->m_options->m_tasks[idx];
+        const BitRef_t bit_ref =
+            GetBitRef((atomic_char *)task->m_subscriptions, a_type);
+        const bool task_is_subscribed =
+            atomic_load(bit_ref.m_byte) & bit_ref.m_bit_mask;
+
+        if (task_is_subscribed)
+        {
+            subscribed_task_mask |= 1 << idx;
+        }
+    }
+
+    for (size_t group = 1; group <= s_router->m_last_worker_group; ++group)
+    {
+        const uint32_t candidates =
+            subscribed_task_mask & s_router->m_worker_groups[group];
+        if ((candidates & (candidates - 1)) != 0)
+        {
+            subscribed_task_mask &= ~candidates;
+            subscribed_task_mask |= PickWorker(group, candidates, a_event);
+        }
+    }
+
+    *a_count = CountTasks(subscribed_task_mask);
+    return subscribed_task_mask;
+}
+
+/// Reassigns the partitions of worker `a_group` so each task in `a_task_mask`
+/// owns an even share; see `ErRebalancePartitions()`.
+static void SpreadPartitions(size_t a_group, uint32_t a_task_mask)
+{
+    atomic_uchar *owners = s_router->m_partition_owners[a_group];
+    const size_t share   = ER_KEY_PARTITIONS / CountTasks(a_task_mask);
+    size_t spare_shares  = ER_KEY_PARTITIONS % CountTasks(a_task_mask);
+
+    size_t owned[TASK_SEND_LIMIT] = {0};
+    bool moving[ER_KEY_PARTITIONS];
+
+    // Tasks keep their share of the partitions they own, and the first to
+    // reach it keep one more while the partitions don't divide evenly.
+    for (size_t partition = 0; partition < ER_KEY_PARTITIONS; ++partition)
+    {
+        const size_t owner =
+            atomic_load_explicit(&owners[partition], memory_order_relaxed);
+        const bool in_mask = (a_task_mask & (UINT32_C(1) << owner)) != 0;
+        moving[partition]  = true;
+        if (in_mask && (owned[owner] < share))
+        {
+            owned[owner] += 1;
+            moving[partition] = false;
+        }
+        else if (in_mask && (owned[owner] == share) && (spare_shares > 0))
+        {
+            owned[owner] += 1;
+            spare_shares -= 1;
+            moving[partition] = false;
+        }
+    }
+
+    // The rest go to tasks short of their share first.
+    for (size_t partition = 0; partition < ER_KEY_PARTITIONS; ++partition)
+    {
+        size_t new_owner = SIZE_MAX;
+        for (size_t idx = 0; moving[partition] && (idx < TASK_SEND_LIMIT);
+             ++idx)
+        {
+            if ((a_task_mask & (UINT32_C(1) << idx)) == 0)
+            {
+                // Not one of the tasks sharing the partitions.
+            }
+            else if (owned[idx] < share)
+            {
+                new_owner = idx;
+                break;
+            }
+            else if ((owned[idx] == share) && (spare_shares > 0) &&
+                     (new_owner == SIZE_MAX))
+            {
+                new_owner = idx;
+            }
+        }
+
+        if (new_owner != SIZE_MAX)
+        {
+            if (owned[new_owner] == share)
+            {
+                spare_shares -= 1;
+            }
+            owned[new_owner] += 1;
+            atomic_store_explicit(&owners[partition], (unsigned char)new_owner,
+                                  memory_order_relaxed);
+        }
+    }
+}
+
+#if ER_EVENT_STATS
+/// Returns the latency histogram bucket that `a_latency_us` falls into.
+static size_t LatencyBucket(int64_t a_latency_us)
+{
+    size_t bucket = 0;
+    while ((a_latency_us > 0) && (bucket < (ER_LATENCY_BUCKET_COUNT - 1)))
+    {
+        a_latency_us >>= 1;
+        bucket += 1;
+    }
+    return bucket;
+}
+
+/// Counts a send of `a_event`. Events which were idle before this send start a
+/// new latency measurement; re-sends are part of the measurement in progress.
+static void EventStatsOnSend(ErEvent_t *a_event, bool a_was_idle)
+{
+    EventTypeStats_t *stats =
+        &s_router->m_type_stats[a_event->m_type - ER_EVENT_TYPE__FIRST];
+    atomic_fetch_add_explicit(&stats->m_sends, 1, memory_order_relaxed);
+
+    if (a_was_idle)
+    {
+        a_event->m_send_time_us = s_router->m_os_functions.GetTimeUs();
+    }
+}
+
+/// Takes back the count from `EventStatsOnSend()` for a send that reached no
+/// queue at all.
+static void EventStatsOnUnsent(ErEvent_t *a_event)
+{
+    EventTypeStats_t *stats =
+        &s_router->m_type_stats[a_event->m_type - ER_EVENT_TYPE__FIRST];
+    atomic_fetch_sub_explicit(&stats->m_sends, 1, memory_order_relaxed);
+}
+
+/// Counts the return of `a_event` to its sender and records its latency.
+static void EventStatsOnReturn(ErEvent_t *a_event)
+{
+    EventTypeStats_t *stats =
+        &s_router->m_type_stats[a_event->m_type - ER_EVENT_TYPE__FIRST];
+    const int64_t latency_us =
+        s_router->m_os_functions.GetTimeUs() - a_event->m_send_time_us;
+
+    atomic_fetch_add_explicit(&stats->m_returns, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(
+        &stats->m_latency_buckets[LatencyBucket(latency_us)], 1,
+        memory_order_relaxed);
+}
+#else
+static void EventStatsOnSend(ErEvent_t *a_event, bool a_was_idle)
+{
+    ER_UNUSED(a_event);
+    ER_UNUSED(a_was_idle);
+}
+
+static void EventStatsOnUnsent(ErEvent_t *a_event)
+{
+    ER_UNUSED(a_event);
+}
+
+static void EventStatsOnReturn(ErEvent_t *a_event)
+{
+    ER_UNUSED(a_event);
+}
+#endif
+
+#if (ER_IMPLEMENTATION == ER_IMPL_POSIX) && ER_CAPTURE
+// Defined in capture_posix.c, which is included at the end of this file.
+static void CaptureOnSend(const ErEvent_t *a_event);
+#else
+static void CaptureOnSend(const ErEvent_t *a_event)
+{
+    ER_UNUSED(a_event);
+}
+#endif
+
+/// Finishes a fire-and-forget event once every subscriber is done with it. The
+/// caller reads `a_release` before dropping the last reference because the
+/// event may be sent again as soon as the reference count reaches zero.
+static void ReleaseEvent(ErEvent_t *a_event, ErEventRelease_t a_release)
+{
+    EventStatsOnReturn(a_event);
+
+    if (a_release != NULL)
+    {
+        a_release(a_event);
+    }
+    if (a_event->m_pool != NULL)
+    {
+        ErEventPoolFree(a_event->m_pool, a_event);
+    }
+}
+
+/// Posts the wakeup of the task at `a_task_idx` unless one is already queued.
+/// The task clears `m_wakeup_queued` before it checks for notifications, so
+/// either it finds what the caller left for it or this call sees the flag
+/// clear and posts another wakeup.
+///
+/// The wakeup never waits for room; the caller may be the task that drains
+/// the queue, or an interrupt. A full queue needs no wakeup: the task has
+/// events to receive and checks for notifications before each one. The flag
+/// stays set until the task finds its queue empty; see `Receive()`.
+static void WakeTask(size_t a_task_idx)
+{
+    Notifications_t *notifications = &s_router->m_notifications[a_task_idx];
+
+    if (!atomic_exchange(&notifications->m_wakeup_queued, true))
+    {
+        const bool posted = s_router->m_os_functions.TimedSendEvent(
+            s_router->m_options->m_tasks[a_task_idx].m_event_queue,
+            &notifications->m_wakeup, 0);
+        ER_UNUSED(posted);
+    }
+}
+
+/// Sends `a_event`, which only has its return trip left, back to its sending
+/// task without waiting for room. The caller may be that task, or one it is
+/// waiting on, so waiting might never end. An event that finds the queue full
+/// is parked with the task instead, which receives it before anything queued.
+static void ReturnWithoutWaiting(ErEvent_t *a_event)
+{
+    const size_t task_idx = a_event->m_sending_module->m_task_idx;
+    if (s_router->m_os_functions.TimedSendEvent(
+            s_router->m_options->m_tasks[task_idx].m_event_queue, a_event, 0))
+    {
+        return;
+    }
+
+    // The exchange publishes the event, like the queue would have.
+    Notifications_t *notifications = &s_router->m_notifications[task_idx];
+    ErEvent_t *parked              = atomic_load(&notifications->m_parked);
+    do
+    {
+        a_event->m_next_parked = parked;
+    } while (!atomic_compare_exchange_weak(&notifications->m_parked, &parked,
+                                           a_event));
+    WakeTask(task_idx);
+}
+
+/// Drops `a_count` references to `a_event` held for tasks which will never
+/// call `ErReturnToSender()` for them. If only the return trip is left, the
+/// event goes back through the sending task's queue, like a send without
+/// subscribers, so the sending module's handler is never called from here.
+/// Fire-and-forget events are released once the last reference is gone.
+static void DropReferences(ErEvent_t *a_event, size_t a_count)
+{
+    // Read these first; see `ReleaseEvent()`.
+    const bool fire_and_forget     = a_event->m_fire_and_forget;
+    const ErEventRelease_t release = a_event->m_release;
+
+    // Ordered like the decrement in `ErReturnToSender()`.
+    const int previous_reference_count = atomic_fetch_sub_explicit(
+        &a_event->m_reference_count, a_count, memory_order_release);
+    const int reference_count = previous_reference_count - (int)a_count;
+    ER_ASSERT_E(reference_count >= 0, a_event);
+
+    if (fire_and_forget && (reference_count == 0))
+    {
+        atomic_thread_fence(memory_order_acquire);
+        ReleaseEvent(a_event, release);
+    }
+    else if (!fire_and_forget && (reference_count == 1))
+    {
+        atomic_thread_fence(memory_order_acquire);
+        ReturnWithoutWaiting(a_event);
+    }
+}
+
+/// Returns true if `a_queued` may be dropped from a full queue. A count of 1
+/// means the event is on its way back to its sending module; dropping it would
+/// lose the return trip. Events that are still being delivered hold a count
+/// above 1 for as long as they are queued, so this cannot change under us.
+static bool IsDisplaceable(const ErEvent_t *a_queued, const ErEvent_t *a_event)
+{
+    ER_UNUSED(a_event);
+    return a_queued->m_fire_and_forget ||
+           (atomic_load_explicit(&a_queued->m_reference_count,
+                                 memory_order_relaxed) > 1);
+}
+
+/// Returns true if `a_event` makes the queued `a_queued` obsolete.
+static bool IsSupersededBy(const ErEvent_t *a_queued, const ErEvent_t *a_event)
+{
+    return (a_queued->m_type == a_event->m_type) &&
+           (a_queued->m_sending_module == a_event->m_sending_module) &&
+           IsDisplaceable(a_queued, a_event);
+}
+
+/// Applies the overflow policy of the task at `a_task_idx` to `a_event`, which
+/// did not fit in its queue, and counts the drop, if any. Returns true if the
+/// event was queued in place of another one, whose reference is dropped here;
+/// if it returns false the caller still holds the reference taken for this
+/// task.
+static bool HandleOverflow(size_t a_task_idx, ErEvent_t *a_event)
+{
+    const ErTask_t *task = &s_router->m_options->m_tasks[a_task_idx];
+    ErEvent_t *displaced = NULL;
+
+    // Like conflated types, a superseded event is not a drop.
+    if ((task->m_overflow_policy == ER_OVERFLOW_POLICY__CONFLATE) &&
+        ((displaced = s_router->m_os_functions.DisplaceEvent(
+              task->m_event_queue, a_event, IsSupersededBy, true)) != NULL))
+    {
+        DropReferences(displaced, 1);
+        return true;
+    }
+    if ((task->m_overflow_policy == ER_OVERFLOW_POLICY__DROP_OLDEST) ||
+        (task->m_overflow_policy == ER_OVERFLOW_POLICY__CONFLATE))
+    {
+        displaced = s_router->m_os_functions.DisplaceEvent(
+            task->m_event_queue, a_event, IsDisplaceable, false);
+    }
+
+    atomic_fetch_add_explicit(&s_router->m_task_drops[a_task_idx], 1,
+                              memory_order_relaxed);
+    if (displaced == NULL)
+    {
+        return false;
+    }
+
+    DropReferences(displaced, 1);
+    return true;
+}
+
+/// Puts `a_event` in place of an undelivered event it supersedes in the queue
+/// of the task at `a_task_idx`, if its type is conflated and there is one; on
+/// FreeRTOS, only if its lane is full, see `DefaultDisplaceEvent()`. Returns
+/// true if it did; the superseded event's reference is dropped here.
+static bool ConflateQueuedEvent(size_t a_task_idx, ErEvent_t *a_event)
+{
+    if (!s_router->m_conflated_types[a_event->m_type - ER_EVENT_TYPE__FIRST])
+    {
+        return false;
+    }
+
+    const ErTask_t *task = &s_router->m_options->m_tasks[a_task_idx];
+    ErEvent_t *superseded = s_router->m_os_functions.DisplaceEvent(
+        task->m_event_queue, a_event, IsSupersededBy, true);
+    if (superseded == NULL)
+    {
+        return false;
+    }
+
+    DropReferences(superseded, 1);
+    return true;
+}
+
+/// Sends `a_event` to the queue of the task at `a_task_idx`, for which the
+/// caller holds one reference, according to the task's overflow policy.
+static void PostToTask(size_t a_task_idx, ErEvent_t *a_event)
+{
+    const ErTask_t *task = &s_router->m_options->m_tasks[a_task_idx];
+
+    if (ConflateQueuedEvent(a_task_idx, a_event))
+    {
+        // The event already took a queued event's place.
+    }
+    else if (task->m_overflow_policy == ER_OVERFLOW_POLICY__BLOCK)
+    {
+        s_router->m_os_functions.SendEvent(task->m_event_queue, a_event);
+    }
+    else if (!s_router->m_os_functions.TimedSendEvent(task->m_event_queue,
+                                                      a_event, 0) &&
+             !HandleOverflow(a_task_idx, a_event))
+    {
+        DropReferences(a_event, 1);
+    }
+}
+
+#if ER_RETURN_BATCH_SIZE > 0
+/// Posts every event held by the task at `a_task_idx` to its sending task,
+/// with one call to `SendEvents()` per sending task. Events bound for the same
+/// task keep their relative order.
+static void FlushReturns(size_t a_task_idx)
+{
+    ReturnBatch_t *batch = &s_router->m_return_batches[a_task_idx];
+
+    for (size_t first = 0; first < batch->m_count; ++first)
+    {
+        if (batch->m_events[first] == NULL)
+        {
+            continue;  // Already sent with an earlier group.
+        }
+
+        const size_t sending_task_idx =
+            batch->m_events[first]->m_sending_module->m_task_idx;
+        ErEvent_t *group[ER_RETURN_BATCH_SIZE];
+        size_t group_size = 0;
+
+        for (size_t idx = first; idx < batch->m_count; ++idx)
+        {
+            ErEvent_t *event = batch->m_events[idx];
+            if ((event != NULL) &&
+                (event->m_sending_module->m_task_idx == sending_task_idx))
+            {
+                group[group_size++]  = event;
+                batch->m_events[idx] = NULL;
+            }
+        }
+
+        s_router->m_os_functions.SendEvents(
+            s_router->m_options->m_tasks[sending_task_idx].m_event_queue,
+            group, group_size);
+    }
+
+    batch->m_count    = 0;
+    batch->m_receives = 0;
+}
+
+/// Holds `a_event`, bound for a sender in another task, in the current task's
+/// batch if that task batches its returns. Returns false if the caller must
+/// post the event itself.
+static bool DeferReturn(size_t a_task_idx, ErEvent_t *a_event)
+{
+    if (!s_router->m_options->m_tasks[a_task_idx].m_batch_returns)
+    {
+        return false;
+    }
+
+    ReturnBatch_t *batch = &s_router->m_return_batches[a_task_idx];
+    batch->m_events[batch->m_count++] = a_event;
+    if (batch->m_count == ER_RETURN_BATCH_SIZE)
+    {
+        FlushReturns(a_task_idx);
+    }
+    return true;
+}
+
+/// Flushes the current task's batch if the task is about to block. Held events
+/// must not wait on a task that has nothing else to do.
+static void FlushReturnsBeforeBlocking(size_t a_task_idx)
+{
+    const ReturnBatch_t *batch = &s_router->m_return_batches[a_task_idx];
+    if ((batch->m_count > 0) &&
+        (s_router->m_os_functions.GetQueueDepth(
+             s_router->m_options->m_tasks[a_task_idx].m_event_queue) == 0))
+    {
+        FlushReturns(a_task_idx);
+    }
+}
+
+/// Counts an event the current task received, and flushes its batch once held
+/// events have waited through `ER_RETURN_BATCH_SIZE` receives. A task whose
+/// queue never runs dry would otherwise hold a partial batch indefinitely.
+static void FlushReturnsAfterReceive(size_t a_task_idx)
+{
+    ReturnBatch_t *batch = &s_router->m_return_batches[a_task_idx];
+    if ((batch->m_count > 0) &&
+        (++batch->m_receives >= ER_RETURN_BATCH_SIZE))
+    {
+        FlushReturns(a_task_idx);
+    }
+}
+#else
+static bool DeferReturn(size_t a_task_idx, ErEvent_t *a_event)
+{
+    ER_UNUSED(a_task_idx);
+    ER_UNUSED(a_event);
+    return false;
+}
+
+static void FlushReturnsBeforeBlocking(size_t a_task_idx)
+{
+    ER_UNUSED(a_task_idx);
+}
+
+static void FlushReturnsAfterReceive(size_t a_task_idx)
+{
+    ER_UNUSED(a_task_idx);
+}
+#endif
+
+/// Calls `a_module`'s handler with `a_event` and accounts for it being kept.
+static void DeliverToModule(ErModule_t *a_module, ErEvent_t *a_event)
+{
+    const ErEventHandlerRet_t ret =
+        a_module->m_handler(a_event, a_module->m_context);
+
+    if (ret == ER_EVENT_HANDLER_RET__KEPT)
+    {
+        ER_ASSERT_E(a_event->m_sending_module != NULL, a_event);
+
+        // If a module keeps a reference to an event it is responsible for
+        // calling `ErReturnToSender()`. We account for this extra call by
+        // incrementing the reference count. This task still holds a
+        // reference, so nothing is ordered by the increment.
+        atomic_fetch_add_explicit(&a_event->m_reference_count, 1,
+                                  memory_order_relaxed);
+    }
+    ER_INTERLEAVING_POINT();
+
+    // NOTE: This is a good place to put diagnostic information about how event
+    // handlers respond to events.
+}
+
+#if ER_IMPLEMENTATION == ER_IMPL_POSIX
+// Defined in fan_out_posix.c, which is included at the end of this file.
+static bool FanOutModule(FanOut_t *a_fan_out, ErModule_t *a_module,
+                         ErEvent_t *a_event);
+static void FanOutJoin(FanOut_t *a_fan_out, ErEvent_t *a_event);
+// Defined in pool_posix.c, which is included at the end of this file.
+static void PoolReturn(ErEvent_t *a_event);
+#else
+static bool FanOutModule(FanOut_t *a_fan_out, ErModule_t *a_module,
+                         ErEvent_t *a_event)
+{
+    ER_UNUSED(a_fan_out);
+    ER_UNUSED(a_module);
+    ER_UNUSED(a_event);
+    return false;
+}
+
+static void FanOutJoin(FanOut_t *a_fan_out, ErEvent_t *a_event)
+{
+    ER_UNUSED(a_fan_out);
+    ER_UNUSED(a_event);
+}
+
+static void PoolReturn(ErEvent_t *a_event)
+{
+    ER_UNUSED(a_event);
+}
+#endif
+
 void ErInit(const ErOptions_t *a_options)
 {
-    ER_ASSERT(!s_context.m_initialized);
+    ER_ASSERT(!s_router->m_initialized);
     ValidateAndInitializeOptions(a_options);
-    s_context.m_options      = a_options;
-    s_context.m_os_functions = (ErOsFunctions_t){
+    s_router->m_options      = a_options;
+    s_router->m_os_functions = (ErOsFunctions_t){
         .SendEvent            = DefaultSendEvent,
+        .SendEvents           = DefaultSendEvents,
+        .TimedSendEvent       = DefaultTimedSendEvent,
+        .DisplaceEvent        = DefaultDisplaceEvent,
         .ReceiveEvent         = DefaultReceiveEvent,
         .TimedReceiveEvent    = DefaultTimedReceiveEvent,
         .GetCurrentTaskHandle = DefaultGetCurrentTaskHandle,
+        .GetTimeUs            = DefaultGetTimeUs,
+        .GetQueueDepth        = DefaultGetQueueDepth,
     };
 
+    for (size_t idx = 0; idx < a_options->m_num_conflated_types; ++idx)
+    {
+        const ErEventType_t type = a_options->m_conflated_types[idx];
+        s_router->m_conflated_types[type - ER_EVENT_TYPE__FIRST] = true;
+    }
+    if (a_options->m_type_lanes != NULL)
+    {
+        memcpy(s_router->m_type_lanes, a_options->m_type_lanes,
+               sizeof(s_router->m_type_lanes));
+    }
+    if (a_options->m_key_extractors != NULL)
+    {
+        memcpy(s_router->m_key_extractors, a_options->m_key_extractors,
+               sizeof(s_router->m_key_extractors));
+    }
+    for (size_t idx = 0; idx < a_options->m_num_tasks; ++idx)
+    {
+        const ErTask_t *task = &a_options->m_tasks[idx];
+        const size_t group   = task->m_worker_group;
+        if (group != 0)
+        {
+            s_router->m_worker_groups[group] |= UINT32_C(1) << idx;
+            s_router->m_worker_balances[group] = task->m_worker_balance;
+            if (group > s_router->m_last_worker_group)
+            {
+                s_router->m_last_worker_group = group;
+            }
+        }
+    }
+    for (size_t group = 1; group <= s_router->m_last_worker_group; ++group)
+    {
+        if (s_router->m_worker_groups[group] != 0)
+        {
+            SpreadPartitions(group, s_router->m_worker_groups[group]);
+        }
+    }
+    // Wakeups for `ErNotify()` skip ahead of any backlog.
+    for (size_t idx = 0; idx < TASK_SEND_LIMIT; ++idx)
+    {
+        s_router->m_notifications[idx].m_wakeup.m_lane = ER_PRIORITY_LANES - 1;
+    }
+
 #if ER_IMPLEMENTATION == ER_IMPL_POSIX
     pthread_mutex_lock(&s_init_gate_mutex);
 #endif
 
-    s_context.m_initialized = true;
+    s_router->m_initialized = true;
 
 #if ER_IMPLEMENTATION == ER_IMPL_POSIX
-    pthread_cond_signal(&s_init_gate_cond);
+    // Threads of every router wait on the same gate.
+    pthread_cond_broadcast(&s_init_gate_cond);
     pthread_mutex_unlock(&s_init_gate_mutex);
 #endif
 }
 
 void ErDeinit(void)
 {
-    ER_ASSERT(s_context.m_initialized);
-    memset(&s_context, 0, sizeof(s_context));
+    ER_ASSERT(s_router->m_initialized);
+    memset(s_router, 0, sizeof(*s_router));
+}
+
+#if ER_IMPLEMENTATION == ER_IMPL_POSIX
+ErRouter_t *ErRouterNew(void)
+{
+    const size_t size = (sizeof(ErRouter_t) + (ROUTER_ALIGNMENT - 1)) &
+                        ~(size_t)(ROUTER_ALIGNMENT - 1);
+    ErRouter_t *router = aligned_alloc(ROUTER_ALIGNMENT, size);
+    if (router != NULL)
+    {
+        memset(router, 0, size);
+    }
+    return router;
+}
+
+void ErRouterFree(ErRouter_t *a_router)
+{
+    ER_ASSERT(a_router != &s_default_router);
+    ER_ASSERT((a_router == NULL) || !a_router->m_initialized);
+    free(a_router);
+}
+
+ErRouter_t *ErRouterUse(ErRouter_t *a_router)
+{
+    ErRouter_t *previous = s_router;
+    s_router             = (a_router != NULL) ? a_router : &s_default_router;
+    return previous;
 }
+#endif
 
 void ErSendEx(ErEvent_t *a_event, ErSendExOptions_t a_options)
 {
-    ER_ASSERT(s_context.m_initialized);
+    ER_ASSERT(s_router->m_initialized);
     ER_ASSERT(a_event != NULL);
     ER_ASSERT_E(IsEventSendable(a_event), a_event);
 
@@ -312,6 +1324,8 @@ void ErSendEx(ErEvent_t *a_event, ErSendExOptions_t a_options)
     const bool sending_module_subscribed =
         *module_bit_ref.m_byte & module_bit_ref.m_bit_mask;
     ER_ASSERT_E(!sending_module_subscribed, a_event);
+    ER_ASSERT_E(!(a_options.m_fire_and_forget && a_options.m_allow_resending),
+                a_event);
 
     // When an event is sent its reference count is incremented by the number of
     // tasks that should receive the event plus one; each task that receives the
@@ -360,39 +1374,33 @@ void ErSendEx(ErEvent_t *a_event, ErSendExOptions_t a_options)
     // late, too bad; it will get the next event of this type.
 
     // Count and mark tasks which should receive this event.
-    uint32_t subscribed_task_mask = 0;
-    ER_STATIC_ASSERT(
-        (sizeof(subscribed_task_mask) * CHAR_BIT) >= TASK_SEND_LIMIT,
-        "There must be enough bits in the mask to mark all the tasks");
     size_t subscribed_task_count = 0;
-    for (size_t idx = 0; idx < s_context.m_options->m_num_tasks; ++idx)
-    {
-        const ErTask_t *task = &s_context.m_options->m_tasks[idx];
-        const BitRef_t bit_ref =
-            GetBitRef((atomic_char *)task->m_subscriptions, a_event->m_type);
-        const bool task_is_subscribed =
-            atomic_load(bit_ref.m_byte) & bit_ref.m_bit_mask;
-
-        if (task_is_subscribed)
-        {
-            subscribed_task_count += 1;
-            subscribed_task_mask |= 1 << idx;
-        }
-    }
+    uint32_t subscribed_task_mask =
+        MarkSubscribedTasks(a_event->m_type, a_event, &subscribed_task_count);
 
     // Update the reference count to account for each event we plan to send to
     // subscribed tasks. The atomic increment returns the previous reference
     // count which tells us what else is happening in the system.
+    //
+    // Increments can be relaxed. The queue operations in `SendEvent()`
+    // publish the count (and the event) to receiving tasks, and the decisions
+    // below only depend on the previous value, which every atomic operation
+    // on the count sees in the same order.
 
-    const int old_reference_count =
-        atomic_fetch_add(&a_event->m_reference_count, subscribed_task_count);
+    const int old_reference_count = atomic_fetch_add_explicit(
+        &a_event->m_reference_count, subscribed_task_count,
+        memory_order_relaxed);
+    ER_INTERLEAVING_POINT();
 
     // The reference count may NEVER go negative.
     ER_ASSERT_E(old_reference_count >= 0, a_event);
 
+    EventStatsOnSend(a_event, old_reference_count == 0);
+    CaptureOnSend(a_event);
+
     const size_t sending_task_idx = a_event->m_sending_module->m_task_idx;
     const ErTask_t *sending_task =
-        &s_context.m_options->m_tasks[sending_task_idx];
+        &s_router->m_options->m_tasks[sending_task_idx];
 
     // NOTE: This block is the trickiest logic in the module; any modifications
     // to it require careful consideration and heavy testing.
@@ -402,18 +1410,35 @@ void ErSendEx(ErEvent_t *a_event, ErSendExOptions_t a_options)
         // IDLE; either it has never been sent, or it has been received by the
         // sender as many times as it has been sent. In either case, there is no
         // risk of a race condition.
-        //
-        // Add 1 to the reference count to account for sending the event back to
-        // the sending task after delivering it to all subscribers.
-        atomic_fetch_add(&a_event->m_reference_count, 1);
+        a_event->m_fire_and_forget = a_options.m_fire_and_forget;
+        a_event->m_release         = a_options.m_release;
+        a_event->m_lane            = LaneOfType(a_event->m_type);
 
-        // If there are no subscribers the sending task must still receive a
-        // copy of the event. Send the event here and exit the function.
-        if (subscribed_task_count == 0)
+        if (a_options.m_fire_and_forget)
         {
-            s_context.m_os_functions.SendEvent(sending_task->m_event_queue,
-                                               a_event);
-            return;
+            // Fire-and-forget events skip the return trip, so there is no 1 to
+            // add. With no subscribers, nothing else will release the event.
+            if (subscribed_task_count == 0)
+            {
+                ReleaseEvent(a_event, a_options.m_release);
+                return;
+            }
+        }
+        else
+        {
+            // Add 1 to the reference count to account for sending the event
+            // back to the sending task after delivering it to all subscribers.
+            atomic_fetch_add_explicit(&a_event->m_reference_count, 1,
+                                      memory_order_relaxed);
+
+            // If there are no subscribers the sending task must still receive
+            // a copy of the event. Send the event here and exit the function.
+            if (subscribed_task_count == 0)
+            {
+                s_router->m_os_functions.SendEvent(sending_task->m_event_queue,
+                                                   a_event);
+                return;
+            }
         }
     }
     else if (old_reference_count == 1)
@@ -421,6 +1446,7 @@ void ErSendEx(ErEvent_t *a_event, ErSendExOptions_t a_options)
         // The event was already sent, make sure it can be re-sent.
         ER_ASSERT_E(EventResendingAllowed(&a_options, sending_task_idx),
                     a_event);
+        ER_ASSERT_E(!a_event->m_fire_and_forget, a_event);
 
         // If the old reference count is 1, then all subscribers from the
         // previous send received the event, the last subscriber's task has
@@ -475,7 +1501,8 @@ void ErSendEx(ErEvent_t *a_event, ErSendExOptions_t a_options)
             // There are subscribers but none of them are in the sending
             // module's task. The only thing needed is increment the reference
             // count by 1 to account for the return trip.
-            atomic_fetch_add(&a_event->m_reference_count, 1);
+            atomic_fetch_add_explicit(&a_event->m_reference_count, 1,
+                                      memory_order_relaxed);
         }
     }
     else
@@ -483,6 +1510,7 @@ void ErSendEx(ErEvent_t *a_event, ErSendExOptions_t a_options)
         // The event was already sent, make sure it can be re-sent.
         ER_ASSERT_E(EventResendingAllowed(&a_options, sending_task_idx),
                     a_event);
+        ER_ASSERT_E(!a_event->m_fire_and_forget, a_event);
 
         // The event is already in flight but it has not yet consumed the 1 in
         // the reference count dedicated to returning it to the sending module's
@@ -491,12 +1519,15 @@ void ErSendEx(ErEvent_t *a_event, ErSendExOptions_t a_options)
 
     // Deliver the event to the marked tasks. Since tasks are listed from
     // highest-priority to lowest they are delivered in priority order.
-    for (size_t idx = 0; idx < s_context.m_options->m_num_tasks; ++idx)
+    //
+    // A task that drops the event because its queue is full gives up its
+    // reference right away. Tasks that have yet to be sent the event still
+    // hold theirs, so a drop cannot return the event before they get it.
+    for (size_t idx = 0; idx < s_router->m_options->m_num_tasks; ++idx)
     {
         if (subscribed_task_mask & (1 << idx))
         {
-            s_context.m_os_functions.SendEvent(
-                s_context.m_options->m_tasks[idx].m_event_queue, a_event);
+            PostToTask(idx, a_event);
         }
     }
 }
@@ -509,7 +1540,7 @@ void ErSend(ErEvent_t *a_event)
 
 void ErCallHandlers(ErEvent_t *a_event)
 {
-    ER_ASSERT(s_context.m_initialized);
+    ER_ASSERT(s_router->m_initialized);
     ER_ASSERT(a_event != NULL);
     ER_ASSERT_E(IsEventTypeRoutable(a_event->m_type), a_event);
 
@@ -519,13 +1550,29 @@ void ErCallHandlers(ErEvent_t *a_event)
     /// and should not be delivered to subscribing modules.
     ///
     /// The sending module's handler is called by ErReturnToSender().
-    if (atomic_load(&a_event->m_reference_count) <= 1)
+    ///
+    /// Fire-and-forget events never make the return trip; a count of 1 just
+    /// means this is the last task to receive them.
+    ///
+    /// The load can be relaxed; the queue this event arrived through already
+    /// ordered it after the send that put it there.
+    ///
+    /// Notifications from `ErNotify()` have no sender and are never counted.
+    const bool is_notification = (a_event->m_sending_module == NULL);
+    ER_INTERLEAVING_POINT();
+    if (!is_notification && !a_event->m_fire_and_forget &&
+        (atomic_load_explicit(&a_event->m_reference_count,
+                              memory_order_relaxed) <= 1))
     {
         goto done;
     }
 
     const size_t task_idx = GetIndexOfCurrentTask();
-    const ErTask_t *task  = &s_context.m_options->m_tasks[task_idx];
+    const ErTask_t *task  = &s_router->m_options->m_tasks[task_idx];
+    ER_ASSERT_E(!is_notification ||
+                    (a_event == &s_router->m_notifications[task_idx].m_event),
+                a_event);
+    FanOut_t fan_out = {.m_task_idx = task_idx, .m_router = s_router};
 
     for (size_t module_idx = 0; module_idx < task->m_num_modules; ++module_idx)
     {
@@ -542,38 +1589,62 @@ void ErCallHandlers(ErEvent_t *a_event)
         // a module unsubscribes from an event type it will not receive another
         // event of that type event if one was already on its way.
 
-        if (module_is_subscribed)
+        // Deliver the event to the subscribed module, or have a helper do it.
+        if (module_is_subscribed && !FanOutModule(&fan_out, module, a_event))
         {
-            // Deliver the event to the subscribed module.
-            const ErEventHandlerRet_t ret =
-                module->m_handler(a_event, module->m_context);
-
-            if (ret == ER_EVENT_HANDLER_RET__KEPT)
-            {
-                // If a module keeps a reference to an event it is
-                // responsible for calling `ErReturnToSender()`. We account
-                // for this extra call by incrementing the reference count.
-                atomic_fetch_add(&a_event->m_reference_count, 1);
-            }
-
-            // NOTE: This is a good place to put diagnostic information
-            // about how event handlers respond to events.
+            DeliverToModule(module, a_event);
         }
     }
 
+    // Helpers hold their modules' uses of the event until they are joined.
+    FanOutJoin(&fan_out, a_event);
+
 done:
-    ErReturnToSender(a_event);
+    if (!is_notification)
+    {
+        ErReturnToSender(a_event);
+    }
 }
 
 void ErReturnToSender(ErEvent_t *a_event)
 {
-    ER_ASSERT(s_context.m_initialized);
+    ER_ASSERT(s_router->m_initialized);
     ER_ASSERT(a_event != NULL);
     ER_ASSERT_E(IsEventSendable(a_event), a_event);
 
-    const int previous_reference_count =
-        atomic_fetch_sub(&a_event->m_reference_count, 1);
+    if (a_event->m_fire_and_forget)
+    {
+        // Whoever drops the last reference releases the event right here
+        // instead of posting it back to the sending task. Every task releases
+        // its use of the event when it drops its reference, and the last one
+        // acquires all of them before handing the event to `release`.
+        const ErEventRelease_t release = a_event->m_release;
+        const int previous_reference_count = atomic_fetch_sub_explicit(
+            &a_event->m_reference_count, 1, memory_order_release);
+        ER_INTERLEAVING_POINT();
+        if (previous_reference_count == 1)
+        {
+            atomic_thread_fence(memory_order_acquire);
+            ReleaseEvent(a_event, release);
+        }
+        return;
+    }
+
+    // The decrement releases this task's use of the event. Only the task that
+    // brings the count to 1 or 0 goes on to return the event, and it acquires
+    // the uses of every task that finished before it; the queue carries them
+    // on to the sending task.
+    const int previous_reference_count = atomic_fetch_sub_explicit(
+        &a_event->m_reference_count, 1, memory_order_release);
     const int reference_count = previous_reference_count - 1;
+    ER_INTERLEAVING_POINT();
+
+    // Whether this call delivers the event to the sending module. This must be
+    // decided from this call's own decrements; once another task can see the
+    // count at 1 it may return the event and even send it again. A count of 0
+    // means the event came back through the sending task's queue, which
+    // already ordered it after the task that posted it.
+    bool return_here = (reference_count == 0);
 
     if (reference_count > 1)
     {
@@ -586,16 +1657,41 @@ void ErReturnToSender(ErEvent_t *a_event)
     {
         // All the recipient tasks are done with the event. We must return the
         // event to its sender.
+        atomic_thread_fence(memory_order_acquire);
 
         const size_t sending_task_idx = a_event->m_sending_module->m_task_idx;
+        if (IsOffloadWorker())
+        {
+            // Offload workers belong to no task, so they neither batch nor
+            // call the sending module themselves. Nor do they wait: a handler
+            // of the sending task may be waiting in `ErOffload()` for them.
+            ReturnWithoutWaiting(a_event);
+            return;
+        }
+        const size_t current_task_idx = GetIndexOfCurrentTask();
+
+        // A pooled task and its workers hand the event straight to the
+        // sending module's mailbox; see `ErPoolDispatch()`.
+        if ((sending_task_idx == current_task_idx) &&
+            IsTaskPooled(current_task_idx))
+        {
+            PoolReturn(a_event);
+            return;
+        }
 
         // The sending task is different from the current task, so we need to
-        // send it to that task's queue.
-        if (sending_task_idx != GetIndexOfCurrentTask())
+        // send it to that task's queue, now or with the current task's batch.
+        // So do helper threads, which must never call a module of their task
+        // that isn't theirs to run.
+        if ((sending_task_idx != current_task_idx) || IsHelperThread())
         {
-            s_context.m_os_functions.SendEvent(
-                s_context.m_options->m_tasks[sending_task_idx].m_event_queue,
-                a_event);
+            if (!DeferReturn(current_task_idx, a_event))
+            {
+                s_router->m_os_functions.SendEvent(
+                    s_router->m_options->m_tasks[sending_task_idx]
+                        .m_event_queue,
+                    a_event);
+            }
 
             // The `return` below is necessary to prevent double-delivery of
             // events to the sending module. The problematic case, without this
@@ -620,25 +1716,171 @@ void ErReturnToSender(ErEvent_t *a_event)
             // Avoid an extra send by decrementing the reference count (as if we
             // sent it back) and then delivering the event to the sending
             // module's event handler below.
-            ER_ASSERT_E(1 == atomic_fetch_sub(&a_event->m_reference_count, 1),
+            ER_ASSERT_E(1 == atomic_fetch_sub_explicit(
+                                 &a_event->m_reference_count, 1,
+                                 memory_order_relaxed),
                         a_event);
+            return_here = true;
         }
     }
+    ER_INTERLEAVING_POINT();
 
     // Deliver the event to the sending module's event handler.
     //
     // This block is intentionally disconnected from the if-else blocks above to
-    // support the optimization mentioned a few lines up.
-    if (atomic_load(&a_event->m_reference_count) == 0)
+    // support the optimization mentioned a few lines up. It must not re-read
+    // the count: a task that decremented from above 1 could otherwise find it
+    // at 0 after the sending task handled the return, and deliver it again.
+    if (return_here)
     {
+        EventStatsOnReturn(a_event);
+
         ErModule_t *sender = a_event->m_sending_module;
         sender->m_handler(a_event, sender->m_context);
+
+        // Recycle pooled events unless the handler sent the event again.
+        if ((a_event->m_pool != NULL) && !ErEventIsInFlight(a_event))
+        {
+            ErEventPoolFree(a_event->m_pool, a_event);
+        }
+    }
+}
+
+uint32_t ErTimedSend(ErEvent_t *a_event, int64_t a_ms)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_event != NULL);
+    ER_ASSERT(a_ms >= 0);
+    ER_ASSERT_E(IsEventSendable(a_event), a_event);
+
+    // See `ErSendEx()`; the sending module must not subscribe to its own type.
+    const BitRef_t module_bit_ref =
+        GetBitRef((atomic_char *)a_event->m_sending_module->m_subscriptions,
+                  a_event->m_type);
+    ER_ASSERT_E(!(*module_bit_ref.m_byte & module_bit_ref.m_bit_mask),
+                a_event);
+
+    // Only idle events can be sent this way. An event that is already in
+    // flight would end up re-sent to some tasks but not others, and the
+    // reference count could not tell which.
+    ER_ASSERT_E(!ErEventIsInFlight(a_event), a_event);
+
+    const int64_t deadline_us =
+        s_router->m_os_functions.GetTimeUs() + (a_ms * 1000);
+    const size_t sending_task_idx = a_event->m_sending_module->m_task_idx;
+    const ErTask_t *sending_task =
+        &s_router->m_options->m_tasks[sending_task_idx];
+
+    // Tasks are marked before the count is updated for the reasons given in
+    // `ErSendEx()`. Add 1 for the return trip, as `ErSendEx()` does for idle
+    // events.
+    size_t subscribed_task_count = 0;
+    const uint32_t subscribed_task_mask =
+        MarkSubscribedTasks(a_event->m_type, a_event, &subscribed_task_count);
+    atomic_fetch_add_explicit(&a_event->m_reference_count,
+                              subscribed_task_count + 1, memory_order_relaxed);
+    a_event->m_fire_and_forget = false;
+    a_event->m_release         = NULL;
+    a_event->m_lane            = LaneOfType(a_event->m_type);
+    EventStatsOnSend(a_event, true);
+    CaptureOnSend(a_event);
+
+    // Without subscribers the sending task receives the event right away, so
+    // its queue is the only one that can reject it.
+    uint32_t rejected_task_mask = 0;
+    size_t rejected_task_count  = 0;
+    if (subscribed_task_count == 0)
+    {
+        if (!s_router->m_os_functions.TimedSendEvent(
+                sending_task->m_event_queue, a_event, a_ms))
+        {
+            atomic_store_explicit(&a_event->m_reference_count, 0,
+                                  memory_order_relaxed);
+            EventStatsOnUnsent(a_event);
+            return 1 << sending_task_idx;
+        }
+        return 0;
+    }
+
+    for (size_t idx = 0; idx < s_router->m_options->m_num_tasks; ++idx)
+    {
+        if (subscribed_task_mask & (1 << idx))
+        {
+            // All the tasks share one deadline; later tasks get what is left.
+            const int64_t remaining_us =
+                deadline_us - s_router->m_os_functions.GetTimeUs();
+            const int64_t remaining_ms =
+                (remaining_us > 0) ? (remaining_us / 1000) : 0;
+
+            // Tasks with an overflow policy apply it once the wait is over.
+            const ErTask_t *task = &s_router->m_options->m_tasks[idx];
+            if (!ConflateQueuedEvent(idx, a_event) &&
+                !s_router->m_os_functions.TimedSendEvent(
+                    task->m_event_queue, a_event, remaining_ms) &&
+                ((task->m_overflow_policy == ER_OVERFLOW_POLICY__BLOCK) ||
+                 !HandleOverflow(idx, a_event)))
+            {
+                rejected_task_mask |= 1 << idx;
+                rejected_task_count += 1;
+            }
+        }
+    }
+
+    if (rejected_task_count == subscribed_task_count)
+    {
+        // No task received the event, so nothing else refers to it. Leave it
+        // idle; the caller still owns it and may send it again.
+        atomic_store_explicit(&a_event->m_reference_count, 0,
+                              memory_order_relaxed);
+        EventStatsOnUnsent(a_event);
+    }
+    else if (rejected_task_count > 0)
+    {
+        // The tasks that did receive the event hold the count above 1 until
+        // they are done; if they already are, this returns the event.
+        DropReferences(a_event, rejected_task_count);
+    }
+
+    return rejected_task_mask;
+}
+
+uint32_t ErTrySend(ErEvent_t *a_event)
+{
+    return ErTimedSend(a_event, 0);
+}
+
+void ErNotify(ErEventType_t a_type)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(IsEventTypeRoutable(a_type));
+
+    size_t subscribed_task_count = 0;
+    const uint32_t subscribed_task_mask =
+        MarkSubscribedTasks(a_type, NULL, &subscribed_task_count);
+
+    for (size_t idx = 0; idx < s_router->m_options->m_num_tasks; ++idx)
+    {
+        if ((subscribed_task_mask & (1 << idx)) == 0)
+        {
+            continue;
+        }
+
+        // If the bit was already set, whoever set it is responsible for the
+        // wakeup; the task has not looked at it since.
+        Notifications_t *notifications = &s_router->m_notifications[idx];
+        const BitRef_t bit_ref =
+            GetBitRef(notifications->m_pending, a_type - ER_EVENT_TYPE__FIRST);
+        if ((atomic_fetch_or(bit_ref.m_byte, bit_ref.m_bit_mask) &
+             bit_ref.m_bit_mask) == 0)
+        {
+            WakeTask(idx);
+        }
     }
 }
 
 void ErSubscribe(ErModule_t *a_module, ErEventType_t a_event_type)
 {
-    ER_ASSERT(s_context.m_initialized);
+    ER_ASSERT(s_router->m_initialized);
     ER_ASSERT(IsModuleOwned(a_module));
     ER_ASSERT(IsEventTypeRoutable(a_event_type));
 
@@ -648,7 +1890,7 @@ void ErSubscribe(ErModule_t *a_module, ErEventType_t a_event_type)
     atomic_fetch_or(module_bit_ref.m_byte, module_bit_ref.m_bit_mask);
 
     // Set the subscription bit for the task that owns this module.
-    const ErTask_t *task = &s_context.m_options->m_tasks[a_module->m_task_idx];
+    const ErTask_t *task = &s_router->m_options->m_tasks[a_module->m_task_idx];
     const BitRef_t task_bit_ref =
         GetBitRef((atomic_char *)task->m_subscriptions, a_event_type);
     atomic_fetch_or(task_bit_ref.m_byte, task_bit_ref.m_bit_mask);
@@ -656,7 +1898,7 @@ void ErSubscribe(ErModule_t *a_module, ErEventType_t a_event_type)
 
 void ErUnsubscribe(ErModule_t *a_module, ErEventType_t a_event_type)
 {
-    ER_ASSERT(s_context.m_initialized);
+    ER_ASSERT(s_router->m_initialized);
     ER_ASSERT(IsModuleOwned(a_module));
     ER_ASSERT(IsEventTypeRoutable(a_event_type));
 
@@ -667,7 +1909,7 @@ void ErUnsubscribe(ErModule_t *a_module, ErEventType_t a_event_type)
     *bit_ref.m_byte &= ~bit_ref.m_bit_mask;
 
     // Clear the task's subscription bit if none of its modules are subscribed.
-    const ErTask_t *task = &s_context.m_options->m_tasks[a_module->m_task_idx];
+    const ErTask_t *task = &s_router->m_options->m_tasks[a_module->m_task_idx];
     bool any_subscriptions = false;
     for (size_t module_idx = 0; module_idx < task->m_num_modules; ++module_idx)
     {
@@ -698,38 +1940,352 @@ void ErUnsubscribe(ErModule_t *a_module, ErEventType_t a_event_type)
     }
 }
 
-ErEvent_t *ErReceive(void)
+//==============================================================================
+// Task Statistics
+//==============================================================================
+
+#if ER_TASK_STATS
+/// Called by the current task right before it waits for its next event.
+static void TaskStatsBeginWait(size_t a_task_idx)
+{
+    TaskStats_t *stats   = &s_router->m_task_stats[a_task_idx];
+    const ErTask_t *task = &s_router->m_options->m_tasks[a_task_idx];
+    const int64_t now_us = s_router->m_os_functions.GetTimeUs();
+
+    stats->m_depth =
+        s_router->m_os_functions.GetQueueDepth(task->m_event_queue);
+
+    if (stats->m_started)
+    {
+        // Everything since the last receive returned was spent handling the
+        // event it returned (or doing other work in the task's loop). If more
+        // events arrived in the meantime the task never had a chance to idle.
+        stats->m_busy_us   = now_us - stats->m_last_return_us;
+        stats->m_saturated = (stats->m_depth > 0);
+    }
+    else
+    {
+        stats->m_started         = true;
+        stats->m_window_start_us = now_us;
+    }
+
+    stats->m_wait_start_us = now_us;
+}
+
+/// Called by the current task once its wait for an event is over, whether or
+/// not an event arrived. Publishes updated statistics.
+static void TaskStatsEndWait(size_t a_task_idx)
+{
+    TaskStats_t *stats       = &s_router->m_task_stats[a_task_idx];
+    const int64_t now_us     = s_router->m_os_functions.GetTimeUs();
+    const int64_t blocked_us = now_us - stats->m_wait_start_us;
+
+    stats->m_last_return_us = now_us;
+    stats->m_window_busy_us += stats->m_busy_us;
+    stats->m_window_blocked_us += blocked_us;
+    stats->m_window_receives += 1;
+    stats->m_window_saturated += stats->m_saturated;
+
+    // Only this task writes `m_published`; bracketing the update with odd and
+    // even sequence numbers is enough to let readers detect torn copies.
+    const unsigned sequence =
+        atomic_load_explicit(&stats->m_sequence, memory_order_relaxed);
+    atomic_store_explicit(&stats->m_sequence, sequence + 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    ErTaskStats_t *published = &stats->m_published;
+    published->m_busy_us += stats->m_busy_us;
+    published->m_blocked_us += blocked_us;
+    published->m_receives += 1;
+    published->m_saturated_receives += stats->m_saturated;
+    published->m_queue_depth = stats->m_depth;
+
+    if ((now_us - stats->m_window_start_us) >=
+        ((int64_t)ER_TASK_STATS_WINDOW_MS * 1000))
+    {
+        const int64_t total_us =
+            stats->m_window_busy_us + stats->m_window_blocked_us;
+        published->m_utilization_permille =
+            (total_us > 0) ? ((stats->m_window_busy_us * 1000) / total_us) : 0;
+        published->m_saturation_permille =
+            (stats->m_window_saturated * 1000) / stats->m_window_receives;
+
+        stats->m_window_start_us   = now_us;
+        stats->m_window_busy_us    = 0;
+        stats->m_window_blocked_us = 0;
+        stats->m_window_receives   = 0;
+        stats->m_window_saturated  = 0;
+    }
+
+    atomic_store_explicit(&stats->m_sequence, sequence + 2,
+                          memory_order_release);
+
+    stats->m_busy_us   = 0;
+    stats->m_saturated = false;
+}
+
+void ErGetTaskStats(size_t a_task_idx, ErTaskStats_t *a_stats)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_task_idx < s_router->m_options->m_num_tasks);
+    ER_ASSERT(a_stats != NULL);
+
+    TaskStats_t *stats = &s_router->m_task_stats[a_task_idx];
+    unsigned before    = 0;
+    unsigned after     = 0;
+    do
+    {
+        before = atomic_load_explicit(&stats->m_sequence, memory_order_acquire);
+        memcpy(a_stats, &stats->m_published, sizeof(*a_stats));
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&stats->m_sequence, memory_order_relaxed);
+    } while ((before != after) || (before & 1));
+}
+#else
+static void TaskStatsBeginWait(size_t a_task_idx)
+{
+    ER_UNUSED(a_task_idx);
+}
+
+static void TaskStatsEndWait(size_t a_task_idx)
+{
+    ER_UNUSED(a_task_idx);
+}
+#endif
+
+#if ER_EVENT_STATS
+void ErGetEventTypeStats(ErEventType_t a_type, ErEventTypeStats_t *a_stats)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(IsEventTypeRoutable(a_type));
+    ER_ASSERT(a_stats != NULL);
+
+    EventTypeStats_t *stats =
+        &s_router->m_type_stats[a_type - ER_EVENT_TYPE__FIRST];
+    a_stats->m_sends =
+        atomic_load_explicit(&stats->m_sends, memory_order_relaxed);
+    a_stats->m_returns =
+        atomic_load_explicit(&stats->m_returns, memory_order_relaxed);
+    for (size_t idx = 0; idx < ER_LATENCY_BUCKET_COUNT; ++idx)
+    {
+        a_stats->m_latency_buckets[idx] = atomic_load_explicit(
+            &stats->m_latency_buckets[idx], memory_order_relaxed);
+    }
+}
+#endif
+
+size_t ErGetTaskQueueDepth(size_t a_task_idx)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_task_idx < s_router->m_options->m_num_tasks);
+
+    const ErTask_t *task = &s_router->m_options->m_tasks[a_task_idx];
+    return s_router->m_os_functions.GetQueueDepth(task->m_event_queue);
+}
+
+uint64_t ErGetTaskDropCount(size_t a_task_idx)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_task_idx < s_router->m_options->m_num_tasks);
+
+    return atomic_load_explicit(&s_router->m_task_drops[a_task_idx],
+                                memory_order_relaxed);
+}
+
+size_t ErGetKeyPartition(uint32_t a_key)
+{
+    // Fibonacci hashing spreads nearby keys apart, and scaling the high bits
+    // of the hash avoids the weak low ones.
+    const uint32_t hash = (uint32_t)(a_key * UINT32_C(2654435769));
+    return (size_t)(((uint64_t)hash * ER_KEY_PARTITIONS) >> 32);
+}
+
+size_t ErGetPartitionTask(size_t a_group, size_t a_partition)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT((a_group > 0) && (a_group <= s_router->m_last_worker_group));
+    ER_ASSERT(a_partition < ER_KEY_PARTITIONS);
+
+    return atomic_load_explicit(
+        &s_router->m_partition_owners[a_group][a_partition],
+        memory_order_relaxed);
+}
+
+void ErRebalancePartitions(size_t a_group, uint32_t a_task_mask)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT((a_group > 0) && (a_group <= s_router->m_last_worker_group));
+    ER_ASSERT(a_task_mask != 0);
+    ER_ASSERT((a_task_mask & ~s_router->m_worker_groups[a_group]) == 0);
+
+    SpreadPartitions(a_group, a_task_mask);
+}
+
+/// Returns the next event the task at `a_task_idx` is owed outside its queue,
+/// or NULL if there is none. Parked returns come first, newest first; then
+/// the lowest pending notification type is cleared and returned in the task's
+/// notification event.
+static ErEvent_t *TakeNotification(size_t a_task_idx)
+{
+    Notifications_t *notifications = &s_router->m_notifications[a_task_idx];
+
+    // Only this task pops, so the head can't be popped and pushed again
+    // between the load and the exchange.
+    ErEvent_t *parked = atomic_load(&notifications->m_parked);
+    while ((parked != NULL) &&
+           !atomic_compare_exchange_weak(&notifications->m_parked, &parked,
+                                         parked->m_next_parked))
+    {
+    }
+    if (parked != NULL)
+    {
+        return parked;
+    }
+
+    for (size_t byte_idx = 0; byte_idx < sizeof(notifications->m_pending);
+         ++byte_idx)
+    {
+        atomic_char *byte = &notifications->m_pending[byte_idx];
+        const uint8_t pending = (uint8_t)atomic_load(byte);
+
+        for (size_t bit = 0; bit < CHAR_BIT; ++bit)
+        {
+            const uint8_t bit_mask = (uint8_t)(1 << bit);
+            if (pending & bit_mask)
+            {
+                atomic_fetch_and(byte, (char)~bit_mask);
+                notifications->m_event.m_type =
+                    (ErEventType_t)(ER_EVENT_TYPE__FIRST +
+                                    (byte_idx * CHAR_BIT) + bit);
+                return &notifications->m_event;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/// Implements `ErReceive()` (`a_timed` false) and `ErTimedReceive()`. Parked
+/// returns and pending notifications are returned before waiting; wakeups
+/// posted by `WakeTask()` are consumed here and never returned.
+static ErEvent_t *Receive(bool a_timed, int64_t a_ms)
 {
     WaitUntilInitComplete();
 
-    const ErTask_t *task =
-        &s_context.m_options->m_tasks[GetIndexOfCurrentTask()];
-    ErEvent_t *event = NULL;
-    s_context.m_os_functions.ReceiveEvent(task->m_event_queue, &event);
+    const size_t task_idx = GetIndexOfCurrentTask();
+    const ErTask_t *task  = &s_router->m_options->m_tasks[task_idx];
+    Notifications_t *notifications = &s_router->m_notifications[task_idx];
+    const int64_t deadline_us =
+        a_timed ? (s_router->m_os_functions.GetTimeUs() + (a_ms * 1000)) : 0;
+    int64_t wait_ms  = a_ms;
+    ErEvent_t *event = TakeNotification(task_idx);
+
+    while (event == NULL)
+    {
+        FlushReturnsBeforeBlocking(task_idx);
+
+        // A wakeup that found the queue full was never posted, and with the
+        // queue empty nothing else would wake this task for it. Clearing the
+        // flag first means later notifications post their own wakeup; if
+        // one was still on its way the task just receives it twice.
+        if (atomic_load(&notifications->m_wakeup_queued) &&
+            (s_router->m_os_functions.GetQueueDepth(task->m_event_queue) == 0))
+        {
+            atomic_store(&notifications->m_wakeup_queued, false);
+            event = TakeNotification(task_idx);
+            if (event != NULL)
+            {
+                break;
+            }
+        }
+
+        TaskStatsBeginWait(task_idx);
+        if (a_timed)
+        {
+            s_router->m_os_functions.TimedReceiveEvent(task->m_event_queue,
+                                                       &event, wait_ms);
+        }
+        else
+        {
+            s_router->m_os_functions.ReceiveEvent(task->m_event_queue, &event);
+        }
+        TaskStatsEndWait(task_idx);
+
+        if (event != &notifications->m_wakeup)
+        {
+            break;
+        }
+
+        // Any notification posted after this store queues a new wakeup, so
+        // none can be missed between the check below and the next wait.
+        atomic_store(&notifications->m_wakeup_queued, false);
+        event = TakeNotification(task_idx);
+
+        if (a_timed)
+        {
+            const int64_t remaining_us =
+                deadline_us - s_router->m_os_functions.GetTimeUs();
+            wait_ms = (remaining_us > 0) ? (remaining_us / 1000) : 0;
+        }
+    }
+
+    if (event != NULL)
+    {
+        FlushReturnsAfterReceive(task_idx);
+    }
+    return event;
+}
+
+ErEvent_t *ErReceive(void)
+{
+    ErEvent_t *event = Receive(false, 0);
     ER_ASSERT(event != NULL);
     return event;
 }
 
 ErEvent_t *ErTimedReceive(int64_t a_ms)
 {
-    WaitUntilInitComplete();
+    return Receive(true, a_ms);
+}
 
-    const ErTask_t *task =
-        &s_context.m_options->m_tasks[GetIndexOfCurrentTask()];
-    ErEvent_t *event = NULL;
-    s_context.m_os_functions.TimedReceiveEvent(task->m_event_queue, &event,
-                                               a_ms);
-    return event;
+void ErFlushReturns(void)
+{
+    ER_ASSERT(s_router->m_initialized);
+#if ER_RETURN_BATCH_SIZE > 0
+    FlushReturns(GetIndexOfCurrentTask());
+#endif
 }
 
 void ErSetOsFunctions(const ErOsFunctions_t *a_fns)
 {
-    ER_ASSERT(s_context.m_initialized);
+    ER_ASSERT(s_router->m_initialized);
     ER_ASSERT(a_fns != NULL);
     ER_ASSERT(a_fns->SendEvent != NULL);
+    ER_ASSERT(a_fns->SendEvents != NULL);
+    ER_ASSERT(a_fns->TimedSendEvent != NULL);
+    ER_ASSERT(a_fns->DisplaceEvent != NULL);
     ER_ASSERT(a_fns->ReceiveEvent != NULL);
     ER_ASSERT(a_fns->TimedReceiveEvent != NULL);
     ER_ASSERT(a_fns->GetCurrentTaskHandle != NULL);
+    ER_ASSERT(a_fns->GetTimeUs != NULL);
+    ER_ASSERT(a_fns->GetQueueDepth != NULL);
 
-    s_context.m_os_functions = *a_fns;
+    s_router->m_os_functions = *a_fns;
 }
+
+#if ER_IMPLEMENTATION == ER_IMPL_POSIX
+#include "fan_out_posix.c"
+#include "offload_posix.c"
+#include "pool_posix.c"
+#include "shm_bridge_posix.c"
+#include "socket_bridge_posix.c"
+#include "stats_shm_posix.c"
+#include "durable_log_posix.c"
+#if ER_SHARDS
+#include "shard_posix.c"
+#endif
+#if ER_CAPTURE
+#include "capture_posix.c"
+#endif
+#endif
@@ -0,0 +1,217 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+// NOTE: This file is included at the end of eventrouter_os.c and reads the
+// calling thread's `s_router` directly; it is not compiled on its own.
+
+/// @file Helper threads for `ErFanOutStart()`. When a task delivers an event,
+/// every parallel-safe module after the first is handed to a helper through a
+/// bounded ring, and the task runs the first one itself. The task then waits
+/// for the helpers before it drops its reference to the event, so the event is
+/// returned exactly as if the modules had run one after another.
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// How many deliveries each helper can have waiting. When the ring is full
+/// the task runs the module itself instead of waiting for room.
+#define FAN_OUT_JOBS_PER_HELPER 4
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+typedef struct
+{
+    FanOut_t *m_fan_out;
+    ErModule_t *m_module;
+    ErEvent_t *m_event;
+} Delivery_t;
+
+//==============================================================================
+// Static Variables
+//==============================================================================
+
+static struct
+{
+    pthread_mutex_t m_mutex; //< Guards everything below.
+    pthread_cond_t m_work;   //< Wakes helpers.
+    pthread_cond_t m_done;   //< Wakes tasks joining their helpers.
+    // Also read without the mutex, so that tasks that never fan out don't
+    // take it.
+    atomic_bool m_running;
+    pthread_t *m_threads;
+    size_t m_num_threads;
+    // A ring of deliveries waiting for a helper.
+    Delivery_t *m_jobs;
+    size_t m_capacity;
+    size_t m_head;
+    size_t m_size;
+} s_fan_out = {
+    .m_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .m_work  = PTHREAD_COND_INITIALIZER,
+    .m_done  = PTHREAD_COND_INITIALIZER,
+};
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+static void *FanOutThread(void *a_unused)
+{
+    ER_UNUSED(a_unused);
+
+    pthread_mutex_lock(&s_fan_out.m_mutex);
+    for (;;)
+    {
+        while (s_fan_out.m_running && (s_fan_out.m_size == 0))
+        {
+            pthread_cond_wait(&s_fan_out.m_work, &s_fan_out.m_mutex);
+        }
+        // Stopping waits for the ring to drain; tasks are waiting on it.
+        if (s_fan_out.m_size == 0)
+        {
+            break;
+        }
+
+        const Delivery_t job = s_fan_out.m_jobs[s_fan_out.m_head];
+        s_fan_out.m_head     = (s_fan_out.m_head + 1) % s_fan_out.m_capacity;
+        s_fan_out.m_size    -= 1;
+        pthread_mutex_unlock(&s_fan_out.m_mutex);
+
+        // The module belongs to the task that handed it over, so the helper
+        // counts as that task, of that task's router, while it runs.
+        s_pool_worker_task = job.m_fan_out->m_task_idx + 1;
+        s_router           = job.m_fan_out->m_router;
+        DeliverToModule(job.m_module, job.m_event);
+        s_pool_worker_task = 0;
+
+        pthread_mutex_lock(&s_fan_out.m_mutex);
+        job.m_fan_out->m_pending -= 1;
+        if (job.m_fan_out->m_pending == 0)
+        {
+            pthread_cond_broadcast(&s_fan_out.m_done);
+        }
+    }
+    pthread_mutex_unlock(&s_fan_out.m_mutex);
+
+    return NULL;
+}
+
+/// Hands `a_module` to a helper, or holds it for `FanOutJoin()`. Returns false
+/// if the caller has to deliver the event to the module itself.
+static bool FanOutModule(FanOut_t *a_fan_out, ErModule_t *a_module,
+                         ErEvent_t *a_event)
+{
+    // Helpers never fan out again; they'd be waiting on each other.
+    if (!a_module->m_parallel_safe || IsHelperThread() ||
+        !atomic_load_explicit(&s_fan_out.m_running, memory_order_relaxed))
+    {
+        return false;
+    }
+    if (a_fan_out->m_held_module == NULL)
+    {
+        // The task runs one module itself while the helpers run the rest, so
+        // it isn't worth waking a helper until there is a second one.
+        a_fan_out->m_held_module = a_module;
+        return true;
+    }
+
+    pthread_mutex_lock(&s_fan_out.m_mutex);
+    const bool has_room =
+        s_fan_out.m_running && (s_fan_out.m_size < s_fan_out.m_capacity);
+    if (has_room)
+    {
+        s_fan_out.m_jobs[(s_fan_out.m_head + s_fan_out.m_size) %
+                         s_fan_out.m_capacity] = (Delivery_t){
+            .m_fan_out = a_fan_out,
+            .m_module  = a_module,
+            .m_event   = a_event,
+        };
+        s_fan_out.m_size    += 1;
+        a_fan_out->m_pending += 1;
+        pthread_cond_signal(&s_fan_out.m_work);
+    }
+    pthread_mutex_unlock(&s_fan_out.m_mutex);
+
+    return has_room;
+}
+
+/// Delivers `a_event` to the held module and waits for the helpers to finish
+/// with the others.
+static void FanOutJoin(FanOut_t *a_fan_out, ErEvent_t *a_event)
+{
+    if (a_fan_out->m_held_module == NULL)
+    {
+        return;
+    }
+    DeliverToModule(a_fan_out->m_held_module, a_event);
+
+    // The mutex orders everything the helpers did with the event before this
+    // task drops its reference.
+    pthread_mutex_lock(&s_fan_out.m_mutex);
+    while (a_fan_out->m_pending != 0)
+    {
+        pthread_cond_wait(&s_fan_out.m_done, &s_fan_out.m_mutex);
+    }
+    pthread_mutex_unlock(&s_fan_out.m_mutex);
+}
+
+//==============================================================================
+// Public Functions
+//==============================================================================
+
+bool ErFanOutStart(size_t a_num_helpers)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_num_helpers > 0);
+
+    pthread_mutex_lock(&s_fan_out.m_mutex);
+    ER_ASSERT(!s_fan_out.m_running);
+
+    s_fan_out.m_capacity    = a_num_helpers * FAN_OUT_JOBS_PER_HELPER;
+    s_fan_out.m_threads     = calloc(a_num_helpers, sizeof(pthread_t));
+    s_fan_out.m_jobs        = calloc(s_fan_out.m_capacity, sizeof(Delivery_t));
+    s_fan_out.m_head        = 0;
+    s_fan_out.m_size        = 0;
+    s_fan_out.m_num_threads = 0;
+
+    if ((s_fan_out.m_threads != NULL) && (s_fan_out.m_jobs != NULL))
+    {
+        s_fan_out.m_running = true;
+        while ((s_fan_out.m_num_threads < a_num_helpers) &&
+               (pthread_create(&s_fan_out.m_threads[s_fan_out.m_num_threads],
+                               NULL, FanOutThread, NULL) == 0))
+        {
+            s_fan_out.m_num_threads += 1;
+        }
+    }
+    const bool result = (s_fan_out.m_num_threads == a_num_helpers);
+    pthread_mutex_unlock(&s_fan_out.m_mutex);
+
+    if (!result)
+    {
+        ErFanOutStop();
+    }
+    return result;
+}
+
+void ErFanOutStop(void)
+{
+    pthread_mutex_lock(&s_fan_out.m_mutex);
+    s_fan_out.m_running = false;
+    pthread_cond_broadcast(&s_fan_out.m_work);
+    pthread_mutex_unlock(&s_fan_out.m_mutex);
+
+    for (size_t idx = 0; idx < s_fan_out.m_num_threads; ++idx)
+    {
+        pthread_join(s_fan_out.m_threads[idx], NULL);
+    }
+
+    free(s_fan_out.m_threads);
+    free(s_fan_out.m_jobs);
+    s_fan_out.m_threads     = NULL;
+    s_fan_out.m_jobs        = NULL;
+    s_fan_out.m_num_threads = 0;
+}
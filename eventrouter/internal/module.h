@@ -3,6 +3,7 @@
 
 #include <inttypes.h>
 #include <limits.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 #include "atomic.h"
@@ -21,6 +22,11 @@ extern "C"
     {
         ErEventHandler_t m_handler;  /// Where events are delivered/returned.
         void *m_context;  /// Passed to `m_handler` when an event is delivered.
+        /// Set if `m_handler` may run at the same time as the handlers of
+        /// other modules in its task; see `ErFanOutStart()`. Only the POSIX
+        /// implementation acts on it, and it MUST NOT change while the module
+        /// is subscribed to anything.
+        bool m_parallel_safe;
 
         // Implementation details.
         size_t m_task_idx;
@@ -31,10 +37,11 @@ extern "C"
 
     /// Used to initialize `ErModule_t` definitions while avoiding
     /// missing-field-initializers warnings.
-#define ER_CREATE_MODULE(a_handler, a_context)                           \
-    {                                                                    \
-        .m_handler = a_handler, .m_context = a_context, .m_task_idx = 0, \
-        .m_module_idx = 0, .m_subscriptions = {0},                       \
+#define ER_CREATE_MODULE(a_handler, a_context)                        \
+    {                                                                 \
+        .m_handler = a_handler, .m_context = a_context,               \
+        .m_parallel_safe = false, .m_task_idx = 0, .m_module_idx = 0, \
+        .m_subscriptions = {0},                                       \
     }
 
 #ifdef __cplusplus
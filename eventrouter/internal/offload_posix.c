@@ -0,0 +1,211 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+// NOTE: This file is included at the end of eventrouter_os.c and reads the
+// calling thread's `s_router` directly; it is not compiled on its own.
+
+/// @file A shared pool of threads for `ErOffload()`. Handlers post work items
+/// to a bounded ring; workers run them in order and return each event to its
+/// sender when its work is done. Workers belong to no task, so those returns
+/// always travel through the sending task's queue, and never wait for room in
+/// it: a handler of that task may be waiting for room in the ring.
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+typedef struct
+{
+    ErEvent_t *m_event;
+    ErOffloadWork_t m_work;
+    void *m_context;
+    ErRouter_t *m_router;  //< The router `m_event` was sent through.
+} Job_t;
+
+//==============================================================================
+// Static Variables
+//==============================================================================
+
+static struct
+{
+    pthread_mutex_t m_mutex;    //< Guards everything below.
+    pthread_cond_t m_not_empty; //< Wakes workers.
+    pthread_cond_t m_not_full;  //< Wakes handlers waiting for room.
+    bool m_running;
+    pthread_t *m_threads;
+    size_t m_num_threads;
+    // A ring of work waiting for a worker.
+    Job_t *m_jobs;
+    size_t m_capacity;
+    size_t m_head;
+    size_t m_size;
+    ErOffloadStats_t m_stats;
+} s_offload = {
+    .m_mutex     = PTHREAD_MUTEX_INITIALIZER,
+    .m_not_empty = PTHREAD_COND_INITIALIZER,
+    .m_not_full  = PTHREAD_COND_INITIALIZER,
+};
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+static void *OffloadThread(void *a_unused)
+{
+    ER_UNUSED(a_unused);
+    s_offload_worker = true;
+
+    pthread_mutex_lock(&s_offload.m_mutex);
+    for (;;)
+    {
+        while (s_offload.m_running && (s_offload.m_size == 0))
+        {
+            pthread_cond_wait(&s_offload.m_not_empty, &s_offload.m_mutex);
+        }
+        // Stopping waits for the ring to drain.
+        if (s_offload.m_size == 0)
+        {
+            break;
+        }
+
+        const Job_t job   = s_offload.m_jobs[s_offload.m_head];
+        s_offload.m_head  = (s_offload.m_head + 1) % s_offload.m_capacity;
+        s_offload.m_size -= 1;
+
+        s_offload.m_stats.m_queued = s_offload.m_size;
+        pthread_cond_signal(&s_offload.m_not_full);
+        pthread_mutex_unlock(&s_offload.m_mutex);
+
+        // The pool is shared by every router.
+        s_router               = job.m_router;
+        const int64_t start_us = s_router->m_os_functions.GetTimeUs();
+        job.m_work(job.m_event, job.m_context);
+        const int64_t busy_us = s_router->m_os_functions.GetTimeUs() - start_us;
+
+        // Count the work before the event can reach its sender.
+        pthread_mutex_lock(&s_offload.m_mutex);
+        s_offload.m_stats.m_jobs    += 1;
+        s_offload.m_stats.m_busy_us += busy_us;
+        pthread_mutex_unlock(&s_offload.m_mutex);
+
+        ErReturnToSender(job.m_event);
+        pthread_mutex_lock(&s_offload.m_mutex);
+    }
+    pthread_mutex_unlock(&s_offload.m_mutex);
+
+    return NULL;
+}
+
+//==============================================================================
+// Public Functions
+//==============================================================================
+
+bool ErOffloadStart(size_t a_num_workers, size_t a_capacity)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_num_workers > 0);
+    ER_ASSERT(a_capacity > 0);
+
+    pthread_mutex_lock(&s_offload.m_mutex);
+    ER_ASSERT(!s_offload.m_running);
+
+    s_offload.m_threads     = calloc(a_num_workers, sizeof(pthread_t));
+    s_offload.m_jobs        = calloc(a_capacity, sizeof(Job_t));
+    s_offload.m_capacity    = a_capacity;
+    s_offload.m_head        = 0;
+    s_offload.m_size        = 0;
+    s_offload.m_num_threads = 0;
+    memset(&s_offload.m_stats, 0, sizeof(s_offload.m_stats));
+
+    if ((s_offload.m_threads != NULL) && (s_offload.m_jobs != NULL))
+    {
+        s_offload.m_running = true;
+        while ((s_offload.m_num_threads < a_num_workers) &&
+               (pthread_create(&s_offload.m_threads[s_offload.m_num_threads],
+                               NULL, OffloadThread, NULL) == 0))
+        {
+            s_offload.m_num_threads += 1;
+        }
+    }
+    const bool result = (s_offload.m_num_threads == a_num_workers);
+    pthread_mutex_unlock(&s_offload.m_mutex);
+
+    if (!result)
+    {
+        ErOffloadStop();
+    }
+    return result;
+}
+
+ErEventHandlerRet_t ErOffload(ErEvent_t *a_event, ErOffloadWork_t a_work,
+                              void *a_context)
+{
+    ER_ASSERT(a_event != NULL);
+    ER_ASSERT(a_work != NULL);
+    // Notifications can't be kept, so they can't wait for a worker either.
+    ER_ASSERT(a_event->m_sending_module != NULL);
+
+    // The work item holds a reference of its own, taken before a worker can
+    // drop it; this is what `ErCallHandlers()` does for KEPT events, so the
+    // handler's part is done. The caller holds a reference, so nothing is
+    // ordered by the increment.
+    atomic_fetch_add_explicit(&a_event->m_reference_count, 1,
+                              memory_order_relaxed);
+
+    pthread_mutex_lock(&s_offload.m_mutex);
+    ER_ASSERT(s_offload.m_running);
+    if (s_offload.m_size == s_offload.m_capacity)
+    {
+        s_offload.m_stats.m_waits += 1;
+        do
+        {
+            pthread_cond_wait(&s_offload.m_not_full, &s_offload.m_mutex);
+        } while (s_offload.m_size == s_offload.m_capacity);
+    }
+
+    s_offload.m_jobs[(s_offload.m_head + s_offload.m_size) %
+                     s_offload.m_capacity] = (Job_t){
+        .m_event   = a_event,
+        .m_work    = a_work,
+        .m_context = a_context,
+        .m_router  = s_router,
+    };
+    s_offload.m_size += 1;
+    s_offload.m_stats.m_queued = s_offload.m_size;
+    if (s_offload.m_size > s_offload.m_stats.m_peak_queued)
+    {
+        s_offload.m_stats.m_peak_queued = s_offload.m_size;
+    }
+    pthread_cond_signal(&s_offload.m_not_empty);
+    pthread_mutex_unlock(&s_offload.m_mutex);
+
+    return ER_EVENT_HANDLER_RET__HANDLED;
+}
+
+void ErGetOffloadStats(ErOffloadStats_t *a_stats)
+{
+    ER_ASSERT(a_stats != NULL);
+
+    pthread_mutex_lock(&s_offload.m_mutex);
+    *a_stats = s_offload.m_stats;
+    pthread_mutex_unlock(&s_offload.m_mutex);
+}
+
+void ErOffloadStop(void)
+{
+    pthread_mutex_lock(&s_offload.m_mutex);
+    s_offload.m_running = false;
+    pthread_cond_broadcast(&s_offload.m_not_empty);
+    pthread_mutex_unlock(&s_offload.m_mutex);
+
+    for (size_t idx = 0; idx < s_offload.m_num_threads; ++idx)
+    {
+        pthread_join(s_offload.m_threads[idx], NULL);
+    }
+
+    free(s_offload.m_threads);
+    free(s_offload.m_jobs);
+    s_offload.m_threads     = NULL;
+    s_offload.m_jobs        = NULL;
+    s_offload.m_num_threads = 0;
+}
@@ -21,10 +21,26 @@ extern "C"
     typedef struct
     {
         void (*SendEvent)(ErQueueHandle_t a_queue, void *a_event);
+        /// Sends `a_count` events to `a_queue` in order; never called in ISRs.
+        void (*SendEvents)(ErQueueHandle_t a_queue, ErEvent_t *const *a_events,
+                           size_t a_count);
+        /// Sends `a_event` to `a_queue` if there is room within `a_ms`, and
+        /// returns whether it did; it must not wait when called in an ISR.
+        bool (*TimedSendEvent)(ErQueueHandle_t a_queue, ErEvent_t *a_event,
+                               int64_t a_ms);
+        /// Behaves like `ErQueueDisplace()`; it may always return NULL in
+        /// ISRs, which drops the event being sent.
+        ErEvent_t *(*DisplaceEvent)(ErQueueHandle_t a_queue, ErEvent_t *a_event,
+                                    ErQueueMatch_t a_match, bool a_in_place);
         void (*ReceiveEvent)(ErQueueHandle_t a_queue, ErEvent_t **a_event);
         void (*TimedReceiveEvent)(ErQueueHandle_t a_queue, ErEvent_t **a_event,
                                   int64_t a_ms);
         ErTaskHandle_t (*GetCurrentTaskHandle)(void);
+        /// Returns a monotonic timestamp in microseconds; the resolution may
+        /// be coarser (e.g. one tick) but the unit must be microseconds.
+        int64_t (*GetTimeUs)(void);
+        /// Returns the number of events waiting in `a_queue`.
+        size_t (*GetQueueDepth)(ErQueueHandle_t a_queue);
     } ErOsFunctions_t;
 
     /// Overrides the OS functions used by this module. This makes testing
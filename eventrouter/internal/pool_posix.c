@@ -0,0 +1,477 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+// NOTE: This file is included at the end of eventrouter_os.c and reads the
+// calling thread's `s_router` directly; it is not compiled on its own.
+
+/// @file Runs the modules of one task as actors on a work-stealing pool of
+/// threads. The task's own thread receives events as usual and hands them to
+/// `ErPoolDispatch()`, which posts them to the mailbox of every subscribed
+/// module. A module with mail is runnable; it sits in exactly one worker's
+/// deque until a worker takes it, and only that worker reads its mailbox
+/// until the mailbox is empty, so each module still handles one event at a
+/// time, in the order they arrived. Workers take the newest module from their
+/// own deque and steal the oldest from the others when they run dry.
+
+//==============================================================================
+// Macros And Defines
+//==============================================================================
+
+/// The most letters a worker handles for one module before it lets others
+/// run; a module with more mail goes to the old end of the worker's deque.
+#define POOL_TURN_LENGTH 16
+
+/// The number of letters a mailbox starts with room for; it grows as needed.
+#define POOL_MAILBOX_CAPACITY 16
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+/// One event (or notification) for one module.
+typedef struct
+{
+    ErEvent_t *m_event;  //< NULL for a notification of `m_type`.
+    ErEventType_t m_type;
+    bool m_returning;  //< `m_event` is coming back to its sending module.
+} Letter_t;
+
+typedef struct
+{
+    pthread_mutex_t m_mutex;
+    /// True while the module is in a deque or running; letters posted in the
+    /// meantime are picked up by whoever runs it.
+    bool m_scheduled;
+    // A ring of letters that grows when full; never blocks the dispatcher.
+    Letter_t *m_letters;
+    size_t m_capacity;
+    size_t m_head;
+    size_t m_size;
+    /// Carries notifications to the module's handler.
+    ErEvent_t m_notification;
+} Mailbox_t;
+
+typedef struct
+{
+    pthread_mutex_t m_mutex;
+    // A ring of runnable module indices; the owner works at the back and
+    // thieves at the front. Each module is in at most one deque.
+    size_t *m_modules;
+    size_t m_head;
+    size_t m_size;
+    pthread_t m_thread;
+    struct ErPool *m_pool;
+} Worker_t;
+
+/// The pool of one router; see `ErRouter::m_pool`.
+typedef struct ErPool
+{
+    pthread_mutex_t m_mutex;  //< Guards `m_running` and sleeping workers.
+    pthread_cond_t m_cond;    //< Wakes sleeping workers.
+    bool m_running;
+    ErRouter_t *m_router;
+    size_t m_task_idx;
+    const ErTask_t *m_task;
+    Mailbox_t *m_mailboxes;  //< One per module of `m_task`.
+    Worker_t *m_workers;
+    size_t m_num_workers;
+    size_t m_num_started;  //< Workers whose threads are running.
+    /// Gets the next module to become runnable; the task and workers both
+    /// schedule modules.
+    atomic_size_t m_next_worker;
+    atomic_size_t m_runnable;  //< Modules waiting in all deques.
+} ErPool_t;
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+/// Adds `a_module_idx` to the back of `a_worker`'s deque, or to the front if
+/// `a_at_front` is set, and wakes a sleeping worker to take it.
+static void PoolSchedule(Worker_t *a_worker, size_t a_module_idx,
+                         bool a_at_front)
+{
+    ErPool_t *pool        = a_worker->m_pool;
+    const size_t capacity = pool->m_task->m_num_modules;
+
+    pthread_mutex_lock(&a_worker->m_mutex);
+    if (a_at_front)
+    {
+        a_worker->m_head = (a_worker->m_head + capacity - 1) % capacity;
+        a_worker->m_modules[a_worker->m_head] = a_module_idx;
+    }
+    else
+    {
+        a_worker->m_modules[(a_worker->m_head + a_worker->m_size) % capacity] =
+            a_module_idx;
+    }
+    a_worker->m_size += 1;
+    pthread_mutex_unlock(&a_worker->m_mutex);
+
+    // Sleepers check the count under the mutex, so this wakeup can't be lost.
+    atomic_fetch_add_explicit(&pool->m_runnable, 1, memory_order_relaxed);
+    pthread_mutex_lock(&pool->m_mutex);
+    pthread_cond_signal(&pool->m_cond);
+    pthread_mutex_unlock(&pool->m_mutex);
+}
+
+/// Takes a runnable module from the back of `a_worker`'s deque or, failing
+/// that, the front of another's. Returns false if every deque is empty.
+static bool PoolTakeModule(ErPool_t *a_pool, size_t a_worker_idx,
+                           size_t *a_module_idx)
+{
+    const size_t capacity = a_pool->m_task->m_num_modules;
+    bool taken            = false;
+
+    for (size_t offset = 0; !taken && (offset < a_pool->m_num_workers);
+         ++offset)
+    {
+        Worker_t *worker =
+            &a_pool->m_workers[(a_worker_idx + offset) % a_pool->m_num_workers];
+
+        pthread_mutex_lock(&worker->m_mutex);
+        if (worker->m_size > 0)
+        {
+            const bool own = (offset == 0);
+            *a_module_idx =
+                worker->m_modules[own ? ((worker->m_head + worker->m_size - 1) %
+                                         capacity)
+                                      : worker->m_head];
+            worker->m_head = own ? worker->m_head
+                                 : ((worker->m_head + 1) % capacity);
+            worker->m_size -= 1;
+            taken = true;
+        }
+        pthread_mutex_unlock(&worker->m_mutex);
+    }
+
+    if (taken)
+    {
+        atomic_fetch_sub_explicit(&a_pool->m_runnable, 1, memory_order_relaxed);
+    }
+    return taken;
+}
+
+/// Takes the oldest letter from `a_mailbox`. Returns false, and unschedules
+/// the module, if there are none.
+static bool PoolTakeLetter(Mailbox_t *a_mailbox, Letter_t *a_letter)
+{
+    pthread_mutex_lock(&a_mailbox->m_mutex);
+    const bool taken = (a_mailbox->m_size > 0);
+    if (taken)
+    {
+        *a_letter          = a_mailbox->m_letters[a_mailbox->m_head];
+        a_mailbox->m_head  = (a_mailbox->m_head + 1) % a_mailbox->m_capacity;
+        a_mailbox->m_size -= 1;
+    }
+    else
+    {
+        a_mailbox->m_scheduled = false;
+    }
+    pthread_mutex_unlock(&a_mailbox->m_mutex);
+
+    return taken;
+}
+
+/// Hands `a_letter` to `a_module`, the way `ErCallHandlers()` would.
+static void PoolDeliver(ErModule_t *a_module, Mailbox_t *a_mailbox,
+                        const Letter_t *a_letter)
+{
+    ErEvent_t *event = a_letter->m_event;
+
+    if (event == NULL)
+    {
+        a_mailbox->m_notification.m_type = a_letter->m_type;
+        const ErEventHandlerRet_t ret = a_module->m_handler(
+            &a_mailbox->m_notification, a_module->m_context);
+        ER_ASSERT(ret != ER_EVENT_HANDLER_RET__KEPT);
+        return;
+    }
+
+    // Returns finish in `ErReturnToSender()`, which calls the sending module.
+    // Otherwise, the subscription is checked again so that unsubscribing is
+    // as instantaneous as it is for tasks.
+    const BitRef_t bit_ref =
+        GetBitRef((atomic_char *)a_module->m_subscriptions, event->m_type);
+    if (!a_letter->m_returning && (*bit_ref.m_byte & bit_ref.m_bit_mask))
+    {
+        if (a_module->m_handler(event, a_module->m_context) ==
+            ER_EVENT_HANDLER_RET__KEPT)
+        {
+            // This letter still holds a reference, so nothing is ordered by
+            // the increment; see `ErCallHandlers()`.
+            atomic_fetch_add_explicit(&event->m_reference_count, 1,
+                                      memory_order_relaxed);
+        }
+    }
+    ErReturnToSender(event);
+}
+
+/// Posts `a_letter` to the module at `a_module_idx` and schedules the module
+/// if it isn't already.
+static void PoolPost(ErPool_t *a_pool, size_t a_module_idx, Letter_t a_letter)
+{
+    Mailbox_t *mailbox = &a_pool->m_mailboxes[a_module_idx];
+
+    pthread_mutex_lock(&mailbox->m_mutex);
+    if (mailbox->m_size == mailbox->m_capacity)
+    {
+        // Unroll the ring into storage twice the size.
+        Letter_t *letters =
+            malloc(2 * mailbox->m_capacity * sizeof(*letters));
+        ER_ASSERT(letters != NULL);
+        for (size_t idx = 0; idx < mailbox->m_size; ++idx)
+        {
+            letters[idx] = mailbox->m_letters[(mailbox->m_head + idx) %
+                                              mailbox->m_capacity];
+        }
+        free(mailbox->m_letters);
+        mailbox->m_letters   = letters;
+        mailbox->m_capacity *= 2;
+        mailbox->m_head      = 0;
+    }
+    mailbox->m_letters[(mailbox->m_head + mailbox->m_size) %
+                       mailbox->m_capacity] = a_letter;
+    mailbox->m_size += 1;
+    const bool was_scheduled = mailbox->m_scheduled;
+    mailbox->m_scheduled     = true;
+    pthread_mutex_unlock(&mailbox->m_mutex);
+
+    if (!was_scheduled)
+    {
+        const size_t turn = atomic_fetch_add_explicit(
+            &a_pool->m_next_worker, 1, memory_order_relaxed);
+        PoolSchedule(&a_pool->m_workers[turn % a_pool->m_num_workers],
+                     a_module_idx, false);
+    }
+}
+
+static void *PoolWorkerThread(void *a_worker)
+{
+    ErPool_t *pool          = ((Worker_t *)a_worker)->m_pool;
+    const size_t worker_idx = (Worker_t *)a_worker - pool->m_workers;
+    s_pool_worker_task      = pool->m_task_idx + 1;
+    s_router                = pool->m_router;
+
+    for (;;)
+    {
+        size_t module_idx = 0;
+        if (PoolTakeModule(pool, worker_idx, &module_idx))
+        {
+            ErModule_t *module = pool->m_task->m_modules[module_idx];
+            Mailbox_t *mailbox = &pool->m_mailboxes[module_idx];
+            Letter_t letter = {0};
+            size_t handled  = 0;
+            while ((handled < POOL_TURN_LENGTH) &&
+                   PoolTakeLetter(mailbox, &letter))
+            {
+                PoolDeliver(module, mailbox, &letter);
+                handled += 1;
+            }
+
+            // A full turn may have left mail behind; the module is still
+            // scheduled, so it goes back in line.
+            if (handled == POOL_TURN_LENGTH)
+            {
+                PoolSchedule(a_worker, module_idx, true);
+            }
+            continue;
+        }
+
+        // Stopping waits for every deque to drain; the modules still running
+        // can only put themselves back in their own worker's deque.
+        pthread_mutex_lock(&pool->m_mutex);
+        while (pool->m_running &&
+               (atomic_load_explicit(&pool->m_runnable,
+                                     memory_order_relaxed) == 0))
+        {
+            pthread_cond_wait(&pool->m_cond, &pool->m_mutex);
+        }
+        const bool stopped =
+            !pool->m_running &&
+            (atomic_load_explicit(&pool->m_runnable, memory_order_relaxed) ==
+             0);
+        pthread_mutex_unlock(&pool->m_mutex);
+
+        if (stopped)
+        {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/// Frees `a_pool` and everything in it; workers must not be running.
+static void PoolFree(ErPool_t *a_pool)
+{
+    for (size_t idx = 0; idx < a_pool->m_task->m_num_modules; ++idx)
+    {
+        pthread_mutex_destroy(&a_pool->m_mailboxes[idx].m_mutex);
+        free(a_pool->m_mailboxes[idx].m_letters);
+    }
+    for (size_t idx = 0; idx < a_pool->m_num_workers; ++idx)
+    {
+        pthread_mutex_destroy(&a_pool->m_workers[idx].m_mutex);
+        free(a_pool->m_workers[idx].m_modules);
+    }
+    free(a_pool->m_mailboxes);
+    free(a_pool->m_workers);
+    pthread_mutex_destroy(&a_pool->m_mutex);
+    pthread_cond_destroy(&a_pool->m_cond);
+    free(a_pool);
+}
+
+/// Posts `a_event`, on its way back to a module of the pooled task, straight
+/// to that module's mailbox. The task and its workers return events this way
+/// instead of through the task's own queue, where they could wait on a task
+/// that is waiting on them.
+static void PoolReturn(ErEvent_t *a_event)
+{
+    const Letter_t letter = {.m_event = a_event, .m_returning = true};
+    PoolPost(s_router->m_pool, a_event->m_sending_module->m_module_idx,
+             letter);
+}
+
+//==============================================================================
+// Public Functions
+//==============================================================================
+
+bool ErPoolStart(size_t a_num_workers)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_num_workers > 0);
+    ER_ASSERT(s_router->m_pooled_task == 0);
+
+    const size_t task_idx = GetIndexOfCurrentTask();
+    const ErTask_t *task  = &s_router->m_options->m_tasks[task_idx];
+    ER_ASSERT(!task->m_batch_returns);
+
+    ErPool_t *pool = calloc(1, sizeof(ErPool_t));
+    if (pool == NULL)
+    {
+        return false;
+    }
+    pool->m_router      = s_router;
+    pool->m_task_idx    = task_idx;
+    pool->m_task        = task;
+    pool->m_num_workers = a_num_workers;
+    pool->m_mailboxes   = calloc(task->m_num_modules, sizeof(Mailbox_t));
+    pool->m_workers     = calloc(a_num_workers, sizeof(Worker_t));
+    if ((pool->m_mailboxes == NULL) || (pool->m_workers == NULL))
+    {
+        free(pool->m_mailboxes);
+        free(pool->m_workers);
+        free(pool);
+        return false;
+    }
+    pthread_mutex_init(&pool->m_mutex, NULL);
+    pthread_cond_init(&pool->m_cond, NULL);
+
+    bool allocated = true;
+    for (size_t idx = 0; idx < task->m_num_modules; ++idx)
+    {
+        Mailbox_t *mailbox = &pool->m_mailboxes[idx];
+        pthread_mutex_init(&mailbox->m_mutex, NULL);
+        mailbox->m_letters  = malloc(POOL_MAILBOX_CAPACITY * sizeof(Letter_t));
+        mailbox->m_capacity = POOL_MAILBOX_CAPACITY;
+        allocated           = allocated && (mailbox->m_letters != NULL);
+    }
+    for (size_t idx = 0; idx < a_num_workers; ++idx)
+    {
+        Worker_t *worker = &pool->m_workers[idx];
+        pthread_mutex_init(&worker->m_mutex, NULL);
+        worker->m_modules = malloc(task->m_num_modules * sizeof(size_t));
+        worker->m_pool    = pool;
+        allocated         = allocated && (worker->m_modules != NULL);
+    }
+    if (!allocated)
+    {
+        PoolFree(pool);
+        return false;
+    }
+
+    // Workers count as the pooled task from their first instruction.
+    s_router->m_pool        = pool;
+    s_router->m_pooled_task = task_idx + 1;
+    pool->m_running         = true;
+    while ((pool->m_num_started < a_num_workers) &&
+           (pthread_create(&pool->m_workers[pool->m_num_started].m_thread,
+                           NULL, PoolWorkerThread,
+                           &pool->m_workers[pool->m_num_started]) == 0))
+    {
+        pool->m_num_started += 1;
+    }
+
+    if (pool->m_num_started < a_num_workers)
+    {
+        ErPoolStop();
+        return false;
+    }
+    return true;
+}
+
+void ErPoolDispatch(ErEvent_t *a_event)
+{
+    ER_ASSERT(a_event != NULL);
+    ER_ASSERT(s_router->m_pooled_task == (GetIndexOfCurrentTask() + 1));
+    ErPool_t *pool = s_router->m_pool;
+
+    // Returns, told apart as in `ErCallHandlers()`, go to the sending module.
+    const bool is_notification = (a_event->m_sending_module == NULL);
+    if (!is_notification && !a_event->m_fire_and_forget &&
+        (atomic_load_explicit(&a_event->m_reference_count,
+                              memory_order_relaxed) <= 1))
+    {
+        const Letter_t letter = {.m_event = a_event, .m_returning = true};
+        PoolPost(pool, a_event->m_sending_module->m_module_idx, letter);
+        return;
+    }
+
+    // Every subscribed module gets a letter holding a reference of its own,
+    // added before the task's reference is dropped below.
+    for (size_t idx = 0; idx < pool->m_task->m_num_modules; ++idx)
+    {
+        const ErModule_t *module = pool->m_task->m_modules[idx];
+        const BitRef_t bit_ref =
+            GetBitRef((atomic_char *)module->m_subscriptions, a_event->m_type);
+        if (*bit_ref.m_byte & bit_ref.m_bit_mask)
+        {
+            const Letter_t letter = {
+                .m_event = is_notification ? NULL : a_event,
+                .m_type  = a_event->m_type,
+            };
+            if (!is_notification)
+            {
+                atomic_fetch_add_explicit(&a_event->m_reference_count, 1,
+                                          memory_order_relaxed);
+            }
+            PoolPost(pool, idx, letter);
+        }
+    }
+
+    if (!is_notification)
+    {
+        ErReturnToSender(a_event);
+    }
+}
+
+void ErPoolStop(void)
+{
+    ER_ASSERT(s_router->m_pooled_task == (GetIndexOfCurrentTask() + 1));
+    ErPool_t *pool = s_router->m_pool;
+
+    pthread_mutex_lock(&pool->m_mutex);
+    pool->m_running = false;
+    pthread_cond_broadcast(&pool->m_cond);
+    pthread_mutex_unlock(&pool->m_mutex);
+
+    for (size_t idx = 0; idx < pool->m_num_started; ++idx)
+    {
+        pthread_join(pool->m_workers[idx].m_thread, NULL);
+    }
+
+    s_router->m_pooled_task = 0;
+    s_router->m_pool        = NULL;
+    PoolFree(pool);
+}
@@ -2,6 +2,8 @@
 
 #if ER_IMPLEMENTATION == ER_IMPL_FREERTOS
 #include "queue_freertos.c"
+#elif ER_IMPLEMENTATION == ER_IMPL_POSIX && (ER_PRODUCER_RINGS > 0)
+#include "queue_posix_rings.c"
 #elif ER_IMPLEMENTATION == ER_IMPL_POSIX
 #include "queue_posix.c"
 #else
@@ -15,7 +15,14 @@ extern "C"
     typedef void* ErQueue_t;
     typedef ErQueue_t ErQueueHandle_t;
 
-    /// Allocates a new `ErQueue_t` that can hold at most `a_capacity` elements.
+    /// Returns true if `a_queued`, an event waiting in a queue, may be replaced
+    /// by `a_event`; see `ErQueueDisplace()`.
+    typedef bool (*ErQueueMatch_t)(const ErEvent_t* a_queued,
+                                   const ErEvent_t* a_event);
+
+    /// Allocates a new `ErQueue_t` with `ER_PRIORITY_LANES` lanes that can
+    /// each hold at most `a_capacity` elements. Events go to the lane named by
+    /// their `m_lane` and are read from the highest non-empty lane first.
     ErQueue_t ErQueueNew(size_t a_capacity);
 
     /// Frees a `ErQueue_t` previously allocated with `ErQueueNew()`.
@@ -24,9 +31,22 @@ extern "C"
     /// Blocks until there is a value to read from `a_queue`, then returns it.
     ErEvent_t* ErQueuePopFront(ErQueue_t a_queue);
 
-    /// Blocks until there is space to write to the queue, then returns.
+    /// Blocks until there is space to write to the event's lane, then returns.
     void ErQueuePushBack(ErQueue_t a_queue, ErEvent_t* a_event);
 
+    /// Writes `a_count` events to the back of `a_queue` in order, blocking
+    /// whenever the queue is full, and wakes readers as few times as possible.
+    void ErQueuePushBackMany(ErQueue_t a_queue, ErEvent_t* const* a_events,
+                             size_t a_count);
+
+    /// Removes the oldest event in the lane of `a_event` for which `a_match`
+    /// returns true and returns it, or returns NULL and leaves the queue
+    /// unchanged if there is none. `a_event` takes the removed event's place
+    /// if `a_in_place` is true and goes to the back of its lane otherwise.
+    /// Never blocks.
+    ErEvent_t* ErQueueDisplace(ErQueue_t a_queue, ErEvent_t* a_event,
+                               ErQueueMatch_t a_match, bool a_in_place);
+
     /// Returns true if `a_event` was read from `a_queue` within `a_ms`.
     bool ErQueueTimedPopFront(ErQueue_t a_queue, ErEvent_t** a_event,
                               int64_t a_ms);
@@ -35,6 +55,17 @@ extern "C"
     bool ErQueueTimedPushBack(ErQueue_t a_queue, ErEvent_t* a_event,
                               int64_t a_ms);
 
+    /// Returns the number of elements currently held in `a_queue`. The value
+    /// may be stale by the time it is returned if other tasks use the queue.
+    size_t ErQueueSize(ErQueue_t a_queue);
+
+#if ER_IMPLEMENTATION == ER_IMPL_FREERTOS
+    /// Returns the FreeRTOS queue behind lane `a_lane` of `a_queue`, for
+    /// writers that need the native API, such as interrupts. Writing to it
+    /// directly is fine; reads MUST go through the functions above.
+    void* ErQueueLane(ErQueue_t a_queue, size_t a_lane);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,6 +4,7 @@
 
 #include "FreeRTOS.h"
 #include "queue.h"
+#include "task.h"
 
 #include "event.h"
 
@@ -17,40 +18,207 @@
                   (TickType_t)1000U))
 #endif
 
+#if (ER_PRIORITY_LANES > 1) && !configUSE_QUEUE_SETS
+#error "ER_PRIORITY_LANES above 1 requires configUSE_QUEUE_SETS."
+#endif
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+#if ER_PRIORITY_LANES > 1
+/// With more than one lane, an `ErQueue_t` is a FreeRTOS queue per lane and a
+/// queue set holding one entry for every event in any of them, which lets the
+/// reader wait on all the lanes at once. With one lane it is a plain queue.
+typedef struct
+{
+    QueueSetHandle_t m_set;
+    QueueHandle_t m_lanes[ER_PRIORITY_LANES];
+} Queue_t;
+#endif
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+/// Waits up to `a_ticks` for an event in any lane of `a_queue` and reads it
+/// from the highest non-empty lane. Returns false on timeout.
+static bool ReadHighestLane(ErQueue_t a_queue, ErEvent_t **a_event,
+                            TickType_t a_ticks)
+{
+#if ER_PRIORITY_LANES > 1
+    Queue_t *q = a_queue;
+    if (xQueueSelectFromSet(q->m_set, a_ticks) == NULL)
+    {
+        return false;
+    }
+
+    // The set entry names the lane of *some* queued event, not necessarily
+    // the most urgent one. Reading one event per selected entry, from any lane,
+    // keeps the set and the lanes in step.
+    for (size_t lane = ER_PRIORITY_LANES; lane-- > 0;)
+    {
+        if (xQueueReceive(q->m_lanes[lane], a_event, 0) == pdTRUE)
+        {
+            return true;
+        }
+    }
+    assert(!"The queue set is out of step with its lanes");
+    return false;
+#else
+    return (xQueueReceive(a_queue, a_event, a_ticks) == pdTRUE);
+#endif
+}
+
 //==============================================================================
 // Public Functions
 //==============================================================================
 
 ErQueue_t ErQueueNew(size_t a_capacity)
 {
+#if ER_PRIORITY_LANES > 1
+    Queue_t *q = pvPortMalloc(sizeof(*q));
+    assert(q != NULL);
+    q->m_set = xQueueCreateSet(a_capacity * ER_PRIORITY_LANES);
+    for (size_t lane = 0; lane < ER_PRIORITY_LANES; ++lane)
+    {
+        q->m_lanes[lane] = xQueueCreate(a_capacity, sizeof(ErEvent_t *));
+        xQueueAddToSet(q->m_lanes[lane], q->m_set);
+    }
+    return q;
+#else
     return xQueueCreate(a_capacity, sizeof(ErEvent_t *));
+#endif
 }
 
 void ErQueueFree(ErQueue_t a_queue)
 {
+#if ER_PRIORITY_LANES > 1
+    Queue_t *q = a_queue;
+    for (size_t lane = 0; lane < ER_PRIORITY_LANES; ++lane)
+    {
+        xQueueRemoveFromSet(q->m_lanes[lane], q->m_set);
+        vQueueDelete(q->m_lanes[lane]);
+    }
+    vQueueDelete(q->m_set);
+    vPortFree(q);
+#else
     vQueueDelete(a_queue);
+#endif
+}
+
+void *ErQueueLane(ErQueue_t a_queue, size_t a_lane)
+{
+    assert(a_lane < ER_PRIORITY_LANES);
+#if ER_PRIORITY_LANES > 1
+    return ((Queue_t *)a_queue)->m_lanes[a_lane];
+#else
+    return a_queue;
+#endif
 }
 
 ErEvent_t *ErQueuePopFront(ErQueue_t a_queue)
 {
-    ErEvent_t *event = NULL;
-    assert(pdTRUE == xQueueReceive(a_queue, &event, portMAX_DELAY));
+    ErEvent_t *event    = NULL;
+    const bool received = ReadHighestLane(a_queue, &event, portMAX_DELAY);
+    assert(received);
+    (void)received;
     return event;
 }
 
 void ErQueuePushBack(ErQueue_t a_queue, ErEvent_t *a_event)
 {
-    assert(pdTRUE == xQueueSend(a_queue, &a_event, portMAX_DELAY));
+    QueueHandle_t lane = ErQueueLane(a_queue, a_event->m_lane);
+    assert(pdTRUE == xQueueSend(lane, &a_event, portMAX_DELAY));
+}
+
+void ErQueuePushBackMany(ErQueue_t a_queue, ErEvent_t *const *a_events,
+                         size_t a_count)
+{
+    // FreeRTOS queues copy one item at a time; a reader blocked on the queue
+    // is only readied once, by the first item.
+    for (size_t idx = 0; idx < a_count; ++idx)
+    {
+        ErQueuePushBack(a_queue, a_events[idx]);
+    }
+}
+
+ErEvent_t *ErQueueDisplace(ErQueue_t a_queue, ErEvent_t *a_event,
+                           ErQueueMatch_t a_match, bool a_in_place)
+{
+    QueueHandle_t lane   = ErQueueLane(a_queue, a_event->m_lane);
+    ErEvent_t *displaced = NULL;
+    BaseType_t higher_priority_task_woken = pdFALSE;
+
+    // FreeRTOS queues can only be read from the front, so rotate the whole
+    // lane once. Interrupts stay masked throughout so that no one sees the
+    // lane half rotated, or takes the slot a read frees; this is slow, so the
+    // router only calls it once the lane is full, on overflow or to conflate.
+    // Only the calls meant for interrupts are safe with interrupts masked, and
+    // none of them ever blocks.
+    taskENTER_CRITICAL();
+    const UBaseType_t count = uxQueueMessagesWaitingFromISR(lane);
+    for (UBaseType_t idx = 0; idx < count; ++idx)
+    {
+        ErEvent_t *queued = NULL;
+        const BaseType_t read =
+            xQueueReceiveFromISR(lane, &queued, &higher_priority_task_woken);
+        assert(read == pdTRUE);
+        (void)read;
+#if ER_PRIORITY_LANES > 1
+        // Reads from a lane leave the set alone but every write adds an
+        // entry. Dropping one entry per read keeps the set at or below its
+        // length, and in step with the lanes once the rotation is done.
+        xQueueSelectFromSetFromISR(((Queue_t *)a_queue)->m_set);
+#endif
+        if ((displaced == NULL) && a_match(queued, a_event))
+        {
+            displaced = queued;
+            if (!a_in_place)
+            {
+                continue;
+            }
+            queued = a_event;
+        }
+        const BaseType_t written = xQueueSendToBackFromISR(
+            lane, &queued, &higher_priority_task_woken);
+        assert(written == pdTRUE);
+        (void)written;
+    }
+    if ((displaced != NULL) && !a_in_place)
+    {
+        const BaseType_t written = xQueueSendToBackFromISR(
+            lane, &a_event, &higher_priority_task_woken);
+        assert(written == pdTRUE);
+        (void)written;
+    }
+    taskEXIT_CRITICAL();
+
+    if (higher_priority_task_woken)
+    {
+        taskYIELD();
+    }
+    return displaced;
 }
 
 bool ErQueueTimedPopFront(ErQueue_t a_queue, ErEvent_t **a_event, int64_t a_ms)
 {
-    BaseType_t ret = xQueueReceive(a_queue, a_event, pdMS_TO_TICKS(a_ms));
-    return (ret == pdTRUE);
+    return ReadHighestLane(a_queue, a_event, pdMS_TO_TICKS(a_ms));
 }
 
 bool ErQueueTimedPushBack(ErQueue_t a_queue, ErEvent_t *a_event, int64_t a_ms)
 {
-    BaseType_t ret = xQueueSend(a_queue, &a_event, pdMS_TO_TICKS(a_ms));
-    return (ret = pdTRUE);
+    QueueHandle_t lane = ErQueueLane(a_queue, a_event->m_lane);
+    BaseType_t ret     = xQueueSend(lane, &a_event, pdMS_TO_TICKS(a_ms));
+    return (ret == pdTRUE);
+}
+
+size_t ErQueueSize(ErQueue_t a_queue)
+{
+    size_t result = 0;
+    for (size_t lane = 0; lane < ER_PRIORITY_LANES; ++lane)
+    {
+        result += uxQueueMessagesWaiting(ErQueueLane(a_queue, lane));
+    }
+    return result;
 }
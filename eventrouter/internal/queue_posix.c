@@ -11,16 +11,25 @@
 // Type Definitions
 //==============================================================================
 
+/// The events queued in one priority lane, in the order they were written.
+typedef struct
+{
+    size_t m_idx;        //< The next index to read from.
+    size_t m_size;       //< The number of elements in the lane.
+    ErEvent_t** m_data;  //< This lane's slots in `Queue_t::m_data`.
+} Lane_t;
+
 typedef struct
 {
     // Manage concurrency.
     pthread_mutex_t m_mutex;
     pthread_cond_t m_cond;
     // Manage contents.
-    int m_idx;      //< The next index to read from.
-    size_t m_size;  //< The number of elements in the queue.
+    uint32_t m_occupied;  //< Bit `i` is set while lane `i` holds elements.
+    size_t m_size;        //< The number of elements in all lanes.
+    Lane_t m_lanes[ER_PRIORITY_LANES];
     // Manage storage.
-    size_t m_capacity;    //< The maximum number of elements the queue can hold.
+    size_t m_capacity;    //< The maximum number of elements each lane can hold.
     ErEvent_t* m_data[];  //< The space where the data is held.
 } Queue_t;
 
@@ -28,19 +37,43 @@ typedef struct
 // Local Functions
 //==============================================================================
 
-static ErEvent_t* read(Queue_t* a_queue)
+static Lane_t* LaneOf(Queue_t* a_queue, const ErEvent_t* a_event)
+{
+    assert(a_event->m_lane < ER_PRIORITY_LANES);
+    return &a_queue->m_lanes[a_event->m_lane];
+}
+
+static bool IsFull(Queue_t* a_queue, const ErEvent_t* a_event)
+{
+    return LaneOf(a_queue, a_event)->m_size == a_queue->m_capacity;
+}
+
+/// Reads from the highest occupied lane; the queue MUST NOT be empty.
+static ErEvent_t* ReadFront(Queue_t* a_queue)
 {
-    ErEvent_t* result = a_queue->m_data[a_queue->m_idx];
-    a_queue->m_idx    = (a_queue->m_idx + 1) % a_queue->m_capacity;
+    const size_t lane_idx = 31 - __builtin_clz(a_queue->m_occupied);
+    Lane_t* lane          = &a_queue->m_lanes[lane_idx];
+
+    ErEvent_t* result = lane->m_data[lane->m_idx];
+    lane->m_idx       = (lane->m_idx + 1) % a_queue->m_capacity;
+    lane->m_size -= 1;
     a_queue->m_size -= 1;
+    if (lane->m_size == 0)
+    {
+        a_queue->m_occupied &= ~(UINT32_C(1) << lane_idx);
+    }
     return result;
 }
 
-static void write(Queue_t* a_queue, ErEvent_t* a_event)
+/// Writes to the back of the event's lane; the lane MUST NOT be full.
+static void WriteBack(Queue_t* a_queue, ErEvent_t* a_event)
 {
-    int write_idx = (a_queue->m_idx + a_queue->m_size) % a_queue->m_capacity;
-    a_queue->m_data[write_idx] = a_event;
+    Lane_t* lane     = LaneOf(a_queue, a_event);
+    size_t write_idx = (lane->m_idx + lane->m_size) % a_queue->m_capacity;
+    lane->m_data[write_idx] = a_event;
+    lane->m_size += 1;
     a_queue->m_size += 1;
+    a_queue->m_occupied |= UINT32_C(1) << a_event->m_lane;
 }
 
 /// Returns a `struct timespec` corresponding to the time `a_ms` in the future.
@@ -63,13 +96,22 @@ static struct timespec future(int64_t a_ms)
 ErQueue_t ErQueueNew(size_t a_capacity)
 {
     Queue_t* const result =
-        malloc(sizeof(*result) + (sizeof(result->m_data[0]) * a_capacity));
+        malloc(sizeof(*result) + (sizeof(result->m_data[0]) * a_capacity *
+                                  ER_PRIORITY_LANES));
 
     pthread_mutex_init(&result->m_mutex, NULL);
     pthread_cond_init(&result->m_cond, NULL);
-    result->m_idx      = 0;
+    result->m_occupied = 0;
     result->m_size     = 0;
     result->m_capacity = a_capacity;
+    for (size_t idx = 0; idx < ER_PRIORITY_LANES; ++idx)
+    {
+        result->m_lanes[idx] = (Lane_t){
+            .m_idx  = 0,
+            .m_size = 0,
+            .m_data = &result->m_data[idx * a_capacity],
+        };
+    }
 
     return result;
 }
@@ -115,7 +157,7 @@ ErEvent_t* ErQueuePopFront(ErQueue_t a_queue)
             // break out of the loop. If there isn't any data (because another
             // thread read it) then go back to waiting on the condition
             // variable.
-            result = read(q);
+            result = ReadFront(q);
             pthread_cond_broadcast(&q->m_cond);  // Notify blocked writers.
             break;
         }
@@ -136,13 +178,13 @@ void ErQueuePushBack(ErQueue_t a_queue, ErEvent_t* a_event)
     pthread_mutex_lock(&q->m_mutex);
     while (1)
     {
-        if (q->m_size == q->m_capacity)
+        if (IsFull(q, a_event))
         {
             pthread_cond_wait(&q->m_cond, &q->m_mutex);
         }
         else
         {
-            write(q, a_event);
+            WriteBack(q, a_event);
             pthread_cond_broadcast(&q->m_cond);  // Notify blocked readers.
             break;
         }
@@ -150,6 +192,80 @@ void ErQueuePushBack(ErQueue_t a_queue, ErEvent_t* a_event)
     pthread_mutex_unlock(&q->m_mutex);
 }
 
+// NOTE: The structure and motivations of this function are similar to that
+// of `ErQueuePopFront()`; please read those comments to understand this.
+void ErQueuePushBackMany(ErQueue_t a_queue, ErEvent_t* const* a_events,
+                         size_t a_count)
+{
+    assert(a_queue != NULL);
+    assert((a_events != NULL) || (a_count == 0));
+
+    Queue_t* q     = a_queue;
+    size_t written = 0;
+
+    pthread_mutex_lock(&q->m_mutex);
+    while (written < a_count)
+    {
+        if (IsFull(q, a_events[written]))
+        {
+            // Readers must see what was written so far or they would never
+            // make room for the rest.
+            pthread_cond_broadcast(&q->m_cond);
+            pthread_cond_wait(&q->m_cond, &q->m_mutex);
+        }
+        else
+        {
+            WriteBack(q, a_events[written]);
+            written += 1;
+        }
+    }
+    pthread_cond_broadcast(&q->m_cond);  // Notify blocked readers once.
+    pthread_mutex_unlock(&q->m_mutex);
+}
+
+ErEvent_t* ErQueueDisplace(ErQueue_t a_queue, ErEvent_t* a_event,
+                           ErQueueMatch_t a_match, bool a_in_place)
+{
+    assert(a_queue != NULL);
+    assert(a_match != NULL);
+
+    Queue_t* q           = a_queue;
+    ErEvent_t* displaced = NULL;
+
+    // Only `a_event`'s lane is searched; that is the lane it needs room in.
+    pthread_mutex_lock(&q->m_mutex);
+    Lane_t* lane = LaneOf(q, a_event);
+    for (size_t offset = 0; offset < lane->m_size; ++offset)
+    {
+        const size_t idx = (lane->m_idx + offset) % q->m_capacity;
+        if (!a_match(lane->m_data[idx], a_event))
+        {
+            continue;
+        }
+
+        displaced = lane->m_data[idx];
+        if (a_in_place)
+        {
+            lane->m_data[idx] = a_event;
+            break;
+        }
+
+        // Close the gap by moving every later event forward by one, then
+        // append `a_event`. The size is unchanged, so no one needs waking.
+        for (size_t later = offset + 1; later < lane->m_size; ++later)
+        {
+            lane->m_data[(lane->m_idx + later - 1) % q->m_capacity] =
+                lane->m_data[(lane->m_idx + later) % q->m_capacity];
+        }
+        lane->m_data[(lane->m_idx + lane->m_size - 1) % q->m_capacity] =
+            a_event;
+        break;
+    }
+    pthread_mutex_unlock(&q->m_mutex);
+
+    return displaced;
+}
+
 // NOTE: The structure and motivations of this function are similar to that of
 // `ErQueuePopFront()`; please read those comments to understand this.
 bool ErQueueTimedPopFront(ErQueue_t a_queue, ErEvent_t** a_event, int64_t a_ms)
@@ -174,7 +290,7 @@ bool ErQueueTimedPopFront(ErQueue_t a_queue, ErEvent_t** a_event, int64_t a_ms)
         }
         else
         {
-            *a_event = read(q);
+            *a_event = ReadFront(q);
             pthread_cond_broadcast(&q->m_cond);  // Notify blocked writers.
             result = true;
             break;
@@ -198,7 +314,7 @@ bool ErQueueTimedPushBack(ErQueue_t a_queue, ErEvent_t* a_event, int64_t a_ms)
     pthread_mutex_lock(&q->m_mutex);
     while (1)
     {
-        if (q->m_size == q->m_capacity)
+        if (IsFull(q, a_event))
         {
             if (pthread_cond_timedwait(&q->m_cond, &q->m_mutex, &ts) ==
                 ETIMEDOUT)
@@ -209,7 +325,7 @@ bool ErQueueTimedPushBack(ErQueue_t a_queue, ErEvent_t* a_event, int64_t a_ms)
         }
         else
         {
-            write(q, a_event);
+            WriteBack(q, a_event);
             pthread_cond_broadcast(&q->m_cond);  // Notify blocked readers.
             result = true;
             break;
@@ -219,3 +335,16 @@ bool ErQueueTimedPushBack(ErQueue_t a_queue, ErEvent_t* a_event, int64_t a_ms)
 
     return result;
 }
+
+size_t ErQueueSize(ErQueue_t a_queue)
+{
+    assert(a_queue != NULL);
+
+    Queue_t* q = a_queue;
+
+    pthread_mutex_lock(&q->m_mutex);
+    const size_t result = q->m_size;
+    pthread_mutex_unlock(&q->m_mutex);
+
+    return result;
+}
@@ -0,0 +1,458 @@
+#include "queue_.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/errno.h>
+#include <sys/time.h>
+
+/// @file An `ErQueue_t` for many producers and one consumer, selected with
+/// `ER_PRODUCER_RINGS`. Each priority lane holds `ER_PRODUCER_RINGS`
+/// single-producer rings, plus one shared ring, guarded by the mutex. A thread
+/// takes a free ring number the first time it writes to any queue, keeps it
+/// until it exits, and writes to that ring of every queue; threads that find
+/// every number taken use the shared ring. Writers to their own ring never
+/// take a lock or touch another writer's cache lines, and the reader visits
+/// the rings of a lane round-robin, so one busy producer cannot starve the
+/// others.
+///
+/// Only one thread may read from a queue. The mutex and condition variable are
+/// used only to sleep, and writers only take them when someone is asleep.
+
+//==============================================================================
+// Macros And Defines
+//==============================================================================
+
+/// The number of rings in each lane; the last one is shared.
+#define RING_COUNT (ER_PRODUCER_RINGS + 1)
+
+/// A common cache line size. Each ring index gets a line of its own so that
+/// writers to different rings, and the reader, never write to the same line.
+#define RING_ALIGNMENT 64
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+/// A bounded ring with one writer (or writers serialized by the queue's mutex)
+/// and one reader. `m_head` and `m_tail` count up forever; slot `i % capacity`
+/// holds the `i`-th event written.
+typedef struct
+{
+    _Alignas(RING_ALIGNMENT) atomic_size_t m_head;  //< Only the reader writes.
+    _Alignas(RING_ALIGNMENT) atomic_size_t m_tail;  //< Only the writer writes.
+    _Atomic(ErEvent_t*)* m_slots;
+} Ring_t;
+
+/// The rings of one priority lane.
+typedef struct
+{
+    Ring_t m_rings[RING_COUNT];
+    size_t m_next_ring;  //< Where the reader starts looking next; reader-only.
+} Lane_t;
+
+typedef struct
+{
+    // Manage concurrency.
+    pthread_mutex_t m_mutex;  //< Serializes the shared rings and displacement.
+    pthread_cond_t m_cond;
+    atomic_int m_sleepers;  //< Threads waiting on `m_cond`.
+    // Manage contents.
+    atomic_size_t m_size;  //< The number of events in all rings.
+    Lane_t m_lanes[ER_PRIORITY_LANES];
+    // Manage storage.
+    size_t m_capacity;  //< The maximum number of events each ring can hold.
+    _Atomic(ErEvent_t*) m_data[];  //< The space where the data is held.
+} Queue_t;
+
+//==============================================================================
+// Static Variables
+//==============================================================================
+
+/// Whether a live thread holds each ring number.
+static atomic_bool s_ring_taken[ER_PRODUCER_RINGS];
+/// Hands a thread's ring number back when the thread exits.
+static pthread_key_t s_ring_key;
+static pthread_once_t s_ring_key_once = PTHREAD_ONCE_INIT;
+/// The calling thread's ring number; `RING_COUNT` until it first writes.
+static _Thread_local size_t s_producer_ring = RING_COUNT;
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+/// Frees the ring number of a thread that is exiting. The release pairs with
+/// the next taker's acquire, so it sees every write to the rings that number
+/// names.
+static void ReleaseProducerRing(void* a_ring)
+{
+    atomic_store_explicit(&s_ring_taken[(uintptr_t)a_ring - 1], false,
+                          memory_order_release);
+}
+
+static void CreateRingKey(void)
+{
+    pthread_key_create(&s_ring_key, ReleaseProducerRing);
+}
+
+/// Returns the index of the calling thread's ring in every lane, taking a free
+/// ring number if the thread has none yet. A thread never changes rings once
+/// it has written, so its events keep their order.
+static size_t ProducerRing(void)
+{
+    if (s_producer_ring == RING_COUNT)
+    {
+        pthread_once(&s_ring_key_once, CreateRingKey);
+        s_producer_ring = ER_PRODUCER_RINGS;
+        for (size_t ring_idx = 0; ring_idx < ER_PRODUCER_RINGS; ++ring_idx)
+        {
+            bool taken = false;
+            if (atomic_compare_exchange_strong_explicit(
+                    &s_ring_taken[ring_idx], &taken, true,
+                    memory_order_acquire, memory_order_relaxed))
+            {
+                // The key holds `ring_idx + 1`, since destructors only run for
+                // non-NULL values.
+                pthread_setspecific(s_ring_key, (void*)(ring_idx + 1));
+                s_producer_ring = ring_idx;
+                break;
+            }
+        }
+    }
+    return s_producer_ring;
+}
+
+static Lane_t* LaneOf(Queue_t* a_queue, const ErEvent_t* a_event)
+{
+    assert(a_event->m_lane < ER_PRIORITY_LANES);
+    return &a_queue->m_lanes[a_event->m_lane];
+}
+
+static bool IsRingFull(Queue_t* a_queue, Ring_t* a_ring)
+{
+    return (atomic_load(&a_ring->m_tail) - atomic_load(&a_ring->m_head)) ==
+           a_queue->m_capacity;
+}
+
+/// Wakes every sleeping thread, if there are any, after a read or write. The
+/// fence pairs with the one in `SleepUntil()`: either the sleeper sees this
+/// thread's change or this thread sees the sleeper.
+static void WakeSleepers(Queue_t* a_queue)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&a_queue->m_sleepers, memory_order_relaxed) > 0)
+    {
+        pthread_mutex_lock(&a_queue->m_mutex);
+        pthread_cond_broadcast(&a_queue->m_cond);
+        pthread_mutex_unlock(&a_queue->m_mutex);
+    }
+}
+
+/// Returns true if the calling thread's ring in `a_event`'s lane has room.
+static bool HasRoom(Queue_t* a_queue, const ErEvent_t* a_event)
+{
+    return !IsRingFull(a_queue,
+                       &LaneOf(a_queue, a_event)->m_rings[ProducerRing()]);
+}
+
+/// Returns true if there is an event to read.
+static bool HasEvents(Queue_t* a_queue, const ErEvent_t* a_event)
+{
+    ER_UNUSED(a_event);
+    return atomic_load(&a_queue->m_size) > 0;
+}
+
+/// Sleeps until `a_ready` returns true or `a_deadline` passes; NULL waits
+/// forever. Returns the last result of `a_ready`.
+static bool SleepUntil(Queue_t* a_queue,
+                       bool (*a_ready)(Queue_t*, const ErEvent_t*),
+                       const ErEvent_t* a_event,
+                       const struct timespec* a_deadline)
+{
+    pthread_mutex_lock(&a_queue->m_mutex);
+    atomic_fetch_add(&a_queue->m_sleepers, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    bool ready = a_ready(a_queue, a_event);
+    while (!ready)
+    {
+        if (a_deadline == NULL)
+        {
+            pthread_cond_wait(&a_queue->m_cond, &a_queue->m_mutex);
+        }
+        else if (pthread_cond_timedwait(&a_queue->m_cond, &a_queue->m_mutex,
+                                        a_deadline) == ETIMEDOUT)
+        {
+            ready = a_ready(a_queue, a_event);
+            break;
+        }
+        ready = a_ready(a_queue, a_event);
+    }
+
+    atomic_fetch_sub(&a_queue->m_sleepers, 1);
+    pthread_mutex_unlock(&a_queue->m_mutex);
+    return ready;
+}
+
+/// Writes `a_event` to the calling thread's ring in its lane, without waking
+/// anyone. Returns false if the ring is full.
+static bool TryWrite(Queue_t* a_queue, ErEvent_t* a_event)
+{
+    const size_t ring_idx = ProducerRing();
+    const bool shared     = (ring_idx == ER_PRODUCER_RINGS);
+    Ring_t* ring          = &LaneOf(a_queue, a_event)->m_rings[ring_idx];
+    bool written          = false;
+
+    if (shared)
+    {
+        pthread_mutex_lock(&a_queue->m_mutex);
+    }
+
+    const size_t tail = atomic_load_explicit(&ring->m_tail,
+                                             memory_order_relaxed);
+    const size_t head = atomic_load_explicit(&ring->m_head,
+                                             memory_order_acquire);
+    if ((tail - head) < a_queue->m_capacity)
+    {
+        atomic_store_explicit(&ring->m_slots[tail % a_queue->m_capacity],
+                              a_event, memory_order_relaxed);
+        atomic_store_explicit(&ring->m_tail, tail + 1, memory_order_release);
+        atomic_fetch_add(&a_queue->m_size, 1);
+        written = true;
+    }
+
+    if (shared)
+    {
+        pthread_mutex_unlock(&a_queue->m_mutex);
+    }
+    return written;
+}
+
+/// Reads the next event from the highest non-empty lane, visiting that lane's
+/// rings round-robin, without waking anyone. Returns false if there is none.
+static bool TryRead(Queue_t* a_queue, ErEvent_t** a_event)
+{
+    if (atomic_load(&a_queue->m_size) == 0)
+    {
+        return false;
+    }
+
+    for (size_t lane_idx = ER_PRIORITY_LANES; lane_idx-- > 0;)
+    {
+        Lane_t* lane = &a_queue->m_lanes[lane_idx];
+        for (size_t offset = 0; offset < RING_COUNT; ++offset)
+        {
+            const size_t ring_idx = (lane->m_next_ring + offset) % RING_COUNT;
+            Ring_t* ring          = &lane->m_rings[ring_idx];
+            const size_t head     = atomic_load_explicit(&ring->m_head,
+                                                     memory_order_relaxed);
+            if (head ==
+                atomic_load_explicit(&ring->m_tail, memory_order_acquire))
+            {
+                continue;
+            }
+
+            // Displacement may swap the slot at any time until this exchange;
+            // whatever is in it now is what gets read.
+            *a_event = atomic_exchange(
+                &ring->m_slots[head % a_queue->m_capacity], NULL);
+            atomic_store_explicit(&ring->m_head, head + 1,
+                                  memory_order_release);
+            atomic_fetch_sub(&a_queue->m_size, 1);
+            lane->m_next_ring = (ring_idx + 1) % RING_COUNT;
+            return true;
+        }
+    }
+
+    assert(!"The queue size is out of step with its rings");
+    return false;
+}
+
+/// Returns a `struct timespec` corresponding to the time `a_ms` in the future.
+static struct timespec future(int64_t a_ms)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    const int64_t nanos = (tv.tv_sec * 1e9) + (a_ms * 1e6) + (tv.tv_usec * 1e3);
+
+    struct timespec ts;
+    ts.tv_sec  = nanos / 1000000000;
+    ts.tv_nsec = nanos % 1000000000;
+    return ts;
+}
+
+//==============================================================================
+// Public Functions
+//==============================================================================
+
+ErQueue_t ErQueueNew(size_t a_capacity)
+{
+    // The rings' alignment carries over to the allocation, whose size must be
+    // a multiple of it.
+    const size_t slots     = a_capacity * RING_COUNT * ER_PRIORITY_LANES;
+    const size_t slot_size = sizeof(((Queue_t*)NULL)->m_data[0]);
+    const size_t size      = sizeof(Queue_t) + (slot_size * slots);
+    Queue_t* const result = aligned_alloc(
+        RING_ALIGNMENT,
+        ((size + RING_ALIGNMENT - 1) / RING_ALIGNMENT) * RING_ALIGNMENT);
+
+    pthread_mutex_init(&result->m_mutex, NULL);
+    pthread_cond_init(&result->m_cond, NULL);
+    atomic_init(&result->m_sleepers, 0);
+    atomic_init(&result->m_size, 0);
+    result->m_capacity = a_capacity;
+    for (size_t lane_idx = 0; lane_idx < ER_PRIORITY_LANES; ++lane_idx)
+    {
+        Lane_t* lane      = &result->m_lanes[lane_idx];
+        lane->m_next_ring = 0;
+        for (size_t ring_idx = 0; ring_idx < RING_COUNT; ++ring_idx)
+        {
+            Ring_t* ring = &lane->m_rings[ring_idx];
+            atomic_init(&ring->m_head, 0);
+            atomic_init(&ring->m_tail, 0);
+            ring->m_slots =
+                &result->m_data[((lane_idx * RING_COUNT) + ring_idx) *
+                                a_capacity];
+        }
+    }
+
+    return result;
+}
+
+void ErQueueFree(ErQueue_t a_queue)
+{
+    assert(a_queue != NULL);
+    Queue_t* q = a_queue;
+    pthread_cond_destroy(&q->m_cond);
+    pthread_mutex_destroy(&q->m_mutex);
+    free(q);
+}
+
+ErEvent_t* ErQueuePopFront(ErQueue_t a_queue)
+{
+    assert(a_queue != NULL);
+
+    Queue_t* q        = a_queue;
+    ErEvent_t* result = NULL;
+    while (!TryRead(q, &result))
+    {
+        SleepUntil(q, HasEvents, NULL, NULL);
+    }
+    WakeSleepers(q);  // Notify blocked writers.
+    return result;
+}
+
+void ErQueuePushBack(ErQueue_t a_queue, ErEvent_t* a_event)
+{
+    assert(a_queue != NULL);
+
+    Queue_t* q = a_queue;
+    while (!TryWrite(q, a_event))
+    {
+        SleepUntil(q, HasRoom, a_event, NULL);
+    }
+    WakeSleepers(q);  // Notify the blocked reader.
+}
+
+void ErQueuePushBackMany(ErQueue_t a_queue, ErEvent_t* const* a_events,
+                         size_t a_count)
+{
+    assert(a_queue != NULL);
+    assert((a_events != NULL) || (a_count == 0));
+
+    Queue_t* q = a_queue;
+    for (size_t written = 0; written < a_count; ++written)
+    {
+        while (!TryWrite(q, a_events[written]))
+        {
+            // The reader must see what was written so far or it would never
+            // make room for the rest.
+            WakeSleepers(q);
+            SleepUntil(q, HasRoom, a_events[written], NULL);
+        }
+    }
+    WakeSleepers(q);  // Notify the blocked reader once.
+}
+
+ErEvent_t* ErQueueDisplace(ErQueue_t a_queue, ErEvent_t* a_event,
+                           ErQueueMatch_t a_match, bool a_in_place)
+{
+    assert(a_queue != NULL);
+    assert(a_match != NULL);
+
+    // Rings cannot close a gap while their writer and reader run, so the
+    // replacement always takes the displaced event's slot, even when
+    // `a_in_place` is false. The calling thread's own ring is searched first.
+    ER_UNUSED(a_in_place);
+
+    Queue_t* q           = a_queue;
+    Lane_t* lane         = LaneOf(q, a_event);
+    const size_t first   = ProducerRing();
+    ErEvent_t* displaced = NULL;
+
+    pthread_mutex_lock(&q->m_mutex);
+    for (size_t offset = 0; (offset < RING_COUNT) && (displaced == NULL);
+         ++offset)
+    {
+        Ring_t* ring      = &lane->m_rings[(first + offset) % RING_COUNT];
+        const size_t tail = atomic_load(&ring->m_tail);
+        for (size_t idx = atomic_load(&ring->m_head); idx < tail; ++idx)
+        {
+            _Atomic(ErEvent_t*)* slot = &ring->m_slots[idx % q->m_capacity];
+            ErEvent_t* queued         = atomic_load(slot);
+
+            // A NULL slot is being read right now.
+            if ((queued != NULL) && a_match(queued, a_event) &&
+                atomic_compare_exchange_strong(slot, &queued, a_event))
+            {
+                displaced = queued;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&q->m_mutex);
+
+    return displaced;
+}
+
+bool ErQueueTimedPopFront(ErQueue_t a_queue, ErEvent_t** a_event, int64_t a_ms)
+{
+    assert(a_queue != NULL);
+
+    struct timespec ts = future(a_ms);
+    Queue_t* q         = a_queue;
+    while (!TryRead(q, a_event))
+    {
+        if (!SleepUntil(q, HasEvents, NULL, &ts))
+        {
+            return false;
+        }
+    }
+    WakeSleepers(q);  // Notify blocked writers.
+    return true;
+}
+
+bool ErQueueTimedPushBack(ErQueue_t a_queue, ErEvent_t* a_event, int64_t a_ms)
+{
+    assert(a_queue != NULL);
+
+    struct timespec ts = future(a_ms);
+    Queue_t* q         = a_queue;
+    while (!TryWrite(q, a_event))
+    {
+        if (!SleepUntil(q, HasRoom, a_event, &ts))
+        {
+            return false;
+        }
+    }
+    WakeSleepers(q);  // Notify the blocked reader.
+    return true;
+}
+
+size_t ErQueueSize(ErQueue_t a_queue)
+{
+    assert(a_queue != NULL);
+    return atomic_load(&((Queue_t*)a_queue)->m_size);
+}
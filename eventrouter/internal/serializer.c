@@ -0,0 +1,240 @@
+#include "serializer.h"
+
+#include <string.h>
+
+#include "checked_config.h"
+
+// NOTE: This file is included by eventrouter.c and shared by every
+// implementation.
+
+/// @file The registry behind `ErSerializerRegister()`. A record is the event's
+/// type and the size of its payload, each a LEB128 varint, then the payload:
+/// small types and payloads cost a byte each.
+
+//==============================================================================
+// Static Variables
+//==============================================================================
+
+/// Indexed by `type - ER_EVENT_TYPE__FIRST`; `m_size` is 0 for types with no
+/// serializer.
+static ErSerializer_t s_serializers[ER_EVENT_TYPE__COUNT];
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+static bool IsSerializableType(ErEventType_t a_type)
+{
+    return ((size_t)a_type - (size_t)ER_EVENT_TYPE__FIRST) <
+           ER_EVENT_TYPE__COUNT;
+}
+
+/// Writes `a_value` as a LEB128 varint and returns the number of bytes.
+static size_t WriteVarint(uint64_t a_value, uint8_t *a_bytes)
+{
+    size_t length = 0;
+    do
+    {
+        uint8_t byte = a_value & 0x7Fu;
+        a_value    >>= 7;
+        if (a_value != 0)
+        {
+            byte |= 0x80u;
+        }
+        a_bytes[length++] = byte;
+    } while (a_value != 0);
+    return length;
+}
+
+/// Reads a LEB128 varint of up to 64 bits into `a_value` and returns the
+/// number of bytes it took; 0 if `a_size` bytes end partway through it, and
+/// `SIZE_MAX` if it is too long.
+static size_t ReadVarint(const uint8_t *a_bytes, size_t a_size,
+                         uint64_t *a_value)
+{
+    uint64_t value = 0;
+    for (size_t idx = 0; idx < a_size; ++idx)
+    {
+        if (idx == (ER_RECORD_MAX_HEADER_SIZE / 2))
+        {
+            return SIZE_MAX;
+        }
+        value |= (uint64_t)(a_bytes[idx] & 0x7Fu) << (7 * idx);
+        if ((a_bytes[idx] & 0x80u) == 0)
+        {
+            *a_value = value;
+            return idx + 1;
+        }
+    }
+    return (a_size < (ER_RECORD_MAX_HEADER_SIZE / 2)) ? 0 : SIZE_MAX;
+}
+
+//==============================================================================
+// API Functions
+//==============================================================================
+
+void ErSerializerRegister(ErEventType_t a_type,
+                          const ErSerializer_t *a_serializer)
+{
+    ER_ASSERT(IsSerializableType(a_type));
+    ErSerializer_t *entry = &s_serializers[a_type - ER_EVENT_TYPE__FIRST];
+    if (a_serializer == NULL)
+    {
+        memset(entry, 0, sizeof(*entry));
+        return;
+    }
+
+    ER_ASSERT(a_serializer->m_size >= sizeof(ErEvent_t));
+    ER_ASSERT((a_serializer->m_encode == NULL) ==
+              (a_serializer->m_decode == NULL));
+    *entry = *a_serializer;
+}
+
+const ErSerializer_t *ErSerializerGet(ErEventType_t a_type)
+{
+    if (!IsSerializableType(a_type))
+    {
+        return NULL;
+    }
+    const ErSerializer_t *entry =
+        &s_serializers[a_type - ER_EVENT_TYPE__FIRST];
+    return (entry->m_size != 0) ? entry : NULL;
+}
+
+const void *ErPodPayload(const ErEvent_t *a_event, size_t *a_size)
+{
+    ER_ASSERT(a_event != NULL);
+    ER_ASSERT(a_size != NULL);
+
+    const ErSerializer_t *serializer = ErSerializerGet(a_event->m_type);
+    if ((serializer == NULL) || (serializer->m_encode != NULL))
+    {
+        return NULL;
+    }
+    *a_size = serializer->m_size - sizeof(ErEvent_t);
+    return (const uint8_t *)a_event + sizeof(ErEvent_t);
+}
+
+size_t ErEncodePayload(const ErEvent_t *a_event, uint8_t *a_buffer,
+                       size_t a_size)
+{
+    ER_ASSERT(a_event != NULL);
+    const ErSerializer_t *serializer = ErSerializerGet(a_event->m_type);
+    ER_ASSERT(serializer != NULL);
+
+    if (serializer->m_encode != NULL)
+    {
+        return serializer->m_encode(a_event, a_buffer, a_size);
+    }
+    const size_t size = serializer->m_size - sizeof(ErEvent_t);
+    if (size <= a_size)
+    {
+        memcpy(a_buffer, (const uint8_t *)a_event + sizeof(ErEvent_t), size);
+    }
+    return size;
+}
+
+size_t ErWriteRecordHeader(ErEventType_t a_type, size_t a_payload_size,
+                           uint8_t *a_header)
+{
+    ER_ASSERT(a_header != NULL);
+    const size_t length = WriteVarint((uint64_t)a_type, a_header);
+    return length + WriteVarint(a_payload_size, a_header + length);
+}
+
+size_t ErSerialize(const ErEvent_t *a_event, uint8_t *a_buffer, size_t a_size)
+{
+    ER_ASSERT(a_event != NULL);
+    ER_ASSERT((a_buffer != NULL) || (a_size == 0));
+
+    // Encode first: the header's length depends on the payload's.
+    uint8_t header[ER_RECORD_MAX_HEADER_SIZE];
+    const size_t guess   = (a_size > sizeof(header)) ? sizeof(header) : a_size;
+    const size_t payload = ErEncodePayload(
+        a_event, (a_buffer != NULL) ? a_buffer + guess : NULL, a_size - guess);
+    const size_t header_size =
+        ErWriteRecordHeader(a_event->m_type, payload, header);
+    const size_t size = header_size + payload;
+    if (size > a_size)
+    {
+        return size;
+    }
+
+    if (payload > (a_size - guess))
+    {
+        // It only fits without the room left for the longest header.
+        ErEncodePayload(a_event, a_buffer + header_size, a_size - header_size);
+    }
+    else if (header_size != guess)
+    {
+        // Close the gap between the header and where the payload landed.
+        memmove(a_buffer + header_size, a_buffer + guess, payload);
+    }
+    memcpy(a_buffer, header, header_size);
+    return size;
+}
+
+ErParseResult_t ErParseRecord(const uint8_t *a_bytes, size_t a_size,
+                              ErRecord_t *a_record)
+{
+    ER_ASSERT((a_bytes != NULL) || (a_size == 0));
+    ER_ASSERT(a_record != NULL);
+
+    uint64_t type          = 0;
+    uint64_t payload       = 0;
+    const size_t type_size = ReadVarint(a_bytes, a_size, &type);
+    if ((type_size == 0) || (type_size == SIZE_MAX))
+    {
+        return (type_size == 0) ? ER_PARSE_RESULT__SHORT
+                                : ER_PARSE_RESULT__INVALID;
+    }
+    if ((type > (uint64_t)ER_EVENT_TYPE__LAST) ||
+        (ErSerializerGet((ErEventType_t)type) == NULL))
+    {
+        return ER_PARSE_RESULT__INVALID;
+    }
+    const size_t size_size =
+        ReadVarint(a_bytes + type_size, a_size - type_size, &payload);
+    if ((size_size == 0) || (size_size == SIZE_MAX))
+    {
+        return (size_size == 0) ? ER_PARSE_RESULT__SHORT
+                                : ER_PARSE_RESULT__INVALID;
+    }
+
+    const size_t header_size = type_size + size_size;
+    if (payload > (a_size - header_size))
+    {
+        return ER_PARSE_RESULT__SHORT;
+    }
+    *a_record = (ErRecord_t){
+        .m_type         = (ErEventType_t)type,
+        .m_payload      = a_bytes + header_size,
+        .m_payload_size = (size_t)payload,
+        .m_size         = header_size + (size_t)payload,
+    };
+    return ER_PARSE_RESULT__OK;
+}
+
+bool ErDeserialize(const ErRecord_t *a_record, ErEvent_t *a_event)
+{
+    ER_ASSERT(a_record != NULL);
+    ER_ASSERT(a_event != NULL);
+
+    const ErSerializer_t *serializer = ErSerializerGet(a_record->m_type);
+    if (serializer == NULL)
+    {
+        return false;
+    }
+    if (serializer->m_decode != NULL)
+    {
+        return serializer->m_decode(a_event, a_record->m_payload,
+                                    a_record->m_payload_size);
+    }
+    if (a_record->m_payload_size != (serializer->m_size - sizeof(ErEvent_t)))
+    {
+        return false;
+    }
+    memcpy((uint8_t *)a_event + sizeof(ErEvent_t), a_record->m_payload,
+           a_record->m_payload_size);
+    return true;
+}
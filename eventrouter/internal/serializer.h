@@ -0,0 +1,74 @@
+#ifndef EVENTROUTER_SERIALIZER_H
+#define EVENTROUTER_SERIALIZER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "event.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// The longest header `ErSerialize()` writes: the type and the payload size,
+/// each a LEB128 varint of up to 64 bits.
+#define ER_RECORD_MAX_HEADER_SIZE (20)
+
+    /// Writes the payload of `a_event`, the part of its struct after the
+    /// `ErEvent_t`, to `a_buffer` if it fits in `a_size` bytes. Returns the
+    /// size of the payload either way, so that callers can size buffers with
+    /// `a_size` of 0.
+    typedef size_t (*ErEncode_t)(const ErEvent_t *a_event, uint8_t *a_buffer,
+                                 size_t a_size);
+
+    /// Fills the part of `a_event`'s struct after its `ErEvent_t` from the
+    /// `a_size` bytes of a payload at `a_bytes`. Returns false if they don't
+    /// describe one.
+    typedef bool (*ErDecode_t)(ErEvent_t *a_event, const uint8_t *a_bytes,
+                               size_t a_size);
+
+    /// How events of one type become bytes; see `ErSerializerRegister()`.
+    typedef struct
+    {
+        /// The size of the struct, whose `MIXIN_ER_EVENT` MUST come first.
+        size_t m_size;
+        /// Both NULL for plain-old-data structs, whose payloads are their
+        /// bytes as they are; otherwise both set.
+        ErEncode_t m_encode;
+        ErDecode_t m_decode;
+    } ErSerializer_t;
+
+    /// Initializes an `ErSerializer_t` for `a_struct`, a plain-old-data struct
+    /// that starts with `MIXIN_ER_EVENT` and holds no pointers.
+#define ER_POD_SERIALIZER(a_struct)   \
+    {                                 \
+        .m_size   = sizeof(a_struct), \
+        .m_encode = NULL,             \
+        .m_decode = NULL,             \
+    }
+
+    typedef enum
+    {
+        ER_PARSE_RESULT__OK,
+        /// The bytes end partway through the record.
+        ER_PARSE_RESULT__SHORT,
+        /// The bytes don't start with a record of a registered type.
+        ER_PARSE_RESULT__INVALID,
+    } ErParseResult_t;
+
+    /// A record found by `ErParseRecord()`.
+    typedef struct
+    {
+        ErEventType_t m_type;
+        const uint8_t *m_payload;  //< Points into the parsed bytes.
+        size_t m_payload_size;
+        size_t m_size;  //< The size of the whole record, header included.
+    } ErRecord_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENTROUTER_SERIALIZER_H */
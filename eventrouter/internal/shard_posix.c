@@ -0,0 +1,313 @@
+#include <stdlib.h>
+
+// NOTE: This file is included at the end of eventrouter_os.c and reads the
+// calling thread's `s_router` directly; it is not compiled on its own.
+
+/// @file Mailboxes between the shards of `ErShardsStart()`. Each ordered pair
+/// of shards has a ring that only the first writes and only the second reads.
+/// It carries the first shard's events to the second, and the second shard's
+/// events back once the first is done with them. A shard has at most
+/// `a_capacity` events in any other, so each ring needs room for twice that
+/// and writers never check for it.
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+typedef struct
+{
+    ErEvent_t *m_event;
+    bool m_returning;  //< Whether the event is on its way back to its sender.
+} ShardLetter_t;
+
+typedef struct
+{
+    // Written only by the sending shard; the lines keep it from the receiving
+    // shard's writes.
+    _Alignas(ROUTER_ALIGNMENT) atomic_size_t m_tail;
+    /// The sending shard's events in the receiving shard.
+    size_t m_outstanding;
+
+    // Private to the receiving shard.
+    _Alignas(ROUTER_ALIGNMENT) size_t m_head;
+    ShardLetter_t *m_letters;
+} ShardRing_t;
+
+/// Shards joined by one `ErShardsStart()`; each of their routers points here.
+struct ErShards
+{
+    ErShard_t *m_shards;
+    size_t m_num_shards;
+    size_t m_capacity;  //< Letters in each ring.
+    ErEventType_t m_mail_type;
+    /// Ring `(from * m_num_shards) + to` carries letters from shard `from` to
+    /// shard `to`.
+    ShardRing_t *m_rings;
+};
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+static ShardRing_t *ShardRing(const ErShards_t *a_shards, size_t a_from,
+                              size_t a_to)
+{
+    return &a_shards->m_rings[(a_from * a_shards->m_num_shards) + a_to];
+}
+
+/// Returns the index of the shard the calling thread belongs to.
+static size_t CurrentShard(void)
+{
+    ER_ASSERT(s_router->m_shard != 0);
+    return s_router->m_shard - 1;
+}
+
+/// Posts a letter from the calling shard to `a_to` and wakes its module's
+/// task. Neither ever waits: the ring has room by construction, and the wakeup
+/// is a pending bit plus at most one post that gives up if the task's queue is
+/// full. A shard blocked on a busy peer could hold up that peer in turn.
+static void ShardPost(size_t a_to, ErEvent_t *a_event, bool a_returning)
+{
+    const ErShards_t *shards = s_router->m_shards;
+    ShardRing_t *ring        = ShardRing(shards, CurrentShard(), a_to);
+    const size_t tail =
+        atomic_load_explicit(&ring->m_tail, memory_order_relaxed);
+    ring->m_letters[tail % shards->m_capacity] = (ShardLetter_t){
+        .m_event     = a_event,
+        .m_returning = a_returning,
+    };
+    atomic_store_explicit(&ring->m_tail, tail + 1, memory_order_release);
+
+    // The bit coalesces, so a busy shard is told at most once per batch. Only
+    // the module's task subscribes to the mail type.
+    const ErShard_t *shard = &shards->m_shards[a_to];
+    ErRouter_t *previous   = ErRouterUse(shard->m_router);
+    const size_t task_idx  = shard->m_module->m_task_idx;
+    const BitRef_t bit_ref =
+        GetBitRef(s_router->m_notifications[task_idx].m_pending,
+                  shards->m_mail_type - ER_EVENT_TYPE__FIRST);
+    if ((atomic_fetch_or(bit_ref.m_byte, bit_ref.m_bit_mask) &
+         bit_ref.m_bit_mask) == 0)
+    {
+        WakeTask(task_idx);
+    }
+    ErRouterUse(previous);
+}
+
+/// Returns the shard whose router owns `a_module`.
+static size_t ShardOfModule(const ErModule_t *a_module)
+{
+    const ErShards_t *shards = s_router->m_shards;
+    for (size_t idx = 0; idx < shards->m_num_shards; ++idx)
+    {
+        const ErOptions_t *options = shards->m_shards[idx].m_router->m_options;
+        if (a_module->m_task_idx >= options->m_num_tasks)
+        {
+            continue;
+        }
+        const ErTask_t *task = &options->m_tasks[a_module->m_task_idx];
+        if ((a_module->m_module_idx < task->m_num_modules) &&
+            (task->m_modules[a_module->m_module_idx] == a_module))
+        {
+            return idx;
+        }
+    }
+    ER_ASSERT(false);
+    return 0;
+}
+
+/// Handles every letter that other shards have posted to this one.
+static void ShardReadMail(size_t a_shard)
+{
+    const ErShards_t *shards = s_router->m_shards;
+    ErModule_t *module       = shards->m_shards[a_shard].m_module;
+    for (size_t from = 0; from < shards->m_num_shards; ++from)
+    {
+        if (from == a_shard)
+        {
+            continue;
+        }
+
+        ShardRing_t *ring = ShardRing(shards, from, a_shard);
+        const size_t tail =
+            atomic_load_explicit(&ring->m_tail, memory_order_acquire);
+        for (; ring->m_head != tail; ++ring->m_head)
+        {
+            const ShardLetter_t letter =
+                ring->m_letters[ring->m_head % shards->m_capacity];
+            ErEvent_t *event = letter.m_event;
+
+            if (letter.m_returning)
+            {
+                // One of this shard's events is back. The letter stands for
+                // the other shard's subscribers, so returning it drops their
+                // reference and takes the event to its module's task.
+                ShardRing(shards, a_shard, from)->m_outstanding -= 1;
+                atomic_fetch_add_explicit(&event->m_reference_count, 1,
+                                          memory_order_relaxed);
+                ErReturnToSender(event);
+            }
+            else
+            {
+                // This shard's module sends the event as its own until its
+                // subscribers here are done with it.
+                event->m_remote_sender  = event->m_sending_module;
+                event->m_sending_module = module;
+                atomic_store_explicit(&event->m_reference_count, 0,
+                                      memory_order_relaxed);
+                ErSend(event);
+            }
+        }
+    }
+}
+
+/// Frees `a_shards` once no router points to it.
+static void ShardsFree(ErShards_t *a_shards)
+{
+    if (a_shards->m_rings != NULL)
+    {
+        const size_t num_rings =
+            a_shards->m_num_shards * a_shards->m_num_shards;
+        for (size_t idx = 0; idx < num_rings; ++idx)
+        {
+            ER_ASSERT(a_shards->m_rings[idx].m_outstanding == 0);
+            free(a_shards->m_rings[idx].m_letters);
+        }
+    }
+    free(a_shards->m_shards);
+    free(a_shards->m_rings);
+    free(a_shards);
+}
+
+//==============================================================================
+// Public Functions
+//==============================================================================
+
+ErShards_t *ErShardsStart(const ErShard_t *a_shards, size_t a_num_shards,
+                          size_t a_capacity, ErEventType_t a_mail_type)
+{
+    ER_ASSERT(a_shards != NULL);
+    ER_ASSERT(a_num_shards > 0);
+    ER_ASSERT(a_capacity > 0);
+
+    ErShards_t *shards = calloc(1, sizeof(ErShards_t));
+    if (shards == NULL)
+    {
+        return NULL;
+    }
+    const size_t num_rings = a_num_shards * a_num_shards;
+    shards->m_shards       = calloc(a_num_shards, sizeof(ErShard_t));
+    shards->m_rings =
+        aligned_alloc(ROUTER_ALIGNMENT, num_rings * sizeof(ShardRing_t));
+    shards->m_num_shards = a_num_shards;
+    shards->m_capacity   = 2 * a_capacity;
+    shards->m_mail_type  = a_mail_type;
+
+    bool allocated = (shards->m_shards != NULL) && (shards->m_rings != NULL);
+    if (shards->m_rings != NULL)
+    {
+        memset(shards->m_rings, 0, num_rings * sizeof(ShardRing_t));
+        for (size_t idx = 0; idx < num_rings; ++idx)
+        {
+            shards->m_rings[idx].m_letters =
+                calloc(shards->m_capacity, sizeof(ShardLetter_t));
+            allocated = allocated && (shards->m_rings[idx].m_letters != NULL);
+        }
+    }
+    if (!allocated)
+    {
+        ShardsFree(shards);
+        return NULL;
+    }
+
+    for (size_t idx = 0; idx < a_num_shards; ++idx)
+    {
+        ErRouter_t *previous = ErRouterUse(a_shards[idx].m_router);
+        ER_ASSERT(s_router->m_initialized);
+        ER_ASSERT(s_router->m_shard == 0);
+        ER_ASSERT(a_shards[idx].m_module->m_handler == ErShardHandler);
+
+        // Shards on the default router get its address, so that other
+        // threads can find it.
+        shards->m_shards[idx] = (ErShard_t){
+            .m_router = s_router,
+            .m_module = a_shards[idx].m_module,
+        };
+        s_router->m_shards = shards;
+        s_router->m_shard  = idx + 1;
+        ErSubscribe(a_shards[idx].m_module, a_mail_type);
+        ErRouterUse(previous);
+    }
+
+    return shards;
+}
+
+bool ErShardSend(size_t a_shard, ErEvent_t *a_event)
+{
+    ER_ASSERT(a_event != NULL);
+    const size_t shard       = CurrentShard();
+    const ErShards_t *shards = s_router->m_shards;
+    ER_ASSERT(a_shard < shards->m_num_shards);
+    ER_ASSERT(a_shard != shard);
+    ER_ASSERT_E(IsEventSendable(a_event), a_event);
+    ER_ASSERT_E(!ErEventIsInFlight(a_event), a_event);
+    ER_ASSERT_E(a_event->m_type != shards->m_mail_type, a_event);
+    // The other shard's router would recycle it once it returned there.
+    ER_ASSERT_E(a_event->m_pool == NULL, a_event);
+    ER_ASSERT(GetIndexOfCurrentTask() ==
+              shards->m_shards[shard].m_module->m_task_idx);
+    ER_ASSERT(!IsHelperThread());
+
+    // Each event in the other shard holds one slot here and one for its way
+    // back, so this is all the rings ever need checking.
+    ShardRing_t *ring = ShardRing(shards, shard, a_shard);
+    if (ring->m_outstanding == (shards->m_capacity / 2))
+    {
+        return false;
+    }
+    ring->m_outstanding += 1;
+
+    // The event is in flight until it comes back, and `ErSend()` has nothing
+    // to do with it in this shard.
+    a_event->m_fire_and_forget = false;
+    atomic_store_explicit(&a_event->m_reference_count, 1,
+                          memory_order_relaxed);
+    ShardPost(a_shard, a_event, false);
+    return true;
+}
+
+ErEventHandlerRet_t ErShardHandler(ErEvent_t *a_event, void *a_context)
+{
+    ER_UNUSED(a_context);
+    const size_t shard = CurrentShard();
+
+    if (a_event->m_sending_module == NULL)
+    {
+        ShardReadMail(shard);
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    // An event from another shard is back from this shard's subscribers; it
+    // goes home as it came, in flight.
+    a_event->m_sending_module = a_event->m_remote_sender;
+    atomic_store_explicit(&a_event->m_reference_count, 1,
+                          memory_order_relaxed);
+    ShardPost(ShardOfModule(a_event->m_sending_module), a_event, true);
+    return ER_EVENT_HANDLER_RET__HANDLED;
+}
+
+void ErShardsStop(ErShards_t *a_shards)
+{
+    ER_ASSERT(a_shards != NULL);
+
+    for (size_t idx = 0; idx < a_shards->m_num_shards; ++idx)
+    {
+        const ErShard_t *shard = &a_shards->m_shards[idx];
+        ErRouter_t *previous   = ErRouterUse(shard->m_router);
+        ErUnsubscribe(shard->m_module, a_shards->m_mail_type);
+        s_router->m_shards = NULL;
+        s_router->m_shard  = 0;
+        ErRouterUse(previous);
+    }
+    ShardsFree(a_shards);
+}
@@ -0,0 +1,619 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bridge_posix.h"
+
+// NOTE: This file is included at the end of eventrouter_os.c and reads the
+// calling thread's `s_router` directly; it is not compiled on its own.
+
+/// @file Routes events between processes through a POSIX shared-memory object.
+/// The object holds a range of event slots for each process and a lock-free
+/// queue of letters into each process. An exporter module subscribes to the
+/// types other processes want and copies each event it receives into one of
+/// its process's slots per destination; an importer module in the destination
+/// sends the slot as its own event, in place, and posts it back when its
+/// subscribers are done. The exporter keeps the original until every copy is
+/// back, so return-to-sender works as it does within a process.
+///
+/// Each queue can hold every slot of every process, and a slot is in at most
+/// one queue at a time, so queues never fill. A thread in each process sleeps
+/// on a process-shared semaphore while its queue is empty and wakes the
+/// importer's task with a notification.
+
+//==============================================================================
+// Macros and Defines
+//==============================================================================
+
+#define SHM_BRIDGE_MAGIC   (0x42525245u) /* "ERRB" as little-endian bytes. */
+#define SHM_BRIDGE_VERSION (2u)
+
+/// Describes the `ErEvent_t` that slots hold as it is: its size, and the
+/// settings that can move its fields without changing its size. Processes
+/// built with different ones would misread each other's events.
+#define SHM_BRIDGE_EVENT_LAYOUT                                                \
+    ((uint32_t)sizeof(ErEvent_t) |                                             \
+     ((uint32_t)ER_EVENT_CACHE_LINE_SIZE << 16) |                              \
+     ((uint32_t)(ER_EVENT_STATS != 0) << 30) |                                 \
+     ((uint32_t)(ER_SHARDS != 0) << 31))
+
+/// How long attaching waits for the creator to finish laying out the object.
+#define SHM_BRIDGE_ATTACH_TIMEOUT_MS (1000)
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+/// One entry of a bounded multi-producer queue; see `ShmQueuePush()`.
+typedef struct
+{
+    atomic_size_t m_sequence;
+    uint32_t m_slot;
+    uint32_t m_returning;
+} ShmCell_t;
+
+/// The part of the object that belongs to one process.
+typedef struct
+{
+    /// Bit `i` is set while this process has modules subscribed to type
+    /// `ER_EVENT_TYPE__FIRST + i`.
+    _Alignas(BRIDGE_LINE) atomic_uchar m_wants[BRIDGE_TYPE_BYTES];
+    /// Posted by senders that find the receiver asleep.
+    sem_t m_wakeup;
+    atomic_bool m_sleeping;
+    _Alignas(BRIDGE_LINE) atomic_size_t m_enqueue;
+    _Alignas(BRIDGE_LINE) atomic_size_t m_dequeue;
+} ShmProcess_t;
+
+typedef struct
+{
+    /// Set last by the process that creates the object.
+    atomic_uint m_magic;
+    uint32_t m_version;
+    uint32_t m_num_slots;    //< Slots per process.
+    uint32_t m_slot_stride;  //< Bytes per slot, including its header.
+    uint32_t m_event_layout;  //< The creator's `SHM_BRIDGE_EVENT_LAYOUT`.
+    /// Bit `p` is set while process `p` is attached.
+    atomic_uint m_attached;
+    ShmProcess_t m_processes[ER_SHM_BRIDGE_MAX_PROCESSES];
+} ShmHeader_t;
+
+/// Precedes the event in every slot; only the slot's owner reads it.
+typedef struct
+{
+    _Alignas(BRIDGE_LINE) ErEvent_t *m_original;
+} ShmSlot_t;
+
+struct ErShmBridge
+{
+    ErShmBridgeOptions_t m_options;
+    ErRouter_t *m_router;
+    ShmHeader_t *m_header;
+    size_t m_size;          //< Bytes mapped.
+    bool m_attached;        //< Whether this bridge set its bit in the object.
+    size_t m_queue_length;  //< Cells in each process's queue.
+    ShmCell_t *m_cells;     //< Every process's queue, one after another.
+    uint8_t *m_slots;       //< Every process's slots, one after another.
+
+    // Private to the task of the bridge modules.
+    uint32_t *m_free_slots;  //< A stack of this process's free slots.
+    size_t m_num_free_slots;
+    uint64_t m_drops;
+    size_t m_imports_out;  //< Other processes' copies this one's modules hold.
+    uint8_t m_exported[ER_SHM_BRIDGE_MAX_PROCESSES][BRIDGE_TYPE_BYTES];
+
+    /// Set by the receiver to have the importer exchange subscriptions.
+    atomic_bool m_sync_due;
+    atomic_bool m_running;
+    pthread_t m_thread;
+};
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+static ShmSlot_t *ShmSlot(const ErShmBridge_t *a_bridge, size_t a_slot)
+{
+    return (ShmSlot_t *)(a_bridge->m_slots +
+                         (a_slot * a_bridge->m_header->m_slot_stride));
+}
+
+/// The event in a slot; it starts on the line after the header.
+static ErEvent_t *ShmSlotEvent(const ErShmBridge_t *a_bridge, size_t a_slot)
+{
+    return (ErEvent_t *)((uint8_t *)ShmSlot(a_bridge, a_slot) +
+                         sizeof(ShmSlot_t));
+}
+
+/// Pushes a letter into process `a_process`'s queue and wakes its receiver if
+/// it is asleep. This is Dmitry Vyukov's bounded queue; each cell's sequence
+/// number tells producers and the consumer whose turn it is, so nothing else
+/// is shared and no process ever waits for another to finish a push.
+static void ShmQueuePush(ErShmBridge_t *a_bridge, size_t a_process,
+                         uint32_t a_slot, bool a_returning)
+{
+    ShmProcess_t *process = &a_bridge->m_header->m_processes[a_process];
+    ShmCell_t *cells = &a_bridge->m_cells[a_process * a_bridge->m_queue_length];
+    size_t position =
+        atomic_load_explicit(&process->m_enqueue, memory_order_relaxed);
+    for (;;)
+    {
+        ShmCell_t *cell = &cells[position % a_bridge->m_queue_length];
+        const size_t sequence =
+            atomic_load_explicit(&cell->m_sequence, memory_order_acquire);
+        if (sequence == position)
+        {
+            if (atomic_compare_exchange_weak_explicit(
+                    &process->m_enqueue, &position, position + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+            {
+                cell->m_slot      = a_slot;
+                cell->m_returning = a_returning;
+                atomic_store_explicit(&cell->m_sequence, position + 1,
+                                      memory_order_release);
+                break;
+            }
+        }
+        else
+        {
+            // Queues hold every slot there is, so the cell can only be behind
+            // while another producer is between its claim and its store.
+            position =
+                atomic_load_explicit(&process->m_enqueue, memory_order_relaxed);
+        }
+    }
+
+    // Pairs with the fence in `ShmBridgeThread()`: either the receiver sees
+    // this letter when it checks the queue, or this sees it asleep.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_exchange(&process->m_sleeping, false))
+    {
+        sem_post(&process->m_wakeup);
+    }
+}
+
+/// Pops a letter from this process's queue; returns false if it is empty.
+static bool ShmQueuePop(ErShmBridge_t *a_bridge, ShmCell_t *a_letter)
+{
+    const size_t self     = a_bridge->m_options.m_process;
+    ShmProcess_t *process = &a_bridge->m_header->m_processes[self];
+    ShmCell_t *cells      = &a_bridge->m_cells[self * a_bridge->m_queue_length];
+
+    // This process is the only consumer.
+    const size_t position =
+        atomic_load_explicit(&process->m_dequeue, memory_order_relaxed);
+    ShmCell_t *cell = &cells[position % a_bridge->m_queue_length];
+    if (atomic_load_explicit(&cell->m_sequence, memory_order_acquire) !=
+        position + 1)
+    {
+        return false;
+    }
+
+    a_letter->m_slot      = cell->m_slot;
+    a_letter->m_returning = cell->m_returning;
+    atomic_store_explicit(&cell->m_sequence,
+                          position + a_bridge->m_queue_length,
+                          memory_order_release);
+    atomic_store_explicit(&process->m_dequeue, position + 1,
+                          memory_order_relaxed);
+    return true;
+}
+
+static bool ShmQueueIsEmpty(ErShmBridge_t *a_bridge)
+{
+    const size_t self     = a_bridge->m_options.m_process;
+    ShmProcess_t *process = &a_bridge->m_header->m_processes[self];
+    ShmCell_t *cells      = &a_bridge->m_cells[self * a_bridge->m_queue_length];
+    const size_t position =
+        atomic_load_explicit(&process->m_dequeue, memory_order_relaxed);
+    return atomic_load_explicit(
+               &cells[position % a_bridge->m_queue_length].m_sequence,
+               memory_order_acquire) != position + 1;
+}
+
+/// Publishes the types this process's modules want from others, and
+/// subscribes the exporter to the types other processes want. Runs in the
+/// task of the bridge modules.
+static void ShmBridgeSync(ErShmBridge_t *a_bridge)
+{
+    const ErShmBridgeOptions_t *options = &a_bridge->m_options;
+    ShmHeader_t *header                 = a_bridge->m_header;
+    uint8_t wants[BRIDGE_TYPE_BYTES];
+
+    BridgeLocalWants(options->m_exporter, options->m_importer, wants);
+    for (size_t byte = 0; byte < BRIDGE_TYPE_BYTES; ++byte)
+    {
+        atomic_store_explicit(&header->m_processes[options->m_process]
+                                   .m_wants[byte],
+                              wants[byte], memory_order_relaxed);
+    }
+
+    // The exporter wants whatever any other attached process wants.
+    const unsigned attached =
+        atomic_load_explicit(&header->m_attached, memory_order_acquire);
+    for (size_t process = 0; process < ER_SHM_BRIDGE_MAX_PROCESSES; ++process)
+    {
+        const bool is_peer = (process != options->m_process) &&
+                             ((attached & (1u << process)) != 0);
+        for (size_t byte = 0; byte < BRIDGE_TYPE_BYTES; ++byte)
+        {
+            a_bridge->m_exported[process][byte] =
+                is_peer ? atomic_load_explicit(
+                              &header->m_processes[process].m_wants[byte],
+                              memory_order_relaxed)
+                        : 0;
+        }
+    }
+    BridgeExport(options->m_exporter, a_bridge->m_exported,
+                 ER_SHM_BRIDGE_MAX_PROCESSES, options->m_event_sizes,
+                 options->m_mail_type);
+}
+
+/// Sleeps until letters arrive or it is time to exchange subscriptions, and
+/// wakes the importer's task either way.
+static void *ShmBridgeThread(void *a_bridge)
+{
+    ErShmBridge_t *bridge = a_bridge;
+    ShmProcess_t *process =
+        &bridge->m_header->m_processes[bridge->m_options.m_process];
+    s_router = bridge->m_router;
+
+    while (atomic_load(&bridge->m_running))
+    {
+        // Senders that push after this store post the semaphore, and the
+        // importer takes everything pushed before it, so nothing is missed.
+        // The fence keeps the check below from moving ahead of the store; see
+        // `ShmQueuePush()`. Notifications coalesce, so waking for every letter
+        // costs the importer nothing.
+        atomic_store(&process->m_sleeping, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!ShmQueueIsEmpty(bridge))
+        {
+            ErNotify(bridge->m_options.m_mail_type);
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        const int64_t nanos = deadline.tv_nsec +
+                              ((bridge->m_options.m_poll_ms % 1000) * 1000000);
+        deadline.tv_sec += (bridge->m_options.m_poll_ms / 1000) +
+                           (nanos / 1000000000);
+        deadline.tv_nsec = nanos % 1000000000;
+        if ((sem_timedwait(&process->m_wakeup, &deadline) != 0) &&
+            (errno == ETIMEDOUT))
+        {
+            atomic_store(&bridge->m_sync_due, true);
+            ErNotify(bridge->m_options.m_mail_type);
+        }
+    }
+
+    return NULL;
+}
+
+/// Maps the object, creating and laying it out if this process is first.
+static bool ShmBridgeMap(ErShmBridge_t *a_bridge)
+{
+    const ErShmBridgeOptions_t *options = &a_bridge->m_options;
+    const size_t slot_stride =
+        sizeof(ShmSlot_t) + RoundUp(options->m_slot_size, BRIDGE_LINE);
+    const size_t total_slots =
+        ER_SHM_BRIDGE_MAX_PROCESSES * options->m_num_slots;
+    const size_t cells_offset = RoundUp(sizeof(ShmHeader_t), BRIDGE_LINE);
+    const size_t slots_offset =
+        RoundUp(cells_offset + (ER_SHM_BRIDGE_MAX_PROCESSES * total_slots *
+                                sizeof(ShmCell_t)),
+                BRIDGE_LINE);
+    a_bridge->m_size         = slots_offset + (total_slots * slot_stride);
+    a_bridge->m_queue_length = total_slots;
+
+    bool created = true;
+    int fd       = shm_open(options->m_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if ((fd < 0) && (errno == EEXIST))
+    {
+        created = false;
+        fd      = shm_open(options->m_name, O_RDWR, 0600);
+    }
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    // The creator sizes the object before it lays it out.
+    bool sized = created ? (ftruncate(fd, a_bridge->m_size) == 0) : false;
+    for (int waited_ms = 0;
+         !sized && (waited_ms < SHM_BRIDGE_ATTACH_TIMEOUT_MS); ++waited_ms)
+    {
+        struct stat stat;
+        sized = (fstat(fd, &stat) == 0) &&
+                ((size_t)stat.st_size == a_bridge->m_size);
+        if (!sized)
+        {
+            usleep(1000);
+        }
+    }
+    void *mapping = sized ? mmap(NULL, a_bridge->m_size,
+                                 PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                          : MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        if (created)
+        {
+            shm_unlink(options->m_name);
+        }
+        return false;
+    }
+
+    ShmHeader_t *header = mapping;
+    a_bridge->m_header  = header;
+    a_bridge->m_cells   = (ShmCell_t *)((uint8_t *)mapping + cells_offset);
+    a_bridge->m_slots   = (uint8_t *)mapping + slots_offset;
+    if (created)
+    {
+        header->m_num_slots   = options->m_num_slots;
+        header->m_slot_stride  = slot_stride;
+        header->m_event_layout = SHM_BRIDGE_EVENT_LAYOUT;
+        for (size_t idx = 0; idx < ER_SHM_BRIDGE_MAX_PROCESSES; ++idx)
+        {
+            sem_init(&header->m_processes[idx].m_wakeup, 1, 0);
+        }
+        for (size_t idx = 0; idx < ER_SHM_BRIDGE_MAX_PROCESSES * total_slots;
+             ++idx)
+        {
+            atomic_init(&a_bridge->m_cells[idx].m_sequence,
+                        idx % total_slots);
+        }
+        header->m_version = SHM_BRIDGE_VERSION;
+        atomic_store_explicit(&header->m_magic,
+                              SHM_BRIDGE_MAGIC, memory_order_release);
+    }
+
+    for (int waited_ms = 0;
+         (atomic_load_explicit(&header->m_magic,
+                               memory_order_acquire) != SHM_BRIDGE_MAGIC) &&
+         (waited_ms < SHM_BRIDGE_ATTACH_TIMEOUT_MS);
+         ++waited_ms)
+    {
+        usleep(1000);
+    }
+    return (atomic_load_explicit(&header->m_magic,
+                                 memory_order_acquire) == SHM_BRIDGE_MAGIC) &&
+           (header->m_version == SHM_BRIDGE_VERSION) &&
+           (header->m_num_slots == options->m_num_slots) &&
+           (header->m_slot_stride == slot_stride) &&
+           (header->m_event_layout == SHM_BRIDGE_EVENT_LAYOUT);
+}
+
+/// Frees everything `ErShmBridgeStart()` allocated, and unlinks the object if
+/// no process is attached to it any more.
+static void ShmBridgeFree(ErShmBridge_t *a_bridge)
+{
+    if (a_bridge->m_attached)
+    {
+        const unsigned self = 1u << a_bridge->m_options.m_process;
+        if (atomic_fetch_and(&a_bridge->m_header->m_attached, ~self) == self)
+        {
+            shm_unlink(a_bridge->m_options.m_name);
+        }
+    }
+    if (a_bridge->m_header != NULL)
+    {
+        munmap(a_bridge->m_header, a_bridge->m_size);
+    }
+    free(a_bridge->m_free_slots);
+    free(a_bridge);
+}
+
+//==============================================================================
+// Public Functions
+//==============================================================================
+
+ErShmBridge_t *ErShmBridgeStart(const ErShmBridgeOptions_t *a_options)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_options != NULL);
+    ER_ASSERT(a_options->m_name != NULL);
+    ER_ASSERT(a_options->m_process < ER_SHM_BRIDGE_MAX_PROCESSES);
+    ER_ASSERT(a_options->m_event_sizes != NULL);
+    ER_ASSERT(a_options->m_num_slots > 0);
+    ER_ASSERT(a_options->m_poll_ms > 0);
+    ER_ASSERT(a_options->m_exporter->m_handler == ErShmExportHandler);
+    ER_ASSERT(a_options->m_importer->m_handler == ErShmImportHandler);
+    ER_ASSERT(IsModuleOwned(a_options->m_exporter));
+    ER_ASSERT(IsModuleOwned(a_options->m_importer));
+    ER_ASSERT(a_options->m_exporter->m_task_idx ==
+              a_options->m_importer->m_task_idx);
+    for (size_t idx = 0; idx < ER_EVENT_TYPE__COUNT; ++idx)
+    {
+        ER_ASSERT(a_options->m_event_sizes[idx] <= a_options->m_slot_size);
+        ER_ASSERT((a_options->m_event_sizes[idx] == 0) ||
+                  (a_options->m_event_sizes[idx] >= sizeof(ErEvent_t)));
+    }
+
+    ErShmBridge_t *bridge = calloc(1, sizeof(ErShmBridge_t));
+    if (bridge == NULL)
+    {
+        return NULL;
+    }
+    bridge->m_options = *a_options;
+    bridge->m_router  = s_router;
+    bridge->m_free_slots =
+        malloc(a_options->m_num_slots * sizeof(*bridge->m_free_slots));
+    if ((bridge->m_free_slots == NULL) || !ShmBridgeMap(bridge))
+    {
+        ShmBridgeFree(bridge);
+        return NULL;
+    }
+
+    // Another process may already have this index; leave it attached.
+    const unsigned self = 1u << a_options->m_process;
+    bridge->m_attached  = !(atomic_fetch_or(&bridge->m_header->m_attached,
+                                            self) &
+                           self);
+    if (!bridge->m_attached)
+    {
+        ShmBridgeFree(bridge);
+        return NULL;
+    }
+
+    // This process's slots, handed out from the top of the stack.
+    const size_t first = a_options->m_process * a_options->m_num_slots;
+    for (size_t idx = 0; idx < a_options->m_num_slots; ++idx)
+    {
+        bridge->m_free_slots[idx] = first + a_options->m_num_slots - 1 - idx;
+    }
+    bridge->m_num_free_slots = a_options->m_num_slots;
+
+    a_options->m_exporter->m_context = bridge;
+    a_options->m_importer->m_context = bridge;
+    ErSubscribe(a_options->m_importer, a_options->m_mail_type);
+    atomic_store(&bridge->m_sync_due, true);
+    atomic_store(&bridge->m_running, true);
+    if (pthread_create(&bridge->m_thread, NULL, ShmBridgeThread, bridge) != 0)
+    {
+        ErUnsubscribe(a_options->m_importer, a_options->m_mail_type);
+        ShmBridgeFree(bridge);
+        return NULL;
+    }
+    return bridge;
+}
+
+void ErShmBridgeSync(ErShmBridge_t *a_bridge)
+{
+    ER_ASSERT(a_bridge != NULL);
+    ER_ASSERT(GetIndexOfCurrentTask() ==
+              a_bridge->m_options.m_importer->m_task_idx);
+    ShmBridgeSync(a_bridge);
+}
+
+ErEventHandlerRet_t ErShmExportHandler(ErEvent_t *a_event, void *a_context)
+{
+    ErShmBridge_t *bridge = a_context;
+
+    // Notifications can't wait for copies to return, and imported events
+    // already reached every process that wanted them.
+    if ((a_event->m_sending_module == NULL) ||
+        (a_event->m_sending_module == bridge->m_options.m_importer))
+    {
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    const size_t bit  = a_event->m_type - ER_EVENT_TYPE__FIRST;
+    const size_t size = bridge->m_options.m_event_sizes[bit];
+    size_t copies     = 0;
+    for (size_t process = 0; process < ER_SHM_BRIDGE_MAX_PROCESSES; ++process)
+    {
+        if (!TestBit(bridge->m_exported[process], bit))
+        {
+            continue;
+        }
+        if (bridge->m_num_free_slots == 0)
+        {
+            bridge->m_drops += 1;
+            continue;
+        }
+
+        // This is the only copy; the destination delivers the slot in place.
+        bridge->m_num_free_slots -= 1;
+        const uint32_t slot = bridge->m_free_slots[bridge->m_num_free_slots];
+        ShmSlot(bridge, slot)->m_original = a_event;
+        memcpy(ShmSlotEvent(bridge, slot), a_event, size);
+        ShmQueuePush(bridge, process, slot, false);
+        copies += 1;
+    }
+    if (copies == 0)
+    {
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    // Each copy returns the event once. Returning KEPT covers one of them;
+    // this task holds a reference, so nothing is ordered by the increment.
+    atomic_fetch_add_explicit(&a_event->m_reference_count, copies - 1,
+                              memory_order_relaxed);
+    return ER_EVENT_HANDLER_RET__KEPT;
+}
+
+ErEventHandlerRet_t ErShmImportHandler(ErEvent_t *a_event, void *a_context)
+{
+    ErShmBridge_t *bridge = a_context;
+
+    if (a_event->m_sending_module != NULL)
+    {
+        // A slot from another process is back from this one's subscribers.
+        const size_t slot =
+            ((uint8_t *)a_event - bridge->m_slots) /
+            bridge->m_header->m_slot_stride;
+        bridge->m_imports_out -= 1;
+        ShmQueuePush(bridge, slot / bridge->m_options.m_num_slots,
+                     (uint32_t)slot, true);
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    if (atomic_exchange(&bridge->m_sync_due, false))
+    {
+        ShmBridgeSync(bridge);
+    }
+
+    ShmCell_t letter;
+    while (ShmQueuePop(bridge, &letter))
+    {
+        if (letter.m_returning)
+        {
+            // One of this process's copies is back.
+            ErEvent_t *original = ShmSlot(bridge, letter.m_slot)->m_original;
+            bridge->m_free_slots[bridge->m_num_free_slots] = letter.m_slot;
+            bridge->m_num_free_slots += 1;
+            ErReturnToSender(original);
+        }
+        else
+        {
+            // The copy still carries the sender's routing fields.
+            ErEvent_t *event = ShmSlotEvent(bridge, letter.m_slot);
+            ErEventInit(event, event->m_type, bridge->m_options.m_importer);
+            bridge->m_imports_out += 1;
+            ErSend(event);
+        }
+    }
+    return ER_EVENT_HANDLER_RET__HANDLED;
+}
+
+uint64_t ErShmBridgeGetDropCount(const ErShmBridge_t *a_bridge)
+{
+    ER_ASSERT(a_bridge != NULL);
+    return a_bridge->m_drops;
+}
+
+void ErShmBridgeStop(ErShmBridge_t *a_bridge)
+{
+    ER_ASSERT(a_bridge != NULL);
+    ER_ASSERT(a_bridge->m_num_free_slots == a_bridge->m_options.m_num_slots);
+    // Their returns go through the bridge and the object.
+    ER_ASSERT(a_bridge->m_imports_out == 0);
+
+    ShmProcess_t *process =
+        &a_bridge->m_header->m_processes[a_bridge->m_options.m_process];
+    atomic_store(&a_bridge->m_running, false);
+    sem_post(&process->m_wakeup);
+    pthread_join(a_bridge->m_thread, NULL);
+
+    // Other processes stop exporting to this one when they next sync.
+    for (size_t byte = 0; byte < BRIDGE_TYPE_BYTES; ++byte)
+    {
+        atomic_store_explicit(&process->m_wants[byte], 0,
+                              memory_order_relaxed);
+    }
+    for (size_t bit = 0; bit < ER_EVENT_TYPE__COUNT; ++bit)
+    {
+        ErUnsubscribe(a_bridge->m_options.m_exporter,
+                      (ErEventType_t)(ER_EVENT_TYPE__FIRST + bit));
+    }
+    ErUnsubscribe(a_bridge->m_options.m_importer,
+                  a_bridge->m_options.m_mail_type);
+    ShmBridgeFree(a_bridge);
+}
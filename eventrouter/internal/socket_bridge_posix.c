@@ -0,0 +1,785 @@
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "bridge_posix.h"
+
+// NOTE: This file is included at the end of eventrouter_os.c and reads the
+// calling thread's `s_router` directly; it is not compiled on its own.
+
+/// @file Routes events to a peer router over a connected stream socket. The
+/// bridge modules work as they do in shm_bridge_posix.c, but copies travel as
+/// frames: the exporter queues a frame per event that points at the event
+/// itself, or at its encoding, and a writer thread sends everything queued
+/// with one `sendmsg()`, so the busier the bridge, the more frames each call
+/// carries. A reader thread reads as much as the socket holds at once, copies
+/// or decodes each event into the slot the peer named, and wakes the
+/// importer's task.
+///
+/// Both peers have at most `m_num_slots` events in the other, and a frame is
+/// in at most one queue at a time, so queues never fill.
+///
+/// Once either thread finds the connection broken, by the peer closing it, an
+/// error, or a frame that makes no sense, it marks the bridge broken, shuts
+/// the socket for sending so that a writer blocked on a peer that stopped
+/// reading gives up, and wakes the importer's task. The writer drops frames
+/// from then on, and once it isn't sending, the importer hands back every
+/// event still with the peer.
+
+//==============================================================================
+// Macros and Defines
+//==============================================================================
+
+/// The least the reader asks the socket for at once.
+#define SOCKET_BRIDGE_READ_BYTES (64 * 1024)
+
+/// The fewest buffers POSIX lets one `sendmsg()` take, for systems that don't
+/// say.
+#define SOCKET_BRIDGE_MIN_IOV (16)
+
+//==============================================================================
+// Type Definitions
+//==============================================================================
+
+typedef enum
+{
+    /// An event from the peer's slot `m_id`, followed by its payload: encoded
+    /// if its type has an encoder in the serializer registry, and otherwise
+    /// the part of it after its `ErEvent_t` as it is.
+    SOCKET_FRAME__DELIVER = 1,
+    /// The peer is done with this side's slot `m_id`.
+    SOCKET_FRAME__RETURN,
+    /// The types the peer's modules want, as a bit set.
+    SOCKET_FRAME__WANTS,
+} SocketFrameKind_t;
+
+/// Precedes every frame. Peers share a host, so fields are in its byte order.
+typedef struct
+{
+    uint32_t m_kind;
+    uint32_t m_type;
+    uint32_t m_id;
+    uint32_t m_size;  //< Bytes that follow the header.
+} SocketFrameHeader_t;
+
+typedef struct
+{
+    SocketFrameHeader_t m_header;
+    const void *m_payload;
+} SocketFrame_t;
+
+struct ErSocketBridge
+{
+    ErSocketBridgeOptions_t m_options;
+    ErRouter_t *m_router;
+    size_t m_slot_stride;
+    size_t m_queue_length;  //< Frames in each queue.
+    pthread_t m_reader;
+    pthread_t m_writer;
+    bool m_reader_started;
+    bool m_writer_started;
+    atomic_bool m_running;
+    atomic_bool m_broken;
+
+    // Private to the task of the bridge modules.
+    ErEvent_t **m_originals;  //< The event in each of this side's slots.
+    uint32_t *m_free_slots;   //< A stack of this side's free slots.
+    size_t m_num_free_slots;
+    uint64_t m_drops;
+    size_t m_imports_out;  //< The peer's events this side's modules hold.
+    uint8_t m_exported[BRIDGE_TYPE_BYTES];  //< What the peer wants.
+    uint8_t m_published[BRIDGE_TYPE_BYTES];
+
+    /// The peer's events, one per slot of the peer's; written by the reader
+    /// and then read by the bridge task until it returns the slot.
+    uint8_t *m_inbound;
+    /// Encoded payloads, one per slot of this side's, kept until the writer
+    /// has sent them.
+    uint8_t *m_encoded;
+
+    pthread_mutex_t m_mutex;  //< Guards everything below.
+    pthread_cond_t m_work;    //< Wakes the writer.
+    // Frames waiting for the writer, and the ones it is sending.
+    SocketFrame_t *m_outbox;
+    SocketFrame_t *m_sending;
+    size_t m_outbox_size;
+    bool m_wants_due;  //< Whether `m_published` is yet to be sent.
+    /// Set while the writer sends frames, whose payloads point into events.
+    bool m_writer_busy;
+    // Letters from the reader to the importer, as frames without payloads.
+    SocketFrameHeader_t *m_inbox;
+    size_t m_inbox_head;
+    size_t m_inbox_size;
+    uint8_t m_peer_wants[BRIDGE_TYPE_BYTES];
+    bool m_sync_due;  //< Set to have the importer exchange subscriptions.
+};
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+static ErEvent_t *SocketInboundEvent(const ErSocketBridge_t *a_bridge,
+                                     size_t a_slot)
+{
+    return (ErEvent_t *)(a_bridge->m_inbound +
+                         (a_slot * a_bridge->m_slot_stride));
+}
+
+/// Queues a frame for the writer; call this with the mutex held.
+static void SocketQueueFrame(ErSocketBridge_t *a_bridge,
+                             SocketFrameHeader_t a_header,
+                             const void *a_payload)
+{
+    ER_ASSERT(a_bridge->m_outbox_size < a_bridge->m_queue_length);
+    a_bridge->m_outbox[a_bridge->m_outbox_size] = (SocketFrame_t){
+        .m_header  = a_header,
+        .m_payload = a_payload,
+    };
+    a_bridge->m_outbox_size += 1;
+    pthread_cond_signal(&a_bridge->m_work);
+}
+
+/// Sends all of `a_iov`, at most `a_max_iov` buffers per call. Returns false
+/// if the socket is broken.
+static bool SocketSendAll(int a_socket, struct iovec *a_iov, size_t a_count,
+                          size_t a_max_iov)
+{
+    while (a_count > 0)
+    {
+        struct msghdr message = {
+            .msg_iov    = a_iov,
+            .msg_iovlen = (a_count < a_max_iov) ? a_count : a_max_iov,
+        };
+        // The peer may be gone; that is for the caller to notice, not a
+        // signal.
+        ssize_t sent = sendmsg(a_socket, &message, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+
+        // Skip whatever was sent, and resume partway into the next buffer.
+        while ((a_count > 0) && ((size_t)sent >= a_iov->iov_len))
+        {
+            sent    -= a_iov->iov_len;
+            a_iov   += 1;
+            a_count -= 1;
+        }
+        if (a_count > 0)
+        {
+            a_iov->iov_base  = (uint8_t *)a_iov->iov_base + sent;
+            a_iov->iov_len  -= sent;
+        }
+    }
+    return true;
+}
+
+/// Marks the connection broken and wakes the importer's task to deal with it.
+static void SocketBreak(ErSocketBridge_t *a_bridge)
+{
+    if (!atomic_exchange(&a_bridge->m_broken, true))
+    {
+        // Fails a send that waits for the peer to read; see
+        // `SocketReturnOriginals()`.
+        shutdown(a_bridge->m_options.m_socket, SHUT_WR);
+        ErNotify(a_bridge->m_options.m_mail_type);
+    }
+}
+
+/// Sends queued frames until the bridge stops and the queue is empty. Once the
+/// connection breaks, frames are dropped instead.
+static void *SocketBridgeWriter(void *a_bridge)
+{
+    ErSocketBridge_t *bridge = a_bridge;
+    s_router                 = bridge->m_router;
+    // A header and a payload for every frame, plus the subscriptions.
+    const size_t max_iov = (2 * bridge->m_queue_length) + 2;
+    struct iovec *iov    = calloc(max_iov, sizeof(struct iovec));
+    const long iov_limit = sysconf(_SC_IOV_MAX);
+    const size_t max_iov_per_send =
+        (iov_limit > 0) ? (size_t)iov_limit : SOCKET_BRIDGE_MIN_IOV;
+    SocketFrameHeader_t wants_header;
+    uint8_t wants[BRIDGE_TYPE_BYTES];
+    if (iov == NULL)
+    {
+        SocketBreak(bridge);
+    }
+
+    pthread_mutex_lock(&bridge->m_mutex);
+    for (;;)
+    {
+        while (atomic_load(&bridge->m_running) &&
+               (bridge->m_outbox_size == 0) && !bridge->m_wants_due)
+        {
+            pthread_cond_wait(&bridge->m_work, &bridge->m_mutex);
+        }
+        // Stopping sends whatever is left; the peer waits for returns.
+        if ((bridge->m_outbox_size == 0) && !bridge->m_wants_due)
+        {
+            break;
+        }
+        // The importer hands back the events these frames point into once
+        // this isn't sending.
+        if (atomic_load(&bridge->m_broken))
+        {
+            bridge->m_outbox_size = 0;
+            bridge->m_wants_due   = false;
+            continue;
+        }
+
+        // Swap queues so that the task can queue more while this one sends.
+        SocketFrame_t *frames = bridge->m_outbox;
+        const size_t count    = bridge->m_outbox_size;
+        bridge->m_outbox      = bridge->m_sending;
+        bridge->m_sending     = frames;
+        bridge->m_outbox_size = 0;
+        bridge->m_writer_busy = true;
+        size_t num_iov        = 0;
+        if (bridge->m_wants_due)
+        {
+            memcpy(wants, bridge->m_published, sizeof(wants));
+            wants_header = (SocketFrameHeader_t){
+                .m_kind = SOCKET_FRAME__WANTS,
+                .m_size = sizeof(wants),
+            };
+            bridge->m_wants_due = false;
+            iov[num_iov++] = (struct iovec){&wants_header,
+                                            sizeof(wants_header)};
+            iov[num_iov++] = (struct iovec){wants, sizeof(wants)};
+        }
+        pthread_mutex_unlock(&bridge->m_mutex);
+
+        // Payloads are the events themselves, which stay in flight until the
+        // peer returns them.
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            iov[num_iov++] = (struct iovec){&frames[idx].m_header,
+                                            sizeof(SocketFrameHeader_t)};
+            if (frames[idx].m_header.m_size > 0)
+            {
+                iov[num_iov++] = (struct iovec){
+                    (void *)frames[idx].m_payload,
+                    frames[idx].m_header.m_size,
+                };
+            }
+        }
+        if (!SocketSendAll(bridge->m_options.m_socket, iov, num_iov,
+                           max_iov_per_send))
+        {
+            SocketBreak(bridge);
+        }
+
+        // An importer that found this busy after a break waits for this
+        // wakeup to hand the events back.
+        pthread_mutex_lock(&bridge->m_mutex);
+        bridge->m_writer_busy = false;
+        if (atomic_load(&bridge->m_broken))
+        {
+            pthread_mutex_unlock(&bridge->m_mutex);
+            ErNotify(bridge->m_options.m_mail_type);
+            pthread_mutex_lock(&bridge->m_mutex);
+        }
+    }
+    pthread_mutex_unlock(&bridge->m_mutex);
+
+    free(iov);
+    return NULL;
+}
+
+/// Returns the registry's encoder for `a_type`, or NULL if its payload goes as
+/// it is.
+static ErEncode_t SocketEncoder(ErEventType_t a_type)
+{
+    const ErSerializer_t *serializer = ErSerializerGet(a_type);
+    return (serializer != NULL) ? serializer->m_encode : NULL;
+}
+
+/// Checks a frame from the peer before anything acts on it.
+static bool SocketFrameIsValid(const ErSocketBridge_t *a_bridge,
+                               const SocketFrameHeader_t *a_header)
+{
+    const ErSocketBridgeOptions_t *options = &a_bridge->m_options;
+    switch (a_header->m_kind)
+    {
+        case SOCKET_FRAME__DELIVER:
+        {
+            // Types below the first wrap around to large bits.
+            const size_t bit =
+                (size_t)a_header->m_type - (size_t)ER_EVENT_TYPE__FIRST;
+            if ((a_header->m_id >= options->m_num_slots) ||
+                (bit >= ER_EVENT_TYPE__COUNT) ||
+                (options->m_event_sizes[bit] == 0))
+            {
+                return false;
+            }
+            return (SocketEncoder((ErEventType_t)a_header->m_type) != NULL)
+                       ? (a_header->m_size <= options->m_slot_size)
+                       : (a_header->m_size ==
+                          options->m_event_sizes[bit] - sizeof(ErEvent_t));
+        }
+        case SOCKET_FRAME__RETURN:
+            return (a_header->m_id < options->m_num_slots) &&
+                   (a_header->m_size == 0);
+        case SOCKET_FRAME__WANTS:
+            return a_header->m_size == BRIDGE_TYPE_BYTES;
+        default:
+            return false;
+    }
+}
+
+/// Reads frames until the bridge stops or the connection breaks, and wakes
+/// the importer's task once per read. Also wakes it every `m_poll_ms` to
+/// exchange subscriptions.
+static void *SocketBridgeReader(void *a_bridge)
+{
+    ErSocketBridge_t *bridge = a_bridge;
+    const ErEventType_t mail = bridge->m_options.m_mail_type;
+    const size_t capacity =
+        sizeof(SocketFrameHeader_t) + bridge->m_options.m_slot_size +
+        SOCKET_BRIDGE_READ_BYTES;
+    uint8_t *buffer = malloc(capacity);
+    size_t length   = 0;
+    bool broken     = (buffer == NULL);
+    s_router        = bridge->m_router;
+
+    while (!broken && atomic_load(&bridge->m_running))
+    {
+        struct pollfd poll_fd = {
+            .fd     = bridge->m_options.m_socket,
+            .events = POLLIN,
+        };
+        const int ready = poll(&poll_fd, 1, (int)bridge->m_options.m_poll_ms);
+        if (ready < 0)
+        {
+            broken = (errno != EINTR);
+            continue;
+        }
+        if (ready == 0)
+        {
+            pthread_mutex_lock(&bridge->m_mutex);
+            bridge->m_sync_due = true;
+            pthread_mutex_unlock(&bridge->m_mutex);
+            ErNotify(mail);
+            continue;
+        }
+
+        const ssize_t received = read(bridge->m_options.m_socket,
+                                      buffer + length, capacity - length);
+        if (received <= 0)
+        {
+            broken = (received == 0) || (errno != EINTR);
+            continue;
+        }
+        length += received;
+
+        size_t offset = 0;
+        pthread_mutex_lock(&bridge->m_mutex);
+        while (!broken && ((length - offset) >= sizeof(SocketFrameHeader_t)))
+        {
+            SocketFrameHeader_t header;
+            memcpy(&header, buffer + offset, sizeof(header));
+            broken = !SocketFrameIsValid(bridge, &header);
+            if (broken ||
+                ((length - offset) < (sizeof(header) + header.m_size)))
+            {
+                break;
+            }
+
+            const uint8_t *payload = buffer + offset + sizeof(header);
+            offset += sizeof(header) + header.m_size;
+            if (header.m_kind == SOCKET_FRAME__WANTS)
+            {
+                memcpy(bridge->m_peer_wants, payload, header.m_size);
+                bridge->m_sync_due = true;
+                continue;
+            }
+            if (header.m_kind == SOCKET_FRAME__DELIVER)
+            {
+                // The peer won't reuse the slot until this side returns it.
+                ErEvent_t *event = SocketInboundEvent(bridge, header.m_id);
+                const ErRecord_t record = {
+                    .m_type         = (ErEventType_t)header.m_type,
+                    .m_payload      = payload,
+                    .m_payload_size = header.m_size,
+                };
+                if (SocketEncoder(record.m_type) != NULL)
+                {
+                    broken = !ErDeserialize(&record, event);
+                }
+                else
+                {
+                    memcpy((uint8_t *)event + sizeof(ErEvent_t), payload,
+                           header.m_size);
+                }
+                if (broken)
+                {
+                    break;
+                }
+            }
+            // A peer that keeps to its slots never fills the inbox.
+            broken = (bridge->m_inbox_size == bridge->m_queue_length);
+            if (broken)
+            {
+                break;
+            }
+            bridge->m_inbox[(bridge->m_inbox_head + bridge->m_inbox_size) %
+                            bridge->m_queue_length] = header;
+            bridge->m_inbox_size += 1;
+        }
+        pthread_mutex_unlock(&bridge->m_mutex);
+
+        // Keep the start of a partial frame for the next read.
+        memmove(buffer, buffer + offset, length - offset);
+        length -= offset;
+        ErNotify(mail);
+    }
+
+    // The frames read before the break are in the inbox ahead of it.
+    if (broken)
+    {
+        SocketBreak(bridge);
+    }
+    free(buffer);
+    return NULL;
+}
+
+/// Hands every event still with the peer back to its sender; the peer will
+/// never return them now. Returns the peer sent before it broke came first.
+/// Does nothing while the writer is sending, since its frames may point into
+/// the events; it wakes the importer's task again once it is done.
+static void SocketReturnOriginals(ErSocketBridge_t *a_bridge)
+{
+    pthread_mutex_lock(&a_bridge->m_mutex);
+    const bool busy = a_bridge->m_writer_busy;
+    pthread_mutex_unlock(&a_bridge->m_mutex);
+    if (busy)
+    {
+        return;
+    }
+
+    for (size_t slot = 0; slot < a_bridge->m_options.m_num_slots; ++slot)
+    {
+        ErEvent_t *original = a_bridge->m_originals[slot];
+        if (original != NULL)
+        {
+            a_bridge->m_originals[slot] = NULL;
+            a_bridge->m_free_slots[a_bridge->m_num_free_slots] =
+                (uint32_t)slot;
+            a_bridge->m_num_free_slots += 1;
+            ErReturnToSender(original);
+        }
+    }
+}
+
+/// Frees everything `ErSocketBridgeStart()` allocated.
+static void SocketBridgeFree(ErSocketBridge_t *a_bridge)
+{
+    pthread_mutex_destroy(&a_bridge->m_mutex);
+    pthread_cond_destroy(&a_bridge->m_work);
+    free(a_bridge->m_originals);
+    free(a_bridge->m_free_slots);
+    free(a_bridge->m_inbound);
+    free(a_bridge->m_encoded);
+    free(a_bridge->m_outbox);
+    free(a_bridge->m_sending);
+    free(a_bridge->m_inbox);
+    free(a_bridge);
+}
+
+//==============================================================================
+// Public Functions
+//==============================================================================
+
+ErSocketBridge_t *ErSocketBridgeStart(const ErSocketBridgeOptions_t *a_options)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_options != NULL);
+    ER_ASSERT(a_options->m_socket >= 0);
+    ER_ASSERT(a_options->m_event_sizes != NULL);
+    ER_ASSERT(a_options->m_num_slots > 0);
+    ER_ASSERT(a_options->m_num_slots <= UINT32_MAX);
+    ER_ASSERT(a_options->m_poll_ms > 0);
+    ER_ASSERT(a_options->m_exporter->m_handler == ErSocketExportHandler);
+    ER_ASSERT(a_options->m_importer->m_handler == ErSocketImportHandler);
+    ER_ASSERT(IsModuleOwned(a_options->m_exporter));
+    ER_ASSERT(IsModuleOwned(a_options->m_importer));
+    ER_ASSERT(a_options->m_exporter->m_task_idx ==
+              a_options->m_importer->m_task_idx);
+    for (size_t idx = 0; idx < ER_EVENT_TYPE__COUNT; ++idx)
+    {
+        ER_ASSERT(a_options->m_event_sizes[idx] <= a_options->m_slot_size);
+        ER_ASSERT((a_options->m_event_sizes[idx] == 0) ||
+                  (a_options->m_event_sizes[idx] >= sizeof(ErEvent_t)));
+    }
+
+    ErSocketBridge_t *bridge = calloc(1, sizeof(ErSocketBridge_t));
+    if (bridge == NULL)
+    {
+        return NULL;
+    }
+    const size_t num_slots = a_options->m_num_slots;
+    bridge->m_options      = *a_options;
+    bridge->m_router       = s_router;
+    bridge->m_slot_stride  = RoundUp(a_options->m_slot_size, BRIDGE_LINE);
+    // Deliveries of this side's slots, and returns of the peer's.
+    bridge->m_queue_length = 2 * num_slots;
+    pthread_mutex_init(&bridge->m_mutex, NULL);
+    pthread_cond_init(&bridge->m_work, NULL);
+    bridge->m_originals  = calloc(num_slots, sizeof(ErEvent_t *));
+    bridge->m_free_slots = calloc(num_slots, sizeof(uint32_t));
+    bridge->m_inbound =
+        aligned_alloc(BRIDGE_LINE, num_slots * bridge->m_slot_stride);
+    bridge->m_encoded = malloc(num_slots * bridge->m_slot_stride);
+    bridge->m_outbox =
+        calloc(bridge->m_queue_length, sizeof(SocketFrame_t));
+    bridge->m_sending =
+        calloc(bridge->m_queue_length, sizeof(SocketFrame_t));
+    bridge->m_inbox =
+        calloc(bridge->m_queue_length, sizeof(SocketFrameHeader_t));
+    if ((bridge->m_originals == NULL) || (bridge->m_free_slots == NULL) ||
+        (bridge->m_inbound == NULL) || (bridge->m_encoded == NULL) ||
+        (bridge->m_outbox == NULL) ||
+        (bridge->m_sending == NULL) || (bridge->m_inbox == NULL))
+    {
+        SocketBridgeFree(bridge);
+        return NULL;
+    }
+    for (size_t idx = 0; idx < num_slots; ++idx)
+    {
+        bridge->m_free_slots[idx] = num_slots - 1 - idx;
+    }
+    bridge->m_num_free_slots = num_slots;
+    bridge->m_sync_due       = true;
+
+    a_options->m_exporter->m_context = bridge;
+    a_options->m_importer->m_context = bridge;
+    ErSubscribe(a_options->m_importer, a_options->m_mail_type);
+    atomic_store(&bridge->m_running, true);
+    bridge->m_writer_started = (pthread_create(&bridge->m_writer, NULL,
+                                               SocketBridgeWriter,
+                                               bridge) == 0);
+    bridge->m_reader_started =
+        bridge->m_writer_started &&
+        (pthread_create(&bridge->m_reader, NULL, SocketBridgeReader, bridge) ==
+         0);
+    if (!bridge->m_reader_started)
+    {
+        ErSocketBridgeStop(bridge);
+        return NULL;
+    }
+    return bridge;
+}
+
+void ErSocketBridgeSync(ErSocketBridge_t *a_bridge)
+{
+    ER_ASSERT(a_bridge != NULL);
+    ER_ASSERT(GetIndexOfCurrentTask() ==
+              a_bridge->m_options.m_importer->m_task_idx);
+
+    uint8_t wants[BRIDGE_TYPE_BYTES];
+    BridgeLocalWants(a_bridge->m_options.m_exporter,
+                     a_bridge->m_options.m_importer, wants);
+
+    pthread_mutex_lock(&a_bridge->m_mutex);
+    a_bridge->m_sync_due = false;
+    if (memcmp(wants, a_bridge->m_published, sizeof(wants)) != 0)
+    {
+        memcpy(a_bridge->m_published, wants, sizeof(wants));
+        a_bridge->m_wants_due = true;
+        pthread_cond_signal(&a_bridge->m_work);
+    }
+    memcpy(a_bridge->m_exported, a_bridge->m_peer_wants,
+           sizeof(a_bridge->m_peer_wants));
+    pthread_mutex_unlock(&a_bridge->m_mutex);
+
+    BridgeExport(a_bridge->m_options.m_exporter, &a_bridge->m_exported, 1,
+                 a_bridge->m_options.m_event_sizes,
+                 a_bridge->m_options.m_mail_type);
+}
+
+ErEventHandlerRet_t ErSocketExportHandler(ErEvent_t *a_event, void *a_context)
+{
+    ErSocketBridge_t *bridge = a_context;
+
+    // Notifications can't wait for the peer to return them, and imported
+    // events came from the peer.
+    if ((a_event->m_sending_module == NULL) ||
+        (a_event->m_sending_module == bridge->m_options.m_importer))
+    {
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+    if ((bridge->m_num_free_slots == 0) || atomic_load(&bridge->m_broken))
+    {
+        bridge->m_drops += 1;
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    const size_t bit    = a_event->m_type - ER_EVENT_TYPE__FIRST;
+    const uint32_t slot = bridge->m_free_slots[bridge->m_num_free_slots - 1];
+    const uint8_t *payload = (const uint8_t *)a_event + sizeof(ErEvent_t);
+    size_t size = bridge->m_options.m_event_sizes[bit] - sizeof(ErEvent_t);
+    if (SocketEncoder(a_event->m_type) != NULL)
+    {
+        uint8_t *encoded = bridge->m_encoded + (slot * bridge->m_slot_stride);
+        size             = ErEncodePayload(a_event, encoded,
+                                           bridge->m_options.m_slot_size);
+        payload          = encoded;
+        if (size > bridge->m_options.m_slot_size)
+        {
+            bridge->m_drops += 1;
+            return ER_EVENT_HANDLER_RET__HANDLED;
+        }
+    }
+    bridge->m_num_free_slots -= 1;
+    bridge->m_originals[slot] = a_event;
+
+    pthread_mutex_lock(&bridge->m_mutex);
+    SocketQueueFrame(bridge,
+                     (SocketFrameHeader_t){
+                         .m_kind = SOCKET_FRAME__DELIVER,
+                         .m_type = a_event->m_type,
+                         .m_id   = slot,
+                         .m_size = size,
+                     },
+                     payload);
+    pthread_mutex_unlock(&bridge->m_mutex);
+
+    return ER_EVENT_HANDLER_RET__KEPT;
+}
+
+ErEventHandlerRet_t ErSocketImportHandler(ErEvent_t *a_event, void *a_context)
+{
+    ErSocketBridge_t *bridge = a_context;
+
+    if (a_event->m_sending_module != NULL)
+    {
+        // One of the peer's events is back from this side's subscribers.
+        const size_t slot =
+            ((uint8_t *)a_event - bridge->m_inbound) / bridge->m_slot_stride;
+        bridge->m_imports_out -= 1;
+        pthread_mutex_lock(&bridge->m_mutex);
+        SocketQueueFrame(bridge,
+                         (SocketFrameHeader_t){
+                             .m_kind = SOCKET_FRAME__RETURN,
+                             .m_id   = (uint32_t)slot,
+                         },
+                         NULL);
+        pthread_mutex_unlock(&bridge->m_mutex);
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    pthread_mutex_lock(&bridge->m_mutex);
+    const bool sync_due = bridge->m_sync_due;
+    pthread_mutex_unlock(&bridge->m_mutex);
+    if (sync_due)
+    {
+        ErSocketBridgeSync(bridge);
+    }
+
+    for (;;)
+    {
+        pthread_mutex_lock(&bridge->m_mutex);
+        const bool any = (bridge->m_inbox_size > 0);
+        SocketFrameHeader_t letter;
+        if (any)
+        {
+            letter = bridge->m_inbox[bridge->m_inbox_head];
+            bridge->m_inbox_head =
+                (bridge->m_inbox_head + 1) % bridge->m_queue_length;
+            bridge->m_inbox_size -= 1;
+        }
+        pthread_mutex_unlock(&bridge->m_mutex);
+        if (!any)
+        {
+            break;
+        }
+
+        if (letter.m_kind == SOCKET_FRAME__RETURN)
+        {
+            // A broken writer doesn't stop the reader, so a return can still
+            // come in for an event that was already handed back.
+            ErEvent_t *original = bridge->m_originals[letter.m_id];
+            if (original == NULL)
+            {
+                ER_ASSERT(atomic_load(&bridge->m_broken));
+                continue;
+            }
+            bridge->m_originals[letter.m_id] = NULL;
+            bridge->m_free_slots[bridge->m_num_free_slots] = letter.m_id;
+            bridge->m_num_free_slots += 1;
+            ErReturnToSender(original);
+        }
+        else
+        {
+            ErEvent_t *event = SocketInboundEvent(bridge, letter.m_id);
+            ErEventInit(event, (ErEventType_t)letter.m_type,
+                        bridge->m_options.m_importer);
+            bridge->m_imports_out += 1;
+            ErSend(event);
+        }
+    }
+
+    if (atomic_load(&bridge->m_broken))
+    {
+        SocketReturnOriginals(bridge);
+    }
+    return ER_EVENT_HANDLER_RET__HANDLED;
+}
+
+uint64_t ErSocketBridgeGetDropCount(const ErSocketBridge_t *a_bridge)
+{
+    ER_ASSERT(a_bridge != NULL);
+    return a_bridge->m_drops;
+}
+
+bool ErSocketBridgeIsBroken(const ErSocketBridge_t *a_bridge)
+{
+    ER_ASSERT(a_bridge != NULL);
+    return atomic_load(&a_bridge->m_broken);
+}
+
+void ErSocketBridgeStop(ErSocketBridge_t *a_bridge)
+{
+    ER_ASSERT(a_bridge != NULL);
+    // Their slots are about to be freed, and their returns come through it.
+    ER_ASSERT(a_bridge->m_imports_out == 0);
+
+    // The writer sends any returns still queued before it exits; the reader
+    // notices within `m_poll_ms`.
+    pthread_mutex_lock(&a_bridge->m_mutex);
+    atomic_store(&a_bridge->m_running, false);
+    pthread_cond_signal(&a_bridge->m_work);
+    pthread_mutex_unlock(&a_bridge->m_mutex);
+    if (a_bridge->m_writer_started)
+    {
+        pthread_join(a_bridge->m_writer, NULL);
+    }
+    if (a_bridge->m_reader_started)
+    {
+        pthread_join(a_bridge->m_reader, NULL);
+    }
+
+    // With the writer gone, nothing points into the events any more.
+    if (atomic_load(&a_bridge->m_broken))
+    {
+        SocketReturnOriginals(a_bridge);
+    }
+    ER_ASSERT(a_bridge->m_num_free_slots == a_bridge->m_options.m_num_slots);
+
+    for (size_t bit = 0; bit < ER_EVENT_TYPE__COUNT; ++bit)
+    {
+        ErUnsubscribe(a_bridge->m_options.m_exporter,
+                      (ErEventType_t)(ER_EVENT_TYPE__FIRST + bit));
+    }
+    ErUnsubscribe(a_bridge->m_options.m_importer,
+                  a_bridge->m_options.m_mail_type);
+    SocketBridgeFree(a_bridge);
+}
@@ -0,0 +1,71 @@
+#ifndef EVENTROUTER_STATS_H
+#define EVENTROUTER_STATS_H
+
+/// @file Types describing the optional statistics kept by OS-backed
+/// implementations; see `ER_TASK_STATS` and `ER_EVENT_STATS`.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "checked_config.h"
+
+#ifndef ER_CONFIG_OS
+#error "Statistics are only kept by OS-backed implementations."
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /// A snapshot of how busy a task is. "Busy" time is time spent outside
+    /// `ErReceive()`/`ErTimedReceive()` (handling events); "blocked" time is
+    /// time spent inside them waiting for events. A receive is "saturated" if
+    /// the task's queue already held events when the task asked for the next
+    /// one, meaning it never had a chance to idle.
+    typedef struct
+    {
+        /// Totals accumulated since initialization.
+        int64_t m_busy_us;
+        int64_t m_blocked_us;
+        uint32_t m_receives;
+        uint32_t m_saturated_receives;
+
+        /// Rolling values computed over the last complete window of
+        /// `ER_TASK_STATS_WINDOW_MS`; both are zero until one window elapses.
+        uint16_t m_utilization_permille;
+        uint16_t m_saturation_permille;
+
+        /// The depth of the task's queue at its most recent receive.
+        size_t m_queue_depth;
+    } ErTaskStats_t;
+
+
+    /// Counters kept for each event type. Latency is measured from the moment
+    /// an idle event is sent until it is handed back to its sending module; it
+    /// covers queueing, every subscriber's handler, and any time spent KEPT.
+    typedef struct
+    {
+        uint64_t m_sends;    /// Every call to `ErSendEx()`, including re-sends.
+        uint64_t m_returns;  /// Every time an event came back to its sender.
+        uint64_t m_latency_buckets[ER_LATENCY_BUCKET_COUNT];
+    } ErEventTypeStats_t;
+
+#if ER_IMPLEMENTATION == ER_IMPL_POSIX
+    /// Counters for the `ErOffload()` pool since `ErOffloadStart()`. These are
+    /// always kept; they cost nothing beyond the pool's own lock.
+    typedef struct
+    {
+        uint64_t m_jobs;      /// Work items finished.
+        uint64_t m_waits;     /// Calls to `ErOffload()` that waited for room.
+        int64_t m_busy_us;    /// Time workers spent in work functions.
+        size_t m_queued;      /// Work items waiting for a worker right now.
+        size_t m_peak_queued; /// The most that have waited at once.
+    } ErOffloadStats_t;
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENTROUTER_STATS_H */
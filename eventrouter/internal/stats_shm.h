@@ -0,0 +1,109 @@
+#ifndef EVENTROUTER_STATS_SHM_H
+#define EVENTROUTER_STATS_SHM_H
+
+/// @file The layout of the shared-memory object written by `ErStatsShmStart()`.
+/// This header only depends on the configuration and the C library so tools
+/// that monitor a router from another process can include it, map the object
+/// read-only, and copy snapshots out with `ErStatsShmRead()` without linking
+/// against the router.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "atomic.h"
+#include "checked_config.h"
+#include "event_type.h"
+#include "stats.h"
+
+#if ER_IMPLEMENTATION != ER_IMPL_POSIX
+#error "Shared-memory statistics are only available in the POSIX implementation"
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// Identifies a statistics object and the version of its layout. Readers must
+/// check both before trusting any other field.
+#define ER_STATS_SHM_MAGIC   (0x54535245u) /* "ERST" as little-endian bytes. */
+#define ER_STATS_SHM_VERSION (2u)
+
+/// The maximum number of tasks described by a snapshot; this matches the
+/// maximum number of tasks a router supports.
+#define ER_STATS_SHM_MAX_TASKS (32)
+
+    typedef struct
+    {
+        /// The statistics for the task; all zero unless `ER_TASK_STATS` is set.
+        ErTaskStats_t m_stats;
+        /// The depth of the task's queue when the snapshot was taken.
+        uint64_t m_queue_depth;
+        /// See `ErGetTaskDropCount()`.
+        uint64_t m_drops;
+    } ErStatsShmTask_t;
+
+    typedef struct
+    {
+        /// The counters for the type; all zero unless `ER_EVENT_STATS` is set.
+        ErEventTypeStats_t m_stats;
+        /// Sends per second, averaged over the time since the last snapshot.
+        uint64_t m_sends_per_second;
+    } ErStatsShmType_t;
+
+    typedef struct
+    {
+        uint32_t m_magic;
+        uint32_t m_version;
+
+        /// Odd while the publisher is writing a snapshot; incremented twice
+        /// per snapshot. See `ErStatsShmRead()`.
+        atomic_uint m_sequence;
+
+        /// The time the snapshot was taken, from `ErOsFunctions_t::GetTimeUs`.
+        int64_t m_timestamp_us;
+
+        uint32_t m_num_tasks;
+        uint32_t m_num_types;   /// Always `ER_EVENT_TYPE__COUNT`.
+        int32_t m_first_type;   /// Always `ER_EVENT_TYPE__FIRST`.
+
+        ErStatsShmTask_t m_tasks[ER_STATS_SHM_MAX_TASKS];
+        ErStatsShmType_t m_types[ER_EVENT_TYPE__COUNT];
+    } ErStatsShm_t;
+
+    /// Copies a consistent snapshot out of `a_shm` (usually a read-only
+    /// mapping of the object) into `a_copy`. Returns false if `a_shm` does not
+    /// look like a statistics object built with this configuration. This never
+    /// blocks the publisher; it retries if a snapshot changes mid-copy.
+    static inline bool ErStatsShmRead(const ErStatsShm_t *a_shm,
+                                      ErStatsShm_t *a_copy)
+    {
+        if ((a_shm->m_magic != ER_STATS_SHM_MAGIC) ||
+            (a_shm->m_version != ER_STATS_SHM_VERSION) ||
+            (a_shm->m_num_types != ER_EVENT_TYPE__COUNT))
+        {
+            return false;
+        }
+
+        ErStatsShm_t *shm = (ErStatsShm_t *)a_shm;
+        unsigned before   = 0;
+        unsigned after    = 0;
+        do
+        {
+            before = atomic_load_explicit(&shm->m_sequence,
+                                          memory_order_acquire);
+            memcpy((void *)a_copy, (const void *)a_shm, sizeof(*a_copy));
+            atomic_thread_fence(memory_order_acquire);
+            after = atomic_load_explicit(&shm->m_sequence,
+                                         memory_order_relaxed);
+        } while ((before != after) || (before & 1));
+
+        return true;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENTROUTER_STATS_SHM_H */
@@ -0,0 +1,206 @@
+#include "stats_shm.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+// NOTE: This file is included at the end of eventrouter_os.c and reads the
+// calling thread's `s_router` directly; it is not compiled on its own.
+
+//==============================================================================
+// Static Variables
+//==============================================================================
+
+static struct
+{
+    pthread_mutex_t m_mutex;  //< Serializes snapshots, start, and stop.
+    pthread_cond_t m_cond;    //< Wakes the publisher early when stopping.
+    bool m_running;
+    pthread_t m_thread;
+    int64_t m_period_ms;
+    char m_name[NAME_MAX];
+    ErStatsShm_t *m_shm;
+    ErRouter_t *m_router;  //< The router whose statistics are published.
+
+    // Used to turn cumulative send counts into rates.
+    bool m_has_last_snapshot;
+    int64_t m_last_timestamp_us;
+    uint64_t m_last_sends[ER_EVENT_TYPE__COUNT];
+} s_stats_shm = {
+    .m_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .m_cond  = PTHREAD_COND_INITIALIZER,
+};
+
+//==============================================================================
+// Local Functions
+//==============================================================================
+
+/// Writes one snapshot into the shared object; the caller must hold the mutex.
+static void StatsShmSnapshot(void)
+{
+    ErRouter_t *previous = ErRouterUse(s_stats_shm.m_router);
+    ErStatsShm_t *shm    = s_stats_shm.m_shm;
+    const int64_t now_us = s_router->m_os_functions.GetTimeUs();
+
+    // This thread is the only writer; bracketing the update with odd and even
+    // sequence numbers lets readers in other processes detect torn copies.
+    const unsigned sequence =
+        atomic_load_explicit(&shm->m_sequence, memory_order_relaxed);
+    atomic_store_explicit(&shm->m_sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    shm->m_timestamp_us = now_us;
+    shm->m_num_tasks    = s_router->m_options->m_num_tasks;
+
+    for (size_t idx = 0; idx < s_router->m_options->m_num_tasks; ++idx)
+    {
+#if ER_TASK_STATS
+        ErGetTaskStats(idx, &shm->m_tasks[idx].m_stats);
+#endif
+        shm->m_tasks[idx].m_queue_depth = ErGetTaskQueueDepth(idx);
+        shm->m_tasks[idx].m_drops       = ErGetTaskDropCount(idx);
+    }
+
+#if ER_EVENT_STATS
+    const int64_t elapsed_us = now_us - s_stats_shm.m_last_timestamp_us;
+    for (size_t idx = 0; idx < ER_EVENT_TYPE__COUNT; ++idx)
+    {
+        ErStatsShmType_t *type = &shm->m_types[idx];
+        ErGetEventTypeStats(ER_EVENT_TYPE__FIRST + idx, &type->m_stats);
+
+        const uint64_t sends = type->m_stats.m_sends;
+        type->m_sends_per_second =
+            (s_stats_shm.m_has_last_snapshot && (elapsed_us > 0))
+                ? (((sends - s_stats_shm.m_last_sends[idx]) * 1000000) /
+                   elapsed_us)
+                : 0;
+        s_stats_shm.m_last_sends[idx] = sends;
+    }
+#endif
+
+    atomic_store_explicit(&shm->m_sequence, sequence + 2, memory_order_release);
+
+    s_stats_shm.m_has_last_snapshot = true;
+    s_stats_shm.m_last_timestamp_us = now_us;
+    ErRouterUse(previous);
+}
+
+static void *StatsShmThread(void *a_unused)
+{
+    ER_UNUSED(a_unused);
+
+    pthread_mutex_lock(&s_stats_shm.m_mutex);
+    while (s_stats_shm.m_running)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        const int64_t nanos = deadline.tv_nsec +
+                              (s_stats_shm.m_period_ms % 1000) * 1000000;
+        deadline.tv_sec += (s_stats_shm.m_period_ms / 1000) +
+                           (nanos / 1000000000);
+        deadline.tv_nsec = nanos % 1000000000;
+
+        pthread_cond_timedwait(&s_stats_shm.m_cond, &s_stats_shm.m_mutex,
+                               &deadline);
+        if (s_stats_shm.m_running)
+        {
+            StatsShmSnapshot();
+        }
+    }
+    pthread_mutex_unlock(&s_stats_shm.m_mutex);
+
+    return NULL;
+}
+
+//==============================================================================
+// Public Functions
+//==============================================================================
+
+bool ErStatsShmStart(const char *a_name, int64_t a_period_ms)
+{
+    ER_ASSERT(s_router->m_initialized);
+    ER_ASSERT(a_name != NULL);
+    ER_ASSERT(strlen(a_name) < sizeof(s_stats_shm.m_name));
+    ER_ASSERT(a_period_ms > 0);
+
+    pthread_mutex_lock(&s_stats_shm.m_mutex);
+    ER_ASSERT(!s_stats_shm.m_running);
+
+    bool result = false;
+    const int fd = shm_open(a_name, O_CREAT | O_RDWR, 0644);
+    if (fd >= 0)
+    {
+        void *mapping = MAP_FAILED;
+        if (ftruncate(fd, sizeof(ErStatsShm_t)) == 0)
+        {
+            mapping = mmap(NULL, sizeof(ErStatsShm_t), PROT_READ | PROT_WRITE,
+                           MAP_SHARED, fd, 0);
+        }
+        close(fd);
+
+        if (mapping != MAP_FAILED)
+        {
+            ErStatsShm_t *shm = mapping;
+            memset(shm, 0, sizeof(*shm));
+            shm->m_magic      = ER_STATS_SHM_MAGIC;
+            shm->m_version    = ER_STATS_SHM_VERSION;
+            shm->m_num_types  = ER_EVENT_TYPE__COUNT;
+            shm->m_first_type = ER_EVENT_TYPE__FIRST;
+
+            strcpy(s_stats_shm.m_name, a_name);
+            s_stats_shm.m_shm               = shm;
+            s_stats_shm.m_router            = s_router;
+            s_stats_shm.m_period_ms         = a_period_ms;
+            s_stats_shm.m_has_last_snapshot = false;
+            memset(s_stats_shm.m_last_sends, 0,
+                   sizeof(s_stats_shm.m_last_sends));
+            s_stats_shm.m_running = true;
+            StatsShmSnapshot();
+
+            if (pthread_create(&s_stats_shm.m_thread, NULL, StatsShmThread,
+                               NULL) == 0)
+            {
+                result = true;
+            }
+            else
+            {
+                s_stats_shm.m_running = false;
+                munmap(shm, sizeof(*shm));
+                shm_unlink(a_name);
+            }
+        }
+        else
+        {
+            shm_unlink(a_name);
+        }
+    }
+
+    pthread_mutex_unlock(&s_stats_shm.m_mutex);
+    return result;
+}
+
+void ErStatsShmPublish(void)
+{
+    pthread_mutex_lock(&s_stats_shm.m_mutex);
+    ER_ASSERT(s_stats_shm.m_running);
+    StatsShmSnapshot();
+    pthread_mutex_unlock(&s_stats_shm.m_mutex);
+}
+
+void ErStatsShmStop(void)
+{
+    pthread_mutex_lock(&s_stats_shm.m_mutex);
+    ER_ASSERT(s_stats_shm.m_running);
+    s_stats_shm.m_running = false;
+    pthread_cond_signal(&s_stats_shm.m_cond);
+    pthread_mutex_unlock(&s_stats_shm.m_mutex);
+
+    pthread_join(s_stats_shm.m_thread, NULL);
+
+    munmap(s_stats_shm.m_shm, sizeof(*s_stats_shm.m_shm));
+    shm_unlink(s_stats_shm.m_name);
+    s_stats_shm.m_shm = NULL;
+}
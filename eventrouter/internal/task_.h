@@ -2,6 +2,7 @@
 #define EVENTROUTER_TASK_H
 
 #include <limits.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -18,6 +19,41 @@
 extern "C"
 {
 #endif
+#ifdef ER_CONFIG_OS
+    /// What happens to an event sent to a task whose queue is full. Every
+    /// policy but `ER_OVERFLOW_POLICY__BLOCK` counts each event it drops; see
+    /// `ErGetTaskDropCount()`. An event dropped for a task is never delivered
+    /// to that task's modules, but otherwise returns to its sender as usual.
+    typedef enum
+    {
+        /// Leave it to `ErOsFunctions_t::SendEvent`; the POSIX implementation
+        /// waits for room and the FreeRTOS implementation asserts.
+        ER_OVERFLOW_POLICY__BLOCK = 0,
+        /// Drop the event being sent.
+        ER_OVERFLOW_POLICY__DROP_NEWEST,
+        /// Drop the oldest queued event and add the new one at the back.
+        /// Events on their way back to their sending module are never dropped;
+        /// if nothing else is queued, the new event is dropped instead.
+        ER_OVERFLOW_POLICY__DROP_OLDEST,
+        /// Replace the oldest queued event of the same type from the same
+        /// sending module, keeping its place in the queue. If there is none,
+        /// behave like `ER_OVERFLOW_POLICY__DROP_OLDEST`. This suits events
+        /// which describe state, where only the newest value matters.
+        ER_OVERFLOW_POLICY__CONFLATE,
+    } ErOverflowPolicy_t;
+
+    /// How a worker group picks the one member task that gets each event; see
+    /// `ErTask_t::m_worker_group`.
+    typedef enum
+    {
+        /// Take turns, skipping members with no subscribed module.
+        ER_WORKER_BALANCE__ROUND_ROBIN = 0,
+        /// Pick the member with the fewest queued events. Ties go to the
+        /// member whose turn it would be under round-robin.
+        ER_WORKER_BALANCE__LEAST_LOADED,
+    } ErWorkerBalance_t;
+#endif
+
     /// Represents a task which participates in event routing.
     typedef struct
     {
@@ -38,6 +74,21 @@ extern "C"
         /// contain the same module. Each task MUST contain at least one module.
         ErModule_t **m_modules;
         size_t m_num_modules;
+
+#ifdef ER_CONFIG_OS
+        /// Batches the events this task returns to modules in other tasks;
+        /// see `ER_RETURN_BATCH_SIZE`, which MUST be non-zero to set this.
+        bool m_batch_returns;
+        /// Applies when this task's queue is full; see `ErOverflowPolicy_t`.
+        ErOverflowPolicy_t m_overflow_policy;
+        /// Tasks with the same non-zero group, at most `TASK_SEND_LIMIT`, are
+        /// interchangeable workers: each event goes to just one of the group's
+        /// tasks with a subscribed module, instead of to every one of them,
+        /// and returns to its sender as usual. Members usually own identical
+        /// modules, and MUST all use the same `m_worker_balance`.
+        uint8_t m_worker_group;
+        ErWorkerBalance_t m_worker_balance;
+#endif
     } ErTask_t;
 
 #ifdef __cplusplus
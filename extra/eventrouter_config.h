@@ -12,4 +12,7 @@
     X(ER_EVENT_TYPE__5)        \
     X(ER_EVENT_TYPE__SENSOR_DATA)
 
+/// NOTE: Optional features keep their defaults here; the libraries that turn
+/// them on are described in CMakeLists.txt.
+
 #endif /* EVENTROUTER_CONFIG_H */
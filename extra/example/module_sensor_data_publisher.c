@@ -12,25 +12,33 @@ static ErEventHandlerRet_t SensorDataPublisher_EventHandler(ErEvent_t *a_event,
 ErModule_t g_sensor_data_publisher_module =
     ER_CREATE_MODULE(SensorDataPublisher_EventHandler, NULL);
 
-static SensorDataEvent_t s_event = {
-    INIT_ER_EVENT(ER_EVENT_TYPE__SENSOR_DATA, &g_sensor_data_publisher_module),
-};
+/// Samples can be generated faster than subscribers consume them; the pool lets
+/// several samples be in flight at once instead of dropping new ones.
+ER_DEFINE_EVENT_POOL(s_event_pool, SensorDataEvent_t, 8);
 
 void SensorDataPublisher_GenerateData()
 {
-    if (!ErEventIsInFlight(&s_event.m_event))
+    ErEvent_t *event = ErEventPoolAlloc(&s_event_pool);
+    if (event == NULL)
     {
-        s_event.m_temperature_c = rand() % 100;
-        s_event.m_lux           = rand() % 50;
-
-        printf("\nPublishing sensor data\n");
-        ErSend(TO_ER_EVENT(s_event));
+        printf("\nAll sensor data events are in flight; dropping sample\n");
+        return;
     }
+
+    SensorDataEvent_t *data =
+        er_container_of(event, SensorDataEvent_t, ER_EVENT_MEMBER);
+    data->m_temperature_c = rand() % 100;
+    data->m_lux           = rand() % 50;
+
+    printf("\nPublishing sensor data\n");
+    ErSend(event);
 }
 
 void SensorDataPublisher_Init(void)
 {
     srand(time(NULL));
+    ErEventPoolInit(&s_event_pool, ER_EVENT_TYPE__SENSOR_DATA,
+                    &g_sensor_data_publisher_module);
 }
 
 ErEventHandlerRet_t SensorDataPublisher_EventHandler(ErEvent_t *a_event,
@@ -39,8 +39,12 @@ static ErModule_t* s_app_modules[]    = {&g_data_logger_module,
 static ErTask_t s_er_tasks[TASK__COUNT] = {
     [TASK__SENSOR] = {.m_modules     = s_sensor_modules,
                       .m_num_modules = ARRAY_SIZE(s_sensor_modules)},
-    [TASK__APP]    = {.m_modules     = s_app_modules,
-                      .m_num_modules = ARRAY_SIZE(s_app_modules)},
+    // The logger and uploader only care about the latest sensor data; when
+    // they fall behind, newer data replaces what is still queued instead of
+    // holding up the sensor task.
+    [TASK__APP]    = {.m_modules         = s_app_modules,
+                      .m_num_modules     = ARRAY_SIZE(s_app_modules),
+                      .m_overflow_policy = ER_OVERFLOW_POLICY__CONFLATE},
 };
 
 static bool IsInIsr(void)
@@ -48,10 +52,16 @@ static bool IsInIsr(void)
     return false;
 }
 
+/// Sensor data is a reading of current state, so a newer reading replaces an
+/// undelivered one even when the queue has room.
+static const ErEventType_t s_conflated_types[] = {ER_EVENT_TYPE__SENSOR_DATA};
+
 static const ErOptions_t s_er_options = {
-    .m_tasks     = s_er_tasks,
-    .m_num_tasks = TASK__COUNT,
-    .m_IsInIsr   = IsInIsr,
+    .m_tasks               = s_er_tasks,
+    .m_num_tasks           = TASK__COUNT,
+    .m_IsInIsr             = IsInIsr,
+    .m_conflated_types     = s_conflated_types,
+    .m_num_conflated_types = ARRAY_SIZE(s_conflated_types),
 };
 
 static void* GenericTask_Posix(void* a_parameter)
@@ -108,6 +118,12 @@ int main(void)
     DataUploader_Init();
     SensorDataPublisher_Init();
 
+    // Run `posix_stats_cli` in another terminal to watch the router.
+    if (!ErStatsShmStart("/eventrouter_stats", 1000))
+    {
+        perror("stats: ");
+    }
+
     //==========================================================================
     // Start polling timer.
     //==========================================================================
@@ -0,0 +1,72 @@
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "eventrouter/internal/stats_shm.h"
+
+/// Prints the statistics published by `ErStatsShmStart()` in another process.
+/// This only includes the layout header; it does not link against the router.
+///
+/// Usage: posix_stats_cli [name] [period_ms]
+int main(int argc, char** argv)
+{
+    const char* name     = (argc > 1) ? argv[1] : "/eventrouter_stats";
+    const long period_ms = (argc > 2) ? strtol(argv[2], NULL, 10) : 1000;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        perror("shm_open");
+        return 1;
+    }
+    void* mapping =
+        mmap(NULL, sizeof(ErStatsShm_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    const ErStatsShm_t* shm = (const ErStatsShm_t*)mapping;
+
+    while (true)
+    {
+        ErStatsShm_t snapshot;
+        if (!ErStatsShmRead(shm, &snapshot))
+        {
+            fprintf(stderr, "%s is not a compatible statistics object\n", name);
+            return 1;
+        }
+
+        printf("t=%" PRId64 "us\n", snapshot.m_timestamp_us);
+        for (uint32_t i = 0; i < snapshot.m_num_tasks; ++i)
+        {
+            const ErStatsShmTask_t* task = &snapshot.m_tasks[i];
+            printf("  task %" PRIu32 ": util=%u%% sat=%u%% depth=%" PRIu64
+                   " receives=%" PRIu32 " drops=%" PRIu64 "\n",
+                   i, task->m_stats.m_utilization_permille / 10u,
+                   task->m_stats.m_saturation_permille / 10u,
+                   task->m_queue_depth, task->m_stats.m_receives,
+                   task->m_drops);
+        }
+        for (uint32_t i = 0; i < snapshot.m_num_types; ++i)
+        {
+            const ErStatsShmType_t* type = &snapshot.m_types[i];
+            if (type->m_stats.m_sends == 0)
+            {
+                continue;
+            }
+            printf("  type %" PRId32 ": sends=%" PRIu64 " returns=%" PRIu64
+                   " rate=%" PRIu64 "/s\n",
+                   snapshot.m_first_type + (int32_t)i, type->m_stats.m_sends,
+                   type->m_stats.m_returns, type->m_sends_per_second);
+        }
+
+        usleep((useconds_t)(period_ms * 1000));
+    }
+
+    return 0;
+}
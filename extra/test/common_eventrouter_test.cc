@@ -91,11 +91,94 @@ void ResetEvent(ErEvent_t &a_event)
     CopyEvent(a_event, kValidEvent);
 }
 
+struct PooledEvent
+{
+    MIXIN_ER_EVENT;
+    int m_value;
+};
+
+ER_DEFINE_EVENT_POOL(s_pool, PooledEvent, 2);
+
+ErEvent_t *s_last_released = nullptr;
+int s_release_count        = 0;
+
+void RecordRelease(ErEvent_t *a_event)
+{
+    s_last_released = a_event;
+    s_release_count += 1;
+}
+
+/// Plain old data; its payload is its bytes after the `ErEvent_t`.
+struct PodEvent
+{
+    MIXIN_ER_EVENT;
+    int32_t m_value;
+    uint16_t m_flags;
+};
+
+/// Carries a string in a fixed buffer, but only its characters are encoded.
+struct NamedEvent
+{
+    MIXIN_ER_EVENT;
+    char m_name[32];
+};
+
+size_t EncodeName(const ErEvent_t *a_event, uint8_t *a_buffer, size_t a_size)
+{
+    const NamedEvent &named =
+        FROM_ER_EVENT(const_cast<ErEvent_t *>(a_event), NamedEvent);
+    const size_t length = strlen(named.m_name);
+    if (length <= a_size)
+    {
+        memcpy(a_buffer, named.m_name, length);
+    }
+    return length;
+}
+
+bool DecodeName(ErEvent_t *a_event, const uint8_t *a_bytes, size_t a_size)
+{
+    NamedEvent &named = FROM_ER_EVENT(a_event, NamedEvent);
+    if (a_size >= sizeof(named.m_name))
+    {
+        return false;
+    }
+    memcpy(named.m_name, a_bytes, a_size);
+    named.m_name[a_size] = '\0';
+    return true;
+}
+
 }  // namespace
 
 namespace testing
 {
 
+//==============================================================================
+// Tests for `ErEvent_t`
+//==============================================================================
+
+#if ER_EVENT_CACHE_LINE_SIZE > 0
+TEST(ErEvent, ReferenceCountHasItsOwnCacheLine)
+{
+    constexpr size_t kLine       = ER_EVENT_CACHE_LINE_SIZE;
+    constexpr size_t kCountStart = offsetof(ErEvent_t, m_reference_count);
+
+    EXPECT_EQ(kCountStart, kLine);
+
+    // Payload declared after `MIXIN_ER_EVENT` starts on a new line too.
+    EXPECT_EQ(sizeof(ErEvent_t) % kLine, 0);
+    EXPECT_EQ(offsetof(PooledEvent, m_value) % kLine, 0);
+}
+#else
+TEST(ErEvent, ReferenceCountIsPackedWithTheOtherFields)
+{
+    // Without a cache line size the event adds no padding of its own.
+    EXPECT_EQ(alignof(ErEvent_t), alignof(void *));
+    EXPECT_EQ(offsetof(ErEvent_t, m_reference_count), sizeof(ErEventType_t));
+    EXPECT_EQ(offsetof(ErEvent_t, m_sending_module), alignof(void *));
+    EXPECT_EQ(offsetof(PooledEvent, m_value), sizeof(ErEvent_t));
+}
+#endif
+
 //==============================================================================
 // Tests for `ErInit()/ErDeinit()`
 // ==============================================================================
@@ -417,4 +500,246 @@ TEST_F(EventRouterTest, CrossSendAndSubscribe)
     EXPECT_EQ(MockModule<kModuleB>::m_last_event_handled, &eventb);  // Return.
 }
 
+//==============================================================================
+// Tests for `ErEventPool_t`
+//==============================================================================
+
+TEST_F(EventRouterTest, EventPoolRecyclesReturnedEvents)
+{
+    constexpr int kSendingModule     = MockOptions::Module::A;
+    constexpr int kSubscribingModule = MockOptions::Module::B;
+
+    ErEventPoolInit(&s_pool, ER_EVENT_TYPE__1,
+                    &MockModule<kSendingModule>::m_module);
+    ErSubscribe(&MockModule<kSubscribingModule>::m_module, ER_EVENT_TYPE__1);
+
+    // Both events can be in flight at once; the pool runs dry after that.
+    ErEvent_t *first  = ErEventPoolAlloc(&s_pool);
+    ErEvent_t *second = ErEventPoolAlloc(&s_pool);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(ErEventPoolAlloc(&s_pool), nullptr);
+
+    ErSend(first);
+    ErSend(second);
+
+    // Each event goes back in the pool once its sender has seen it return.
+    PrepareToDeliverEvents();
+    EXPECT_TRUE(MaybeDeliverEvent());
+    EXPECT_EQ(MockModule<kSendingModule>::m_last_event_handled, first);
+    EXPECT_EQ(ErEventPoolAlloc(&s_pool), first);
+
+    EXPECT_TRUE(MaybeDeliverEvent());
+    EXPECT_EQ(MockModule<kSendingModule>::m_last_event_handled, second);
+    EXPECT_EQ(ErEventPoolAlloc(&s_pool), second);
+
+    ErEventPoolFree(&s_pool, first);
+    ErEventPoolFree(&s_pool, second);
+}
+
+TEST_F(EventRouterTest, EventPoolDiesOnForeignEvents)
+{
+    ErEventPoolInit(&s_pool, ER_EVENT_TYPE__1,
+                    &MockModule<MockOptions::Module::A>::m_module);
+
+    ErEvent_t event;
+    ResetEvent(event);
+    EXPECT_DEATH(ErEventPoolFree(&s_pool, &event), ".*");
+}
+
+//==============================================================================
+// Tests for `ErSendExOptions_t::m_fire_and_forget`
+//==============================================================================
+
+TEST_F(EventRouterTest, FireAndForgetReleasesInsteadOfReturning)
+{
+    constexpr int kSendingModule     = MockOptions::Module::A;
+    constexpr int kSubscribingModule = MockOptions::Module::B;
+
+    ErEventPoolInit(&s_pool, ER_EVENT_TYPE__1,
+                    &MockModule<kSendingModule>::m_module);
+    ErSubscribe(&MockModule<kSubscribingModule>::m_module, ER_EVENT_TYPE__1);
+    s_last_released = nullptr;
+    s_release_count = 0;
+
+    ErEvent_t *event = ErEventPoolAlloc(&s_pool);
+    ASSERT_NE(event, nullptr);
+    ErSendEx(event, {.m_fire_and_forget = true, .m_release = RecordRelease});
+
+    PrepareToDeliverEvents();
+    EXPECT_TRUE(MaybeDeliverEvent());
+
+    // The subscriber gets the event, but the sender never sees it again.
+    EXPECT_EQ(MockModule<kSubscribingModule>::m_last_event_handled, event);
+    EXPECT_EQ(MockModule<kSendingModule>::m_last_event_handled, nullptr);
+    EXPECT_EQ(s_last_released, event);
+    EXPECT_EQ(s_release_count, 1);
+    EXPECT_FALSE(ErEventIsInFlight(event));
+
+    // Released events go back to their pool.
+    EXPECT_EQ(ErEventPoolAlloc(&s_pool), event);
+    ErEventPoolFree(&s_pool, event);
+}
+
+TEST_F(EventRouterTest, FireAndForgetWaitsForKeptEvents)
+{
+    constexpr int kSendingModule     = MockOptions::Module::A;
+    constexpr int kSubscribingModule = MockOptions::Module::B;
+
+    ErEvent_t event;
+    ResetEvent(event);
+    ErSubscribe(&MockModule<kSubscribingModule>::m_module, event.m_type);
+    MockModule<kSubscribingModule>::m_event_handler_ret =
+        ER_EVENT_HANDLER_RET__KEPT;
+    s_release_count = 0;
+
+    ErSendEx(&event, {.m_fire_and_forget = true, .m_release = RecordRelease});
+
+    PrepareToDeliverEvents();
+    EXPECT_TRUE(MaybeDeliverEvent());
+    EXPECT_EQ(s_release_count, 0);
+    EXPECT_TRUE(ErEventIsInFlight(&event));
+
+    ErReturnToSender(&event);
+    EXPECT_EQ(s_release_count, 1);
+    EXPECT_FALSE(ErEventIsInFlight(&event));
+    EXPECT_EQ(MockModule<kSendingModule>::m_last_event_handled, nullptr);
+}
+
+//==============================================================================
+// Tests for `ErSerializerRegister()` and friends
+//==============================================================================
+
+class ErSerializerTest : public Test
+{
+   protected:
+    ErSerializerTest()
+    {
+        ErSerializerRegister(ER_EVENT_TYPE__1, &kPod);
+        ErSerializerRegister(ER_EVENT_TYPE__2, &kNamed);
+    }
+    ~ErSerializerTest()
+    {
+        ErSerializerRegister(ER_EVENT_TYPE__1, nullptr);
+        ErSerializerRegister(ER_EVENT_TYPE__2, nullptr);
+    }
+
+    static constexpr ErSerializer_t kPod = ER_POD_SERIALIZER(PodEvent);
+    static constexpr ErSerializer_t kNamed = {
+        .m_size   = sizeof(NamedEvent),
+        .m_encode = EncodeName,
+        .m_decode = DecodeName,
+    };
+};
+
+TEST_F(ErSerializerTest, PodEventsRoundTripWithoutCopying)
+{
+    constexpr size_t kPayload    = sizeof(PodEvent) - sizeof(ErEvent_t);
+    PodEvent event               = {.m_value = -42, .m_flags = 0xBEEF};
+    event.ER_EVENT_MEMBER.m_type = ER_EVENT_TYPE__1;
+
+    size_t size = 0;
+    EXPECT_EQ(ErPodPayload(TO_ER_EVENT(event), &size), &event.m_value);
+    EXPECT_EQ(size, kPayload);
+
+    // Small types and sizes take a byte each.
+    uint8_t buffer[2 + kPayload];
+    EXPECT_EQ(ErSerialize(TO_ER_EVENT(event), nullptr, 0), sizeof(buffer));
+    ASSERT_EQ(ErSerialize(TO_ER_EVENT(event), buffer, sizeof(buffer)),
+              sizeof(buffer));
+
+    ErRecord_t record;
+    ASSERT_EQ(ErParseRecord(buffer, sizeof(buffer), &record),
+              ER_PARSE_RESULT__OK);
+    EXPECT_EQ(record.m_type, ER_EVENT_TYPE__1);
+    EXPECT_EQ(record.m_payload, buffer + 2);
+    EXPECT_EQ(record.m_payload_size, kPayload);
+    EXPECT_EQ(record.m_size, sizeof(buffer));
+
+    PodEvent copy = {};
+    ASSERT_TRUE(ErDeserialize(&record, TO_ER_EVENT(copy)));
+    EXPECT_EQ(copy.m_value, event.m_value);
+    EXPECT_EQ(copy.m_flags, event.m_flags);
+}
+
+TEST_F(ErSerializerTest, EncodedEventsRoundTrip)
+{
+    NamedEvent event             = {.m_name = "sensor"};
+    event.ER_EVENT_MEMBER.m_type = ER_EVENT_TYPE__2;
+
+    size_t size = 0;
+    EXPECT_EQ(ErPodPayload(TO_ER_EVENT(event), &size), nullptr);
+
+    // A buffer that fits the record, but not with room for the longest
+    // header, still gets all of it.
+    uint8_t buffer[2 + 6];
+    ASSERT_EQ(ErSerialize(TO_ER_EVENT(event), buffer, sizeof(buffer)),
+              sizeof(buffer));
+
+    ErRecord_t record;
+    ASSERT_EQ(ErParseRecord(buffer, sizeof(buffer), &record),
+              ER_PARSE_RESULT__OK);
+    EXPECT_EQ(record.m_payload_size, 6u);
+
+    NamedEvent copy = {};
+    ASSERT_TRUE(ErDeserialize(&record, TO_ER_EVENT(copy)));
+    EXPECT_STREQ(copy.m_name, "sensor");
+}
+
+TEST_F(ErSerializerTest, RecordsFollowOneAnother)
+{
+    PodEvent pod                 = {.m_value = 7};
+    pod.ER_EVENT_MEMBER.m_type   = ER_EVENT_TYPE__1;
+    NamedEvent named             = {.m_name = "x"};
+    named.ER_EVENT_MEMBER.m_type = ER_EVENT_TYPE__2;
+
+    uint8_t buffer[256];
+    size_t size = ErSerialize(TO_ER_EVENT(pod), buffer, sizeof(buffer));
+    size += ErSerialize(TO_ER_EVENT(named), buffer + size,
+                        sizeof(buffer) - size);
+
+    ErRecord_t first;
+    ErRecord_t second;
+    ASSERT_EQ(ErParseRecord(buffer, size, &first), ER_PARSE_RESULT__OK);
+    ASSERT_EQ(ErParseRecord(buffer + first.m_size, size - first.m_size,
+                            &second),
+              ER_PARSE_RESULT__OK);
+    EXPECT_EQ(first.m_type, ER_EVENT_TYPE__1);
+    EXPECT_EQ(second.m_type, ER_EVENT_TYPE__2);
+    EXPECT_EQ(first.m_size + second.m_size, size);
+}
+
+TEST_F(ErSerializerTest, ParseRejectsShortAndInvalidRecords)
+{
+    NamedEvent event             = {.m_name = "sensor"};
+    event.ER_EVENT_MEMBER.m_type = ER_EVENT_TYPE__2;
+    uint8_t buffer[64];
+    const size_t size = ErSerialize(TO_ER_EVENT(event), buffer, sizeof(buffer));
+
+    ErRecord_t record;
+    for (size_t length = 0; length < size; ++length)
+    {
+        EXPECT_EQ(ErParseRecord(buffer, length, &record),
+                  ER_PARSE_RESULT__SHORT);
+    }
+
+    // Unregistered types, and varints longer than 64 bits.
+    const uint8_t unregistered[] = {(uint8_t)ER_EVENT_TYPE__3, 0};
+    EXPECT_EQ(ErParseRecord(unregistered, sizeof(unregistered), &record),
+              ER_PARSE_RESULT__INVALID);
+    uint8_t overlong[ER_RECORD_MAX_HEADER_SIZE];
+    memset(overlong, 0x80, sizeof(overlong));
+    EXPECT_EQ(ErParseRecord(overlong, sizeof(overlong), &record),
+              ER_PARSE_RESULT__INVALID);
+
+    // Payloads the type's serializer can't decode.
+    ErSerializerRegister(ER_EVENT_TYPE__3, &kPod);
+    ASSERT_EQ(ErParseRecord(unregistered, sizeof(unregistered), &record),
+              ER_PARSE_RESULT__OK);
+    PodEvent pod;
+    EXPECT_FALSE(ErDeserialize(&record, TO_ER_EVENT(pod)));
+    ErSerializerRegister(ER_EVENT_TYPE__3, nullptr);
+}
+
 }  // namespace testing
@@ -6,3 +6,6 @@ std::unordered_map<ErQueueHandle_t, std::queue<ErEvent_t *>>
     MockOs::m_sent_events{};
 constexpr ErOsFunctions_t MockOs::m_os_functions;
 int64_t MockOs::m_now_ms;
+int64_t MockOs::m_receive_block_ms;
+size_t MockOs::m_send_events_calls;
+size_t MockOs::m_queue_capacity;
@@ -11,6 +11,7 @@
 #include <queue>
 #include <unordered_map>
 
+#include <stdint.h>
 #include <string.h>
 
 #include "eventrouter.h"
@@ -23,6 +24,9 @@ struct MockOs
     static void Init(const ErOptions_t *a_options)
     {
         m_now_ms               = 0;
+        m_receive_block_ms     = 0;
+        m_send_events_calls    = 0;
+        m_queue_capacity       = SIZE_MAX;
         m_event_router_options = *a_options;
         m_running_task         = 0;
         m_sent_events.clear();
@@ -71,11 +75,21 @@ struct MockOs
 
     static int64_t GetTimeMs(void) { return m_now_ms; }
 
+    /// Makes every receive appear to block for `a_ms` before returning.
+    static void SetReceiveBlockTimeMs(int64_t a_ms)
+    {
+        m_receive_block_ms = a_ms;
+    }
+
     static ErOptions_t m_event_router_options;
     static ErTaskHandle_t m_running_task;
     static std::unordered_map<ErQueueHandle_t, std::queue<ErEvent_t *>>
         m_sent_events;
     static int64_t m_now_ms;
+    static int64_t m_receive_block_ms;
+    static size_t m_send_events_calls;
+    /// Applies to `TimedSendEvent()` only; other sends never fail.
+    static size_t m_queue_capacity;
 
     //==========================================================================
     // These functions populate a `ErOsFunctions_t` struct and either capture
@@ -87,6 +101,58 @@ struct MockOs
         m_sent_events[a_queue].push((ErEvent_t *)a_event);
     }
 
+    static void SendEvents(ErQueueHandle_t a_queue, ErEvent_t *const *a_events,
+                           size_t a_count)
+    {
+        m_send_events_calls += 1;
+        for (size_t idx = 0; idx < a_count; ++idx)
+        {
+            m_sent_events[a_queue].push(a_events[idx]);
+        }
+    }
+
+    static bool TimedSendEvent(ErQueueHandle_t a_queue, ErEvent_t *a_event,
+                               int64_t a_ms)
+    {
+        // Full queues fail immediately; nothing drains them while we wait.
+        ER_UNUSED(a_ms);
+        if (m_sent_events[a_queue].size() >= m_queue_capacity)
+        {
+            return false;
+        }
+        m_sent_events[a_queue].push(a_event);
+        return true;
+    }
+
+    static ErEvent_t *DisplaceEvent(ErQueueHandle_t a_queue, ErEvent_t *a_event,
+                                    ErQueueMatch_t a_match, bool a_in_place)
+    {
+        // Rebuild the queue with the first matching event replaced.
+        auto &queue          = m_sent_events[a_queue];
+        ErEvent_t *displaced = nullptr;
+        std::queue<ErEvent_t *> rebuilt;
+        for (; !queue.empty(); queue.pop())
+        {
+            ErEvent_t *queued = queue.front();
+            if ((displaced == nullptr) && a_match(queued, a_event))
+            {
+                displaced = queued;
+                if (!a_in_place)
+                {
+                    continue;
+                }
+                queued = a_event;
+            }
+            rebuilt.push(queued);
+        }
+        if ((displaced != nullptr) && !a_in_place)
+        {
+            rebuilt.push(a_event);
+        }
+        queue = std::move(rebuilt);
+        return displaced;
+    }
+
     static ErTaskHandle_t GetCurrentTaskHandle() { return m_running_task; }
 
     static void ReceiveEvent(ErQueueHandle_t a_queue, ErEvent_t **a_event)
@@ -98,21 +164,41 @@ struct MockOs
         ErEvent_t *event = queue.front();
         queue.pop();
         *a_event = event;
+        AdvanceTimeMs(m_receive_block_ms);
     }
 
     static void TimedReceiveEvent(ErQueueHandle_t a_queue, ErEvent_t **a_event,
                                   int64_t a_ms)
     {
-        // We don't have good way to test blocking calls presently.
+        // We don't have good way to test blocking calls presently; an empty
+        // queue times out immediately.
         ER_UNUSED(a_ms);
+        if (m_sent_events[a_queue].empty())
+        {
+            *a_event = nullptr;
+            return;
+        }
         ReceiveEvent(a_queue, a_event);
     }
 
+    static int64_t GetTimeUs() { return m_now_ms * 1000; }
+
+    static size_t GetQueueDepth(ErQueueHandle_t a_queue)
+    {
+        auto entry = m_sent_events.find(a_queue);
+        return (entry == m_sent_events.end()) ? 0 : entry->second.size();
+    }
+
     static constexpr ErOsFunctions_t m_os_functions = {
         .SendEvent            = SendEvent,
+        .SendEvents           = SendEvents,
+        .TimedSendEvent       = TimedSendEvent,
+        .DisplaceEvent        = DisplaceEvent,
         .ReceiveEvent         = ReceiveEvent,
         .TimedReceiveEvent    = TimedReceiveEvent,
         .GetCurrentTaskHandle = GetCurrentTaskHandle,
+        .GetTimeUs            = GetTimeUs,
+        .GetQueueDepth        = GetQueueDepth,
     };
 };
 
@@ -1 +1,1082 @@
-// TODO: Add OS-implementation-specific tests here.
+#include "eventrouter.h"
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+#include "mock_module.h"
+#include "mock_os.h"
+
+namespace
+{
+
+/// Builds an instance of `ErOptions_t` with two tasks. The tests in this file
+/// only apply to OS-backed implementations, so unlike the common tests they can
+/// exercise routing between tasks.
+struct MockOptions
+{
+   public:
+    struct Module
+    {
+        static constexpr int A = 0;
+        static constexpr int B = 1;
+        static constexpr int C = 2;
+    };
+
+    /// Task indices; tasks are listed from highest priority to lowest.
+    struct Task
+    {
+        static constexpr size_t First  = 0;  // Owns modules A and B.
+        static constexpr size_t Second = 1;  // Owns module C.
+    };
+
+    MockOptions()
+    {
+        MockModule<Module::A>::Reset();
+        MockModule<Module::B>::Reset();
+        MockModule<Module::C>::Reset();
+    }
+
+    static bool IsInIsr(void) { return false; }
+
+    ErModule_t *m_first_modules[2] = {
+        &MockModule<Module::A>::m_module,
+        &MockModule<Module::B>::m_module,
+    };
+    ErModule_t *m_second_modules[1] = {
+        &MockModule<Module::C>::m_module,
+    };
+
+    ErTask_t m_tasks[2] = {
+        {
+            .m_task_handle = (ErTaskHandle_t)1,
+            .m_event_queue = (ErQueueHandle_t)1,
+            .m_modules     = m_first_modules,
+            .m_num_modules = 2,
+        },
+        {
+            .m_task_handle = (ErTaskHandle_t)2,
+            .m_event_queue = (ErQueueHandle_t)2,
+            .m_modules     = m_second_modules,
+            .m_num_modules = 1,
+        },
+    };
+
+    ErOptions_t m_options{
+        .m_tasks     = m_tasks,
+        .m_num_tasks = 2,
+        .m_IsInIsr   = IsInIsr,
+    };
+};
+
+int s_release_count = 0;
+
+void CountRelease(ErEvent_t *a_event)
+{
+    ER_UNUSED(a_event);
+    s_release_count += 1;
+}
+
+}  // namespace
+
+namespace testing
+{
+
+class ErOsTest : public Test
+{
+   protected:
+    ErOsTest()
+    {
+        ErInit(&m_options.m_options);
+        ErSetOsFunctions(&MockOs::m_os_functions);
+        MockOs::Init(&m_options.m_options);
+        SwitchToTask(MockOptions::Task::First);
+    }
+    ~ErOsTest()
+    {
+        // Tests must deliver every event they cause to be sent.
+        assert(!MockOs::AnyUnhandledEvents());
+        ErDeinit();
+    }
+
+    void SwitchToTask(size_t a_task_idx)
+    {
+        MockOs::SwitchTask(m_options.m_tasks[a_task_idx].m_task_handle);
+    }
+
+    /// Switches to `a_task_idx`, receives one event, and handles it.
+    ErEvent_t *DeliverOne(size_t a_task_idx)
+    {
+        SwitchToTask(a_task_idx);
+        ErEvent_t *event = ErReceive();
+        ErCallHandlers(event);
+        return event;
+    }
+
+    MockOptions m_options;
+};
+
+//==============================================================================
+// Tests for `ErGetTaskStats()`
+//==============================================================================
+
+TEST_F(ErOsTest, TaskStatsReportRollingUtilization)
+{
+    constexpr int kSendingModule     = MockOptions::Module::A;
+    constexpr int kSubscribingModule = MockOptions::Module::C;
+
+    ErEvent_t event = {
+        .m_type           = ER_EVENT_TYPE__1,
+        .m_sending_module = &MockModule<kSendingModule>::m_module,
+    };
+    ErSubscribe(&MockModule<kSubscribingModule>::m_module, event.m_type);
+    MockModule<kSubscribingModule>::m_event_handler_ret =
+        ER_EVENT_HANDLER_RET__HANDLED;
+
+    // Every iteration, the subscribing task waits 1ms for the event and then
+    // spends 3ms handling it; that is 75% utilization.
+    const int kIterations = (3 * ER_TASK_STATS_WINDOW_MS) / 4;
+    for (int i = 0; i < kIterations; ++i)
+    {
+        SwitchToTask(MockOptions::Task::First);
+        ErSend(&event);
+
+        SwitchToTask(MockOptions::Task::Second);
+        MockOs::SetReceiveBlockTimeMs(1);
+        ErEvent_t *received = ErReceive();
+        MockOs::SetReceiveBlockTimeMs(0);
+        MockOs::AdvanceTimeMs(3);
+        ErCallHandlers(received);
+
+        DeliverOne(MockOptions::Task::First);  // Return to sender.
+    }
+
+    ErTaskStats_t stats;
+    ErGetTaskStats(MockOptions::Task::Second, &stats);
+    EXPECT_EQ(stats.m_receives, kIterations);
+    EXPECT_EQ(stats.m_blocked_us, kIterations * 1000);
+    EXPECT_EQ(stats.m_busy_us, (kIterations - 1) * 3000);
+    EXPECT_EQ(stats.m_utilization_permille, 750);
+
+    // The mock queues events before the task asks for them, so every receive
+    // but the first looks saturated.
+    EXPECT_EQ(stats.m_saturated_receives, kIterations - 1);
+    EXPECT_EQ(stats.m_saturation_permille, 1000);
+}
+
+TEST_F(ErOsTest, TaskStatsCountSaturatedReceives)
+{
+    constexpr int kSendingModule     = MockOptions::Module::A;
+    constexpr int kSubscribingModule = MockOptions::Module::C;
+
+    ErSubscribe(&MockModule<kSubscribingModule>::m_module, ER_EVENT_TYPE__1);
+
+    ErEvent_t events[3];
+    for (auto &event : events)
+    {
+        ErEventInit(&event, ER_EVENT_TYPE__1,
+                    &MockModule<kSendingModule>::m_module);
+        ErSend(&event);
+    }
+
+    // The first receive has nothing to compare against; the second and third
+    // both find more events waiting when they return for the next one.
+    for (size_t i = 0; i < 3; ++i)
+    {
+        DeliverOne(MockOptions::Task::Second);
+    }
+
+    ErTaskStats_t stats;
+    ErGetTaskStats(MockOptions::Task::Second, &stats);
+    EXPECT_EQ(stats.m_receives, 3);
+    EXPECT_EQ(stats.m_saturated_receives, 2);
+    EXPECT_EQ(stats.m_queue_depth, 1);
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        DeliverOne(MockOptions::Task::First);  // Return to sender.
+    }
+}
+
+//==============================================================================
+// Tests for `ErGetEventTypeStats()`
+//==============================================================================
+
+TEST_F(ErOsTest, EventTypeStatsCountSendsAndLatency)
+{
+    constexpr int kSendingModule     = MockOptions::Module::A;
+    constexpr int kSubscribingModule = MockOptions::Module::C;
+
+    ErEvent_t event = {
+        .m_type           = ER_EVENT_TYPE__2,
+        .m_sending_module = &MockModule<kSendingModule>::m_module,
+    };
+    ErSubscribe(&MockModule<kSubscribingModule>::m_module, event.m_type);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        SwitchToTask(MockOptions::Task::First);
+        ErSend(&event);
+        MockOs::AdvanceTimeMs(5);
+        DeliverOne(MockOptions::Task::Second);
+        DeliverOne(MockOptions::Task::First);  // Return to sender.
+    }
+
+    ErEventTypeStats_t stats;
+    ErGetEventTypeStats(ER_EVENT_TYPE__2, &stats);
+    EXPECT_EQ(stats.m_sends, 2);
+    EXPECT_EQ(stats.m_returns, 2);
+
+    // 5000us needs 13 bits, so it lands in [2^12, 2^13).
+    for (size_t idx = 0; idx < ER_LATENCY_BUCKET_COUNT; ++idx)
+    {
+        EXPECT_EQ(stats.m_latency_buckets[idx], (idx == 13) ? 2 : 0) << idx;
+    }
+
+    ErGetEventTypeStats(ER_EVENT_TYPE__1, &stats);
+    EXPECT_EQ(stats.m_sends, 0);
+}
+
+//==============================================================================
+// Tests for `ErSendExOptions_t::m_fire_and_forget`
+//==============================================================================
+
+TEST_F(ErOsTest, FireAndForgetSkipsTheReturnTrip)
+{
+    constexpr int kSendingModule     = MockOptions::Module::A;
+    constexpr int kSubscribingModule = MockOptions::Module::C;
+
+    ErEvent_t event;
+    ErEventInit(&event, ER_EVENT_TYPE__1,
+                &MockModule<kSendingModule>::m_module);
+    ErSubscribe(&MockModule<kSubscribingModule>::m_module, event.m_type);
+    s_release_count = 0;
+
+    ErSendEx(&event, {.m_fire_and_forget = true, .m_release = CountRelease});
+    DeliverOne(MockOptions::Task::Second);
+
+    // The subscriber's task released the event; nothing went back to the
+    // sending task's queue.
+    EXPECT_EQ(MockModule<kSubscribingModule>::m_last_event_handled, &event);
+    EXPECT_EQ(s_release_count, 1);
+    EXPECT_FALSE(ErEventIsInFlight(&event));
+    EXPECT_FALSE(MockOs::AnyUnhandledEvents());
+
+    // The same event can go out again with a return trip.
+    ErSend(&event);
+    DeliverOne(MockOptions::Task::Second);
+    DeliverOne(MockOptions::Task::First);
+    EXPECT_EQ(MockModule<kSendingModule>::m_last_event_handled, &event);
+    EXPECT_EQ(s_release_count, 1);
+}
+
+TEST_F(ErOsTest, FireAndForgetWithoutSubscribersReleasesImmediately)
+{
+    ErEvent_t event;
+    ErEventInit(&event, ER_EVENT_TYPE__1,
+                &MockModule<MockOptions::Module::A>::m_module);
+    s_release_count = 0;
+
+    ErSendEx(&event, {.m_fire_and_forget = true, .m_release = CountRelease});
+    EXPECT_EQ(s_release_count, 1);
+    EXPECT_FALSE(ErEventIsInFlight(&event));
+}
+
+TEST_F(ErOsTest, FireAndForgetEventsCannotBeResent)
+{
+    ErEvent_t event;
+    ErEventInit(&event, ER_EVENT_TYPE__1,
+                &MockModule<MockOptions::Module::A>::m_module);
+    EXPECT_DEATH(ErSendEx(&event, {.m_allow_resending = true,
+                                   .m_fire_and_forget = true}),
+                 ".*");
+
+    ErSubscribe(&MockModule<MockOptions::Module::C>::m_module, event.m_type);
+    ErSendEx(&event, {.m_fire_and_forget = true});
+    EXPECT_DEATH(ErSendEx(&event, {.m_allow_resending = true}), ".*");
+    DeliverOne(MockOptions::Task::Second);
+}
+
+//==============================================================================
+// Tests for `ErTrySend()` and `ErTimedSend()`
+//==============================================================================
+
+TEST_F(ErOsTest, TrySendReportsFullQueuesAndStillReturnsOnce)
+{
+    constexpr int kSendingModule = MockOptions::Module::A;
+
+    ErEvent_t event;
+    ErEventInit(&event, ER_EVENT_TYPE__1,
+                &MockModule<kSendingModule>::m_module);
+    ErSubscribe(&MockModule<MockOptions::Module::B>::m_module, event.m_type);
+    ErSubscribe(&MockModule<MockOptions::Module::C>::m_module, event.m_type);
+    MockModule<MockOptions::Module::B>::m_event_handler_ret =
+        ER_EVENT_HANDLER_RET__HANDLED;
+
+    // Fill the second task's queue.
+    ErEvent_t filler;
+    ErEventInit(&filler, ER_EVENT_TYPE__2,
+                &MockModule<kSendingModule>::m_module);
+    const ErTask_t &second_task = m_options.m_tasks[MockOptions::Task::Second];
+    MockOs::SendEvent(second_task.m_event_queue, &filler);
+    MockOs::m_queue_capacity = 1;
+
+    EXPECT_EQ(ErTrySend(&event), 1u << MockOptions::Task::Second);
+    EXPECT_TRUE(ErEventIsInFlight(&event));
+
+    // The first task still gets the event and returns it to the sender.
+    DeliverOne(MockOptions::Task::First);
+    EXPECT_EQ(MockModule<MockOptions::Module::B>::m_last_event_handled, &event);
+    EXPECT_EQ(MockModule<kSendingModule>::m_last_event_handled, &event);
+    EXPECT_FALSE(ErEventIsInFlight(&event));
+
+    SwitchToTask(MockOptions::Task::Second);
+    EXPECT_EQ(ErReceive(), &filler);
+    EXPECT_EQ(MockModule<MockOptions::Module::C>::m_last_event_handled,
+              nullptr);
+}
+
+TEST_F(ErOsTest, TrySendLeavesEventIdleIfNoTaskHasRoom)
+{
+    constexpr int kSendingModule = MockOptions::Module::A;
+
+    ErEvent_t event;
+    ErEventInit(&event, ER_EVENT_TYPE__2,
+                &MockModule<kSendingModule>::m_module);
+    MockOs::m_queue_capacity = 0;
+
+    // Without subscribers only the sending task's queue can refuse the event.
+    EXPECT_EQ(ErTrySend(&event), 1u << MockOptions::Task::First);
+    EXPECT_FALSE(ErEventIsInFlight(&event));
+
+    ErSubscribe(&MockModule<MockOptions::Module::B>::m_module, event.m_type);
+    ErSubscribe(&MockModule<MockOptions::Module::C>::m_module, event.m_type);
+    EXPECT_EQ(ErTimedSend(&event, 10), (1u << MockOptions::Task::First) |
+                                           (1u << MockOptions::Task::Second));
+    EXPECT_FALSE(ErEventIsInFlight(&event));
+    EXPECT_FALSE(MockOs::AnyUnhandledEvents());
+
+    ErEventTypeStats_t stats;
+    ErGetEventTypeStats(event.m_type, &stats);
+    EXPECT_EQ(stats.m_sends, 0);
+
+    // Once there is room the same event can be sent again.
+    MockOs::m_queue_capacity = SIZE_MAX;
+    EXPECT_EQ(ErTrySend(&event), 0u);
+    DeliverOne(MockOptions::Task::Second);
+    DeliverOne(MockOptions::Task::First);
+    EXPECT_FALSE(ErEventIsInFlight(&event));
+}
+
+TEST_F(ErOsTest, TrySendRejectsEventsInFlight)
+{
+    ErEvent_t event;
+    ErEventInit(&event, ER_EVENT_TYPE__1,
+                &MockModule<MockOptions::Module::A>::m_module);
+    ErSend(&event);
+    EXPECT_DEATH(ErTrySend(&event), ".*");
+    DeliverOne(MockOptions::Task::First);
+}
+
+//==============================================================================
+// Tests for `ErTask_t::m_batch_returns`
+//==============================================================================
+
+/// Re-initializes the router so the second task batches its returns.
+class ErOsBatchedReturnsTest : public ErOsTest
+{
+   protected:
+    ErOsBatchedReturnsTest()
+    {
+        ErDeinit();
+        m_options.m_tasks[MockOptions::Task::Second].m_batch_returns = true;
+        ErInit(&m_options.m_options);
+        ErSetOsFunctions(&MockOs::m_os_functions);
+        MockOs::Init(&m_options.m_options);
+    }
+
+    /// Sends `a_count` events from module A to module C.
+    void SendEvents(ErEvent_t *a_events, size_t a_count)
+    {
+        ErSubscribe(&MockModule<MockOptions::Module::C>::m_module,
+                    ER_EVENT_TYPE__1);
+        SwitchToTask(MockOptions::Task::First);
+        for (size_t idx = 0; idx < a_count; ++idx)
+        {
+            ErEventInit(&a_events[idx], ER_EVENT_TYPE__1,
+                        &MockModule<MockOptions::Module::A>::m_module);
+            ErSend(&a_events[idx]);
+        }
+    }
+};
+
+TEST_F(ErOsBatchedReturnsTest, HoldsReturnsUntilFlushed)
+{
+    constexpr int kSendingModule = MockOptions::Module::A;
+    const ErQueueHandle_t sending_queue =
+        m_options.m_tasks[MockOptions::Task::First].m_event_queue;
+
+    constexpr size_t kCount = ER_RETURN_BATCH_SIZE - 1;
+    ErEvent_t events[kCount];
+    SendEvents(events, kCount);
+
+    for (size_t idx = 0; idx < kCount; ++idx)
+    {
+        DeliverOne(MockOptions::Task::Second);
+    }
+    EXPECT_EQ(MockOs::GetQueueDepth(sending_queue), 0);
+
+    ErFlushReturns();
+    EXPECT_EQ(MockOs::m_send_events_calls, 1);
+    EXPECT_EQ(MockOs::GetQueueDepth(sending_queue), kCount);
+
+    // The sender sees each event exactly once, in the order they returned.
+    for (auto &event : events)
+    {
+        DeliverOne(MockOptions::Task::First);
+        EXPECT_EQ(MockModule<kSendingModule>::m_last_event_handled, &event);
+        EXPECT_FALSE(ErEventIsInFlight(&event));
+    }
+}
+
+TEST_F(ErOsBatchedReturnsTest, FlushesWhenFull)
+{
+    constexpr size_t kCount = ER_RETURN_BATCH_SIZE;
+    ErEvent_t events[kCount];
+    SendEvents(events, kCount);
+
+    for (size_t idx = 0; idx < kCount; ++idx)
+    {
+        DeliverOne(MockOptions::Task::Second);
+    }
+    EXPECT_EQ(MockOs::m_send_events_calls, 1);
+
+    for (size_t idx = 0; idx < kCount; ++idx)
+    {
+        DeliverOne(MockOptions::Task::First);
+    }
+}
+
+TEST_F(ErOsBatchedReturnsTest, FlushesBeforeBlocking)
+{
+    ErEvent_t events[2];
+    SendEvents(events, 2);
+
+    // Returns stay held while the task has more events to handle...
+    DeliverOne(MockOptions::Task::Second);
+    DeliverOne(MockOptions::Task::Second);
+    EXPECT_EQ(MockOs::m_send_events_calls, 0);
+
+    // ...and go out once it would wait for more.
+    EXPECT_EQ(ErTimedReceive(0), nullptr);
+    EXPECT_EQ(MockOs::m_send_events_calls, 1);
+
+    DeliverOne(MockOptions::Task::First);
+    DeliverOne(MockOptions::Task::First);
+}
+
+TEST_F(ErOsBatchedReturnsTest, FlushesUnderSustainedLoad)
+{
+    const ErQueueHandle_t sending_queue =
+        m_options.m_tasks[MockOptions::Task::First].m_event_queue;
+
+    ErEvent_t event;
+    SendEvents(&event, 1);
+
+    // Events without a return trip keep the second task busy without adding
+    // to its batch, so only `event` is held.
+    ErEvent_t load[ER_RETURN_BATCH_SIZE + 1];
+    for (auto &load_event : load)
+    {
+        ErEventInit(&load_event, ER_EVENT_TYPE__1,
+                    &MockModule<MockOptions::Module::A>::m_module);
+        ErSendEx(&load_event, {.m_fire_and_forget = true});
+    }
+
+    for (size_t idx = 0; idx < ER_RETURN_BATCH_SIZE; ++idx)
+    {
+        DeliverOne(MockOptions::Task::Second);
+    }
+    EXPECT_EQ(MockOs::m_send_events_calls, 0);
+
+    // The queue never ran dry, but `event` has waited long enough.
+    DeliverOne(MockOptions::Task::Second);
+    EXPECT_EQ(MockOs::m_send_events_calls, 1);
+    EXPECT_EQ(MockOs::GetQueueDepth(sending_queue), 1);
+
+    DeliverOne(MockOptions::Task::Second);
+    DeliverOne(MockOptions::Task::First);
+    EXPECT_FALSE(ErEventIsInFlight(&event));
+}
+
+//==============================================================================
+// Tests for `ErTask_t::m_overflow_policy`
+//==============================================================================
+
+/// Re-initializes the router so the second task's queue holds `a_capacity`
+/// events and applies `a_policy` when full. Module A sends; module C, in the
+/// second task, subscribes.
+class ErOsOverflowTest : public ErOsTest
+{
+   protected:
+    void SetUp(ErOverflowPolicy_t a_policy, size_t a_capacity)
+    {
+        ErDeinit();
+        m_options.m_tasks[MockOptions::Task::Second].m_overflow_policy =
+            a_policy;
+        ErInit(&m_options.m_options);
+        ErSetOsFunctions(&MockOs::m_os_functions);
+        MockOs::Init(&m_options.m_options);
+        MockOs::m_queue_capacity = a_capacity;
+        ErSubscribe(&MockModule<MockOptions::Module::C>::m_module,
+                    ER_EVENT_TYPE__1);
+        ErSubscribe(&MockModule<MockOptions::Module::C>::m_module,
+                    ER_EVENT_TYPE__2);
+        SwitchToTask(MockOptions::Task::First);
+    }
+
+    /// Sends `a_event` from module A as a new event of `a_type`.
+    void Send(ErEvent_t *a_event, ErEventType_t a_type)
+    {
+        ErEventInit(a_event, a_type,
+                    &MockModule<MockOptions::Module::A>::m_module);
+        ErSend(a_event);
+    }
+
+    /// Delivers the next event in `a_task_idx` and returns the module A or C
+    /// handler's last event, whichever belongs to that task.
+    ErEvent_t *Handled(size_t a_task_idx)
+    {
+        DeliverOne(a_task_idx);
+        return (a_task_idx == MockOptions::Task::First)
+                   ? MockModule<MockOptions::Module::A>::m_last_event_handled
+                   : MockModule<MockOptions::Module::C>::m_last_event_handled;
+    }
+};
+
+TEST_F(ErOsOverflowTest, DropNewestReturnsTheDroppedEvent)
+{
+    SetUp(ER_OVERFLOW_POLICY__DROP_NEWEST, 1);
+    ErEvent_t events[2];
+    Send(&events[0], ER_EVENT_TYPE__1);
+    Send(&events[1], ER_EVENT_TYPE__1);
+    EXPECT_EQ(ErGetTaskDropCount(MockOptions::Task::Second), 1);
+    EXPECT_EQ(ErGetTaskDropCount(MockOptions::Task::First), 0);
+
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[1]);
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &events[0]);
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[0]);
+}
+
+TEST_F(ErOsOverflowTest, DropOldestReturnsTheDisplacedEvent)
+{
+    SetUp(ER_OVERFLOW_POLICY__DROP_OLDEST, 1);
+    ErEvent_t events[2];
+    Send(&events[0], ER_EVENT_TYPE__1);
+    Send(&events[1], ER_EVENT_TYPE__1);
+    EXPECT_EQ(ErGetTaskDropCount(MockOptions::Task::Second), 1);
+
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[0]);
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &events[1]);
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[1]);
+}
+
+TEST_F(ErOsOverflowTest, ConflateReplacesTheQueuedEventInPlace)
+{
+    SetUp(ER_OVERFLOW_POLICY__CONFLATE, 2);
+    ErEvent_t events[3];
+    Send(&events[0], ER_EVENT_TYPE__1);
+    Send(&events[1], ER_EVENT_TYPE__2);
+    Send(&events[2], ER_EVENT_TYPE__1);
+
+    // Nothing was lost, so nothing counts as dropped.
+    EXPECT_EQ(ErGetTaskDropCount(MockOptions::Task::Second), 0);
+
+    // The replacement keeps the place of the event it superseded.
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[0]);
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &events[2]);
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &events[1]);
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[2]);
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[1]);
+}
+
+TEST_F(ErOsOverflowTest, ReturnTripsAreNeverDisplaced)
+{
+    SetUp(ER_OVERFLOW_POLICY__DROP_OLDEST, 1);
+
+    // Module C's event comes back to the second task through its queue.
+    ErEvent_t returning;
+    ErEventInit(&returning, ER_EVENT_TYPE__3,
+                &MockModule<MockOptions::Module::C>::m_module);
+    ErSubscribe(&MockModule<MockOptions::Module::B>::m_module,
+                returning.m_type);
+    SwitchToTask(MockOptions::Task::Second);
+    ErSend(&returning);
+    DeliverOne(MockOptions::Task::First);
+
+    // With only the return trip queued, the new event is dropped instead.
+    SwitchToTask(MockOptions::Task::First);
+    ErEvent_t event;
+    Send(&event, ER_EVENT_TYPE__1);
+    EXPECT_EQ(ErGetTaskDropCount(MockOptions::Task::Second), 1);
+
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &returning);
+    EXPECT_EQ(Handled(MockOptions::Task::First), &event);
+}
+
+TEST_F(ErOsOverflowTest, DroppedEventsNeverWaitForTheSendersQueue)
+{
+    SetUp(ER_OVERFLOW_POLICY__DROP_NEWEST, 1);
+
+    // Fill both queues; the first task's holds an event for module B.
+    ErSubscribe(&MockModule<MockOptions::Module::B>::m_module,
+                ER_EVENT_TYPE__3);
+    ErEvent_t events[3];
+    Send(&events[0], ER_EVENT_TYPE__1);
+    Send(&events[1], ER_EVENT_TYPE__3);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::First), 1);
+
+    // The dropped event can't go back through the sending task's queue, so
+    // the task gets it before anything queued.
+    Send(&events[2], ER_EVENT_TYPE__1);
+    EXPECT_EQ(ErGetTaskDropCount(MockOptions::Task::Second), 1);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::First), 1);
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[2]);
+    EXPECT_FALSE(ErEventIsInFlight(&events[2]));
+
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[1]);
+    EXPECT_EQ(MockModule<MockOptions::Module::B>::m_last_event_handled,
+              &events[1]);
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &events[0]);
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[0]);
+}
+
+//==============================================================================
+// Tests for `ErOptions_t::m_conflated_types`
+//==============================================================================
+
+class ErOsConflationTest : public ErOsOverflowTest
+{
+   protected:
+    void SetUp() override
+    {
+        static constexpr ErEventType_t kConflatedTypes[] = {ER_EVENT_TYPE__1};
+        m_options.m_options.m_conflated_types     = kConflatedTypes;
+        m_options.m_options.m_num_conflated_types = 1;
+        ErOsOverflowTest::SetUp(ER_OVERFLOW_POLICY__BLOCK, SIZE_MAX);
+    }
+};
+
+TEST_F(ErOsConflationTest, NewEventReplacesTheUndeliveredOneInPlace)
+{
+    ErEvent_t events[3];
+    Send(&events[0], ER_EVENT_TYPE__1);
+    Send(&events[1], ER_EVENT_TYPE__2);
+    Send(&events[2], ER_EVENT_TYPE__1);
+
+    // Conflation is not an overflow, even though an event was dropped.
+    EXPECT_EQ(ErGetTaskDropCount(MockOptions::Task::Second), 0);
+
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[0]);
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &events[2]);
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &events[1]);
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[2]);
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[1]);
+}
+
+TEST_F(ErOsConflationTest, EventsFromOtherSendersAreKept)
+{
+    ErEvent_t events[2];
+    Send(&events[0], ER_EVENT_TYPE__1);
+    ErEventInit(&events[1], ER_EVENT_TYPE__1,
+                &MockModule<MockOptions::Module::B>::m_module);
+    ErSend(&events[1]);
+
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &events[0]);
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &events[1]);
+    DeliverOne(MockOptions::Task::First);
+    DeliverOne(MockOptions::Task::First);
+    EXPECT_EQ(MockModule<MockOptions::Module::B>::m_last_event_handled,
+              &events[1]);
+}
+
+TEST_F(ErOsConflationTest, DeliveredEventsAreNotReplaced)
+{
+    ErEvent_t events[2];
+    Send(&events[0], ER_EVENT_TYPE__1);
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &events[0]);
+    Send(&events[1], ER_EVENT_TYPE__1);
+
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[0]);
+    EXPECT_EQ(Handled(MockOptions::Task::Second), &events[1]);
+    EXPECT_EQ(Handled(MockOptions::Task::First), &events[1]);
+}
+
+//==============================================================================
+// Tests for `ErOptions_t::m_type_lanes`
+//==============================================================================
+
+TEST_F(ErOsTest, EventsTravelInTheLaneOfTheirType)
+{
+    uint8_t type_lanes[ER_EVENT_TYPE__COUNT]          = {};
+    type_lanes[ER_EVENT_TYPE__2 - ER_EVENT_TYPE__FIRST] = 1;
+    ErDeinit();
+    m_options.m_options.m_type_lanes = type_lanes;
+    ErInit(&m_options.m_options);
+    ErSetOsFunctions(&MockOs::m_os_functions);
+    MockOs::Init(&m_options.m_options);
+    SwitchToTask(MockOptions::Task::First);
+
+    ErEvent_t events[2];
+    ErEventInit(&events[0], ER_EVENT_TYPE__1,
+                &MockModule<MockOptions::Module::A>::m_module);
+    ErEventInit(&events[1], ER_EVENT_TYPE__2,
+                &MockModule<MockOptions::Module::A>::m_module);
+    ErSend(&events[0]);
+    ErSend(&events[1]);
+    EXPECT_EQ(events[0].m_lane, 0);
+    EXPECT_EQ(events[1].m_lane, 1);
+
+    DeliverOne(MockOptions::Task::First);
+    DeliverOne(MockOptions::Task::First);
+}
+
+//==============================================================================
+// Tests for `ErTask_t::m_worker_group`
+//==============================================================================
+
+/// Both tasks form one worker group, with modules B and C as the workers.
+class ErOsWorkerGroupTest : public ErOsTest
+{
+   protected:
+    void SetUp(ErWorkerBalance_t a_balance)
+    {
+        ErDeinit();
+        for (ErTask_t &task : m_options.m_tasks)
+        {
+            task.m_worker_group   = 1;
+            task.m_worker_balance = a_balance;
+        }
+        ErInit(&m_options.m_options);
+        ErSetOsFunctions(&MockOs::m_os_functions);
+        MockOs::Init(&m_options.m_options);
+        ErSubscribe(&MockModule<MockOptions::Module::B>::m_module,
+                    ER_EVENT_TYPE__1);
+        ErSubscribe(&MockModule<MockOptions::Module::C>::m_module,
+                    ER_EVENT_TYPE__1);
+        SwitchToTask(MockOptions::Task::First);
+    }
+
+    /// Sends `a_event` from module A as a new event of `a_type`.
+    void Send(ErEvent_t *a_event, ErEventType_t a_type)
+    {
+        SwitchToTask(MockOptions::Task::First);
+        ErEventInit(a_event, a_type,
+                    &MockModule<MockOptions::Module::A>::m_module);
+        ErSend(a_event);
+    }
+};
+
+TEST_F(ErOsWorkerGroupTest, RoundRobinDeliversEachEventToOneWorker)
+{
+    SetUp(ER_WORKER_BALANCE__ROUND_ROBIN);
+    ErEvent_t events[2];
+    Send(&events[0], ER_EVENT_TYPE__1);
+    Send(&events[1], ER_EVENT_TYPE__1);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::First), 1);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::Second), 1);
+
+    // Each returns to module A as usual: straight away from module B, which
+    // shares its task, and through the first task's queue from module C.
+    DeliverOne(MockOptions::Task::First);
+    EXPECT_EQ(MockModule<MockOptions::Module::B>::m_last_event_handled,
+              &events[0]);
+    EXPECT_EQ(MockModule<MockOptions::Module::A>::m_last_event_handled,
+              &events[0]);
+    DeliverOne(MockOptions::Task::Second);
+    EXPECT_EQ(MockModule<MockOptions::Module::C>::m_last_event_handled,
+              &events[1]);
+    DeliverOne(MockOptions::Task::First);
+    EXPECT_EQ(MockModule<MockOptions::Module::A>::m_last_event_handled,
+              &events[1]);
+}
+
+TEST_F(ErOsWorkerGroupTest, LeastLoadedSkipsTheBusierWorker)
+{
+    SetUp(ER_WORKER_BALANCE__LEAST_LOADED);
+    ErSubscribe(&MockModule<MockOptions::Module::C>::m_module,
+                ER_EVENT_TYPE__2);
+
+    // Module C is still busy with the first event when the second arrives, so
+    // module B takes it; the third is a tie, and goes to whoever's turn it is.
+    ErEvent_t events[3];
+    Send(&events[0], ER_EVENT_TYPE__2);
+    Send(&events[1], ER_EVENT_TYPE__1);
+    Send(&events[2], ER_EVENT_TYPE__1);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::First), 1);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::Second), 2);
+
+    DeliverOne(MockOptions::Task::First);
+    EXPECT_EQ(MockModule<MockOptions::Module::B>::m_last_event_handled,
+              &events[1]);
+    DeliverOne(MockOptions::Task::Second);
+    DeliverOne(MockOptions::Task::Second);
+    EXPECT_EQ(MockModule<MockOptions::Module::C>::m_last_event_handled,
+              &events[2]);
+    DeliverOne(MockOptions::Task::First);
+    DeliverOne(MockOptions::Task::First);
+}
+
+/// An event that carries its partitioning key.
+struct KeyedEvent
+{
+    ErEvent_t m_event;
+    uint32_t m_key;
+};
+
+static uint32_t KeyOf(const ErEvent_t *a_event)
+{
+    return ((const KeyedEvent *)a_event)->m_key;
+}
+
+/// Returns a key whose partition group 1 assigns to `a_task_idx`.
+static uint32_t KeyOwnedBy(size_t a_task_idx)
+{
+    uint32_t key = 0;
+    while (ErGetPartitionTask(1, ErGetKeyPartition(key)) != a_task_idx)
+    {
+        key += 1;
+    }
+    return key;
+}
+
+TEST_F(ErOsWorkerGroupTest, KeyedEventsGoToTheTaskOwningTheirPartition)
+{
+    ErEventKey_t key_extractors[ER_EVENT_TYPE__COUNT]       = {};
+    key_extractors[ER_EVENT_TYPE__1 - ER_EVENT_TYPE__FIRST] = KeyOf;
+    m_options.m_options.m_key_extractors                    = key_extractors;
+    SetUp(ER_WORKER_BALANCE__ROUND_ROBIN);
+
+    const uint32_t first_key  = KeyOwnedBy(MockOptions::Task::First);
+    const uint32_t second_key = KeyOwnedBy(MockOptions::Task::Second);
+    KeyedEvent events[4];
+    for (KeyedEvent &event : events)
+    {
+        event.m_key = (&event == &events[3]) ? first_key : second_key;
+        Send(&event.m_event, ER_EVENT_TYPE__1);
+    }
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::First), 1);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::Second), 3);
+
+    for (KeyedEvent &event : events)
+    {
+        if (&event != &events[3])
+        {
+            DeliverOne(MockOptions::Task::Second);
+            EXPECT_EQ(MockModule<MockOptions::Module::C>::m_last_event_handled,
+                      &event.m_event);
+        }
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        DeliverOne(MockOptions::Task::First);
+    }
+}
+
+TEST_F(ErOsTest, KeysOfAnUnsubscribedOwnerStayTogether)
+{
+    // Module A sends from a task of its own to a group of three workers, and
+    // the first worker has no module subscribed.
+    constexpr int kWorkers[3] = {3, 4, 5};
+    MockModule<kWorkers[0]>::Reset();
+    MockModule<kWorkers[1]>::Reset();
+    MockModule<kWorkers[2]>::Reset();
+    ErModule_t *modules[4] = {
+        &MockModule<MockOptions::Module::A>::m_module,
+        &MockModule<kWorkers[0]>::m_module,
+        &MockModule<kWorkers[1]>::m_module,
+        &MockModule<kWorkers[2]>::m_module,
+    };
+    ErTask_t tasks[4] = {};
+    for (size_t idx = 0; idx < 4; ++idx)
+    {
+        tasks[idx].m_task_handle  = (ErTaskHandle_t)(idx + 1);
+        tasks[idx].m_event_queue  = (ErQueueHandle_t)(idx + 1);
+        tasks[idx].m_modules      = &modules[idx];
+        tasks[idx].m_num_modules  = 1;
+        tasks[idx].m_worker_group = (idx == 0) ? 0 : 1;
+    }
+    ErEventKey_t key_extractors[ER_EVENT_TYPE__COUNT]       = {};
+    key_extractors[ER_EVENT_TYPE__1 - ER_EVENT_TYPE__FIRST] = KeyOf;
+
+    ErOptions_t options      = m_options.m_options;
+    options.m_tasks          = tasks;
+    options.m_num_tasks      = 4;
+    options.m_key_extractors = key_extractors;
+
+    ErDeinit();
+    ErInit(&options);
+    ErSetOsFunctions(&MockOs::m_os_functions);
+    MockOs::Init(&options);
+    ErSubscribe(modules[2], ER_EVENT_TYPE__1);
+    ErSubscribe(modules[3], ER_EVENT_TYPE__1);
+
+    // Round robin would split these; the key keeps them on one task.
+    MockOs::SwitchTask(tasks[0].m_task_handle);
+    KeyedEvent events[2];
+    for (KeyedEvent &event : events)
+    {
+        ErEventInit(&event.m_event, ER_EVENT_TYPE__1, modules[0]);
+        event.m_key = KeyOwnedBy(1);
+        ErSend(&event.m_event);
+    }
+    const size_t depths[2] = {ErGetTaskQueueDepth(2), ErGetTaskQueueDepth(3)};
+    EXPECT_EQ(std::max(depths[0], depths[1]), 2);
+    EXPECT_EQ(std::min(depths[0], depths[1]), 0);
+
+    const size_t worker = (depths[0] == 2) ? 2 : 3;
+    for (size_t idx = 0; idx < 2; ++idx)
+    {
+        MockOs::SwitchTask(tasks[worker].m_task_handle);
+        ErCallHandlers(ErReceive());
+    }
+    for (size_t idx = 0; idx < 2; ++idx)
+    {
+        MockOs::SwitchTask(tasks[0].m_task_handle);
+        ErCallHandlers(ErReceive());
+    }
+    ErDeinit();
+    ErInit(&m_options.m_options);
+}
+
+TEST_F(ErOsWorkerGroupTest, RebalancingMovesAsFewPartitionsAsPossible)
+{
+    SetUp(ER_WORKER_BALANCE__ROUND_ROBIN);
+    size_t owners[ER_KEY_PARTITIONS];
+    size_t on_second = 0;
+    for (size_t partition = 0; partition < ER_KEY_PARTITIONS; ++partition)
+    {
+        owners[partition] = ErGetPartitionTask(1, partition);
+        on_second += (owners[partition] == MockOptions::Task::Second) ? 1 : 0;
+    }
+    EXPECT_EQ(on_second, ER_KEY_PARTITIONS / 2);
+
+    // The second task leaves and rejoins; only its own partitions move, and
+    // they come back to it.
+    ErRebalancePartitions(1, 1 << MockOptions::Task::First);
+    for (size_t partition = 0; partition < ER_KEY_PARTITIONS; ++partition)
+    {
+        EXPECT_EQ(ErGetPartitionTask(1, partition), MockOptions::Task::First);
+    }
+    ErRebalancePartitions(1, (1 << MockOptions::Task::First) |
+                                 (1 << MockOptions::Task::Second));
+    for (size_t partition = 0; partition < ER_KEY_PARTITIONS; ++partition)
+    {
+        EXPECT_EQ(ErGetPartitionTask(1, partition), owners[partition]);
+    }
+}
+
+//==============================================================================
+// Tests for `ErNotify()`
+//==============================================================================
+
+TEST_F(ErOsTest, NotificationsCoalesceAndArriveInTypeOrder)
+{
+    ErModule_t *module = &MockModule<MockOptions::Module::C>::m_module;
+    ErSubscribe(module, ER_EVENT_TYPE__1);
+    ErSubscribe(module, ER_EVENT_TYPE__2);
+
+    ErNotify(ER_EVENT_TYPE__2);
+    ErNotify(ER_EVENT_TYPE__1);
+    ErNotify(ER_EVENT_TYPE__2);
+    ErNotify(ER_EVENT_TYPE__3);  // Nobody subscribes to this one.
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::First), 0);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::Second), 1);
+
+    for (ErEventType_t type : {ER_EVENT_TYPE__1, ER_EVENT_TYPE__2})
+    {
+        ErEvent_t *event = DeliverOne(MockOptions::Task::Second);
+        EXPECT_EQ(event->m_type, type);
+        EXPECT_EQ(event->m_sending_module, nullptr);
+        EXPECT_EQ(MockModule<MockOptions::Module::C>::m_last_event_handled,
+                  event);
+    }
+
+    // Only the wakeup is left, and nothing returns to the first task.
+    EXPECT_EQ(ErTimedReceive(0), nullptr);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::First), 0);
+}
+
+TEST_F(ErOsTest, NotificationsQueueOneWakeupPerWait)
+{
+    ErSubscribe(&MockModule<MockOptions::Module::C>::m_module,
+                ER_EVENT_TYPE__1);
+
+    // The pending bit is seen before the wakeup is received, so a second
+    // notification still relies on the first wakeup.
+    ErNotify(ER_EVENT_TYPE__1);
+    DeliverOne(MockOptions::Task::Second);
+    ErNotify(ER_EVENT_TYPE__1);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::Second), 1);
+    DeliverOne(MockOptions::Task::Second);
+    EXPECT_EQ(ErTimedReceive(0), nullptr);
+
+    // Once the wakeup has been received, the next notification posts another.
+    ErNotify(ER_EVENT_TYPE__1);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::Second), 1);
+    EXPECT_EQ(DeliverOne(MockOptions::Task::Second)->m_type, ER_EVENT_TYPE__1);
+    EXPECT_EQ(ErTimedReceive(0), nullptr);
+}
+
+TEST_F(ErOsTest, NotificationsIntoAFullQueueNeverWait)
+{
+    ErModule_t *module = &MockModule<MockOptions::Module::C>::m_module;
+    ErSubscribe(module, ER_EVENT_TYPE__1);
+    ErSubscribe(module, ER_EVENT_TYPE__2);
+
+    // Fill the second task's queue; the wakeup finds no room.
+    ErEvent_t event;
+    ErEventInit(&event, ER_EVENT_TYPE__1,
+                &MockModule<MockOptions::Module::A>::m_module);
+    ErSend(&event);
+    MockOs::m_queue_capacity = 1;
+    ErNotify(ER_EVENT_TYPE__2);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::Second), 1);
+
+    // The task still finds the notification before its queued event.
+    EXPECT_EQ(DeliverOne(MockOptions::Task::Second)->m_type, ER_EVENT_TYPE__2);
+    EXPECT_EQ(DeliverOne(MockOptions::Task::Second), &event);
+    EXPECT_EQ(DeliverOne(MockOptions::Task::First), &event);
+
+    // No wakeup was posted, so the flag still holds off new ones until the
+    // task finds its queue empty.
+    ErNotify(ER_EVENT_TYPE__2);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::Second), 0);
+    EXPECT_EQ(DeliverOne(MockOptions::Task::Second)->m_type, ER_EVENT_TYPE__2);
+    EXPECT_EQ(ErTimedReceive(0), nullptr);
+
+    // After that, notifications post wakeups again.
+    ErNotify(ER_EVENT_TYPE__1);
+    EXPECT_EQ(ErGetTaskQueueDepth(MockOptions::Task::Second), 1);
+    EXPECT_EQ(DeliverOne(MockOptions::Task::Second)->m_type, ER_EVENT_TYPE__1);
+    EXPECT_EQ(ErTimedReceive(0), nullptr);
+}
+
+TEST_F(ErOsTest, NotificationsComeBeforeQueuedEvents)
+{
+    ErModule_t *module = &MockModule<MockOptions::Module::C>::m_module;
+    ErSubscribe(module, ER_EVENT_TYPE__1);
+    ErSubscribe(module, ER_EVENT_TYPE__2);
+
+    ErEvent_t event;
+    ErEventInit(&event, ER_EVENT_TYPE__1,
+                &MockModule<MockOptions::Module::A>::m_module);
+    ErSend(&event);
+    ErNotify(ER_EVENT_TYPE__2);
+
+    EXPECT_EQ(DeliverOne(MockOptions::Task::Second)->m_type, ER_EVENT_TYPE__2);
+    EXPECT_EQ(DeliverOne(MockOptions::Task::Second), &event);
+    EXPECT_EQ(ErTimedReceive(0), nullptr);
+    EXPECT_EQ(DeliverOne(MockOptions::Task::First), &event);
+}
+
+}  // namespace testing
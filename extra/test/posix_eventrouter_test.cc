@@ -0,0 +1,1975 @@
+#include "eventrouter.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mock_module.h"
+#include "mock_os.h"
+
+namespace
+{
+
+/// A single-task configuration for tests of POSIX-only features.
+struct MockOptions
+{
+   public:
+    struct Module
+    {
+        static constexpr int A = 0;
+        static constexpr int B = 1;
+    };
+
+    MockOptions()
+    {
+        MockModule<Module::A>::Reset();
+        MockModule<Module::B>::Reset();
+    }
+
+    static bool IsInIsr(void) { return false; }
+
+    ErModule_t *m_modules[2] = {
+        &MockModule<Module::A>::m_module,
+        &MockModule<Module::B>::m_module,
+    };
+
+    ErTask_t m_task{
+        .m_task_handle = (ErTaskHandle_t)1,
+        .m_event_queue = (ErQueueHandle_t)1,
+        .m_modules     = m_modules,
+        .m_num_modules = 2,
+    };
+
+    ErOptions_t m_options{
+        .m_tasks     = &m_task,
+        .m_num_tasks = 1,
+        .m_IsInIsr   = IsInIsr,
+    };
+};
+
+struct PooledEvent
+{
+    MIXIN_ER_EVENT;
+    std::atomic_bool m_owned;
+};
+
+ER_DEFINE_EVENT_POOL(s_pool, PooledEvent, 4);
+
+}  // namespace
+
+namespace testing
+{
+
+class ErPosixTest : public Test
+{
+   protected:
+    ErPosixTest()
+    {
+        ErInit(&m_options.m_options);
+        ErSetOsFunctions(&MockOs::m_os_functions);
+        MockOs::Init(&m_options.m_options);
+        MockOs::SwitchTask(m_options.m_task.m_task_handle);
+    }
+    ~ErPosixTest()
+    {
+        assert(!MockOs::AnyUnhandledEvents());
+        ErDeinit();
+    }
+
+    void DeliverAll()
+    {
+        while (MockOs::AnyUnhandledEvents())
+        {
+            ErCallHandlers(ErReceive());
+        }
+    }
+
+    MockOptions m_options;
+};
+
+//==============================================================================
+// Tests for `ErStatsShmStart()` and friends
+//==============================================================================
+
+TEST_F(ErPosixTest, StatsShmMirrorsCountersForOtherProcesses)
+{
+    constexpr const char *kName = "/eventrouter_stats_shm_test";
+    constexpr int64_t kOneHourMs = 60 * 60 * 1000;
+
+    ErEvent_t event = {
+        .m_type           = ER_EVENT_TYPE__3,
+        .m_sending_module = &MockModule<MockOptions::Module::A>::m_module,
+    };
+    ErSubscribe(&MockModule<MockOptions::Module::B>::m_module, event.m_type);
+
+    ASSERT_TRUE(ErStatsShmStart(kName, kOneHourMs));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        ErSend(&event);
+        MockOs::AdvanceTimeMs(100);
+        DeliverAll();
+    }
+    ErStatsShmPublish();
+
+    // Read the object the way an external tool would: map it read-only and
+    // copy a snapshot out of it.
+    const int fd = shm_open(kName, O_RDONLY, 0);
+    ASSERT_GE(fd, 0);
+    void *mapping =
+        mmap(NULL, sizeof(ErStatsShm_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(mapping, MAP_FAILED);
+
+    ErStatsShm_t snapshot;
+    ASSERT_TRUE(ErStatsShmRead((const ErStatsShm_t *)mapping, &snapshot));
+    munmap(mapping, sizeof(ErStatsShm_t));
+
+    EXPECT_EQ(snapshot.m_num_tasks, 1);
+    EXPECT_EQ(snapshot.m_timestamp_us, 300 * 1000);
+    EXPECT_EQ(snapshot.m_tasks[0].m_stats.m_receives, 3);
+    EXPECT_EQ(snapshot.m_tasks[0].m_queue_depth, 0);
+
+    const ErStatsShmType_t &type =
+        snapshot.m_types[ER_EVENT_TYPE__3 - ER_EVENT_TYPE__FIRST];
+    EXPECT_EQ(type.m_stats.m_sends, 3);
+    EXPECT_EQ(type.m_stats.m_returns, 3);
+    EXPECT_EQ(type.m_sends_per_second, 10);  // 3 sends in 300ms.
+
+    ErStatsShmStop();
+    EXPECT_LT(shm_open(kName, O_RDONLY, 0), 0);
+}
+
+//==============================================================================
+// Tests for `ErEventPool_t`
+//==============================================================================
+
+TEST_F(ErPosixTest, EventPoolNeverHandsOutOneEventTwice)
+{
+    constexpr int kThreads    = 8;
+    constexpr int kIterations = 100000;
+
+    ErEventPoolInit(&s_pool, ER_EVENT_TYPE__1,
+                    &MockModule<MockOptions::Module::A>::m_module);
+
+    // More threads than events hammer the free list; if a stale head ever
+    // won a compare-exchange, two threads would own the same event.
+    std::atomic_int double_allocations{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                for (int i = 0; i < kIterations; ++i)
+                {
+                    ErEvent_t *event = ErEventPoolAlloc(&s_pool);
+                    if (event == nullptr) continue;
+
+                    PooledEvent *pooled =
+                        er_container_of(event, PooledEvent, ER_EVENT_MEMBER);
+                    if (pooled->m_owned.exchange(true))
+                    {
+                        double_allocations++;
+                    }
+                    pooled->m_owned = false;
+                    ErEventPoolFree(&s_pool, event);
+                }
+            });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(double_allocations, 0);
+
+    // Every event made it back to the pool.
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_NE(ErEventPoolAlloc(&s_pool), nullptr);
+    }
+    EXPECT_EQ(ErEventPoolAlloc(&s_pool), nullptr);
+}
+
+//==============================================================================
+// Tests for `ErQueueDisplace()`
+//==============================================================================
+
+TEST(ErPosixQueue, DisplaceKeepsTheOrderOfOtherEvents)
+{
+    ErEvent_t events[4] = {};
+    ErQueue_t queue     = ErQueueNew(3);
+    for (size_t idx = 0; idx < 3; ++idx)
+    {
+        events[idx].m_type = ER_EVENT_TYPE__1;
+        ErQueuePushBack(queue, &events[idx]);
+    }
+    events[1].m_type = ER_EVENT_TYPE__2;
+    events[3].m_type = ER_EVENT_TYPE__2;
+
+    const ErQueueMatch_t same_type = [](const ErEvent_t *a_queued,
+                                        const ErEvent_t *a_event)
+    { return a_queued->m_type == a_event->m_type; };
+    const ErQueueMatch_t nothing = [](const ErEvent_t *, const ErEvent_t *)
+    { return false; };
+
+    // Wrap the ring buffer so the shift crosses the end of the storage.
+    EXPECT_EQ(ErQueuePopFront(queue), &events[0]);
+    ErQueuePushBack(queue, &events[0]);
+
+    EXPECT_EQ(ErQueueDisplace(queue, &events[3], nothing, false), nullptr);
+    EXPECT_EQ(ErQueueDisplace(queue, &events[3], same_type, false),
+              &events[1]);
+    EXPECT_EQ(ErQueueDisplace(queue, &events[1], same_type, true), &events[3]);
+
+    EXPECT_EQ(ErQueueSize(queue), 3);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[2]);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[0]);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[1]);
+    ErQueueFree(queue);
+}
+
+TEST(ErPosixQueue, HigherLanesAreReadFirstAndFillSeparately)
+{
+    ErEvent_t events[4] = {};
+    events[3].m_lane    = 1;
+    ErQueue_t queue     = ErQueueNew(2);
+    ErQueuePushBack(queue, &events[0]);
+    ErQueuePushBack(queue, &events[1]);
+
+    // Lane 0 is full, but that doesn't hold up lane 1.
+    EXPECT_FALSE(ErQueueTimedPushBack(queue, &events[2], 0));
+    EXPECT_TRUE(ErQueueTimedPushBack(queue, &events[3], 0));
+
+    EXPECT_EQ(ErQueueSize(queue), 3);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[3]);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[0]);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[1]);
+    ErQueueFree(queue);
+}
+
+//==============================================================================
+// Tests for `ErPoolStart()` and friends
+//==============================================================================
+
+/// A module that records what it handles, and notices if two workers ever run
+/// it at once.
+struct Actor
+{
+    static ErEventHandlerRet_t Handle(ErEvent_t *a_event, void *a_context)
+    {
+        Actor *actor = (Actor *)a_context;
+        if (actor->m_busy.exchange(true))
+        {
+            actor->m_overlaps++;
+        }
+        actor->m_handled.push_back(a_event);
+        actor->m_notifications += (a_event->m_sending_module == nullptr);
+        actor->m_on_task_thread |= pthread_equal(pthread_self(), s_task_thread);
+        std::this_thread::yield();
+        actor->m_busy = false;
+        actor->m_count++;
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    ErModule_t m_module = ER_CREATE_MODULE(Handle, this);
+    std::atomic_bool m_busy{false};
+    std::atomic_int m_overlaps{0};
+    std::atomic_size_t m_count{0};
+    std::vector<ErEvent_t *> m_handled;
+    int m_notifications   = 0;
+    bool m_on_task_thread = false;
+
+    static pthread_t s_task_thread;
+};
+
+pthread_t Actor::s_task_thread;
+
+/// Pools the test's own thread as the only task, with `actors[0]` sending and
+/// the rest subscribed to `ER_EVENT_TYPE__1`.
+class ErPosixPoolTest : public Test
+{
+   protected:
+    static constexpr size_t kActors = 4;
+
+    ErPosixPoolTest()
+    {
+        Actor::s_task_thread = pthread_self();
+        for (size_t idx = 0; idx < kActors; ++idx)
+        {
+            m_modules[idx] = &m_actors[idx].m_module;
+        }
+        ErInit(&m_options);
+        for (size_t idx = 1; idx < kActors; ++idx)
+        {
+            ErSubscribe(&m_actors[idx].m_module, ER_EVENT_TYPE__1);
+        }
+    }
+    ~ErPosixPoolTest()
+    {
+        ErDeinit();
+        ErQueueFree(m_task.m_event_queue);
+    }
+
+    /// Dispatches events until `a_actor` has handled `a_count` of them.
+    static void DispatchUntil(const Actor &a_actor, size_t a_count)
+    {
+        while (a_actor.m_count < a_count)
+        {
+            ErEvent_t *event = ErTimedReceive(10);
+            if (event != nullptr)
+            {
+                ErPoolDispatch(event);
+            }
+        }
+    }
+
+    /// Sends `a_events` as `ER_EVENT_TYPE__1` from `a_sender`, waiting for
+    /// each to come back before sending the next. Workers may still be
+    /// finishing the last one until the pool stops.
+    static void SendOneAtATime(Actor &a_sender,
+                               std::vector<ErEvent_t> &a_events)
+    {
+        for (size_t idx = 0; idx < a_events.size(); ++idx)
+        {
+            ErEventInit(&a_events[idx], ER_EVENT_TYPE__1, &a_sender.m_module);
+            ErSend(&a_events[idx]);
+            DispatchUntil(a_sender, idx + 1);
+        }
+    }
+
+    Actor m_actors[kActors];
+    ErModule_t *m_modules[kActors];
+    ErTask_t m_task{
+        .m_task_handle = pthread_self(),
+        .m_event_queue = ErQueueNew(1024),
+        .m_modules     = m_modules,
+        .m_num_modules = kActors,
+    };
+    ErOptions_t m_options{
+        .m_tasks     = &m_task,
+        .m_num_tasks = 1,
+        .m_IsInIsr   = MockOptions::IsInIsr,
+    };
+};
+
+TEST_F(ErPosixPoolTest, ModulesHandleOneEventAtATimeInOrder)
+{
+    constexpr size_t kEvents = 500;
+    ASSERT_TRUE(ErPoolStart(3));
+
+    std::vector<ErEvent_t> events(kEvents);
+    for (ErEvent_t &event : events)
+    {
+        ErEventInit(&event, ER_EVENT_TYPE__1, &m_actors[0].m_module);
+        ErSend(&event);
+    }
+    DispatchUntil(m_actors[0], kEvents);
+    ErPoolStop();
+
+    for (size_t idx = 0; idx < kActors; ++idx)
+    {
+        EXPECT_EQ(m_actors[idx].m_overlaps, 0);
+        EXPECT_FALSE(m_actors[idx].m_on_task_thread);
+        ASSERT_EQ(m_actors[idx].m_handled.size(), kEvents);
+    }
+    for (size_t idx = 1; idx < kActors; ++idx)
+    {
+        for (size_t event_idx = 0; event_idx < kEvents; ++event_idx)
+        {
+            EXPECT_EQ(m_actors[idx].m_handled[event_idx], &events[event_idx]);
+        }
+    }
+}
+
+TEST_F(ErPosixPoolTest, ReturnsSkipTheTasksQueue)
+{
+    constexpr size_t kEvents = 100;
+    ASSERT_TRUE(ErPoolStart(3));
+
+    std::vector<ErEvent_t> events(kEvents);
+    for (ErEvent_t &event : events)
+    {
+        ErEventInit(&event, ER_EVENT_TYPE__1, &m_actors[0].m_module);
+        ErSend(&event);
+    }
+    for (size_t idx = 0; idx < kEvents; ++idx)
+    {
+        ErPoolDispatch(ErReceive());
+    }
+
+    // Nothing is dispatched from here on, so the events must come back to
+    // their sender without passing through the task's queue again.
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ((m_actors[0].m_count < kEvents) &&
+           (std::chrono::steady_clock::now() < deadline))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(m_actors[0].m_count, kEvents);
+    EXPECT_EQ(ErTimedReceive(0), nullptr);
+    ErPoolStop();
+}
+
+TEST_F(ErPosixPoolTest, EachRouterPoolsATaskOfItsOwn)
+{
+    static constexpr size_t kEvents = 100;
+    ASSERT_TRUE(ErPoolStart(2));
+
+    std::thread other(
+        []()
+        {
+            ErRouter_t *router = ErRouterNew();
+            ASSERT_NE(router, nullptr);
+            ErRouterUse(router);
+            Actor actors[2];
+            ErModule_t *modules[2] = {&actors[0].m_module,
+                                      &actors[1].m_module};
+            ErTask_t task{
+                .m_task_handle = pthread_self(),
+                .m_event_queue = ErQueueNew(16),
+                .m_modules     = modules,
+                .m_num_modules = 2,
+            };
+            ErOptions_t options{
+                .m_tasks     = &task,
+                .m_num_tasks = 1,
+                .m_IsInIsr   = MockOptions::IsInIsr,
+            };
+            ErInit(&options);
+            ErSubscribe(&actors[1].m_module, ER_EVENT_TYPE__1);
+
+            std::vector<ErEvent_t> events(kEvents);
+            EXPECT_TRUE(ErPoolStart(2));
+            SendOneAtATime(actors[0], events);
+            ErPoolStop();
+            EXPECT_EQ(actors[1].m_count, kEvents);
+
+            ErDeinit();
+            ErQueueFree(task.m_event_queue);
+            ErRouterUse(nullptr);
+            ErRouterFree(router);
+        });
+    std::vector<ErEvent_t> events(kEvents);
+    SendOneAtATime(m_actors[0], events);
+    other.join();
+    ErPoolStop();
+
+    for (size_t idx = 0; idx < kActors; ++idx)
+    {
+        EXPECT_EQ(m_actors[idx].m_count, kEvents);
+    }
+}
+
+TEST_F(ErPosixPoolTest, NotificationsReachPooledModules)
+{
+    ErSubscribe(&m_actors[1].m_module, ER_EVENT_TYPE__2);
+    ASSERT_TRUE(ErPoolStart(2));
+
+    ErNotify(ER_EVENT_TYPE__2);
+    DispatchUntil(m_actors[1], 1);
+    ErPoolStop();
+
+    EXPECT_EQ(m_actors[1].m_notifications, 1);
+    EXPECT_FALSE(m_actors[1].m_on_task_thread);
+}
+
+//==============================================================================
+// Tests for `ErOffload()` and friends
+//==============================================================================
+
+/// Module A sends to module B, which offloads every event it receives. The
+/// test's own thread is the task.
+class ErPosixOffloadTest : public Test
+{
+   protected:
+    ErPosixOffloadTest()
+    {
+        s_gate_open = true;
+        s_work_done = 0;
+        m_options.m_task.m_task_handle = pthread_self();
+        m_options.m_task.m_event_queue = ErQueueNew(16);
+        MockModule<MockOptions::Module::B>::m_module.m_handler = Offload;
+        ErInit(&m_options.m_options);
+        ErSubscribe(&MockModule<MockOptions::Module::B>::m_module,
+                    ER_EVENT_TYPE__1);
+    }
+    ~ErPosixOffloadTest()
+    {
+        ErDeinit();
+        ErQueueFree(m_options.m_task.m_event_queue);
+    }
+
+    static ErEventHandlerRet_t Offload(ErEvent_t *a_event, void *a_context)
+    {
+        ER_UNUSED(a_context);
+        return ErOffload(a_event, Work, nullptr);
+    }
+
+    static void Work(ErEvent_t *a_event, void *a_context)
+    {
+        ER_UNUSED(a_event);
+        ER_UNUSED(a_context);
+        while (!s_gate_open)
+        {
+            std::this_thread::yield();
+        }
+        s_work_done++;
+    }
+
+    /// Sends each of `a_events` from module A, hands them all to module B,
+    /// and then handles return trips until every event is back. Events whose
+    /// work finishes before their handler does return without one.
+    void SendAndDeliver(std::vector<ErEvent_t> &a_events)
+    {
+        for (ErEvent_t &event : a_events)
+        {
+            ErEventInit(&event, ER_EVENT_TYPE__1,
+                        &MockModule<MockOptions::Module::A>::m_module);
+            ErSend(&event);
+        }
+        for (size_t idx = 0; idx < a_events.size(); ++idx)
+        {
+            ErCallHandlers(ErReceive());
+        }
+        while (std::any_of(a_events.begin(), a_events.end(),
+                           [](ErEvent_t &a_event)
+                           { return ErEventIsInFlight(&a_event); }))
+        {
+            ErCallHandlers(ErReceive());
+        }
+    }
+
+    static std::atomic_bool s_gate_open;
+    static std::atomic_int s_work_done;
+    MockOptions m_options;
+};
+
+std::atomic_bool ErPosixOffloadTest::s_gate_open;
+std::atomic_int ErPosixOffloadTest::s_work_done;
+
+TEST_F(ErPosixOffloadTest, EventsReturnOnceTheirWorkIsDone)
+{
+    ASSERT_TRUE(ErOffloadStart(2, 4));
+    std::vector<ErEvent_t> events(3);
+    SendAndDeliver(events);
+
+    EXPECT_EQ(s_work_done, 3);
+    for (ErEvent_t &event : events)
+    {
+        EXPECT_FALSE(ErEventIsInFlight(&event));
+    }
+
+    ErOffloadStats_t stats;
+    ErGetOffloadStats(&stats);
+    EXPECT_EQ(stats.m_jobs, 3);
+    EXPECT_EQ(stats.m_waits, 0);
+    EXPECT_EQ(stats.m_queued, 0);
+    ErOffloadStop();
+}
+
+TEST_F(ErPosixOffloadTest, FullPoolMakesTheHandlerWait)
+{
+    // One worker stuck on the first item and one waiting item fill the pool,
+    // so the third handler has to wait, if the second didn't already; that is
+    // what opens the gate.
+    s_gate_open = false;
+    ASSERT_TRUE(ErOffloadStart(1, 1));
+    std::thread opener(
+        []()
+        {
+            ErOffloadStats_t stats = {};
+            while (stats.m_waits == 0)
+            {
+                std::this_thread::yield();
+                ErGetOffloadStats(&stats);
+            }
+            s_gate_open = true;
+        });
+
+    std::vector<ErEvent_t> events(3);
+    SendAndDeliver(events);
+    opener.join();
+
+    ErOffloadStats_t stats;
+    ErGetOffloadStats(&stats);
+    EXPECT_EQ(stats.m_jobs, 3);
+    EXPECT_GE(stats.m_waits, 1);
+    EXPECT_EQ(stats.m_peak_queued, 1);
+    ErOffloadStop();
+}
+
+TEST_F(ErPosixOffloadTest, WorkersNeverWaitForTheSendersQueue)
+{
+    // As above, the third handler waits for room. While it does, the task's
+    // queue fills up, so the worker can only finish its returns by parking
+    // them with the task.
+    static std::vector<ErEvent_t> s_fillers(16);
+    static ErQueue_t s_queue;
+    s_gate_open = false;
+    s_queue     = m_options.m_task.m_event_queue;
+    ASSERT_TRUE(ErOffloadStart(1, 1));
+    std::thread opener(
+        []()
+        {
+            ErOffloadStats_t stats = {};
+            while (stats.m_waits == 0)
+            {
+                std::this_thread::yield();
+                ErGetOffloadStats(&stats);
+            }
+            // Events on their way back to module A.
+            for (ErEvent_t &filler : s_fillers)
+            {
+                ErEventInit(&filler, ER_EVENT_TYPE__2,
+                            &MockModule<MockOptions::Module::A>::m_module);
+                filler.m_reference_count = 1;
+                if (!ErQueueTimedPushBack(s_queue, &filler, 0))
+                {
+                    filler.m_reference_count = 0;
+                }
+            }
+            s_gate_open = true;
+        });
+
+    std::vector<ErEvent_t> events(3);
+    SendAndDeliver(events);
+    opener.join();
+    while (std::any_of(s_fillers.begin(), s_fillers.end(),
+                       [](ErEvent_t &a_filler)
+                       { return ErEventIsInFlight(&a_filler); }))
+    {
+        ErCallHandlers(ErReceive());
+    }
+
+    ErOffloadStats_t stats;
+    ErGetOffloadStats(&stats);
+    EXPECT_EQ(stats.m_jobs, 3);
+    EXPECT_GE(stats.m_waits, 1);
+    ErOffloadStop();
+}
+
+//==============================================================================
+// Tests for `ErFanOutStart()` and friends
+//==============================================================================
+
+/// Module A sends to modules B and C, which are parallel-safe and wait for
+/// each other before they return. The test's own thread is the task.
+class ErPosixFanOutTest : public Test
+{
+   protected:
+    ErPosixFanOutTest()
+    {
+        MockModule<0>::Reset();
+        MockModule<1>::Reset();
+        MockModule<2>::Reset();
+        MockModule<0>::m_event_handler_ret = ER_EVENT_HANDLER_RET__HANDLED;
+        s_arrived = 0;
+        s_ret[0]  = ER_EVENT_HANDLER_RET__HANDLED;
+        s_ret[1]  = ER_EVENT_HANDLER_RET__HANDLED;
+        for (int idx = 0; idx < 2; ++idx)
+        {
+            m_modules[idx + 1]->m_handler       = Rendezvous;
+            m_modules[idx + 1]->m_context       = &s_ret[idx];
+            m_modules[idx + 1]->m_parallel_safe = true;
+        }
+        m_task.m_event_queue = ErQueueNew(4);
+        ErInit(&m_options);
+        ErSubscribe(m_modules[1], ER_EVENT_TYPE__1);
+        ErSubscribe(m_modules[2], ER_EVENT_TYPE__1);
+        ErEventInit(&m_event, ER_EVENT_TYPE__1, m_modules[0]);
+        EXPECT_TRUE(ErFanOutStart(1));
+    }
+    ~ErPosixFanOutTest()
+    {
+        ErFanOutStop();
+        ErDeinit();
+        ErQueueFree(m_task.m_event_queue);
+    }
+
+    static bool IsInIsr(void) { return false; }
+
+    /// Returns `*a_context` once both modules are running, or after a second
+    /// if they never are.
+    static ErEventHandlerRet_t Rendezvous(ErEvent_t *a_event, void *a_context)
+    {
+        ER_UNUSED(a_event);
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        s_arrived++;
+        while ((s_arrived < 2) && (std::chrono::steady_clock::now() < deadline))
+        {
+            std::this_thread::yield();
+        }
+        s_met = s_met && (s_arrived == 2);
+        return *(ErEventHandlerRet_t *)a_context;
+    }
+
+    static std::atomic_int s_arrived;
+    static std::atomic_bool s_met;
+    static ErEventHandlerRet_t s_ret[2];
+    ErModule_t *m_modules[3] = {
+        &MockModule<0>::m_module,
+        &MockModule<1>::m_module,
+        &MockModule<2>::m_module,
+    };
+    ErTask_t m_task{
+        .m_task_handle = pthread_self(),
+        .m_modules     = m_modules,
+        .m_num_modules = 3,
+    };
+    ErOptions_t m_options{
+        .m_tasks     = &m_task,
+        .m_num_tasks = 1,
+        .m_IsInIsr   = IsInIsr,
+    };
+    ErEvent_t m_event;
+};
+
+std::atomic_int ErPosixFanOutTest::s_arrived;
+std::atomic_bool ErPosixFanOutTest::s_met;
+ErEventHandlerRet_t ErPosixFanOutTest::s_ret[2];
+
+TEST_F(ErPosixFanOutTest, ParallelSafeModulesRunAtTheSameTime)
+{
+    s_met = true;
+    ErSend(&m_event);
+    ErCallHandlers(ErReceive());
+
+    EXPECT_TRUE(s_met);
+    EXPECT_FALSE(ErEventIsInFlight(&m_event));
+    EXPECT_EQ(MockModule<0>::m_last_event_handled, &m_event);
+}
+
+TEST_F(ErPosixFanOutTest, KeptEventsReturnOnlyOnceReleased)
+{
+    s_met    = true;
+    s_ret[1] = ER_EVENT_HANDLER_RET__KEPT;
+    ErSend(&m_event);
+    ErCallHandlers(ErReceive());
+
+    EXPECT_TRUE(s_met);
+    EXPECT_TRUE(ErEventIsInFlight(&m_event));
+    EXPECT_EQ(MockModule<0>::m_last_event_handled, nullptr);
+
+    ErReturnToSender(&m_event);
+    EXPECT_FALSE(ErEventIsInFlight(&m_event));
+    EXPECT_EQ(MockModule<0>::m_last_event_handled, &m_event);
+}
+
+//==============================================================================
+// Tests for `ErRouterNew()` and friends
+//==============================================================================
+
+/// A single task on the calling thread, with a queue and, unless it shares
+/// the default router, a router of its own. The runs below list their modules
+/// and call `Init()` once they are set up; destroying a run undoes whatever
+/// it did.
+class TaskRun
+{
+   public:
+    struct Payload
+    {
+        MIXIN_ER_EVENT;
+        int m_value;
+    };
+
+    static bool IsInIsr(void) { return false; }
+
+    /// Initializes the run's router and leaves the calling thread using it.
+    void Init()
+    {
+        ErRouterUse(m_router);
+        ErInit(&m_options);
+        m_initialized = true;
+    }
+
+    void HandleFor(int64_t a_ms)
+    {
+        ErEvent_t *event = ErTimedReceive(a_ms);
+        if (event != nullptr)
+        {
+            ErCallHandlers(event);
+        }
+    }
+
+    /// Handles events until none are waiting.
+    void HandlePending()
+    {
+        for (ErEvent_t *event = ErTimedReceive(0); event != nullptr;
+             event            = ErTimedReceive(0))
+        {
+            ErCallHandlers(event);
+        }
+    }
+
+    ErRouter_t *m_router;
+    ErTask_t m_task;
+    ErOptions_t m_options;
+
+   protected:
+    /// Only `Init()` looks at `a_modules`, so they can still be under
+    /// construction.
+    TaskRun(ErModule_t **a_modules, size_t a_num_modules,
+            size_t a_queue_length, bool a_own_router = true)
+        : m_router(a_own_router ? ErRouterNew() : nullptr),
+          m_task{
+              .m_task_handle = pthread_self(),
+              .m_event_queue = ErQueueNew(a_queue_length),
+              .m_modules     = a_modules,
+              .m_num_modules = a_num_modules,
+          },
+          m_options{
+              .m_tasks     = &m_task,
+              .m_num_tasks = 1,
+              .m_IsInIsr   = IsInIsr,
+          }
+    {
+    }
+
+    ~TaskRun()
+    {
+        if (m_initialized)
+        {
+            ErRouterUse(m_router);
+            ErDeinit();
+        }
+        ErRouterUse(nullptr);
+        ErRouterFree(m_router);
+        ErQueueFree(m_task.m_event_queue);
+    }
+
+   private:
+    bool m_initialized = false;
+};
+
+/// One module sends to another, and a third carries events to and from other
+/// shards once the run is part of one.
+struct RouterRun : TaskRun
+{
+    explicit RouterRun(bool a_own_router = true)
+        : TaskRun(m_modules, 3, 4, a_own_router)
+    {
+    }
+
+    static ErEventHandlerRet_t Deliver(ErEvent_t *a_event, void *a_context)
+    {
+        ER_UNUSED(a_event);
+        ((RouterRun *)a_context)->m_delivered++;
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    static ErEventHandlerRet_t Return(ErEvent_t *a_event, void *a_context)
+    {
+        ER_UNUSED(a_event);
+        ((RouterRun *)a_context)->m_returned++;
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    /// Initializes the router and sends `a_count` events through it.
+    void Run(int a_count)
+    {
+        Init();
+        ErSubscribe(&m_receiver, ER_EVENT_TYPE__1);
+        for (int idx = 0; idx < a_count; ++idx)
+        {
+            ErEventInit(&m_event, ER_EVENT_TYPE__1, &m_sender);
+            ErSend(&m_event);
+            ErCallHandlers(ErReceive());
+        }
+    }
+
+    int m_delivered = 0;
+    int m_returned  = 0;
+    ErEvent_t m_event;
+    ErModule_t m_sender   = ER_CREATE_MODULE(Return, this);
+    ErModule_t m_receiver = ER_CREATE_MODULE(Deliver, this);
+    ErModule_t m_shard    = ER_CREATE_MODULE(ErShardHandler, nullptr);
+    ErModule_t *m_modules[3] = {&m_sender, &m_receiver, &m_shard};
+};
+
+TEST(ErPosixRouter, ThreadsRouteIndependentlyThroughTheirOwnRouters)
+{
+    static constexpr int kSends = 1000;
+
+    std::vector<std::thread> threads;
+    for (int idx = 0; idx < 2; ++idx)
+    {
+        threads.emplace_back(
+            []()
+            {
+                RouterRun run;
+                ASSERT_NE(run.m_router, nullptr);
+                run.Run(kSends);
+                EXPECT_EQ(run.m_delivered, kSends);
+                EXPECT_EQ(run.m_returned, kSends);
+            });
+    }
+
+    // The default router runs alongside them.
+    RouterRun run(false);
+    run.Run(kSends);
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(run.m_delivered, kSends);
+    EXPECT_EQ(run.m_returned, kSends);
+}
+
+//==============================================================================
+// Tests for `ErShardsStart()` and friends
+//==============================================================================
+
+TEST(ErPosixShards, EventsVisitTheOtherShardAndComeBack)
+{
+    static constexpr int kSends = 1000;
+    static RouterRun *s_runs[2];
+    static std::atomic_int s_ready;
+    static std::atomic_int s_finished;
+    static std::atomic_int s_idle;
+    static std::atomic_bool s_started;
+    static std::atomic_bool s_stopped;
+
+    // Each shard sends to the other through mailboxes with room for 4, so
+    // most sends have to wait for earlier events to come back.
+    const auto shard = [](int a_shard)
+    {
+        RouterRun run;
+        s_runs[a_shard] = &run;
+        run.Init();
+        ErSubscribe(&run.m_receiver, ER_EVENT_TYPE__1);
+        std::vector<ErEvent_t> events(kSends);
+        for (ErEvent_t &event : events)
+        {
+            ErEventInit(&event, ER_EVENT_TYPE__1, &run.m_sender);
+        }
+
+        s_ready++;
+        while (!s_started)
+        {
+            std::this_thread::yield();
+        }
+        int sent     = 0;
+        bool counted = false;
+        while (s_finished < 2)
+        {
+            if ((sent < kSends) && ErShardSend(1 - a_shard, &events[sent]))
+            {
+                sent++;
+            }
+            ErEvent_t *event = ErTimedReceive(1);
+            if (event != nullptr)
+            {
+                ErCallHandlers(event);
+            }
+            if (!counted && (run.m_returned == kSends))
+            {
+                counted = true;
+                s_finished++;
+            }
+        }
+        s_idle++;
+        while (!s_stopped)
+        {
+            std::this_thread::yield();
+        }
+
+        EXPECT_EQ(run.m_delivered, kSends);
+        EXPECT_EQ(run.m_returned, kSends);
+        for (ErEvent_t &event : events)
+        {
+            EXPECT_FALSE(ErEventIsInFlight(&event));
+        }
+    };
+
+    std::thread threads[2] = {std::thread(shard, 0), std::thread(shard, 1)};
+    while (s_ready < 2)
+    {
+        std::this_thread::yield();
+    }
+    const ErShard_t shards[2] = {
+        {.m_router = s_runs[0]->m_router, .m_module = &s_runs[0]->m_shard},
+        {.m_router = s_runs[1]->m_router, .m_module = &s_runs[1]->m_shard},
+    };
+    ErShards_t *joined = ErShardsStart(shards, 2, 4, ER_EVENT_TYPE__5);
+    ASSERT_NE(joined, nullptr);
+    s_started = true;
+
+    while (s_idle < 2)
+    {
+        std::this_thread::yield();
+    }
+    ErShardsStop(joined);
+    s_stopped = true;
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+TEST(ErPosixShards, SendsNeverWaitForABusyShard)
+{
+    // One thread plays both shards, switching routers between them. Shard 1
+    // receives in the lane of its wakeups, so they find the lane full too.
+    RouterRun runs[2];
+    uint8_t lanes[ER_EVENT_TYPE__COUNT] = {};
+    lanes[ER_EVENT_TYPE__1 - ER_EVENT_TYPE__FIRST] = ER_PRIORITY_LANES - 1;
+    runs[1].m_options.m_type_lanes = lanes;
+    ErRouter_t *routers[2];
+    for (int idx = 0; idx < 2; ++idx)
+    {
+        runs[idx].Init();
+        ErSubscribe(&runs[idx].m_receiver, ER_EVENT_TYPE__1);
+        routers[idx] = runs[idx].m_router;
+    }
+    const ErShard_t shards[2] = {
+        {.m_router = routers[0], .m_module = &runs[0].m_shard},
+        {.m_router = routers[1], .m_module = &runs[1].m_shard},
+    };
+    ErShards_t *joined = ErShardsStart(shards, 2, 4, ER_EVENT_TYPE__5);
+    ASSERT_NE(joined, nullptr);
+
+    // Fill shard 1's queue with its own events.
+    ErRouterUse(routers[1]);
+    ErEvent_t fillers[4];
+    for (ErEvent_t &filler : fillers)
+    {
+        ErEventInit(&filler, ER_EVENT_TYPE__1, &runs[1].m_sender);
+        ErSend(&filler);
+    }
+
+    ErRouterUse(routers[0]);
+    ErEvent_t event;
+    ErEventInit(&event, ER_EVENT_TYPE__1, &runs[0].m_sender);
+    ASSERT_TRUE(ErShardSend(1, &event));
+
+    // Shard 1 works through its queue before it reads any mail, which it has
+    // to send on to its receiver through that queue. The event then comes
+    // back through shard 0's.
+    ErRouterUse(routers[1]);
+    for (size_t idx = 0; idx < 4; ++idx)
+    {
+        ErCallHandlers(ErQueuePopFront(runs[1].m_task.m_event_queue));
+    }
+    while (ErEventIsInFlight(&event))
+    {
+        for (int idx = 1; idx >= 0; --idx)
+        {
+            ErRouterUse(routers[idx]);
+            runs[idx].HandlePending();
+        }
+    }
+    EXPECT_EQ(runs[1].m_delivered, 5);
+    EXPECT_EQ(runs[1].m_returned, 4);
+    EXPECT_EQ(runs[0].m_returned, 1);
+
+    ErShardsStop(joined);
+}
+
+//==============================================================================
+// Tests for `ErShmBridgeStart()`, `ErSocketBridgeStart()`, and friends
+//==============================================================================
+
+/// One side of a bridge: a sender, a receiver, and the bridge modules, all in
+/// one task owned by the thread that creates it. The side with index `i`
+/// sends `ER_EVENT_TYPE__1 + i`, and receives what the other sends.
+struct BridgeRun : TaskRun
+{
+    static constexpr int kSends    = 1000;
+    static constexpr int kInFlight = 4;
+
+    // The importer sends every slot that has arrived at once.
+    BridgeRun(ErEventHandler_t a_export, ErEventHandler_t a_import,
+              size_t a_side)
+        : TaskRun(m_modules, 4, 2 * kInFlight),
+          m_sent_type((ErEventType_t)(ER_EVENT_TYPE__1 + (int)a_side)),
+          m_events(kSends)
+    {
+        m_exporter.m_handler = a_export;
+        m_importer.m_handler = a_import;
+        Init();
+        ErSubscribe(&m_receiver,
+                    (ErEventType_t)(ER_EVENT_TYPE__2 - (int)a_side));
+        m_sizes[ER_EVENT_TYPE__1 - ER_EVENT_TYPE__FIRST] = sizeof(Payload);
+        m_sizes[ER_EVENT_TYPE__2 - ER_EVENT_TYPE__FIRST] = sizeof(Payload);
+    }
+
+    static ErEventHandlerRet_t Deliver(ErEvent_t *a_event, void *a_context)
+    {
+        BridgeRun *run  = (BridgeRun *)a_context;
+        run->m_sum     += FROM_ER_EVENT(a_event, Payload).m_value;
+        run->m_delivered++;
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    static ErEventHandlerRet_t Return(ErEvent_t *a_event, void *a_context)
+    {
+        ER_UNUSED(a_event);
+        ((BridgeRun *)a_context)->m_returned++;
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    /// Returns whether the exporter has learned that the other side wants
+    /// what this one sends.
+    bool IsExporting() const
+    {
+        const size_t bit = m_sent_type - ER_EVENT_TYPE__FIRST;
+        return (m_exporter.m_subscriptions[bit / CHAR_BIT] &
+                (1u << (bit % CHAR_BIT))) != 0;
+    }
+
+    /// Waits for the other side to get here too, handling events meanwhile.
+    void Meet(std::atomic_int &a_count)
+    {
+        a_count++;
+        while (a_count < 2)
+        {
+            HandleFor(1);
+        }
+    }
+
+    /// Sends `kSends` events, at most `kInFlight` at a time, and handles
+    /// events until both sides have theirs back and the other side's.
+    void Exchange(std::atomic_int &a_finished)
+    {
+        int sent     = 0;
+        bool counted = false;
+        while (a_finished < 2)
+        {
+            if ((sent < kSends) && ((sent - m_returned) < kInFlight))
+            {
+                ErEventInit(TO_ER_EVENT(m_events[sent]), m_sent_type,
+                            &m_sender);
+                m_events[sent].m_value = sent + 1;
+                ErSend(TO_ER_EVENT(m_events[sent]));
+                sent++;
+            }
+            HandleFor(1);
+            if (!counted && (m_returned == kSends) && (m_delivered == kSends))
+            {
+                counted = true;
+                a_finished++;
+            }
+        }
+    }
+
+    /// Handles whatever the bridge left behind, and checks what arrived.
+    void Check()
+    {
+        HandlePending();
+        EXPECT_EQ(m_delivered, kSends);
+        EXPECT_EQ(m_returned, kSends);
+        EXPECT_EQ(m_sum, (int64_t)kSends * (kSends + 1) / 2);
+        for (Payload &event : m_events)
+        {
+            EXPECT_FALSE(ErEventIsInFlight(TO_ER_EVENT(event)));
+        }
+    }
+
+    int m_delivered = 0;
+    int m_returned  = 0;
+    int64_t m_sum   = 0;
+    ErEventType_t m_sent_type;
+    std::vector<Payload> m_events;
+    size_t m_sizes[ER_EVENT_TYPE__COUNT] = {};
+    ErModule_t m_sender   = ER_CREATE_MODULE(Return, this);
+    ErModule_t m_receiver = ER_CREATE_MODULE(Deliver, this);
+    ErModule_t m_exporter = ER_CREATE_MODULE(nullptr, nullptr);
+    ErModule_t m_importer = ER_CREATE_MODULE(nullptr, nullptr);
+    ErModule_t *m_modules[4] = {&m_sender, &m_receiver, &m_exporter,
+                                &m_importer};
+};
+
+/// Runs process `a_process` of a bridge through the object `a_name`, and has
+/// it exchange `BridgeRun::kSends` events with the other. `a_meetings` points
+/// at four counters, one for each point where the processes wait for each
+/// other.
+static void ExchangeOverShm(const char *a_name, size_t a_process,
+                            std::atomic_int *a_meetings)
+{
+    BridgeRun run(ErShmExportHandler, ErShmImportHandler, a_process);
+    const ErShmBridgeOptions_t options = {
+        .m_name        = a_name,
+        .m_process     = a_process,
+        .m_exporter    = &run.m_exporter,
+        .m_importer    = &run.m_importer,
+        .m_mail_type   = ER_EVENT_TYPE__5,
+        .m_event_sizes = run.m_sizes,
+        .m_num_slots   = BridgeRun::kInFlight,
+        .m_slot_size   = sizeof(BridgeRun::Payload),
+        .m_poll_ms     = 10,
+    };
+    ErShmBridge_t *bridge = ErShmBridgeStart(&options);
+    ASSERT_NE(bridge, nullptr);
+
+    // Publish this process's subscriptions, then pick up the other's.
+    run.Meet(a_meetings[0]);
+    ErShmBridgeSync(bridge);
+    run.Meet(a_meetings[1]);
+    ErShmBridgeSync(bridge);
+
+    run.Exchange(a_meetings[2]);
+    // The other process may still be taking its last events back.
+    run.Meet(a_meetings[3]);
+    EXPECT_EQ(ErShmBridgeGetDropCount(bridge), 0u);
+    ErShmBridgeStop(bridge);
+    run.Check();
+}
+
+TEST(ErPosixShmBridge, EventsReachTheOtherProcessAndComeBack)
+{
+    // Threads with routers of their own stand in for the processes; nothing
+    // but the object's name passes between them.
+    const std::string name =
+        "/er_shm_bridge_test_" + std::to_string(getpid());
+    std::atomic_int meetings[4] = {};
+    std::thread threads[2]      = {
+        std::thread(ExchangeOverShm, name.c_str(), 0, meetings),
+        std::thread(ExchangeOverShm, name.c_str(), 1, meetings),
+    };
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    // The last process to stop removes the object.
+    EXPECT_LT(shm_open(name.c_str(), O_RDWR, 0600), 0);
+}
+
+TEST(ErPosixShmBridge, EventsReachAForkedProcessAndComeBack)
+{
+    const std::string name =
+        "/er_shm_bridge_fork_test_" + std::to_string(getpid());
+
+    // Only the meeting counters are shared besides the object itself.
+    void *mapping = mmap(NULL, sizeof(std::atomic_int[4]),
+                         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                         -1, 0);
+    ASSERT_NE(mapping, MAP_FAILED);
+    std::atomic_int *meetings = new (mapping) std::atomic_int[4]{};
+
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0)
+    {
+        ExchangeOverShm(name.c_str(), 1, meetings);
+        _exit(Test::HasFailure() ? 1 : 0);
+    }
+
+    ExchangeOverShm(name.c_str(), 0, meetings);
+    int status = 0;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    munmap(mapping, sizeof(std::atomic_int[4]));
+
+    EXPECT_LT(shm_open(name.c_str(), O_RDWR, 0600), 0);
+}
+
+/// Runs a bridge on each end of a connected pair of sockets, and has each
+/// side exchange `BridgeRun::kSends` events with the other.
+static void ExchangeOverSockets(const int (&a_sockets)[2])
+{
+    std::atomic_int synced{0};
+    std::atomic_int finished{0};
+    std::atomic_int idle{0};
+
+    // One side's type travels as it is, and the other's through the
+    // serializer registry.
+    static constexpr ErSerializer_t kEncoded = {
+        .m_size = sizeof(BridgeRun::Payload),
+        .m_encode =
+            [](const ErEvent_t *a_event, uint8_t *a_buffer, size_t a_size)
+        {
+            const auto *payload = (const BridgeRun::Payload *)a_event;
+            if (a_size >= sizeof(payload->m_value))
+            {
+                memcpy(a_buffer, &payload->m_value, sizeof(payload->m_value));
+            }
+            return sizeof(payload->m_value);
+        },
+        .m_decode = [](ErEvent_t *a_event, const uint8_t *a_bytes,
+                       size_t a_size)
+        {
+            auto *payload = (BridgeRun::Payload *)a_event;
+            if (a_size != sizeof(payload->m_value))
+            {
+                return false;
+            }
+            memcpy(&payload->m_value, a_bytes, sizeof(payload->m_value));
+            return true;
+        },
+    };
+    ErSerializerRegister(ER_EVENT_TYPE__2, &kEncoded);
+
+    const auto peer = [&](size_t a_side)
+    {
+        BridgeRun run(ErSocketExportHandler, ErSocketImportHandler, a_side);
+        const ErSocketBridgeOptions_t options = {
+            .m_socket      = a_sockets[a_side],
+            .m_exporter    = &run.m_exporter,
+            .m_importer    = &run.m_importer,
+            .m_mail_type   = ER_EVENT_TYPE__5,
+            .m_event_sizes = run.m_sizes,
+            .m_num_slots   = BridgeRun::kInFlight,
+            .m_slot_size   = sizeof(BridgeRun::Payload),
+            .m_poll_ms     = 10,
+        };
+        ErSocketBridge_t *bridge = ErSocketBridgeStart(&options);
+        ASSERT_NE(bridge, nullptr);
+
+        // Send this side's subscriptions, and wait for the other's.
+        ErSocketBridgeSync(bridge);
+        while (!run.IsExporting())
+        {
+            run.HandleFor(1);
+        }
+        run.Meet(synced);
+
+        run.Exchange(finished);
+        run.Meet(idle);
+        EXPECT_EQ(ErSocketBridgeGetDropCount(bridge), 0u);
+        EXPECT_FALSE(ErSocketBridgeIsBroken(bridge));
+        ErSocketBridgeStop(bridge);
+        run.Check();
+    };
+
+    std::thread threads[2] = {std::thread(peer, 0), std::thread(peer, 1)};
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    ErSerializerRegister(ER_EVENT_TYPE__2, nullptr);
+}
+
+TEST(ErPosixSocketBridge, EventsReachThePeerAndComeBack)
+{
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    ExchangeOverSockets(sockets);
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+TEST(ErPosixSocketBridge, EventsCrossATcpConnection)
+{
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(listener, 0);
+    struct sockaddr_in address = {};
+    address.sin_family         = AF_INET;
+    address.sin_addr.s_addr    = htonl(INADDR_LOOPBACK);
+    socklen_t length           = sizeof(address);
+    ASSERT_EQ(bind(listener, (struct sockaddr *)&address, length), 0);
+    ASSERT_EQ(listen(listener, 1), 0);
+    ASSERT_EQ(getsockname(listener, (struct sockaddr *)&address, &length), 0);
+
+    int sockets[2];
+    sockets[0] = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(sockets[0], 0);
+    ASSERT_EQ(connect(sockets[0], (struct sockaddr *)&address, length), 0);
+    sockets[1] = accept(listener, nullptr, nullptr);
+    ASSERT_GE(sockets[1], 0);
+    close(listener);
+
+    // Small frames mustn't wait for more to join them.
+    const int on = 1;
+    for (int socket : sockets)
+    {
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    ExchangeOverSockets(sockets);
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+TEST(ErPosixSocketBridge, EventsWithAPeerThatHangsUpComeBack)
+{
+    static int s_sockets[2];
+    static std::atomic_int s_synced;
+    static std::atomic_bool s_sent;
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, s_sockets), 0);
+
+    // Side 1 takes side 0's events, but hangs up instead of returning them.
+    const auto peer = [](size_t a_side)
+    {
+        BridgeRun run(ErSocketExportHandler, ErSocketImportHandler, a_side);
+        const ErSocketBridgeOptions_t options = {
+            .m_socket      = s_sockets[a_side],
+            .m_exporter    = &run.m_exporter,
+            .m_importer    = &run.m_importer,
+            .m_mail_type   = ER_EVENT_TYPE__5,
+            .m_event_sizes = run.m_sizes,
+            .m_num_slots   = BridgeRun::kInFlight,
+            .m_slot_size   = sizeof(BridgeRun::Payload),
+            .m_poll_ms     = 10,
+        };
+        ErSocketBridge_t *bridge = ErSocketBridgeStart(&options);
+        ASSERT_NE(bridge, nullptr);
+        ErSocketBridgeSync(bridge);
+        if (a_side == 1)
+        {
+            run.Meet(s_synced);
+            while (!s_sent)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            // Hang up first, so that the events go back to no one, and then
+            // let go of them.
+            shutdown(s_sockets[1], SHUT_RDWR);
+            while (!ErSocketBridgeIsBroken(bridge))
+            {
+                run.HandleFor(1);
+            }
+            run.HandlePending();
+            ErSocketBridgeStop(bridge);
+            return;
+        }
+
+        while (!run.IsExporting())
+        {
+            run.HandleFor(1);
+        }
+        run.Meet(s_synced);
+        for (int idx = 0; idx < BridgeRun::kInFlight; ++idx)
+        {
+            ErEventInit(TO_ER_EVENT(run.m_events[idx]), run.m_sent_type,
+                        &run.m_sender);
+            ErSend(TO_ER_EVENT(run.m_events[idx]));
+            run.HandleFor(0);
+        }
+        s_sent = true;
+
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while ((run.m_returned < BridgeRun::kInFlight) &&
+               (std::chrono::steady_clock::now() < deadline))
+        {
+            run.HandleFor(1);
+        }
+        EXPECT_EQ(run.m_returned, BridgeRun::kInFlight);
+        EXPECT_TRUE(ErSocketBridgeIsBroken(bridge));
+        EXPECT_EQ(ErSocketBridgeGetDropCount(bridge), 0u);
+
+        // Anything sent now comes straight back.
+        ErEvent_t *late = TO_ER_EVENT(run.m_events[BridgeRun::kInFlight]);
+        ErEventInit(late, run.m_sent_type, &run.m_sender);
+        ErSend(late);
+        while (ErEventIsInFlight(late))
+        {
+            run.HandleFor(1);
+        }
+        EXPECT_EQ(ErSocketBridgeGetDropCount(bridge), 1u);
+        ErSocketBridgeStop(bridge);
+    };
+
+    std::thread threads[2] = {std::thread(peer, 0), std::thread(peer, 1)};
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    close(s_sockets[0]);
+    close(s_sockets[1]);
+}
+
+TEST(ErPosixSocketBridge, EventsComeBackOnceTheWriterLetsGoOfThem)
+{
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+
+    // Fill side 0's socket so that its writer blocks; the peer won't read
+    // until the bridge breaks.
+    const int flags = fcntl(sockets[0], F_GETFL);
+    ASSERT_EQ(fcntl(sockets[0], F_SETFL, flags | O_NONBLOCK), 0);
+    const uint8_t filler[4096] = {};
+    size_t filled              = 0;
+    for (ssize_t written; (written = write(sockets[0], filler,
+                                           sizeof(filler))) > 0;)
+    {
+        filled += written;
+    }
+    ASSERT_EQ(fcntl(sockets[0], F_SETFL, flags), 0);
+
+    BridgeRun run(ErSocketExportHandler, ErSocketImportHandler, 0);
+    const ErSocketBridgeOptions_t options = {
+        .m_socket      = sockets[0],
+        .m_exporter    = &run.m_exporter,
+        .m_importer    = &run.m_importer,
+        .m_mail_type   = ER_EVENT_TYPE__5,
+        .m_event_sizes = run.m_sizes,
+        .m_num_slots   = BridgeRun::kInFlight,
+        .m_slot_size   = sizeof(BridgeRun::Payload),
+        .m_poll_ms     = 10,
+    };
+    ErSocketBridge_t *bridge = ErSocketBridgeStart(&options);
+    ASSERT_NE(bridge, nullptr);
+
+    // The peer's frames are written by hand, as socket_bridge_posix.c lays
+    // them out: a header of kind, type, slot, and size, then the payload.
+    enum : uint32_t
+    {
+        kDeliver = 1,
+        kWants   = 3,
+        kBogus   = 99,
+    };
+    const size_t bit = run.m_sent_type - ER_EVENT_TYPE__FIRST;
+    std::vector<uint8_t> wants(
+        (ER_EVENT_TYPE__COUNT + (CHAR_BIT - 1)) / CHAR_BIT);
+    wants[bit / CHAR_BIT]   |= 1u << (bit % CHAR_BIT);
+    const uint32_t header[4] = {kWants, 0, 0, (uint32_t)wants.size()};
+    ASSERT_EQ(write(sockets[1], header, sizeof(header)),
+              (ssize_t)sizeof(header));
+    ASSERT_EQ(write(sockets[1], wants.data(), wants.size()),
+              (ssize_t)wants.size());
+    while (!run.IsExporting())
+    {
+        run.HandleFor(1);
+    }
+    for (int idx = 0; idx < BridgeRun::kInFlight; ++idx)
+    {
+        ErEventInit(TO_ER_EVENT(run.m_events[idx]), run.m_sent_type,
+                    &run.m_sender);
+        run.m_events[idx].m_value = idx + 1;
+        ErSend(TO_ER_EVENT(run.m_events[idx]));
+        run.HandleFor(0);
+    }
+
+    // A frame that makes no sense breaks the bridge while the writer waits.
+    const uint32_t bogus[4] = {kBogus, 0, 0, 0};
+    ASSERT_EQ(write(sockets[1], bogus, sizeof(bogus)), (ssize_t)sizeof(bogus));
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ((run.m_returned < BridgeRun::kInFlight) &&
+           (std::chrono::steady_clock::now() < deadline))
+    {
+        run.HandleFor(1);
+    }
+    EXPECT_EQ(run.m_returned, BridgeRun::kInFlight);
+    EXPECT_TRUE(ErSocketBridgeIsBroken(bridge));
+
+    // Senders may reuse their events now, and none of that reaches the peer.
+    for (int idx = 0; idx < BridgeRun::kInFlight; ++idx)
+    {
+        run.m_events[idx].m_value = -1;
+    }
+    std::vector<uint8_t> received;
+    bool closed = false;
+    for (struct pollfd poll_fd = {.fd = sockets[1], .events = POLLIN};
+         !closed && (poll(&poll_fd, 1, 1000) > 0);)
+    {
+        uint8_t buffer[4096];
+        const ssize_t count = read(sockets[1], buffer, sizeof(buffer));
+        closed              = (count <= 0);
+        received.insert(received.end(), buffer,
+                        buffer + std::max<ssize_t>(count, 0));
+    }
+    EXPECT_TRUE(closed);
+
+    // Frames after the filler; the last may have been cut short.
+    const size_t value_offset =
+        offsetof(BridgeRun::Payload, m_value) - sizeof(ErEvent_t);
+    size_t offset = filled;
+    while (offset + sizeof(header) <= received.size())
+    {
+        uint32_t frame[4];
+        memcpy(frame, &received[offset], sizeof(frame));
+        offset += sizeof(frame);
+        if ((frame[0] == kDeliver) && (offset + frame[3] <= received.size()))
+        {
+            int value;
+            memcpy(&value, &received[offset + value_offset], sizeof(value));
+            EXPECT_NE(value, -1);
+        }
+        offset += frame[3];
+    }
+
+    ErSocketBridgeStop(bridge);
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+//==============================================================================
+// Tests for `ErCaptureStart()`, `ErReplayStart()`, and friends
+//==============================================================================
+
+/// A module that sends `ER_EVENT_TYPE__1`, one that receives it, and one that
+/// replays captures.
+struct CaptureRun : TaskRun
+{
+    static constexpr int kSlots = 4;
+
+    CaptureRun() : TaskRun(m_modules, 3, 2 * kSlots)
+    {
+        Init();
+        ErSubscribe(&m_receiver, ER_EVENT_TYPE__1);
+    }
+
+    static ErEventHandlerRet_t Deliver(ErEvent_t *a_event, void *a_context)
+    {
+        ((CaptureRun *)a_context)
+            ->m_values.push_back(FROM_ER_EVENT(a_event, Payload).m_value);
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    static ErEventHandlerRet_t Return(ErEvent_t *a_event, void *a_context)
+    {
+        ER_UNUSED(a_event);
+        ((CaptureRun *)a_context)->m_returned++;
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    /// Sends an event of `a_type` and handles events until it is back.
+    void SendAndWait(ErEventType_t a_type, int a_value)
+    {
+        ErEventInit(TO_ER_EVENT(m_event), a_type, &m_sender);
+        m_event.m_value    = a_value;
+        const int returned = m_returned;
+        ErSend(TO_ER_EVENT(m_event));
+        while (m_returned == returned)
+        {
+            HandleFor(1);
+        }
+    }
+
+    /// Replays `a_path` at `a_speedup` until every event is back, and returns
+    /// the number of records skipped.
+    uint64_t Replay(const std::string &a_path, uint32_t a_speedup)
+    {
+        const ErReplayOptions_t options = {
+            .m_path      = a_path.c_str(),
+            .m_module    = &m_replayer,
+            .m_mail_type = ER_EVENT_TYPE__5,
+            .m_num_slots = kSlots,
+            .m_slot_size = sizeof(Payload),
+            .m_speedup   = a_speedup,
+        };
+        ErReplay_t *replay = ErReplayStart(&options);
+        EXPECT_NE(replay, nullptr);
+        if (replay == nullptr)
+        {
+            return 0;
+        }
+        while (!ErReplayIsDone(replay))
+        {
+            HandleFor(1);
+        }
+        const uint64_t skips = ErReplayGetSkipCount(replay);
+        ErReplayStop(replay);
+        return skips;
+    }
+
+    Payload m_event;
+    int m_returned = 0;
+    std::vector<int> m_values;
+    ErModule_t m_sender   = ER_CREATE_MODULE(Return, this);
+    ErModule_t m_receiver = ER_CREATE_MODULE(Deliver, this);
+    ErModule_t m_replayer = ER_CREATE_MODULE(ErReplayHandler, nullptr);
+    ErModule_t *m_modules[3] = {&m_sender, &m_receiver, &m_replayer};
+};
+
+class ErPosixCaptureTest : public Test
+{
+   protected:
+    ErPosixCaptureTest()
+    {
+        char directory[] = "/tmp/er_capture_test_XXXXXX";
+        EXPECT_NE(mkdtemp(directory), nullptr);
+        m_directory = directory;
+        m_path      = m_directory + "/capture";
+        static constexpr ErSerializer_t kPod =
+            ER_POD_SERIALIZER(TaskRun::Payload);
+        ErSerializerRegister(ER_EVENT_TYPE__1, &kPod);
+    }
+
+    ~ErPosixCaptureTest() override
+    {
+        ErSerializerRegister(ER_EVENT_TYPE__1, nullptr);
+        unlink(m_path.c_str());
+        rmdir(m_directory.c_str());
+    }
+
+    std::string m_directory;
+    std::string m_path;
+};
+
+TEST_F(ErPosixCaptureTest, ReplaySendsEventsInOrderAtTheirPace)
+{
+    constexpr int kEvents = 20;
+    constexpr auto kGap   = std::chrono::milliseconds(50);
+    std::vector<int> expected;
+    {
+        CaptureRun run;
+        ASSERT_TRUE(ErCaptureStart(m_path.c_str(), 64 * 1024));
+        for (int idx = 0; idx < kEvents; ++idx)
+        {
+            if (idx == (kEvents / 2))
+            {
+                std::this_thread::sleep_for(kGap);
+            }
+            run.SendAndWait(ER_EVENT_TYPE__1, idx);
+            expected.push_back(idx);
+        }
+        // Types outside the serializer registry aren't captured.
+        run.SendAndWait(ER_EVENT_TYPE__3, -1);
+        EXPECT_EQ(ErCaptureStop(), 0u);
+        EXPECT_EQ(run.m_values, expected);
+    }
+
+    CaptureRun paced;
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(paced.Replay(m_path, 1), 0u);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, kGap);
+    EXPECT_EQ(paced.m_values, expected);
+}
+
+TEST_F(ErPosixCaptureTest, EventsThatDontFitAreDropped)
+{
+    std::vector<int> expected;
+    {
+        CaptureRun run;
+        // Room for a few entries of a header, a short record, and padding.
+        ASSERT_TRUE(ErCaptureStart(m_path.c_str(), 3 * 32));
+        for (int idx = 0; idx < 10; ++idx)
+        {
+            run.SendAndWait(ER_EVENT_TYPE__1, idx);
+        }
+        const uint64_t drops = ErCaptureStop();
+        EXPECT_GT(drops, 0u);
+        for (int idx = 0; idx < (int)(10 - drops); ++idx)
+        {
+            expected.push_back(idx);
+        }
+    }
+
+    CaptureRun fast;
+    EXPECT_EQ(fast.Replay(m_path, 0), 0u);
+    EXPECT_EQ(fast.m_values, expected);
+}
+
+//==============================================================================
+// Tests for `ErDurableLogStart()` and friends
+//==============================================================================
+
+/// A durable log, and a module that receives what it delivers.
+struct DurableRun : TaskRun
+{
+    static constexpr int kSlots = 4;
+
+    DurableRun(const std::string &a_directory, size_t a_segment_size)
+        : TaskRun(m_modules, 2, 2 * kSlots)
+    {
+        Init();
+        ErSubscribe(&m_receiver, ER_EVENT_TYPE__1);
+        const ErDurableLogOptions_t options = {
+            .m_directory    = a_directory.c_str(),
+            .m_module       = &m_deliverer,
+            .m_mail_type    = ER_EVENT_TYPE__5,
+            .m_num_slots    = kSlots,
+            .m_slot_size    = sizeof(Payload),
+            .m_segment_size = a_segment_size,
+            .m_max_pending  = 64 * 1024,
+        };
+        m_log = ErDurableLogStart(&options);
+        EXPECT_NE(m_log, nullptr);
+    }
+
+    ~DurableRun()
+    {
+        if (m_log != nullptr)
+        {
+            ErDurableLogStop(m_log);
+        }
+    }
+
+    static ErEventHandlerRet_t Deliver(ErEvent_t *a_event, void *a_context)
+    {
+        ((DurableRun *)a_context)
+            ->m_values.push_back(FROM_ER_EVENT(a_event, Payload).m_value);
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    /// Appends events with the values `a_first` to `a_last` and waits until
+    /// they are on disk, without delivering any.
+    void AppendAndCommit(int a_first, int a_last)
+    {
+        uint64_t sequence = 0;
+        for (int value = a_first; value <= a_last; ++value)
+        {
+            Payload event;
+            ErEventInit(TO_ER_EVENT(event), ER_EVENT_TYPE__1, nullptr);
+            event.m_value = value;
+            sequence      = ErDurableAppend(m_log, TO_ER_EVENT(event));
+            ASSERT_NE(sequence, 0u);
+        }
+        while (ErDurableLogGetCommitted(m_log) < sequence)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    /// Handles events until everything on disk is delivered and back.
+    void Drain()
+    {
+        do
+        {
+            HandleFor(1);
+        } while (!ErDurableLogIsIdle(m_log));
+    }
+
+    ErDurableLog_t *m_log;
+    std::vector<int> m_values;
+    ErModule_t m_receiver  = ER_CREATE_MODULE(Deliver, this);
+    ErModule_t m_deliverer = ER_CREATE_MODULE(ErDurableLogHandler, nullptr);
+    ErModule_t *m_modules[2] = {&m_receiver, &m_deliverer};
+};
+
+class ErPosixDurableLogTest : public Test
+{
+   protected:
+    ErPosixDurableLogTest()
+    {
+        char directory[] = "/tmp/er_durable_log_test_XXXXXX";
+        EXPECT_NE(mkdtemp(directory), nullptr);
+        m_directory = directory;
+        static constexpr ErSerializer_t kPod =
+            ER_POD_SERIALIZER(TaskRun::Payload);
+        ErSerializerRegister(ER_EVENT_TYPE__1, &kPod);
+    }
+
+    ~ErPosixDurableLogTest() override
+    {
+        ErSerializerRegister(ER_EVENT_TYPE__1, nullptr);
+        for (const std::string &name : Segments())
+        {
+            unlink((m_directory + "/" + name).c_str());
+        }
+        rmdir(m_directory.c_str());
+    }
+
+    std::vector<std::string> Segments() const
+    {
+        std::vector<std::string> names;
+        DIR *directory = opendir(m_directory.c_str());
+        for (dirent *file = readdir(directory); file != nullptr;
+             file         = readdir(directory))
+        {
+            if (file->d_name[0] != '.')
+            {
+                names.push_back(file->d_name);
+            }
+        }
+        closedir(directory);
+        return names;
+    }
+
+    std::string m_directory;
+};
+
+TEST_F(ErPosixDurableLogTest, UnacknowledgedEntriesAreDeliveredAfterRestart)
+{
+    std::vector<int> expected;
+    {
+        // The log's module never runs, as though the process died first.
+        DurableRun run(m_directory, 1024 * 1024);
+        run.AppendAndCommit(0, 9);
+        EXPECT_TRUE(run.m_values.empty());
+    }
+    {
+        DurableRun run(m_directory, 1024 * 1024);
+        run.AppendAndCommit(10, 14);
+        run.Drain();
+        for (int value = 0; value < 15; ++value)
+        {
+            expected.push_back(value);
+        }
+        EXPECT_EQ(run.m_values, expected);
+        EXPECT_EQ(ErDurableLogGetSkipCount(run.m_log), 0u);
+    }
+    {
+        DurableRun run(m_directory, 1024 * 1024);
+        run.AppendAndCommit(15, 15);
+        run.Drain();
+        EXPECT_EQ(run.m_values, std::vector<int>{15});
+    }
+}
+
+TEST_F(ErPosixDurableLogTest, AcknowledgedSegmentsAreDeleted)
+{
+    // Every batch fills a segment.
+    DurableRun run(m_directory, 1);
+    for (int value = 0; value < 10; ++value)
+    {
+        run.AppendAndCommit(value, value);
+    }
+    EXPECT_GT(Segments().size(), 5u);
+
+    run.Drain();
+    EXPECT_EQ(run.m_values.size(), 10u);
+    ErDurableLogStop(run.m_log);
+    run.m_log = nullptr;
+    EXPECT_EQ(Segments().size(), 1u);
+}
+
+TEST_F(ErPosixDurableLogTest, WriteErrorsAreReported)
+{
+    {
+        DurableRun run(m_directory, 1024 * 1024);
+        run.AppendAndCommit(0, 4);
+        EXPECT_EQ(ErDurableLogGetError(run.m_log), 0);
+
+        // Writes past the file size limit fail instead of raising SIGXFSZ.
+        struct rlimit limit;
+        ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &limit), 0);
+        struct rlimit lowered = limit;
+        lowered.rlim_cur      = 1;
+        ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &lowered), 0);
+        const sighandler_t previous = signal(SIGXFSZ, SIG_IGN);
+
+        TaskRun::Payload event;
+        ErEventInit(TO_ER_EVENT(event), ER_EVENT_TYPE__1, nullptr);
+        event.m_value = 5;
+        EXPECT_NE(ErDurableAppend(run.m_log, TO_ER_EVENT(event)), 0u);
+        while (ErDurableLogGetError(run.m_log) == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        EXPECT_EQ(ErDurableLogGetError(run.m_log), EFBIG);
+        EXPECT_EQ(ErDurableAppend(run.m_log, TO_ER_EVENT(event)), 0u);
+
+        setrlimit(RLIMIT_FSIZE, &limit);
+        signal(SIGXFSZ, previous);
+
+        // What reached the disk is still delivered, but can't be
+        // acknowledged.
+        run.Drain();
+        EXPECT_EQ(run.m_values, (std::vector<int>{0, 1, 2, 3, 4}));
+    }
+    {
+        DurableRun run(m_directory, 1024 * 1024);
+        EXPECT_EQ(ErDurableLogGetError(run.m_log), 0);
+        run.AppendAndCommit(6, 6);
+        run.Drain();
+        EXPECT_EQ(run.m_values, (std::vector<int>{0, 1, 2, 3, 4, 6}));
+    }
+}
+
+}  // namespace testing
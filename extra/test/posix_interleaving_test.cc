@@ -0,0 +1,593 @@
+#include "eventrouter.h"
+
+#include <ucontext.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "eventrouter/internal/os_functions.h"
+#include "gtest/gtest.h"
+
+/// These tests explore the interleavings of a few tasks sending, delivering,
+/// keeping, and returning one event, and check that the sending module sees
+/// the event come back exactly once per send. The router under test is built
+/// with `ER_INTERLEAVING_HARNESS`, so every `ER_INTERLEAVING_POINT()` in the
+/// reference-count protocol hands control to the scheduler below, which picks
+/// the task that runs next.
+///
+/// Tasks are coroutines on one thread, so schedules run under sequential
+/// consistency; weaker orderings are argued next to each atomic operation in
+/// `eventrouter_os.c` rather than tested here.
+
+namespace
+{
+
+/// Runs tasks as coroutines and enumerates their schedules depth-first. Every
+/// run replays the previous run up to its last decision with an untried
+/// alternative and takes that alternative instead. Switching away from a task
+/// that could keep running is a preemption; runs are limited to
+/// `a_preemption_bound` of them, which keeps the search small while still
+/// covering the schedules most bugs need.
+class Scheduler
+{
+   public:
+    explicit Scheduler(size_t a_preemption_bound)
+        : m_preemption_bound(a_preemption_bound)
+    {
+    }
+
+    /// Runs every schedule of `a_scripts`, where task `i` runs `a_scripts[i]`
+    /// and owns task handle and queue handle `i + 1`. `a_before` and `a_after`
+    /// are called around every run. A run ends once every task has finished or
+    /// is waiting on an empty queue.
+    void Explore(const std::vector<std::function<void()>> &a_scripts,
+                 const std::function<void()> &a_before,
+                 const std::function<void()> &a_after)
+    {
+        s_scheduler = this;
+        m_choices.clear();
+        m_num_runs = 0;
+        do
+        {
+            a_before();
+            Reset(a_scripts);
+            Run();
+            m_num_runs += 1;
+            a_after();
+        } while (NextSchedule());
+        s_scheduler = nullptr;
+    }
+
+    /// Describes the decisions made in the current run.
+    std::string Describe() const
+    {
+        std::string result = "schedule:";
+        for (const Choice &choice : m_choices)
+        {
+            result += " " + std::to_string(choice.m_taken) + "/" +
+                      std::to_string(choice.m_count);
+        }
+        return result;
+    }
+
+    size_t NumRuns() const { return m_num_runs; }
+
+    /// Lets the scheduler switch tasks; does nothing outside of a task.
+    static void Yield()
+    {
+        Scheduler *self = s_scheduler;
+        if ((self != nullptr) && (self->m_current >= 0))
+        {
+            swapcontext(&self->m_tasks[self->m_current].m_context,
+                        &self->m_context);
+        }
+    }
+
+    static ErTaskHandle_t CurrentTaskHandle()
+    {
+        return (ErTaskHandle_t)(s_scheduler->m_current + 1);
+    }
+
+    static void Push(ErQueueHandle_t a_queue, ErEvent_t *a_event)
+    {
+        s_scheduler->m_tasks[QueueIndex(a_queue)].m_queue.push_back(a_event);
+    }
+
+    /// Returns the front of `a_queue`, or NULL if it is empty.
+    static ErEvent_t *TryPop(ErQueueHandle_t a_queue)
+    {
+        std::deque<ErEvent_t *> &queue =
+            s_scheduler->m_tasks[QueueIndex(a_queue)].m_queue;
+        if (queue.empty())
+        {
+            return nullptr;
+        }
+        ErEvent_t *event = queue.front();
+        queue.pop_front();
+        return event;
+    }
+
+    /// Waits for an event to arrive in the current task's `a_queue`.
+    static ErEvent_t *Pop(ErQueueHandle_t a_queue)
+    {
+        Task &task = s_scheduler->m_tasks[QueueIndex(a_queue)];
+        while (task.m_queue.empty())
+        {
+            task.m_waiting = true;
+            Yield();
+        }
+        task.m_waiting = false;
+        return TryPop(a_queue);
+    }
+
+    /// See `ErOsFunctions_t::DisplaceEvent`.
+    static ErEvent_t *Displace(ErQueueHandle_t a_queue, ErEvent_t *a_event,
+                               ErQueueMatch_t a_match, bool a_in_place)
+    {
+        std::deque<ErEvent_t *> &queue =
+            s_scheduler->m_tasks[QueueIndex(a_queue)].m_queue;
+        for (auto it = queue.begin(); it != queue.end(); ++it)
+        {
+            ErEvent_t *displaced = *it;
+            if (a_match(displaced, a_event))
+            {
+                if (a_in_place)
+                {
+                    *it = a_event;
+                }
+                else
+                {
+                    queue.erase(it);
+                    queue.push_back(a_event);
+                }
+                return displaced;
+            }
+        }
+        return nullptr;
+    }
+
+    static size_t Depth(ErQueueHandle_t a_queue)
+    {
+        return s_scheduler->m_tasks[QueueIndex(a_queue)].m_queue.size();
+    }
+
+   private:
+    static constexpr size_t kStackSize = 64 * 1024;
+
+    struct Task
+    {
+        std::function<void()> m_script;
+        std::deque<ErEvent_t *> m_queue;
+        bool m_waiting;
+        bool m_done;
+        ucontext_t m_context;
+        std::vector<char> m_stack;
+    };
+
+    struct Choice
+    {
+        size_t m_taken;
+        size_t m_count;
+    };
+
+    static size_t QueueIndex(ErQueueHandle_t a_queue)
+    {
+        return (size_t)(uintptr_t)a_queue - 1;
+    }
+
+    static void TaskEntry(int a_task_idx)
+    {
+        Task &task = s_scheduler->m_tasks[a_task_idx];
+        task.m_script();
+        task.m_done = true;
+    }
+
+    void Reset(const std::vector<std::function<void()>> &a_scripts)
+    {
+        m_tasks.clear();
+        m_tasks.resize(a_scripts.size());
+        for (size_t idx = 0; idx < m_tasks.size(); ++idx)
+        {
+            Task &task     = m_tasks[idx];
+            task.m_script  = a_scripts[idx];
+            task.m_waiting = false;
+            task.m_done    = false;
+            task.m_stack.resize(kStackSize);
+            getcontext(&task.m_context);
+            task.m_context.uc_stack.ss_sp   = task.m_stack.data();
+            task.m_context.uc_stack.ss_size = task.m_stack.size();
+            task.m_context.uc_link          = &m_context;
+            makecontext(&task.m_context, (void (*)())TaskEntry, 1, (int)idx);
+        }
+        m_depth       = 0;
+        m_preemptions = 0;
+        m_current     = -1;
+    }
+
+    void Run()
+    {
+        for (int next = Choose(); next >= 0; next = Choose())
+        {
+            m_current = next;
+            swapcontext(&m_context, &m_tasks[next].m_context);
+        }
+        m_current = -1;
+    }
+
+    bool IsRunnable(size_t a_task_idx) const
+    {
+        const Task &task = m_tasks[a_task_idx];
+        return !task.m_done && !(task.m_waiting && task.m_queue.empty());
+    }
+
+    /// Returns the task to run next, or -1 if no task can run.
+    int Choose()
+    {
+        const bool can_continue = (m_current >= 0) && IsRunnable(m_current);
+        std::vector<int> options;
+        if (can_continue)
+        {
+            options.push_back(m_current);
+        }
+        if (!can_continue || (m_preemptions < m_preemption_bound))
+        {
+            for (size_t idx = 0; idx < m_tasks.size(); ++idx)
+            {
+                if (((int)idx != m_current) && IsRunnable(idx))
+                {
+                    options.push_back(idx);
+                }
+            }
+        }
+
+        if (options.size() <= 1)
+        {
+            return options.empty() ? -1 : options[0];
+        }
+
+        if (m_depth == m_choices.size())
+        {
+            m_choices.push_back({0, options.size()});
+        }
+        const size_t taken = m_choices[m_depth++].m_taken;
+        if (can_continue && (taken != 0))
+        {
+            m_preemptions += 1;
+        }
+        return options[taken];
+    }
+
+    /// Advances to the next untried schedule; returns false if there is none.
+    bool NextSchedule()
+    {
+        while (!m_choices.empty() &&
+               ((m_choices.back().m_taken + 1) == m_choices.back().m_count))
+        {
+            m_choices.pop_back();
+        }
+        if (m_choices.empty())
+        {
+            return false;
+        }
+        m_choices.back().m_taken += 1;
+        return true;
+    }
+
+    static Scheduler *s_scheduler;
+
+    const size_t m_preemption_bound;
+    std::vector<Task> m_tasks;
+    std::vector<Choice> m_choices;
+    size_t m_depth       = 0;
+    size_t m_preemptions = 0;
+    size_t m_num_runs    = 0;
+    int m_current        = -1;
+    ucontext_t m_context;
+};
+
+Scheduler *Scheduler::s_scheduler = nullptr;
+
+//==============================================================================
+// OS functions backed by the scheduler. Sends yield afterwards, as if the
+// receiving task had a higher priority than the sender.
+//==============================================================================
+
+void SendEvent(ErQueueHandle_t a_queue, void *a_event)
+{
+    Scheduler::Push(a_queue, (ErEvent_t *)a_event);
+    Scheduler::Yield();
+}
+
+void SendEvents(ErQueueHandle_t a_queue, ErEvent_t *const *a_events,
+                size_t a_count)
+{
+    for (size_t idx = 0; idx < a_count; ++idx)
+    {
+        Scheduler::Push(a_queue, a_events[idx]);
+    }
+    Scheduler::Yield();
+}
+
+/// The queue that `TimedSendEvent()` treats as full, or 0 for none.
+ErQueueHandle_t s_full_queue = 0;
+
+bool TimedSendEvent(ErQueueHandle_t a_queue, ErEvent_t *a_event, int64_t a_ms)
+{
+    ER_UNUSED(a_ms);
+    if (a_queue == s_full_queue)
+    {
+        return false;
+    }
+    SendEvent(a_queue, a_event);
+    return true;
+}
+
+void ReceiveEvent(ErQueueHandle_t a_queue, ErEvent_t **a_event)
+{
+    *a_event = Scheduler::Pop(a_queue);
+}
+
+void TimedReceiveEvent(ErQueueHandle_t a_queue, ErEvent_t **a_event,
+                       int64_t a_ms)
+{
+    ER_UNUSED(a_ms);
+    *a_event = Scheduler::TryPop(a_queue);
+}
+
+int64_t GetTimeUs() { return 0; }
+
+constexpr ErOsFunctions_t kOsFunctions = {
+    .SendEvent            = SendEvent,
+    .SendEvents           = SendEvents,
+    .TimedSendEvent       = TimedSendEvent,
+    .DisplaceEvent        = Scheduler::Displace,
+    .ReceiveEvent         = ReceiveEvent,
+    .TimedReceiveEvent    = TimedReceiveEvent,
+    .GetCurrentTaskHandle = Scheduler::CurrentTaskHandle,
+    .GetTimeUs            = GetTimeUs,
+    .GetQueueDepth        = Scheduler::Depth,
+};
+
+//==============================================================================
+// Modules and tasks
+//==============================================================================
+
+/// What one module saw during a run. Every module uses `CountingHandler()`.
+struct ModuleState
+{
+    int m_deliveries;  //< Events delivered to this module as a subscriber.
+    int m_returns;     //< Events returned to this module as the sender.
+    int m_in_flight_returns;  //< Returns of events still in flight.
+    bool m_keep;              //< Whether to keep delivered events.
+    std::vector<ErEvent_t *> m_kept;
+};
+
+ErEventHandlerRet_t CountingHandler(ErEvent_t *a_event, void *a_context);
+
+/// A module per task index and role; which ones subscribe depends on the test.
+struct Modules
+{
+    ModuleState m_states[4] = {};
+    ErModule_t m_modules[4] = {
+        ER_CREATE_MODULE(CountingHandler, &m_states[0]),
+        ER_CREATE_MODULE(CountingHandler, &m_states[1]),
+        ER_CREATE_MODULE(CountingHandler, &m_states[2]),
+        ER_CREATE_MODULE(CountingHandler, &m_states[3]),
+    };
+};
+
+/// Module indices. The sending module shares task 0 with a subscriber; tasks 1
+/// and 2 each own one subscriber.
+constexpr size_t kSender        = 0;
+constexpr size_t kSameTask      = 1;
+constexpr size_t kSecondTask    = 2;
+constexpr size_t kThirdTask     = 3;
+constexpr size_t kNumTasks      = 3;
+constexpr size_t kNumModules    = 4;
+constexpr size_t kSubscribers[] = {kSameTask, kSecondTask, kThirdTask};
+
+ErEventHandlerRet_t CountingHandler(ErEvent_t *a_event, void *a_context)
+{
+    ModuleState *state = static_cast<ModuleState *>(a_context);
+    if (a_event->m_sending_module->m_context == a_context)
+    {
+        state->m_returns += 1;
+        state->m_in_flight_returns += ErEventIsInFlight(a_event);
+        return ER_EVENT_HANDLER_RET__HANDLED;
+    }
+
+    state->m_deliveries += 1;
+    if (state->m_keep)
+    {
+        state->m_kept.push_back(a_event);
+        return ER_EVENT_HANDLER_RET__KEPT;
+    }
+    return ER_EVENT_HANDLER_RET__HANDLED;
+}
+
+/// Receives and handles events forever. Events kept by the task's modules are
+/// returned after a chance for other tasks to run.
+void EventLoop(ModuleState *const *a_states, size_t a_num_states)
+{
+    while (true)
+    {
+        ErCallHandlers(ErReceive());
+        for (size_t idx = 0; idx < a_num_states; ++idx)
+        {
+            while (!a_states[idx]->m_kept.empty())
+            {
+                ErEvent_t *event = a_states[idx]->m_kept.back();
+                a_states[idx]->m_kept.pop_back();
+                Scheduler::Yield();
+                ErReturnToSender(event);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+extern "C" void ErInterleavingPoint(void)
+{
+    Scheduler::Yield();
+}
+
+namespace testing
+{
+
+class ErInterleavingTest : public Test
+{
+   protected:
+    ErInterleavingTest() : m_scheduler(2) {}
+
+    /// Sets up a fresh router before each run.
+    void Before()
+    {
+        for (size_t idx = 0; idx < kNumModules; ++idx)
+        {
+            m_modules.m_states[idx]        = ModuleState{};
+            m_modules.m_states[idx].m_keep = m_keep[idx];
+        }
+
+        m_task_modules[0][0] = &m_modules.m_modules[kSender];
+        m_task_modules[0][1] = &m_modules.m_modules[kSameTask];
+        m_task_modules[1][0] = &m_modules.m_modules[kSecondTask];
+        m_task_modules[2][0] = &m_modules.m_modules[kThirdTask];
+        const size_t num_modules[kNumTasks] = {2, 1, 1};
+        for (size_t idx = 0; idx < kNumTasks; ++idx)
+        {
+            m_tasks[idx] = ErTask_t{
+                .m_task_handle = (ErTaskHandle_t)(idx + 1),
+                .m_event_queue = (ErQueueHandle_t)(uintptr_t)(idx + 1),
+                .m_modules     = m_task_modules[idx],
+                .m_num_modules = num_modules[idx],
+            };
+        }
+        m_options = ErOptions_t{
+            .m_tasks     = m_tasks,
+            .m_num_tasks = kNumTasks,
+            .m_IsInIsr   = IsInIsr,
+        };
+
+        ErInit(&m_options);
+        ErSetOsFunctions(&kOsFunctions);
+        for (size_t module : kSubscribers)
+        {
+            ErSubscribe(&m_modules.m_modules[module], ER_EVENT_TYPE__1);
+        }
+        ErEventInit(&m_event, ER_EVENT_TYPE__1, &m_modules.m_modules[kSender]);
+        m_idle_sends = 0;
+        m_sends      = 0;
+    }
+
+    /// Checks that every send was delivered once to every subscriber whose
+    /// queue had room and that the event came back once per send that found
+    /// it idle.
+    void After()
+    {
+        const ModuleState &sender = m_modules.m_states[kSender];
+        EXPECT_FALSE(ErEventIsInFlight(&m_event)) << m_scheduler.Describe();
+        EXPECT_EQ(sender.m_returns, m_idle_sends) << m_scheduler.Describe();
+        EXPECT_EQ(sender.m_in_flight_returns, 0) << m_scheduler.Describe();
+        for (size_t module : kSubscribers)
+        {
+            const size_t task_idx = m_modules.m_modules[module].m_task_idx;
+            const bool queue_full =
+                (m_tasks[task_idx].m_event_queue == s_full_queue);
+            EXPECT_EQ(m_modules.m_states[module].m_deliveries,
+                      queue_full ? 0 : m_sends)
+                << "module " << module << ", " << m_scheduler.Describe();
+        }
+        ErDeinit();
+    }
+
+    /// Sends (or re-sends) the event from the sending module's task.
+    void Send(ErSendExOptions_t a_options)
+    {
+        // Only the sending task takes the reference count to zero, so this
+        // check cannot race with the send below.
+        m_idle_sends += !ErEventIsInFlight(&m_event);
+        m_sends += 1;
+        ErSendEx(&m_event, a_options);
+    }
+
+    /// Runs every schedule where the sending task runs `a_send_script` before
+    /// handling events.
+    void Explore(std::function<void()> a_send_script)
+    {
+        ModuleState *first[]  = {&m_modules.m_states[kSender],
+                                 &m_modules.m_states[kSameTask]};
+        ModuleState *second[] = {&m_modules.m_states[kSecondTask]};
+        ModuleState *third[]  = {&m_modules.m_states[kThirdTask]};
+        m_scheduler.Explore(
+            {
+                [&]() {
+                    a_send_script();
+                    EventLoop(first, 2);
+                },
+                [&]() { EventLoop(second, 1); },
+                [&]() { EventLoop(third, 1); },
+            },
+            [this]() { Before(); }, [this]() { After(); });
+    }
+
+    static bool IsInIsr() { return false; }
+
+    ~ErInterleavingTest() { s_full_queue = 0; }
+
+    Scheduler m_scheduler;
+    bool m_keep[kNumModules] = {};
+    Modules m_modules;
+    ErModule_t *m_task_modules[kNumTasks][2] = {};
+    ErTask_t m_tasks[kNumTasks];
+    ErOptions_t m_options;
+    ErEvent_t m_event;
+    int m_idle_sends;
+    int m_sends;
+};
+
+TEST_F(ErInterleavingTest, SendReturnsOnce)
+{
+    Explore([this]() { Send({.m_allow_resending = false}); });
+    EXPECT_GT(m_scheduler.NumRuns(), 1);
+}
+
+TEST_F(ErInterleavingTest, ResendReturnsOncePerIdleSend)
+{
+    Explore(
+        [this]()
+        {
+            Send({.m_allow_resending = true});
+            Scheduler::Yield();
+            Send({.m_allow_resending = true});
+        });
+    EXPECT_GT(m_scheduler.NumRuns(), 1);
+}
+
+TEST_F(ErInterleavingTest, TrySendReturnsOnceDespiteFullQueues)
+{
+    // The other tasks may finish with the event before `ErTrySend()` drops
+    // the reference held for the sending task, which leaves the return trip
+    // to `ErTrySend()`. The return trip itself does not need room.
+    s_full_queue = (ErQueueHandle_t)(uintptr_t)1;
+    Explore(
+        [this]()
+        {
+            m_idle_sends += 1;
+            m_sends += 1;
+            EXPECT_EQ(ErTrySend(&m_event), 1u << 0);
+        });
+    EXPECT_GT(m_scheduler.NumRuns(), 1);
+}
+
+TEST_F(ErInterleavingTest, KeptEventsReturnOnce)
+{
+    m_keep[kSameTask]   = true;
+    m_keep[kSecondTask] = true;
+    Explore([this]() { Send({.m_allow_resending = false}); });
+    EXPECT_GT(m_scheduler.NumRuns(), 1);
+}
+
+}  // namespace testing
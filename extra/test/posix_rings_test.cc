@@ -0,0 +1,198 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "eventrouter.h"
+#include "gtest/gtest.h"
+
+/// These tests run against a library built with `ER_PRODUCER_RINGS` set to 2.
+/// Threads get rings in the order they first write to a queue and give them
+/// back when they exit, and each test runs in a process of its own, so the
+/// first two writers alive at once in a test have their own rings and any
+/// others share one.
+
+namespace testing
+{
+
+TEST(ErPosixRings, ReaderTakesTurnsBetweenProducers)
+{
+    ErEvent_t a[4]       = {};
+    ErEvent_t b[2]       = {};
+    ErEvent_t c[1]       = {};
+    ErEvent_t *b_list[2] = {&b[0], &b[1]};
+    ErQueue_t queue      = ErQueueNew(8);
+
+    for (ErEvent_t &event : a)
+    {
+        ErQueuePushBack(queue, &event);
+    }
+
+    // The writer of `b` keeps its ring while `c` is written, so `c` shares.
+    std::atomic_bool b_written{false};
+    std::atomic_bool c_written{false};
+    std::thread b_writer(
+        [&]()
+        {
+            ErQueuePushBackMany(queue, b_list, 2);
+            b_written = true;
+            while (!c_written)
+            {
+                std::this_thread::yield();
+            }
+        });
+    while (!b_written)
+    {
+        std::this_thread::yield();
+    }
+    std::thread([&]() { ErQueuePushBack(queue, &c[0]); }).join();
+    c_written = true;
+    b_writer.join();
+
+    for (ErEvent_t *expected :
+         {&a[0], &b[0], &c[0], &a[1], &b[1], &a[2], &a[3]})
+    {
+        EXPECT_EQ(ErQueuePopFront(queue), expected);
+    }
+    EXPECT_EQ(ErQueueSize(queue), 0);
+    ErQueueFree(queue);
+}
+
+TEST(ErPosixRings, FullRingDoesNotBlockOtherProducers)
+{
+    ErEvent_t events[3] = {};
+    ErQueue_t queue     = ErQueueNew(1);
+
+    ErQueuePushBack(queue, &events[0]);
+    EXPECT_FALSE(ErQueueTimedPushBack(queue, &events[1], 0));
+    std::thread([&]()
+                { EXPECT_TRUE(ErQueueTimedPushBack(queue, &events[2], 0)); })
+        .join();
+
+    EXPECT_EQ(ErQueueSize(queue), 2);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[0]);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[2]);
+    ErQueueFree(queue);
+}
+
+TEST(ErPosixRings, ExitedProducersHandTheirRingsOn)
+{
+    ErEvent_t events[4] = {};
+    ErQueue_t queue     = ErQueueNew(1);
+
+    // Writes `a_events` from two threads that are alive at once. Unless both
+    // get a ring of their own, they share one, which only holds one event.
+    const auto write_at_once = [&](ErEvent_t *a_events)
+    {
+        std::atomic_int written{0};
+        std::thread writers[2];
+        for (int idx = 0; idx < 2; ++idx)
+        {
+            writers[idx] = std::thread(
+                [&, idx]()
+                {
+                    EXPECT_TRUE(
+                        ErQueueTimedPushBack(queue, &a_events[idx], 0));
+                    written++;
+                    while (written < 2)
+                    {
+                        std::this_thread::yield();
+                    }
+                });
+        }
+        for (auto &writer : writers)
+        {
+            writer.join();
+        }
+        EXPECT_EQ(ErQueueSize(queue), 2);
+        ErEvent_t *event = nullptr;
+        while (ErQueueTimedPopFront(queue, &event, 0))
+        {
+        }
+    };
+
+    write_at_once(&events[0]);
+    write_at_once(&events[2]);
+    ErQueueFree(queue);
+}
+
+TEST(ErPosixRings, HigherLanesAreReadFirst)
+{
+    ErEvent_t events[2] = {};
+    events[1].m_lane    = 1;
+    ErQueue_t queue     = ErQueueNew(2);
+
+    ErQueuePushBack(queue, &events[0]);
+    std::thread([&]() { ErQueuePushBack(queue, &events[1]); }).join();
+
+    EXPECT_EQ(ErQueuePopFront(queue), &events[1]);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[0]);
+    ErQueueFree(queue);
+}
+
+TEST(ErPosixRings, DisplacedEventsAreAlwaysReplacedInPlace)
+{
+    ErEvent_t events[4] = {};
+    ErQueue_t queue     = ErQueueNew(3);
+    for (size_t idx = 0; idx < 3; ++idx)
+    {
+        events[idx].m_type = ER_EVENT_TYPE__1;
+        ErQueuePushBack(queue, &events[idx]);
+    }
+    events[1].m_type = ER_EVENT_TYPE__2;
+    events[3].m_type = ER_EVENT_TYPE__2;
+
+    const ErQueueMatch_t same_type = [](const ErEvent_t *a_queued,
+                                        const ErEvent_t *a_event)
+    { return a_queued->m_type == a_event->m_type; };
+
+    EXPECT_EQ(ErQueueDisplace(queue, &events[3], same_type, false),
+              &events[1]);
+    EXPECT_EQ(ErQueueSize(queue), 3);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[0]);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[3]);
+    EXPECT_EQ(ErQueuePopFront(queue), &events[2]);
+    ErQueueFree(queue);
+}
+
+TEST(ErPosixRings, EveryProducerKeepsItsOrderUnderLoad)
+{
+    constexpr int kProducers  = 4;  // Two with rings of their own, two sharing.
+    constexpr int kIterations = 20000;
+
+    // Small rings keep both the reader and the writers going to sleep.
+    static ErEvent_t s_events[kProducers][kIterations] = {};
+    ErQueue_t queue = ErQueueNew(4);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p)
+    {
+        producers.emplace_back(
+            [&, p]()
+            {
+                for (int i = 0; i < kIterations; ++i)
+                {
+                    ErQueuePushBack(queue, &s_events[p][i]);
+                }
+            });
+    }
+
+    int next[kProducers] = {};
+    for (int received = 0; received < kProducers * kIterations; ++received)
+    {
+        ErEvent_t *event = nullptr;
+        ASSERT_TRUE(ErQueueTimedPopFront(queue, &event, 5000));
+        const int p = (event - &s_events[0][0]) / kIterations;
+        const int i = (event - &s_events[0][0]) % kIterations;
+        ASSERT_EQ(i, next[p]);
+        next[p] += 1;
+    }
+    for (auto &producer : producers)
+    {
+        producer.join();
+    }
+
+    EXPECT_EQ(ErQueueSize(queue), 0);
+    ErQueueFree(queue);
+}
+
+}  // namespace testing